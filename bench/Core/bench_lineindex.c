@@ -0,0 +1,146 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * line index benchmark: jump to random lines (like ":N") and map
+ * random offsets to lines, between random edits, using the line index
+ * of memcache, and compare it with rescanning the text for newlines.
+ *
+ * usage: bench_lineindex [file-size-in-MiB] [query-count]
+ */
+
+
+#include <stdio.h>
+#include <Core/memcache.h>
+#include "../bench.h"
+
+
+/* find the offset of a line by scanning the text from the beginning. */
+static size_t rescan_line_offset(struct memcache *mc, size_t lnum)
+{
+    size_t offset = 0, len;
+    char const *chunk, *nl;
+
+    if (lnum == 0)
+        return 0;
+
+    while ((chunk = mc_chunk(mc, offset, &len)) != NULL)
+    {
+        while ((nl = memchr(chunk, '\n', len)) != NULL)
+        {
+            len -= nl + 1 - chunk;
+            offset += nl + 1 - chunk;
+            chunk = nl + 1;
+            if (--lnum == 0)
+                return offset;
+        }
+        offset += len;
+    }
+
+    return MC_NPOS;
+}
+
+
+/* find the line of a offset by scanning the text from the beginning. */
+static size_t rescan_offset_line(struct memcache *mc, size_t offset)
+{
+    size_t pos = 0, len, lnum = 0;
+    char const *chunk, *nl, *end;
+
+    while (pos < offset && (chunk = mc_chunk(mc, pos, &len)) != NULL)
+    {
+        if (len > offset - pos)
+            len = offset - pos;
+        end = chunk + len;
+        for (nl = chunk; (nl = memchr(nl, '\n', end - nl)) != NULL; ++nl)
+            ++lnum;
+        pos += len;
+    }
+
+    return lnum;
+}
+
+
+/* run queries between random edits, return the elapsed time. */
+static double run(struct memcache *mc, size_t queries, int rescan)
+{
+    size_t i, lines, off, sum = 0;
+    double start = bench_now();
+
+    for (i = 0; i < queries; ++i)
+    {
+        uint64_t r = bench_rand();
+
+        off = (size_t)(r >> 16) % (mc_size(mc) + 1);
+        mc_insert(mc, off, "edit\n", 5);
+
+        lines = mc_line_count(mc);
+        off = (size_t)(r >> 8) % (mc_size(mc) + 1);
+        if (rescan)
+            sum += rescan_line_offset(mc, (size_t)r % lines)
+                + rescan_offset_line(mc, off);
+        else
+            sum += mc_line_offset(mc, (size_t)r % lines)
+                + mc_offset_line(mc, off);
+    }
+
+    /* keep the compiler from removing the queries. */
+    if (sum == 0)
+        printf("(no result)\n");
+    return bench_now() - start;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 256) << 20;
+    size_t queries = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    size_t rescans = queries / 10000 + 1;
+    size_t lnum, check;
+    struct memcache mc;
+    char *text;
+    double start, elapsed, rescan;
+
+    if ((text = malloc(size)) == NULL)
+    {
+        fprintf(stderr, "can't allocate %lu MiB\n",
+                (unsigned long)(size >> 20));
+        return 1;
+    }
+    bench_fill_text(text, size, 80);
+
+    start = bench_now();
+    mc_init(&mc);
+    if (mc_load(&mc, text, size) == FAIL)
+        return 1;
+    elapsed = bench_now() - start;
+    printf("load %lu MiB (%lu lines): %.3f ms\n",
+            (unsigned long)(size >> 20),
+            (unsigned long)mc_line_count(&mc), elapsed * 1e3);
+
+    /* make sure both ways agree before timing them. */
+    lnum = mc_line_count(&mc) / 2;
+    check = mc_line_offset(&mc, lnum);
+    if (check != rescan_line_offset(&mc, lnum)
+            || mc_offset_line(&mc, check) != lnum
+            || rescan_offset_line(&mc, check) != lnum)
+    {
+        fprintf(stderr, "line index mismatch\n");
+        return 1;
+    }
+
+    elapsed = run(&mc, queries, 0);
+    printf("line index: %lu edit+jump+lookup: %.3f s, %.2f us/query\n",
+            (unsigned long)queries, elapsed, elapsed * 1e6 / queries);
+
+    rescan = run(&mc, rescans, 1);
+    printf("full rescan: %lu edit+jump+lookup: %.3f s, %.2f us/query\n",
+            (unsigned long)rescans, rescan, rescan * 1e6 / rescans);
+    printf("speedup: %.0fx\n", (rescan / rescans) / (elapsed / queries));
+
+    mc_drop(&mc);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * loader benchmark: open a large file and measure the time to the
+ * first screen (the first 50 lines are in memcache) and to the whole
+ * file loaded. the file is read into memcache before showing it, or
+ * loaded by the loader thread while the main loop polls it every
+ * millisecond, as vime_step() does between keys. the longest poll is
+ * the longest time input is blocked. the file is in the page cache,
+ * so the disk is not measured.
+ *
+ * usage: bench_loader [megabytes] [file]
+ */
+
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <Core/loader.h>
+#include "../bench.h"
+
+
+#define SCREEN_LINES 50
+
+
+/* feed the file through a pipe by a child process. */
+static int open_pipe(char const *name, pid_t *pid)
+{
+    struct stream in;
+    char const *window;
+    size_t len;
+    int fds[2];
+
+    if (pipe(fds) != 0 || (*pid = fork()) < 0)
+        return -1;
+
+    if (*pid == 0)
+    {
+        close(fds[0]);
+        if (stream_open(&in, name, STREAM_READ) == FAIL)
+            _exit(1);
+        while ((window = stream_borrow(&in, 1, &len)) != NULL)
+        {
+            ssize_t n = write(fds[1], window, len);
+
+            if (n <= 0)
+                _exit(1);
+            stream_release(&in, (size_t)n);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    return fds[0];
+}
+
+
+/* read the whole file into memcache, then show it. */
+static void read_all(char const *name)
+{
+    struct memcache mc;
+    struct stream s;
+    char const *window;
+    size_t len;
+    double start = bench_now(), t;
+
+    mc_init(&mc);
+    stream_fdopen(&s, open(name, O_RDONLY), STREAM_READ);
+    while ((window = stream_borrow(&s, 1, &len)) != NULL)
+    {
+        mc_insert(&mc, mc_size(&mc), window, len);
+        stream_release(&s, len);
+    }
+    stream_close(&s);
+    mc_line_count(&mc);
+    t = bench_now() - start;
+
+    printf("%-24s first screen %8.1f ms, loaded %8.1f ms\n",
+            "read, then show", t * 1e3, t * 1e3);
+    mc_drop(&mc);
+}
+
+
+/* poll the loader as the main loop, until all text is loaded. */
+static void poll(char const *what, struct loader *ld, struct memcache *mc,
+        double start)
+{
+    struct timespec step = { 0, 1000000 };
+    double first = 0, now, t, longest = 0;
+    size_t polls = 0;
+
+    for (;;)
+    {
+        t = bench_now();
+        if (ld_poll(ld) != LD_BUSY)
+            break;
+        now = bench_now();
+        if (now - t > longest)
+            longest = now - t;
+        ++polls;
+
+        if (first == 0 && mc_line_count(mc) > SCREEN_LINES)
+            first = now;
+        nanosleep(&step, NULL);
+    }
+    now = bench_now();
+    if (first == 0)
+        first = now;
+
+    printf("%-24s first screen %8.1f ms, loaded %8.1f ms, "
+            "%lu polls, longest %.2f ms, %lu lines\n",
+            what, (first - start) * 1e3, (now - start) * 1e3,
+            (unsigned long)polls, longest * 1e3,
+            (unsigned long)mc_line_count(mc));
+    ld_close(ld);
+    mc_drop(mc);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 1024) << 20;
+    char const *name = argc > 2 ? argv[2] : "bench_loader.tmp";
+    struct memcache mc;
+    struct loader ld;
+    size_t i, n;
+    double start;
+    pid_t pid = 0;
+    char *text;
+    FILE *fp;
+
+    if ((text = malloc(1 << 20)) == NULL
+            || (fp = fopen(name, "wb")) == NULL)
+    {
+        fprintf(stderr, "can't create %s\n", name);
+        return 1;
+    }
+    for (i = 0; i < size; i += n)
+    {
+        n = size - i < (1 << 20) ? size - i : (1 << 20);
+        bench_fill_text(text, n, 80);
+        fwrite(text, 1, n, fp);
+    }
+    fclose(fp);
+    free(text);
+    printf("%lu MiB\n", (unsigned long)(size >> 20));
+
+    read_all(name);
+
+    start = bench_now();
+    mc_init(&mc);
+    if (ld_open(&ld, &mc, name) == FAIL)
+        return 1;
+    poll("loader, mapped file", &ld, &mc, start);
+
+    start = bench_now();
+    mc_init(&mc);
+    if (ld_fdopen(&ld, &mc, open_pipe(name, &pid)) == FAIL)
+        return 1;
+    poll("loader, pipe", &ld, &mc, start);
+    waitpid(pid, NULL, 0);
+
+    if (argc <= 2)
+        remove(name);
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * mappings benchmark: put n mappings into a mode, most of them start
+ * with a leader key like the mappings of plugins, then replay a long
+ * normal mode session. every keystroke is matched with a #map_match,
+ * with a binary search of the keys pending in the sorted lhs (like a
+ * lookup of the sbtree of mode), and with a scan of all lhs.
+ *
+ * usage: bench_mappings [mapping-count] [keystrokes]
+ */
+
+
+#include <stdio.h>
+#include <Core/mappings.h>
+#include "../bench.h"
+
+
+#define LHS_MAX 8
+
+
+static struct map_trie trie;
+static char **sorted;
+static size_t count;
+
+
+static int compare_lhs(void const *lhs, void const *rhs)
+{
+    return strcmp(*(char * const *)lhs, *(char * const *)rhs);
+}
+
+
+/* match the keys pending with the sorted lhs. */
+static int search_match(char const *keys, size_t len)
+{
+    size_t low = 0, high = count, mid;
+    int full;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        if (strncmp(sorted[mid], keys, len) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == count || strncmp(sorted[low], keys, len) != 0)
+        return MAP_NONE;
+    full = sorted[low][len] == '\0';
+    if (full && (low + 1 == count
+                || strncmp(sorted[low + 1], keys, len) != 0))
+        return MAP_FULL;
+    return full ? MAP_AMBIGUOUS : MAP_PREFIX;
+}
+
+
+/* match the keys pending with all lhs. */
+static int scan_match(char const *keys, size_t len)
+{
+    size_t i;
+    int full = FALSE, prefix = FALSE;
+
+    for (i = 0; i < count; ++i)
+        if (strncmp(sorted[i], keys, len) == 0)
+        {
+            if (sorted[i][len] == '\0')
+                full = TRUE;
+            else
+                prefix = TRUE;
+        }
+    return !full ? prefix ? MAP_PREFIX : MAP_NONE
+        : prefix ? MAP_AMBIGUOUS : MAP_FULL;
+}
+
+
+/* replay the keys, return the sum of results. */
+static size_t replay(int kind, char const *keys, size_t nkeys)
+{
+    struct map_match match;
+    char pending[LHS_MAX + 1];
+    size_t i, len = 0, sum = 0;
+    int r;
+
+    map_match_init(&match, &trie);
+    for (i = 0; i < nkeys; ++i)
+    {
+        pending[len++] = keys[i];
+        r = kind == 0 ? map_match_feed(&match, keys[i])
+            : kind == 1 ? search_match(pending, len)
+            : scan_match(pending, len);
+        sum += r;
+        if (r == MAP_NONE || r == MAP_FULL)
+        {
+            len = 0;
+            map_match_init(&match, &trie);
+        }
+    }
+    return sum;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t nkeys = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000;
+    size_t i, j, len, sum[3], scan_keys;
+    struct mapping_key *maps;
+    char *lhs, *keys;
+    double start, t[3];
+    int k;
+
+    count = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000;
+    scan_keys = nkeys / 100;
+    maps = malloc(count * sizeof(struct mapping_key));
+    lhs = malloc(count * (LHS_MAX + 1));
+    sorted = malloc(count * sizeof(char *));
+    keys = malloc(nkeys);
+    if (maps == NULL || lhs == NULL || sorted == NULL || keys == NULL)
+        return 1;
+
+    /* ",x", "\\xy", ... and a few single keys. */
+    map_trie_init(&trie);
+    for (i = j = 0; i < count; ++i)
+    {
+        char *p = lhs + j * (LHS_MAX + 1);
+
+        len = i % 50 == 0 ? 1 : 2 + bench_rand() % (LHS_MAX - 2);
+        p[0] = len == 1 ? (char)('A' + bench_rand() % 26) : ",\\"[i % 2];
+        for (k = 1; k < (int)len; ++k)
+            p[k] = 'a' + bench_rand() % 26;
+        p[len] = '\0';
+        maps[j].key = p;
+        if (map_trie_add(&trie, &maps[j]) == OK)
+            sorted[j++] = p;
+    }
+    count = j;
+    qsort(sorted, count, sizeof(char *), compare_lhs);
+
+    /* moving and editing, with a mapping now and then. */
+    for (i = 0; i < nkeys; ++i)
+    {
+        k = (int)(bench_rand() % 40);
+        keys[i] = k == 0 ? ',' : k == 1 ? '\\' : k < 4 ? 'A' + k
+            : "hjklwbexdcpuiaoy"[k % 16];
+    }
+
+    printf("%lu mappings, per keystroke:\n", (unsigned long)count);
+    for (k = 0; k < 3; ++k)
+    {
+        start = bench_now();
+        sum[k] = replay(k, keys, k == 2 ? scan_keys : nkeys);
+        t[k] = (bench_now() - start) * 1e9 / (k == 2 ? scan_keys : nkeys);
+    }
+    if (sum[0] != sum[1] || replay(0, keys, scan_keys) != sum[2])
+    {
+        printf("match mismatch\n");
+        return 1;
+    }
+    printf("%-14s %10.2f ns\n", "trie", t[0]);
+    printf("%-14s %10.2f ns\n", "binary search", t[1]);
+    printf("%-14s %10.2f ns\n", "scan", t[2]);
+
+    map_trie_drop(&trie);
+    free(keys);
+    free(sorted);
+    free(lhs);
+    free(maps);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * marks benchmark: put n marks into a buffer of 1M lines, then paste
+ * 100k lines at once, and paste lines one by one near the top of the
+ * buffer, so all marks are moved by every paste. the marks of
+ * memcache are compared with a plain array of offsets adjusted one by
+ * one after every edit, like mark_adjust() of Vim.
+ *
+ * usage: bench_marks [mark-count] [line-pastes]
+ */
+
+
+#include <stdio.h>
+#include <Core/memcache.h>
+#include "../bench.h"
+
+
+#define LINES 1000000
+#define LINE_LEN 80
+#define PASTE_LINES 100000
+
+
+/* move the offsets after a insert, one by one. */
+static void array_adjust(size_t *offs, size_t count, size_t pos, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < count; ++i)
+        if (offs[i] >= pos)
+            offs[i] += len;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    size_t pastes = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000;
+    size_t size = (size_t)LINES * LINE_LEN, i, pos = 0;
+    char *text = malloc(size), *paste = malloc(PASTE_LINES * LINE_LEN);
+    struct mc_mark *marks = malloc(count * sizeof(struct mc_mark));
+    size_t *offs = malloc(count * sizeof(size_t));
+    size_t *poss = malloc(pastes * sizeof(size_t));
+    struct memcache mc;
+    double start, t[3];
+    int with_marks;
+
+    if (text == NULL || paste == NULL || marks == NULL || offs == NULL
+            || poss == NULL || count == 0)
+        return 1;
+    for (i = 0; i < size; ++i)
+        text[i] = i % LINE_LEN == LINE_LEN - 1 ? '\n' : 'a' + i % 26;
+    memcpy(paste, text, PASTE_LINES * LINE_LEN);
+
+    printf("%lu marks in %d lines:\n", (unsigned long)count, LINES);
+    printf("%-24s %12s %12s %12s\n", "", "no marks", "memcache",
+            "array");
+
+    /* paste 100k lines at once, the first pass warms the allocator. */
+    for (with_marks = -1; with_marks < 2; ++with_marks)
+    {
+        mc_init(&mc);
+        if (mc_load(&mc, text, size) == FAIL)
+            return 1;
+        for (i = 0; with_marks > 0 && i < count; ++i)
+            mc_mark_add(&mc, &marks[i], offs[i] = size / count * i);
+
+        start = bench_now();
+        if (mc_insert(&mc, LINE_LEN * 10, paste, PASTE_LINES * LINE_LEN)
+                == FAIL)
+            return 1;
+        if (with_marks >= 0)
+            t[with_marks] = bench_now() - start;
+        if (with_marks > 0 && mc_mark_offset(&marks[count - 1])
+                != offs[count - 1] + PASTE_LINES * LINE_LEN)
+        {
+            printf("marks mismatch\n");
+            return 1;
+        }
+        mc_drop(&mc);
+    }
+    start = bench_now();
+    array_adjust(offs, count, LINE_LEN * 10, PASTE_LINES * LINE_LEN);
+    t[2] = bench_now() - start + t[0];
+    printf("%-24s %9.3f ms %9.3f ms %9.3f ms\n", "paste 100k lines",
+            t[0] * 1e3, t[1] * 1e3, t[2] * 1e3);
+
+    /* paste lines one by one, at the same positions. */
+    for (i = 0; i < pastes; ++i)
+        poss[i] = LINE_LEN * (10 + bench_rand() % 100);
+    for (with_marks = 0; with_marks < 2; ++with_marks)
+    {
+        mc_init(&mc);
+        if (mc_load(&mc, text, size) == FAIL)
+            return 1;
+        for (i = 0; with_marks && i < count; ++i)
+            mc_mark_add(&mc, &marks[i], offs[i] = size / count * i);
+
+        start = bench_now();
+        for (i = 0; i < pastes; ++i)
+            if (mc_insert(&mc, poss[i], paste, LINE_LEN) == FAIL)
+                return 1;
+        t[with_marks] = bench_now() - start;
+        if (with_marks)
+            pos = mc_mark_offset(&marks[count / 2]);
+        mc_drop(&mc);
+    }
+    start = bench_now();
+    for (i = 0; i < pastes; ++i)
+        array_adjust(offs, count, poss[i], LINE_LEN);
+    t[2] = bench_now() - start + t[0];
+    if (pos != offs[count / 2])
+    {
+        printf("marks mismatch\n");
+        return 1;
+    }
+    printf("%-24s %9.3f ms %9.3f ms %9.3f ms\n", "paste lines one by one",
+            t[0] * 1e3, t[1] * 1e3, t[2] * 1e3);
+
+    free(poss);
+    free(offs);
+    free(marks);
+    free(paste);
+    free(text);
+    return 0;
+}
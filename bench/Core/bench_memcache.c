@@ -0,0 +1,82 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * memcache benchmark: replay random edits over a large synthetic file.
+ *
+ * usage: bench_memcache [file-size-in-MiB] [edit-count]
+ */
+
+
+#include <stdio.h>
+#include <Core/memcache.h>
+#include "../bench.h"
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 1024) << 20;
+    size_t edits = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+    size_t i, off, len, rss_before;
+    struct memcache mc;
+    char *text, typed[32], readbuf[4096];
+    double start, elapsed;
+
+    if ((text = malloc(size)) == NULL)
+    {
+        fprintf(stderr, "can't allocate %lu MiB\n",
+                (unsigned long)(size >> 20));
+        return 1;
+    }
+    bench_fill_text(text, size, 80);
+    memset(typed, 'x', sizeof(typed));
+
+    rss_before = bench_rss_kb();
+    start = bench_now();
+    mc_init(&mc);
+    if (mc_load(&mc, text, size) == FAIL)
+        return 1;
+    elapsed = bench_now() - start;
+    printf("load %lu MiB: %.3f ms, %lu pieces\n",
+            (unsigned long)(size >> 20), elapsed * 1e3,
+            (unsigned long)mc.root->size);
+
+    start = bench_now();
+    for (i = 0; i < edits; ++i)
+    {
+        uint64_t r = bench_rand();
+
+        off = (size_t)(r >> 16) % (mc_size(&mc) + 1);
+        len = 1 + (size_t)(r & 0xF);
+
+        switch (r % 4)
+        {
+        case 0: /* typing at a new place */
+        case 1:
+            mc_insert(&mc, off, typed, len);
+            break;
+        case 2:
+            if (len > mc_size(&mc) - off)
+                len = mc_size(&mc) - off;
+            mc_delete(&mc, off, len);
+            break;
+        default:
+            mc_read(&mc, off, readbuf, sizeof(readbuf));
+            break;
+        }
+    }
+    elapsed = bench_now() - start;
+
+    printf("%lu random edits: %.3f s, %.0f edits/sec\n",
+            (unsigned long)edits, elapsed, edits / elapsed);
+    printf("pieces: %lu, memcache overhead: %lu KiB resident\n",
+            (unsigned long)mc.root->size,
+            (unsigned long)(bench_rss_kb() - rss_before));
+    printf("resident memory: %lu KiB\n", (unsigned long)bench_rss_kb());
+
+    mc_drop(&mc);
+    free(text);
+    return 0;
+}
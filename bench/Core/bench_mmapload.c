@@ -0,0 +1,149 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * file loading benchmark: open a large file by mapping it into
+ * memcache, and compare the startup latency and the resident memory
+ * with reading the whole file into the heap.
+ *
+ * usage: bench_mmapload [file-size-in-MiB] [file]
+ *
+ * if file is not given, a synthetic file is written to
+ * bench_mmapload.txt and removed at the end.
+ */
+
+
+#include <stdio.h>
+#include <Core/memcache.h>
+#include "../bench.h"
+
+
+#define BENCH_FILE "bench_mmapload.txt"
+
+
+/* write a synthetic text file. */
+static int write_file(char const *name, size_t size)
+{
+    static char chunk[1 << 20];
+    FILE *fp = fopen(name, "wb");
+    size_t n;
+
+    if (fp == NULL)
+        return FAIL;
+
+    bench_fill_text(chunk, sizeof(chunk), 80);
+    for (; size != 0; size -= n)
+    {
+        n = size < sizeof(chunk) ? size : sizeof(chunk);
+        if (fwrite(chunk, 1, n, fp) != n)
+        {
+            fclose(fp);
+            return FAIL;
+        }
+    }
+
+    return fclose(fp) == 0 ? OK : FAIL;
+}
+
+
+/* show the first screen, edit and jump around like a user. */
+static void edit(struct memcache *mc, char const *how, double start,
+        size_t rss_before)
+{
+    char screen[50 * 80];
+    size_t lnum, off;
+    double elapsed;
+
+    off = mc_line_offset(mc, 50);
+    if (off > sizeof(screen))
+        off = sizeof(screen);
+    mc_read(mc, 0, screen, off);
+    elapsed = bench_now() - start;
+    printf("%s: first screen after %.3f ms, %lu KiB resident\n",
+            how, elapsed * 1e3,
+            (unsigned long)(bench_rss_kb() - rss_before));
+
+    start = bench_now();
+    mc_insert(mc, mc_size(mc) / 2, "inserted text", 13);
+    elapsed = bench_now() - start;
+    printf("%s: edit at the middle: %.3f ms, %lu KiB resident\n",
+            how, elapsed * 1e3,
+            (unsigned long)(bench_rss_kb() - rss_before));
+
+    start = bench_now();
+    lnum = mc_offset_line(mc, mc_size(mc) / 2);
+    off = mc_line_offset(mc, lnum);
+    elapsed = bench_now() - start;
+    printf("%s: jump to the middle line %lu: %.3f ms, %lu KiB resident\n",
+            how, (unsigned long)lnum, elapsed * 1e3,
+            (unsigned long)(bench_rss_kb() - rss_before));
+
+    start = bench_now();
+    lnum = mc_line_count(mc);
+    elapsed = bench_now() - start;
+    printf("%s: count all %lu lines: %.3f ms, %lu KiB resident\n",
+            how, (unsigned long)lnum, elapsed * 1e3,
+            (unsigned long)(bench_rss_kb() - rss_before));
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 1024) << 20;
+    char const *name = argc > 2 ? argv[2] : BENCH_FILE;
+    size_t rss_before, n;
+    struct memcache mc;
+    double start;
+    char *text;
+    FILE *fp;
+
+    if (argc <= 2 && write_file(name, size) == FAIL)
+    {
+        fprintf(stderr, "can't write %s\n", name);
+        return 1;
+    }
+
+    /* mapped: the file is never copied into the heap. */
+    rss_before = bench_rss_kb();
+    start = bench_now();
+    mc_init(&mc);
+    if (mc_open(&mc, name) == FAIL)
+    {
+        fprintf(stderr, "can't map %s\n", name);
+        return 1;
+    }
+    size = mc_size(&mc);
+    printf("mapped: open %lu MiB: %.3f ms, %lu pieces, %lu KiB resident\n",
+            (unsigned long)(size >> 20), (bench_now() - start) * 1e3,
+            (unsigned long)mc.root->size,
+            (unsigned long)(bench_rss_kb() - rss_before));
+    edit(&mc, "mapped", start, rss_before);
+    mc_drop(&mc);
+
+    /* heap: read the whole file before the first screen. */
+    rss_before = bench_rss_kb();
+    start = bench_now();
+    if ((text = malloc(size == 0 ? 1 : size)) == NULL
+            || (fp = fopen(name, "rb")) == NULL)
+    {
+        fprintf(stderr, "can't read %s into the heap\n", name);
+        return 1;
+    }
+    n = fread(text, 1, size, fp);
+    fclose(fp);
+    mc_init(&mc);
+    if (mc_load(&mc, text, n) == FAIL)
+        return 1;
+    printf("heap: read %lu MiB: %.3f ms, %lu KiB resident\n",
+            (unsigned long)(n >> 20), (bench_now() - start) * 1e3,
+            (unsigned long)(bench_rss_kb() - rss_before));
+    edit(&mc, "heap", start, rss_before);
+    mc_drop(&mc);
+    free(text);
+
+    if (argc <= 2)
+        remove(name);
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * operator dispatch benchmark: replay a long insert session, every
+ * keystroke is executed by op_exec(). a table with the byte commands
+ * (found in the flat array) is compared with a table with the same
+ * operators moved above OP_FAST_MAX, so they are found in the
+ * hashtable like before the flat array.
+ *
+ * usage: bench_opexec [keystrokes]
+ */
+
+
+#include <stdio.h>
+#include <Core/operator.h>
+#include "../bench.h"
+
+
+/* the operators for every byte, and the default operator. */
+static struct op_entry ops[2][256];
+static struct hook_entry actions[256], def;
+static struct list_entry lists[256], def_list;
+static char names[2][256][8];
+
+/* the text inserted. */
+static size_t inserted;
+
+
+static int do_insert(struct hook_entry *self, void *args)
+{
+    inserted += *(int*)args & 0xFF;
+    return OK;
+}
+
+
+/* ESC, BS and the other control keys are not inserted. */
+static int do_control(struct hook_entry *self, void *args)
+{
+    return FAIL;
+}
+
+
+static int do_default(struct hook_entry *self, void *args)
+{
+    ++inserted;
+    return OK;
+}
+
+
+static int fill_table(struct op_table *table, int which, int base)
+{
+    int i;
+
+    op_table_init(table);
+    table->default_hook.hook_list = &def_list;
+    for (i = 0; i < 256; ++i)
+    {
+        sprintf(names[which][i], "op%d", i);
+        ops[which][i].name = names[which][i];
+        ops[which][i].command = base + i;
+        ops[which][i].action.hook_list = &lists[i];
+        if (op_add(table, &ops[which][i]) == FAIL)
+            return FAIL;
+    }
+    return OK;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+    struct op_table *tables[2];
+    int *keys = malloc(count * sizeof(int));
+    size_t i, sum[2];
+    double start, t[2];
+    int k, base;
+
+    list_init(&def_list);
+    def.hook_func = do_default;
+    list_append(&def_list, &def.node);
+    for (i = 0; i < 256; ++i)
+    {
+        actions[i].hook_func = i < ' ' || i == 0x7F ? do_control : do_insert;
+        list_init(&lists[i]);
+        list_append(&lists[i], &actions[i].node);
+    }
+
+    tables[0] = op_table_alloc();
+    tables[1] = op_table_alloc();
+    if (keys == NULL || tables[0] == NULL || tables[1] == NULL
+            || fill_table(tables[0], 0, 0) == FAIL
+            || fill_table(tables[1], 1, OP_FAST_MAX) == FAIL)
+        return 1;
+
+    /* typing text, with a newline or a backspace now and then. */
+    for (i = 0; i < count; ++i)
+    {
+        k = (int)(bench_rand() % 64);
+        keys[i] = k == 0 ? '\n' : k == 1 ? '\b' : ' ' + (k * 37) % 95;
+    }
+
+    printf("%lu keystrokes, per keystroke:\n", (unsigned long)count);
+    for (k = 0; k < 2; ++k)
+    {
+        base = k == 0 ? 0 : OP_FAST_MAX;
+        inserted = 0;
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+            op_exec(tables[k], base + keys[i]);
+        t[k] = (bench_now() - start) * 1e9 / count;
+        sum[k] = inserted;
+    }
+    if (sum[0] != sum[1])
+    {
+        printf("inserted mismatch\n");
+        return 1;
+    }
+    printf("%-14s %9.2f ns\n", "flat array", t[0]);
+    printf("%-14s %9.2f ns\n", "hashtable", t[1]);
+    printf("%.2fx (%lu)\n", t[1] / t[0], (unsigned long)sum[0]);
+
+    op_table_free(tables[1]);
+    op_table_free(tables[0]);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * paste benchmark: feed a 50 MB paste to a keycache in insert mode,
+ * as a terminal does with bracketed paste, and insert it into a
+ * memcache. the keys are inserted one by one by the default operation,
+ * or in runs with KC_BATCH. with "jj" mapped (to <Esc>) the runs are
+ * broken at every 'j'.
+ *
+ * usage: bench_paste [megabytes]
+ */
+
+
+#include <stdio.h>
+#include <Core/keycache.h>
+#include <Core/memcache.h>
+#include "../bench.h"
+
+
+#define CHUNK 4096
+
+
+static struct memcache mc;
+static size_t cursor, edits;
+static char tail[CHUNK];
+
+
+/* the default operation of insert mode, insert the key. */
+static int insert_key(struct hook_entry *self, void *args)
+{
+    char c = (char)*(int*)args;
+
+    ++edits;
+    return mc_insert(&mc, cursor++, &c, 1);
+}
+
+
+static int insert_run(struct hook_entry *self, void *args)
+{
+    struct kc_text *run = args;
+
+    ++edits;
+    cursor += run->len;
+    return mc_insert(&mc, cursor - run->len, run->text, run->len);
+}
+
+
+static int leave_insert(struct hook_entry *self, void *args)
+{
+    return OK;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 50) << 20;
+    char *text = malloc(size);
+    struct op_table ops;
+    struct op_entry esc = OP_ENTRY_INIT;
+    struct map_trie maps;
+    struct mapping_key jj = MAPPING_KEY_INIT;
+    char jj_key[] = "jj", jj_value[] = "\033";
+    struct hook_entry def = HOOK_ENTRY_INIT, ins = HOOK_ENTRY_INIT;
+    struct hook_entry leave = HOOK_ENTRY_INIT;
+    struct list_entry def_list, ins_list, leave_list;
+    struct keycache kc;
+    size_t i;
+    double start, t;
+    int pass;
+
+    if (text == NULL || size == 0)
+        return 1;
+    bench_fill_text(text, size, 60);
+
+    op_table_init(&ops);
+    list_init(&def_list);
+    def.hook_func = insert_key;
+    list_append(&def_list, &def.node);
+    ops.default_hook.hook_list = &def_list;
+    list_init(&leave_list);
+    leave.hook_func = leave_insert;
+    list_append(&leave_list, &leave.node);
+    esc.command = '\033';
+    esc.action.hook_list = &leave_list;
+    op_add(&ops, &esc);
+    map_trie_init(&maps);
+    jj.key = jj_key;
+    jj.value = jj_value;
+
+    printf("paste %lu MB:\n", (unsigned long)(size >> 20));
+    printf("%-22s %10s %10s %12s\n", "", "time", "MB/s", "edits");
+    for (pass = 0; pass < 4; ++pass)
+    {
+        if (pass == 2)
+            map_trie_add(&maps, &jj);
+        kc_init(&kc, &maps, &ops);
+        kc.flags = pass % 2 ? KC_BATCH : KC_FLAGS_CLEAR;
+        list_init(&ins_list);
+        ins.hook_func = insert_run;
+        list_append(&ins_list, &ins.node);
+        kc.insert_hook.hook_list = &ins_list;
+        mc_init(&mc);
+        cursor = edits = 0;
+
+        start = bench_now();
+        for (i = 0; i < size; i += CHUNK)
+            if (kc_feed(&kc, text + i, size - i < CHUNK ? size - i : CHUNK)
+                    == FAIL)
+                return 1;
+        kc_timeout(&kc);
+        t = bench_now() - start;
+
+        /* without mappings, the buffer is the paste. */
+        if (pass < 2 && (mc_size(&mc) != size
+                    || mc_read(&mc, size - CHUNK, tail, CHUNK) != CHUNK
+                    || memcmp(tail, text + size - CHUNK, CHUNK) != 0))
+        {
+            printf("paste mismatch\n");
+            return 1;
+        }
+        printf("%-22s %7.3f s %10.1f %12lu\n",
+                pass == 0 ? "key by key" : pass == 1 ? "batched"
+                : pass == 2 ? "key by key, jj mapped" : "batched, jj mapped",
+                t, (double)size / (1 << 20) / t, (unsigned long)edits);
+        kc_drop(&kc);
+        mc_drop(&mc);
+    }
+
+    map_trie_drop(&maps);
+    op_table_drop(&ops);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * save benchmark: map a large file into memcache, change one line in
+ * the middle, and save it into another file, including the fsync().
+ * the text is written through a stream chunk by chunk, or by
+ * mc_save() which copies the original text in the kernel. the time of
+ * copying the whole file by copy_file_range() is the lower bound.
+ *
+ * usage: bench_save [megabytes] [file]
+ */
+
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <System/stream.h>
+#include <Core/memcache.h>
+#include "../bench.h"
+
+
+#define OUT "bench_save.out"
+
+
+/* write the text through a stream, then sync and rename it. */
+static int save_stream(struct memcache *mc)
+{
+    struct stream s;
+    char const *text;
+    size_t offset, len;
+
+    if (stream_open(&s, OUT ".tmp", STREAM_WRITE) == FAIL)
+        return FAIL;
+    for (offset = 0; (text = mc_chunk(mc, offset, &len)) != NULL;
+            offset += len)
+        stream_write(&s, text, len);
+    if (stream_flush(&s) == FAIL || fsync(s.fd) != 0
+            || stream_close(&s) == FAIL)
+        return FAIL;
+    return rename(OUT ".tmp", OUT) == 0 ? OK : FAIL;
+}
+
+
+/* copy the whole file in the kernel. */
+static int copy_file(char const *name, size_t size)
+{
+    int in = open(name, O_RDONLY);
+    int out = open(OUT, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ssize_t n = 1;
+    size_t done = 0;
+
+    if (in < 0 || out < 0)
+        return FAIL;
+#if defined(__linux__) && defined(_GNU_SOURCE)
+    while (done < size && (n = copy_file_range(in, NULL, out, NULL,
+                    size - done, 0)) > 0)
+        done += n;
+#endif
+    fsync(out);
+    close(in);
+    close(out);
+    return done == size ? OK : FAIL;
+}
+
+
+/* check the file saved. */
+static int verify(struct memcache *mc)
+{
+    static char a[1 << 16], b[1 << 16];
+    FILE *fp = fopen(OUT, "rb");
+    size_t offset = 0, n;
+
+    if (fp == NULL)
+        return FAIL;
+    while ((n = fread(a, 1, sizeof(a), fp)) != 0)
+    {
+        if (mc_read(mc, offset, b, n) != n || memcmp(a, b, n) != 0)
+            break;
+        offset += n;
+    }
+    fclose(fp);
+    return offset == mc_size(mc) ? OK : FAIL;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 1024) << 20;
+    char const *name = argc > 2 ? argv[2] : "bench_save.tmp";
+    struct memcache mc;
+    size_t i, n;
+    double start;
+    char *text;
+    FILE *fp;
+
+    if ((text = malloc(1 << 20)) == NULL
+            || (fp = fopen(name, "wb")) == NULL)
+    {
+        fprintf(stderr, "can't create %s\n", name);
+        return 1;
+    }
+    for (i = 0; i < size; i += n)
+    {
+        n = size - i < (1 << 20) ? size - i : (1 << 20);
+        bench_fill_text(text, n, 80);
+        fwrite(text, 1, n, fp);
+    }
+    fclose(fp);
+    free(text);
+
+    mc_init(&mc);
+    if (mc_open(&mc, name) == FAIL)
+        return 1;
+    i = mc_offset_line(&mc, size / 2);
+    mc_replace(&mc, mc_line_offset(&mc, i), mc_line_length(&mc, i),
+            "one changed line", 16);
+    printf("%lu MiB, one line changed\n", (unsigned long)(size >> 20));
+
+    start = bench_now();
+    if (copy_file(name, mc_size(&mc)) == OK)
+        printf("%-24s %8.1f ms\n", "copy_file_range",
+                (bench_now() - start) * 1e3);
+    else
+        printf("%-24s (not supported)\n", "copy_file_range");
+
+    start = bench_now();
+    if (save_stream(&mc) == FAIL)
+        return 1;
+    printf("%-24s %8.1f ms%s\n", "stream write", (bench_now() - start) * 1e3,
+            verify(&mc) == OK ? "" : " (mismatch)");
+
+    start = bench_now();
+    if (mc_save(&mc, OUT) == FAIL)
+        return 1;
+    printf("%-24s %8.1f ms%s\n", "mc_save", (bench_now() - start) * 1e3,
+            verify(&mc) == OK ? "" : " (mismatch)");
+
+    mc_drop(&mc);
+    remove(OUT);
+    if (argc <= 2)
+        remove(name);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * swapfile benchmark: map a large file into memcache and type into it,
+ * the cursor jumps to a random place every line typed, and some
+ * keystrokes are backspaces. the same keystrokes are replayed without
+ * and with a swapfile, the swapfile is synced when VimE would be idle,
+ * i.e. every SYNC_EVERY keystrokes. the time of syncs is reported
+ * apart, it's not in the time of keystrokes. at last the swapfile is
+ * recovered.
+ *
+ * usage: bench_swapfile [megabytes] [keystrokes] [file]
+ */
+
+
+#include <stdio.h>
+#include <unistd.h>
+#include <Core/swapfile.h>
+#include "../bench.h"
+
+
+#define SWAP "bench_swapfile.swp"
+
+/* the keystrokes between two syncs. */
+#define SYNC_EVERY 10000
+
+
+/* the time of syncs, and the slowest keystroke. */
+static double sync_time, max_time;
+
+
+/* type the keystrokes, sync the swapfile if it's not NULL. */
+static double type(struct memcache *mc, struct swapfile *sw, size_t edits)
+{
+    uint64_t seed = bench_seed;
+    size_t i, cursor = 0;
+    double start, now, last;
+    char c;
+
+    sync_time = max_time = 0;
+    start = last = bench_now();
+    for (i = 0; i < edits; ++i)
+    {
+        uint64_t r = bench_rand();
+
+        if (i % 64 == 0)
+            cursor = (size_t)(r >> 16) % (mc_size(mc) + 1);
+        if (r % 8 == 0 && cursor != 0)
+            mc_delete(mc, --cursor, 1);
+        else
+        {
+            c = i % 64 == 63 ? '\n' : 'a' + (r >> 8) % 26;
+            mc_insert(mc, cursor++, &c, 1);
+        }
+
+        now = bench_now();
+        if (now - last > max_time)
+            max_time = now - last;
+        if (sw != NULL && i % SYNC_EVERY == SYNC_EVERY - 1)
+        {
+            swp_sync(sw);
+            sync_time += bench_now() - now;
+            now = bench_now();
+        }
+        last = now;
+    }
+
+    bench_seed = seed;
+    return bench_now() - start - sync_time;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 256) << 20;
+    size_t edits = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000;
+    char const *name = argc > 3 ? argv[3] : "bench_swapfile.tmp";
+    struct memcache mc;
+    struct swapfile sw;
+    size_t i, n, count, swapsize;
+    double elapsed, start;
+    char *text;
+    FILE *fp;
+
+    if ((text = malloc(1 << 20)) == NULL
+            || (fp = fopen(name, "wb")) == NULL)
+    {
+        fprintf(stderr, "can't create %s\n", name);
+        return 1;
+    }
+    for (i = 0; i < size; i += n)
+    {
+        n = size - i < (1 << 20) ? size - i : (1 << 20);
+        bench_fill_text(text, n, 80);
+        fwrite(text, 1, n, fp);
+    }
+    fclose(fp);
+    free(text);
+    remove(SWAP);
+    printf("%lu MiB, %lu keystrokes, sync every %d\n",
+            (unsigned long)(size >> 20), (unsigned long)edits, SYNC_EVERY);
+
+    mc_init(&mc);
+    if (mc_open(&mc, name) == FAIL)
+        return 1;
+    elapsed = type(&mc, NULL, edits);
+    printf("%-16s %10.0f edits/s, slowest %6.1f us\n", "swapfile off",
+            edits / elapsed, max_time * 1e6);
+    mc_drop(&mc);
+
+    mc_init(&mc);
+    if (mc_open(&mc, name) == FAIL
+            || swp_create(&sw, &mc, SWAP, name) == FAIL)
+        return 1;
+    elapsed = type(&mc, &sw, edits);
+    printf("%-16s %10.0f edits/s, slowest %6.1f us\n", "swapfile on",
+            edits / elapsed, max_time * 1e6);
+    printf("%-16s %10.1f ms in %lu syncs\n", "sync",
+            sync_time * 1e3, (unsigned long)(edits / SYNC_EVERY));
+    swp_sync(&sw);
+    swapsize = sw.checkpoint + sw.logged;
+    swp_close(&sw, FALSE);
+    n = mc_size(&mc);
+    mc_drop(&mc);
+
+    mc_init(&mc);
+    start = bench_now();
+    if (swp_recover(&mc, SWAP, &count) == FAIL || mc_size(&mc) != n)
+        return 1;
+    printf("%-16s %10.1f ms, %lu records, swapfile %lu KiB\n", "recover",
+            (bench_now() - start) * 1e3, (unsigned long)count,
+            (unsigned long)(swapsize >> 10));
+    mc_drop(&mc);
+
+    remove(SWAP);
+    if (argc <= 3)
+        remove(name);
+    return 0;
+}
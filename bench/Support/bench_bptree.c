@@ -0,0 +1,169 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * B+ tree benchmark: put n keys into a #bptree and a sbtree in random
+ * order, then time lookups, lower bounds of absent keys, selects by
+ * rank and in-order iteration over both, and report the memory used.
+ *
+ * usage: bench_bptree [key-count] [rounds]
+ */
+
+
+#include <stdio.h>
+#include <Support/bptree.h>
+#include <Support/sbtree.h>
+#include "../bench.h"
+
+
+/* the sbtree node, with the same key and value as in #bptree. */
+struct node
+{
+    struct sbtree_entry entry;
+    bpt_key_t key;
+    void *value;
+};
+
+#define NODE(ptr) SBTREE_ENTRY(ptr, struct node, entry)
+
+#define KEY_CMP(lhs, rhs) ((lhs) < (rhs) ? -1 : (lhs) > (rhs))
+
+
+    static struct sbtree_entry*
+node_insert(struct sbtree_entry **pnode, struct sbtree_entry *new_node)
+DEFINE_SBTREE_INSERT_BODY(pnode, node, new_node,
+        KEY_CMP(NODE(node)->key, NODE(new_node)->key))
+
+    static struct sbtree_entry*
+node_lookup(struct sbtree_entry *node, bpt_key_t key)
+DEFINE_SBTREE_LOOKUP_BODY(node, KEY_CMP(NODE(node)->key, key))
+
+    static struct sbtree_entry*
+node_lower_bound(struct sbtree_entry *node, bpt_key_t key)
+DEFINE_SBTREE_LOWER_BOUND_BODY(node, KEY_CMP(NODE(node)->key, key))
+
+
+static void print(char const *name, double bpt, double sbt)
+{
+    printf("%-14s %9.1f ns %9.1f ns %7.2fx\n", name, bpt, sbt, sbt / bpt);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 2;
+    struct bptree bpt = BPTREE_INIT;
+    struct sbtree_entry *root = &sbtree_nil, *found;
+    struct node *nodes;
+    bpt_key_t *keys = malloc(count * sizeof(bpt_key_t));
+    size_t i, k, r, sum = 0, rss;
+    double start, t[2];
+    struct bpt_iter it;
+
+    if (keys == NULL || count == 0)
+        return 1;
+
+    /* even keys in random order, odd keys are absent. */
+    for (i = 0; i < count; ++i)
+        keys[i] = (bpt_key_t)i * 2;
+    for (i = count; i > 1; --i)
+    {
+        bpt_key_t tmp;
+        k = (size_t)(bench_rand() % i);
+        tmp = keys[i - 1], keys[i - 1] = keys[k], keys[k] = tmp;
+    }
+
+    printf("%lu keys, per operation:\n", (unsigned long)count);
+    printf("%-14s %12s %12s %8s\n", "", "bptree", "sbtree", "speedup");
+
+    rss = bench_rss_kb();
+    bpt_init(&bpt);
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        if (bpt_insert(&bpt, keys[i], &keys[i]) == FAIL)
+            return 1;
+    t[0] = (bench_now() - start) * 1e9 / count;
+    rss = bench_rss_kb() - rss;
+
+    nodes = malloc(count * sizeof(struct node));
+    if (nodes == NULL)
+        return 1;
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        nodes[i].key = keys[i];
+        nodes[i].value = &keys[i];
+        node_insert(&root, sbtree_init(&nodes[i].entry));
+    }
+    t[1] = (bench_now() - start) * 1e9 / count;
+    print("insert", t[0], t[1]);
+
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+            sum += bpt_lookup(&bpt, keys[i]) != NULL;
+    t[0] = (bench_now() - start) * 1e9 / count / rounds;
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+            sum += node_lookup(root, keys[i]) != &sbtree_nil;
+    t[1] = (bench_now() - start) * 1e9 / count / rounds;
+    print("lookup", t[0], t[1]);
+
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+            sum += bpt_lower_bound(&bpt, keys[i] + 1, &it);
+    t[0] = (bench_now() - start) * 1e9 / count / rounds;
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+        {
+            found = node_lower_bound(root, keys[i] + 1);
+            sum += found != &sbtree_nil ? sbtree_rank(found) : 0;
+        }
+    t[1] = (bench_now() - start) * 1e9 / count / rounds;
+    print("bound+rank", t[0], t[1]);
+
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+            if (bpt_select(&bpt, keys[i] / 2, &it) == OK)
+                sum += bpt_iter_key(&it);
+    t[0] = (bench_now() - start) * 1e9 / count / rounds;
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+        {
+            found = sbtree_select(root, (int)(keys[i] / 2));
+            if (found != &sbtree_nil)
+                sum += NODE(found)->key;
+        }
+    t[1] = (bench_now() - start) * 1e9 / count / rounds;
+    print("select", t[0], t[1]);
+
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (bpt_first(&bpt, &it); it.leaf != NULL; bpt_next(&it))
+            sum += bpt_iter_key(&it);
+    t[0] = (bench_now() - start) * 1e9 / count / rounds;
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (found = sbtree_get_min(root); found != &sbtree_nil;
+                found = sbtree_get_succ(found))
+            sum += NODE(found)->key;
+    t[1] = (bench_now() - start) * 1e9 / count / rounds;
+    print("iterate", t[0], t[1]);
+
+    printf("%-14s %9.1f B  %9.1f B\n", "memory/key",
+            rss * 1024.0 / count, (double)sizeof(struct node));
+    printf("(%lu)\n", (unsigned long)sum);
+
+    bpt_drop(&bpt);
+    free(nodes);
+    free(keys);
+    return 0;
+}
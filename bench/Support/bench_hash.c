@@ -0,0 +1,278 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * string hash benchmark: hash identifiers harvested from source files
+ * with the old byte-at-a-time djb2 hash and ht_hash_bytes(), report
+ * the speed on short and long keys, and how the hash values spread
+ * over the buckets of a table. a set of keys made to collide under
+ * djb2 is checked, too.
+ *
+ * usage: bench_hash [source-file...]
+ *        without files, random identifiers are used.
+ */
+
+
+#include <stdio.h>
+#include <Support/hashtab.h>
+#include "../bench.h"
+
+
+struct ident
+{
+    struct hash_entry entry;
+    size_t len;
+};
+
+
+static struct ident *idents = NULL;
+static size_t ident_count = 0, ident_max = 0;
+static struct fast_hashtable ident_table = FAST_HASHTABLE_INIT;
+static struct hashtable *ident_ht = HASHTABLE(&ident_table);
+
+
+/* the old ht_default_hash(), djb2 started with the first byte. */
+static hash_t djb2_hash(void const *key, size_t len)
+{
+    unsigned char const *p = key, *end = p + len;
+    hash_t hash = *p;
+
+    while (++p < end)
+        hash = (hash << 5) + hash + *p;
+    return hash;
+}
+
+
+/* add a identifier to the corpus, if it isn't there. */
+static void add_ident(char const *name, size_t len)
+{
+    struct ident *ident;
+    char *key;
+
+    if (ht_lookup_len(ident_ht, name, len) != NULL)
+        return;
+
+    if (ident_count == ident_max)
+    {
+        /* the table points to the idents, rebuild it after moving. */
+        size_t i;
+        ident_max = ident_max == 0 ? 4096 : ident_max * 2;
+        idents = realloc(idents, ident_max * sizeof(struct ident));
+        ht_clear(ident_ht);
+        for (i = 0; i < ident_count; ++i)
+            ht_insert(ident_ht, &idents[i].entry);
+    }
+
+    key = malloc(len + 1);
+    memcpy(key, name, len);
+    key[len] = '\0';
+    ident = &idents[ident_count++];
+    ident->entry.key = key;
+    ident->len = len;
+    ht_insert(ident_ht, &ident->entry);
+}
+
+
+/* harvest the identifiers of a file. */
+static void load_file(char const *name)
+{
+    FILE *fp = fopen(name, "rb");
+    char buf[256];
+    size_t len = 0;
+    int c;
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "can't open %s\n", name);
+        return;
+    }
+
+    while ((c = getc(fp)) != EOF)
+    {
+        if (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+                || (len > 0 && c >= '0' && c <= '9'))
+        {
+            if (len < sizeof(buf))
+                buf[len++] = (char)c;
+        }
+        else if (len > 0)
+        {
+            add_ident(buf, len);
+            len = 0;
+        }
+    }
+    if (len > 0)
+        add_ident(buf, len);
+    fclose(fp);
+}
+
+
+/* make random identifiers, like the names of a large program. */
+static void make_idents(size_t count)
+{
+    static char const chars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    char name[32];
+    size_t i, len;
+
+    while (ident_count < count)
+    {
+        len = 3 + (size_t)(bench_rand() % 20);
+        for (i = 0; i < len; ++i)
+        {
+            size_t n = i == 0 ? 26 : sizeof(chars) - 1;
+            name[i] = chars[bench_rand() % n];
+        }
+        add_ident(name, len);
+    }
+}
+
+
+static int cmp_hash(void const *lhs, void const *rhs)
+{
+    hash_t a = *(hash_t const*)lhs, b = *(hash_t const*)rhs;
+    return a < b ? -1 : a > b;
+}
+
+
+/* x to the power of n, by squaring. */
+static double power(double x, size_t n)
+{
+    double r = 1;
+
+    for (; n != 0; n >>= 1, x *= x)
+        if (n & 1)
+            r *= x;
+    return r;
+}
+
+
+/* report how the hash values of keys spread over 2^bits buckets. */
+static void spread(char const *name, hash_t (*hash)(void const*, size_t),
+        char **keys, size_t *lens, size_t count)
+{
+    size_t bits = 0, size, i, used = 0, longest = 0, same = 0;
+    unsigned *buckets;
+    hash_t *values;
+
+    while (((size_t)1 << bits) < count)
+        ++bits;
+    size = (size_t)1 << bits;
+    buckets = calloc(size, sizeof(unsigned));
+    values = malloc(count * sizeof(hash_t));
+
+    for (i = 0; i < count; ++i)
+    {
+        values[i] = hash(keys[i], lens[i]);
+        if (buckets[values[i] & (size - 1)]++ == 0)
+            ++used;
+        if (buckets[values[i] & (size - 1)] > longest)
+            longest = buckets[values[i] & (size - 1)];
+    }
+
+    /* count keys with the same full hash value as another key. */
+    qsort(values, count, sizeof(hash_t), cmp_hash);
+    for (i = 1; i < count; ++i)
+        same += values[i] == values[i - 1];
+
+    printf("  %-10s %6.1f%% buckets used (random: %4.1f%%), "
+            "longest %3lu, same hash %lu\n", name,
+            100.0 * used / size,
+            100.0 * (1 - power(1 - 1.0 / size, count)),
+            (unsigned long)longest, (unsigned long)same);
+    free(values);
+    free(buckets);
+}
+
+
+/* hash every key rounds times, return ns per key. */
+static double speed(hash_t (*hash)(void const*, size_t),
+        char **keys, size_t *lens, size_t count, size_t rounds)
+{
+    size_t i, r;
+    hash_t sum = 0;
+    double start = bench_now();
+
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+            sum += hash(keys[i], lens[i]);
+    if (sum == 0)
+        printf("(no result)\n");
+    return (bench_now() - start) * 1e9 / count / rounds;
+}
+
+
+static void run(char const *title, char **keys, size_t *lens,
+        size_t count, size_t rounds)
+{
+    size_t i, bytes = 0;
+    double djb2, fast;
+
+    for (i = 0; i < count; ++i)
+        bytes += lens[i];
+    djb2 = speed(djb2_hash, keys, lens, count, rounds);
+    fast = speed(ht_hash_bytes, keys, lens, count, rounds);
+
+    printf("%s: %lu keys, %.1f bytes per key\n", title,
+            (unsigned long)count, (double)bytes / count);
+    printf("  %-10s %8.1f ns/key %7.2f GB/s\n", "djb2",
+            djb2, bytes / (djb2 * count));
+    printf("  %-10s %8.1f ns/key %7.2f GB/s\n", "ht_hash",
+            fast, bytes / (fast * count));
+    spread("djb2", djb2_hash, keys, lens, count);
+    spread("ht_hash", ht_hash_bytes, keys, lens, count);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t i, k, count;
+    char **keys;
+    size_t *lens;
+
+    ht_init(ident_ht);
+    for (i = 1; i < (size_t)argc; ++i)
+        load_file(argv[i]);
+    if (ident_count == 0)
+        make_idents(200000);
+
+    count = ident_count > 1 << 16 ? ident_count : 1 << 16;
+    keys = malloc(count * sizeof(char*));
+    lens = malloc(count * sizeof(size_t));
+
+    for (i = 0; i < ident_count; ++i)
+    {
+        keys[i] = (char*)idents[i].entry.key;
+        lens[i] = idents[i].len;
+    }
+    run("identifiers", keys, lens, ident_count,
+            20000000 / ident_count + 1);
+
+    /* lines of text, hashed as a whole. */
+    for (i = 0; i < 4096; ++i)
+    {
+        lens[i] = 64 + (size_t)(bench_rand() % 4032);
+        keys[i] = malloc(lens[i]);
+        bench_fill_text(keys[i], lens[i], 1 << 20);
+    }
+    run("long keys", keys, lens, 4096, 200);
+    for (i = 0; i < 4096; ++i)
+        free(keys[i]);
+
+    /*
+     * "Az" and "BY" have the same djb2 hash, so do all the 2^16
+     * strings made of 16 of them.
+     */
+    for (i = 0; i < 1 << 16; ++i)
+    {
+        keys[i] = malloc(33);
+        for (k = 0; k < 16; ++k)
+            memcpy(keys[i] + k * 2, (i >> k & 1) ? "Az" : "BY", 2);
+        keys[i][32] = '\0';
+        lens[i] = 32;
+    }
+    run("djb2 collisions", keys, lens, 1 << 16, 100);
+
+    return 0;
+}
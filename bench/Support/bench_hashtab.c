@@ -0,0 +1,170 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * hash table benchmark: insert identifier-like keys, look them up
+ * (hits and misses), and churn the table with removals and inserts,
+ * with the perturb-probing #hashtable and the Robin Hood table.
+ *
+ * usage: bench_hashtab [key-count] [rounds]
+ */
+
+
+#include <stdio.h>
+#include <Support/hashtab.h>
+#include <Support/rhtab.h>
+#include "../bench.h"
+
+
+/* the struction put into the tables, like a option or a command. */
+struct node
+{
+    struct hash_entry entry;
+    char name[24];
+};
+
+
+/* the routines of a table used by the benchmark. */
+struct table_ops
+{
+    char const *name;
+    void (*init)(void);
+    void (*drop)(void);
+    struct hash_entry *(*insert)(struct hash_entry *value);
+    struct hash_entry *(*lookup)(void const *key);
+    struct hash_entry *(*remove)(void const *key);
+};
+
+
+static struct fast_hashtable ht = FAST_HASHTABLE_INIT;
+static struct rh_hashtable rht = RH_HASHTABLE_INIT;
+
+static void ht_bench_init(void) { ht_safe_init(HASHTABLE(&ht)); }
+static void ht_bench_drop(void) { ht_drop(HASHTABLE(&ht)); }
+static struct hash_entry *ht_bench_insert(struct hash_entry *value)
+{ return ht_insert(HASHTABLE(&ht), value); }
+static struct hash_entry *ht_bench_lookup(void const *key)
+{ return ht_lookup(HASHTABLE(&ht), key); }
+static struct hash_entry *ht_bench_remove(void const *key)
+{ return ht_remove(HASHTABLE(&ht), key); }
+
+static void rht_bench_init(void) { rht_init(&rht); }
+static void rht_bench_drop(void) { rht_drop(&rht); }
+static struct hash_entry *rht_bench_insert(struct hash_entry *value)
+{ return rht_insert(&rht, value); }
+static struct hash_entry *rht_bench_lookup(void const *key)
+{ return rht_lookup(&rht, key); }
+static struct hash_entry *rht_bench_remove(void const *key)
+{ return rht_remove(&rht, key); }
+
+static struct table_ops const tables[] = {
+    { "hashtable", ht_bench_init, ht_bench_drop,
+        ht_bench_insert, ht_bench_lookup, ht_bench_remove },
+    { "rh_hashtable", rht_bench_init, rht_bench_drop,
+        rht_bench_insert, rht_bench_lookup, rht_bench_remove },
+};
+
+
+/* make a random identifier, starts with first. */
+static void make_name(char *name, int first)
+{
+    static char const chars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    size_t i, len = 4 + (size_t)(bench_rand() % 16);
+
+    name[0] = (char)first;
+    for (i = 1; i < len; ++i)
+        name[i] = chars[bench_rand() % (i < 2 ? 26 : sizeof(chars) - 1)];
+    name[len] = '\0';
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    struct node *nodes = malloc(count * sizeof(struct node));
+    struct node *misses = malloc(count * sizeof(struct node));
+    size_t *order = malloc(count * sizeof(size_t));
+    size_t i, k, r, found;
+    double start, t[5];
+
+    if (nodes == NULL || misses == NULL || order == NULL)
+        return 1;
+
+    /* misses start with a upper case letter, so they never hit. */
+    for (i = 0; i < count; ++i)
+    {
+        make_name(nodes[i].name, 'a' + (int)(bench_rand() % 26));
+        make_name(misses[i].name, 'A' + (int)(bench_rand() % 26));
+        nodes[i].entry.key = nodes[i].name;
+        order[i] = i;
+    }
+    for (i = count; i > 1; --i)
+    {
+        k = (size_t)(bench_rand() % i);
+        r = order[i - 1], order[i - 1] = order[k], order[k] = r;
+    }
+
+    printf("%lu keys, per operation:\n", (unsigned long)count);
+    printf("%-14s %10s %10s %10s %10s %12s\n", "table",
+            "insert", "hit", "miss", "churn", "hit(churned)");
+
+    for (k = 0; k < sizeof(tables) / sizeof(tables[0]); ++k)
+    {
+        struct table_ops const *ops = &tables[k];
+
+        found = 0;
+        ops->init();
+
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+            ops->insert(&nodes[i].entry);
+        t[0] = bench_now() - start;
+
+        start = bench_now();
+        for (r = 0; r < rounds; ++r)
+            for (i = 0; i < count; ++i)
+                found += ops->lookup(nodes[order[i]].name) != NULL;
+        t[1] = bench_now() - start;
+
+        start = bench_now();
+        for (r = 0; r < rounds; ++r)
+            for (i = 0; i < count; ++i)
+                found += ops->lookup(misses[i].name) != NULL;
+        t[2] = bench_now() - start;
+
+        /* remove and insert back, removals leave tombstones in
+         * #hashtable. */
+        start = bench_now();
+        for (i = 0; i < count; ++i)
+        {
+            struct node *node = &nodes[order[(i * 7) % count]];
+            ops->remove(node->name);
+            if (i % 2 == 0)
+                ops->insert(&node->entry);
+        }
+        for (i = 0; i < count; ++i)
+            ops->insert(&nodes[i].entry);
+        t[3] = bench_now() - start;
+
+        start = bench_now();
+        for (r = 0; r < rounds; ++r)
+            for (i = 0; i < count; ++i)
+                found += ops->lookup(nodes[order[i]].name) != NULL;
+        t[4] = bench_now() - start;
+
+        printf("%-14s %7.1f ns %7.1f ns %7.1f ns %7.1f ns %9.1f ns",
+                ops->name, t[0] * 1e9 / count,
+                t[1] * 1e9 / count / rounds, t[2] * 1e9 / count / rounds,
+                t[3] * 1e9 / count / 2.5, t[4] * 1e9 / count / rounds);
+        printf("  (%lu)\n", (unsigned long)found);
+        ops->drop();
+    }
+
+    free(order);
+    free(misses);
+    free(nodes);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * hook benchmark: call hooks with 1, 8 and 64 entries, by walking the
+ * entries list (like before hooks were compiled) and with the compiled
+ * chain. one hook is called again and again (hot), or many hooks with
+ * 1M entries in all are called in random order (cold), like the
+ * action hooks of operators. the entries are allocated one by one,
+ * with other blocks between them, like the entries added by plugins.
+ *
+ * usage: bench_hook [calls]
+ */
+
+
+#include <stdio.h>
+#include <Support/hook.h>
+#include "../bench.h"
+
+
+#define ALL_ENTRIES (1 << 20)
+
+
+static int count_call(struct hook_entry *self, void *args)
+{
+    ++*(size_t*)args;
+    return OK;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t calls = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+    static int const sizes[] = {1, 8, 64};
+    struct hook_entry **entries = malloc(ALL_ENTRIES * sizeof(void *));
+    void **gaps = malloc(ALL_ENTRIES * sizeof(void *));
+    struct list_entry *lists;
+    struct hook *hooks;
+    size_t *order, i, n, nhooks, sum[2], e;
+    double start, t[2][2];
+    int s, k, cold;
+
+    if (entries == NULL || gaps == NULL)
+        return 1;
+
+    printf("per call:\n");
+    printf("%-8s %12s %12s %8s %12s %12s %8s\n", "entries", "hot list",
+            "hot chain", "speedup", "cold list", "cold chain", "speedup");
+    for (s = 0; s < 3; ++s)
+    {
+        nhooks = ALL_ENTRIES / sizes[s];
+        hooks = malloc(nhooks * sizeof(struct hook));
+        lists = malloc(nhooks * sizeof(struct list_entry));
+        order = malloc(calls / sizes[s] * sizeof(size_t));
+        if (hooks == NULL || lists == NULL || order == NULL)
+            return 1;
+
+        /* add the entries round-robin, so the entries of a hook are not
+         * allocated together. */
+        for (i = 0; i < nhooks; ++i)
+            hook_init(&hooks[i], &lists[i]);
+        for (e = 0; e < ALL_ENTRIES; ++e)
+        {
+            entries[e] = calloc(1, sizeof(struct hook_entry));
+            gaps[e] = malloc(16 + bench_rand() % 64);
+            if (entries[e] == NULL || gaps[e] == NULL)
+                return 1;
+            entries[e]->hook_func = count_call;
+            list_append(lists[e % nhooks].prev, &entries[e]->node);
+        }
+
+        n = calls / sizes[s];
+        for (i = 0; i < n; ++i)
+            order[i] = (size_t)(bench_rand() % nhooks);
+        for (k = 0; k < 2; ++k)
+        {
+            for (i = 0; i < nhooks; ++i)
+                if (k == 0)
+                    hook_drop(&hooks[i]);
+                else if (hook_update(&hooks[i]) == FAIL)
+                    return 1;
+
+            for (cold = 0; cold < 2; ++cold)
+            {
+                sum[k] = 0;
+                start = bench_now();
+                for (i = 0; i < n; ++i)
+                    hook_call(&hooks[cold ? order[i] : 0], HF_DEFAULT,
+                            &sum[k]);
+                t[cold][k] = (bench_now() - start) * 1e9 / n;
+            }
+        }
+        if (sum[0] != sum[1])
+        {
+            printf("call mismatch\n");
+            return 1;
+        }
+        printf("%-8d %9.2f ns %9.2f ns %7.2fx %9.2f ns %9.2f ns %7.2fx\n",
+                sizes[s], t[0][0], t[0][1], t[0][0] / t[0][1],
+                t[1][0], t[1][1], t[1][0] / t[1][1]);
+
+        for (i = 0; i < nhooks; ++i)
+            hook_drop(&hooks[i]);
+        for (e = 0; e < ALL_ENTRIES; ++e)
+        {
+            free(gaps[e]);
+            free(entries[e]);
+        }
+        free(order);
+        free(lists);
+        free(hooks);
+    }
+    free(gaps);
+    free(entries);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * hook filter benchmark: a event hook with 500 handlers, like the
+ * autocommands of a large config, 5 of them are for the filetype of
+ * the buffer. the handlers check the filetype themselves (so all of
+ * them are called), or the filetype is the key of entries and checked
+ * by hook_call_filter(), with the compiled chain and with the list.
+ *
+ * usage: bench_hook_filter [calls]
+ */
+
+
+#include <stdio.h>
+#include <Support/hook.h>
+#include "../bench.h"
+
+
+#define HANDLERS 500
+#define MATCHED 5
+#define FILETYPES (HANDLERS / MATCHED)
+
+
+struct handler
+{
+    struct hook_entry entry;
+    unsigned long filetype;
+};
+
+
+static unsigned long current;
+
+
+/* the handler checks the filetype itself. */
+static int check_call(struct hook_entry *self, void *args)
+{
+    if (container_of(self, struct handler, entry)->filetype == current)
+        ++*(size_t*)args;
+    return OK;
+}
+
+
+static int count_call(struct hook_entry *self, void *args)
+{
+    ++*(size_t*)args;
+    return OK;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t calls = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    struct handler *handlers[HANDLERS];
+    unsigned long *keys = malloc(calls * sizeof(unsigned long));
+    struct list_entry list;
+    struct hook hook;
+    size_t i, sum[3];
+    double start, t[3];
+    int k;
+
+    if (keys == NULL)
+        return 1;
+    for (i = 0; i < calls; ++i)
+        keys[i] = 1 + bench_rand() % FILETYPES;
+
+    hook_init(&hook, &list);
+    for (i = 0; i < HANDLERS; ++i)
+    {
+        handlers[i] = calloc(1, sizeof(struct handler));
+        if (handlers[i] == NULL)
+            return 1;
+        handlers[i]->filetype = 1 + i % FILETYPES;
+        handlers[i]->entry.priority = (int)(bench_rand() % 10);
+        hook_add(&hook, &handlers[i]->entry);
+    }
+
+    for (k = 0; k < 3; ++k)
+    {
+        for (i = 0; i < HANDLERS; ++i)
+        {
+            handlers[i]->entry.hook_func = k == 0 ? check_call : count_call;
+            handlers[i]->entry.key = k == 0 ? 0 : handlers[i]->filetype;
+        }
+        if (k < 2)
+            hook_update(&hook);
+        else
+            hook_drop(&hook);
+
+        sum[k] = 0;
+        start = bench_now();
+        for (i = 0; i < calls; ++i)
+        {
+            current = keys[i];
+            hook_call_filter(&hook, HF_DEFAULT, HOOK_MASK_ALL, keys[i],
+                    &sum[k]);
+        }
+        t[k] = (bench_now() - start) * 1e9 / calls;
+    }
+    if (sum[0] != sum[1] || sum[1] != sum[2]
+            || sum[0] != calls * MATCHED)
+    {
+        printf("call mismatch\n");
+        return 1;
+    }
+
+    printf("%d handlers, %d matched, per event:\n", HANDLERS, MATCHED);
+    printf("%-24s %9.1f ns\n", "checked by handlers", t[0]);
+    printf("%-24s %9.1f ns\n", "filtered, chain", t[1]);
+    printf("%-24s %9.1f ns\n", "filtered, list", t[2]);
+
+    for (i = 0; i < HANDLERS; ++i)
+        free(handlers[i]);
+    free(keys);
+    return 0;
+}
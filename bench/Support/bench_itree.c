@@ -0,0 +1,126 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * interval tree benchmark: put n highlight spans in a buffer of 10 MB,
+ * then find the spans in a screen (100 lines of 80 bytes) and insert
+ * or delete text at random positions, with a #itree and with a sorted
+ * array of spans scanned and adjusted linearly.
+ *
+ * usage: bench_itree [span-count] [rounds]
+ */
+
+
+#include <stdio.h>
+#include <Support/itree.h>
+#include "../bench.h"
+
+
+#define BUF_SIZE (10 * 1024 * 1024)
+#define SCREEN (100 * 80)
+
+
+struct span
+{
+    struct itree_entry entry;
+    size_t start, end;  /* the array version. */
+};
+
+
+static void print(char const *name, double tree, double array)
+{
+    printf("%-14s %9.1f ns %9.1f ns %7.1fx\n", name, tree, array,
+            array / tree);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 50000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000;
+    struct itree tree = ITREE_INIT;
+    struct itree_iter it;
+    struct span *spans = malloc(count * sizeof(struct span));
+    size_t *pos = malloc(rounds * sizeof(size_t));
+    size_t i, r, low, sum = 0, found = 0;
+    double start, t[2];
+
+    if (spans == NULL || pos == NULL || count == 0)
+        return 1;
+
+    /* sorted spans, a few of them are long (e.g. comments). */
+    itree_init(&tree);
+    for (i = 0; i < count; ++i)
+    {
+        spans[i].start = (size_t)((double)i * BUF_SIZE / count);
+        spans[i].end = spans[i].start + (i % 100 == 0 ? 20000
+                : (size_t)(bench_rand() % 40));
+        itree_insert(&tree, &spans[i].entry, spans[i].start, spans[i].end);
+    }
+    for (r = 0; r < rounds; ++r)
+        pos[r] = (size_t)(bench_rand() % (BUF_SIZE - SCREEN));
+
+    printf("%lu spans, per operation:\n", (unsigned long)count);
+    printf("%-14s %12s %12s %8s\n", "", "itree", "array", "speedup");
+
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (itree_overlap(&tree, pos[r], pos[r] + SCREEN, &it);
+                it.node != &sbtree_nil; itree_overlap_next(&it))
+            sum += it.start, ++found;
+    t[0] = (bench_now() - start) * 1e9 / rounds;
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count && spans[i].start < pos[r] + SCREEN; ++i)
+            if (spans[i].end > pos[r])
+                sum += spans[i].start;
+    t[1] = (bench_now() - start) * 1e9 / rounds;
+    print("screen", t[0], t[1]);
+
+    /* type a byte, or delete a line. */
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+        if (r % 2 == 0)
+            itree_adjust(&tree, pos[r], 0, 1);
+        else
+            itree_adjust(&tree, pos[r], 80, 0);
+    t[0] = (bench_now() - start) * 1e9 / rounds;
+    start = bench_now();
+    for (r = 0; r < rounds; ++r)
+    {
+        size_t del = r % 2 == 0 ? 0 : 80, ins = r % 2 == 0 ? 1 : 0;
+
+        low = pos[r];
+        for (i = 0; i < count; ++i)
+        {
+            if (spans[i].start >= low + del)
+                spans[i].start = spans[i].start - del + ins;
+            else if (spans[i].start >= low)
+                spans[i].start = low + ins;
+            if (spans[i].end > low)
+                spans[i].end = spans[i].end >= low + del
+                    ? spans[i].end - del + ins : low;
+            if (spans[i].end < spans[i].start)
+                spans[i].end = spans[i].start;
+        }
+    }
+    t[1] = (bench_now() - start) * 1e9 / rounds;
+    print("edit", t[0], t[1]);
+
+    /* both are the same after the edits. */
+    for (i = 0; i < count; ++i)
+        if (itree_start(&spans[i].entry) != spans[i].start
+                || itree_end(&spans[i].entry) != spans[i].end)
+        {
+            printf("span %lu mismatch\n", (unsigned long)i);
+            return 1;
+        }
+
+    printf("%.1f spans in a screen (%lu)\n", (double)found / rounds,
+            (unsigned long)sum);
+    free(pos);
+    free(spans);
+    return 0;
+}
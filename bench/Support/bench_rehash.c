@@ -0,0 +1,88 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * rehash benchmark: insert keys into a growing #hashtable one by one,
+ * timing every insert, and report the latency percentiles with the
+ * whole-table resize and with the incremental resize.
+ *
+ * usage: bench_rehash [key-count]
+ */
+
+
+#include <stdio.h>
+#include <Support/hashtab.h>
+#include "../bench.h"
+
+
+struct node
+{
+    struct hash_entry entry;
+    char name[16];
+};
+
+
+static int cmp_double(void const *lhs, void const *rhs)
+{
+    double a = *(double const*)lhs, b = *(double const*)rhs;
+    return a < b ? -1 : a > b;
+}
+
+
+static void run(char const *name, int flags, struct node *nodes,
+        size_t count, double *lat)
+{
+    struct fast_hashtable table = FAST_HASHTABLE_INIT;
+    struct hashtable *hashtab = HASHTABLE(&table);
+    size_t i;
+    double start, total = 0;
+
+    ht_init(hashtab)->flags |= flags;
+    for (i = 0; i < count; ++i)
+    {
+        start = bench_now();
+        ht_insert(hashtab, &nodes[i].entry);
+        lat[i] = bench_now() - start;
+        total += lat[i];
+    }
+    if (hashtab->size != count)
+        printf("(lost items)\n");
+    ht_drop(hashtab);
+
+    qsort(lat, count, sizeof(double), cmp_double);
+    printf("%-12s %8.0f ns %8.0f ns %8.0f ns %8.3f ms %8.3f s\n",
+            name, lat[count / 2] * 1e9, lat[count * 99 / 100] * 1e9,
+            lat[count * 999 / 1000] * 1e9, lat[count - 1] * 1e3, total);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000000;
+    struct node *nodes = malloc(count * sizeof(struct node));
+    double *lat = malloc(count * sizeof(double));
+    size_t i;
+
+    if (nodes == NULL || lat == NULL)
+        return 1;
+
+    /* unique identifier-like keys. */
+    for (i = 0; i < count; ++i)
+    {
+        sprintf(nodes[i].name, "w%lx_%lu", (unsigned long)(bench_rand()
+                    & 0xFFFFF), (unsigned long)i);
+        nodes[i].entry.key = nodes[i].name;
+    }
+
+    printf("%lu inserts, latency:\n", (unsigned long)count);
+    printf("%-12s %11s %11s %11s %11s %10s\n", "resize",
+            "p50", "p99", "p999", "max", "total");
+    run("whole", HF_DEFAULT, nodes, count, lat);
+    run("incremental", HF_INCREMENTAL, nodes, count, lat);
+
+    free(lat);
+    free(nodes);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * sbtree bulk build benchmark: put n sorted keys into a sbtree with n
+ * inserts (in sorted and in random order) and with one bulk build,
+ * and merge two trees with inserts and with sbtree_merge(). the depth
+ * of the trees and the lookup time are reported too.
+ *
+ * usage: bench_sbtree [key-count] [rounds]
+ */
+
+
+#include <stdio.h>
+#include <Support/sbtree.h>
+#include "../bench.h"
+
+
+struct node
+{
+    struct sbtree_entry entry;
+    unsigned long key;
+};
+
+#define NODE(ptr) SBTREE_ENTRY(ptr, struct node, entry)
+
+
+    static struct sbtree_entry*
+node_insert(struct sbtree_entry **pnode, struct sbtree_entry *new_node)
+DEFINE_SBTREE_INSERT_BODY(pnode, node, new_node,
+        NODE(node)->key < NODE(new_node)->key ? -1
+        : NODE(node)->key > NODE(new_node)->key)
+
+    static struct sbtree_entry*
+node_lookup(struct sbtree_entry *node, unsigned long key)
+DEFINE_SBTREE_LOOKUP_BODY(node, NODE(node)->key < key ? -1
+        : NODE(node)->key > key)
+
+    static struct sbtree_entry*
+node_merge(struct sbtree_entry **pnode, struct sbtree_entry *other)
+DEFINE_SBTREE_MERGE_BODY(pnode, other, lhs, rhs,
+        NODE(lhs)->key < NODE(rhs)->key ? -1
+        : NODE(lhs)->key > NODE(rhs)->key)
+
+
+static size_t depth(struct sbtree_entry *node)
+{
+    size_t left, right;
+
+    if (node == &sbtree_nil)
+        return 0;
+    left = depth(node->left);
+    right = depth(node->right);
+    return (left > right ? left : right) + 1;
+}
+
+
+/* look up every key, return ns per lookup. */
+static double lookup_all(struct sbtree_entry *root, struct node *nodes,
+        size_t *order, size_t count, size_t rounds)
+{
+    size_t i, r, found = 0;
+    double start = bench_now();
+
+    for (r = 0; r < rounds; ++r)
+        for (i = 0; i < count; ++i)
+            found += node_lookup(root, nodes[order[i]].key) != &sbtree_nil;
+    if (found != count * rounds)
+        printf("(lost nodes)\n");
+    return (bench_now() - start) * 1e9 / count / rounds;
+}
+
+
+static void report(char const *name, double t, struct sbtree_entry *root,
+        struct node *nodes, size_t *order, size_t count, size_t rounds)
+{
+    printf("%-16s %8.3f ms %7.1f ns/node  depth %2lu  lookup %6.1f ns\n",
+            name, t * 1e3, t * 1e9 / count, (unsigned long)depth(root),
+            lookup_all(root, nodes, order, count, rounds));
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 2;
+    struct node *nodes = malloc(count * sizeof(struct node));
+    struct sbtree_entry **ptrs = malloc(count * sizeof(struct sbtree_entry*));
+    size_t *order = malloc(count * sizeof(size_t));
+    struct sbtree_entry *root, *other, *head;
+    size_t i, k, t;
+    double start;
+
+    if (nodes == NULL || ptrs == NULL || order == NULL || count < 2)
+        return 1;
+    count &= ~(size_t)1;
+
+    /* sorted keys with gaps, like line numbers of marks. */
+    for (i = 0; i < count; ++i)
+    {
+        nodes[i].key = i * 4 + (unsigned long)(bench_rand() % 4);
+        ptrs[i] = &nodes[i].entry;
+        order[i] = i;
+    }
+    for (i = count; i > 1; --i)
+    {
+        k = (size_t)(bench_rand() % i);
+        t = order[i - 1], order[i - 1] = order[k], order[k] = t;
+    }
+
+    printf("%lu nodes:\n", (unsigned long)count);
+
+    root = &sbtree_nil;
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        node_insert(&root, sbtree_init(&nodes[i].entry));
+    report("insert sorted", bench_now() - start, root,
+            nodes, order, count, rounds);
+
+    root = &sbtree_nil;
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        node_insert(&root, sbtree_init(&nodes[order[i]].entry));
+    report("insert random", bench_now() - start, root,
+            nodes, order, count, rounds);
+
+    start = bench_now();
+    root = sbtree_build(ptrs, count);
+    report("build array", bench_now() - start, root,
+            nodes, order, count, rounds);
+
+    start = bench_now();
+    head = sbtree_flatten(root);
+    root = sbtree_build_list(&head, count);
+    report("flatten+build", bench_now() - start, root,
+            nodes, order, count, rounds);
+
+    /* two trees, with the even and the odd nodes. */
+    printf("merge two trees of %lu nodes:\n", (unsigned long)count / 2);
+    for (k = 0; k < 2; ++k)
+    {
+        for (i = 0; i < count / 2; ++i)
+        {
+            ptrs[i] = &nodes[i * 2].entry;
+            ptrs[count / 2 + i] = &nodes[i * 2 + 1].entry;
+        }
+        root = sbtree_build(ptrs, count / 2);
+        other = sbtree_build(ptrs + count / 2, count / 2);
+
+        start = bench_now();
+        if (k == 0)
+        {
+            for (i = count / 2; i < count; ++i)
+                node_insert(&root, sbtree_init(ptrs[i]));
+        }
+        else
+            node_merge(&root, other);
+        report(k == 0 ? "insert" : "sbtree_merge", bench_now() - start,
+                root, nodes, order, count, rounds);
+    }
+
+    free(order);
+    free(ptrs);
+    free(nodes);
+    return 0;
+}
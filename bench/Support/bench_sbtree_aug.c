@@ -0,0 +1,226 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * augmented sbtree benchmark: insert n random keys into a sbtree and
+ * remove them all, with the plain routines, with the sbtree_aug_*
+ * routines calling the update function by pointer, and with the
+ * routines defined by DEFINE_SBTREE_AUG_ROUTINES(). the summary is one
+ * field (bytes) or five fields (bytes, newlines, max width, folded
+ * lines and max end).
+ *
+ * usage: bench_sbtree_aug [key-count] [rounds]
+ */
+
+
+#include <stdio.h>
+#include <Support/sbtree.h>
+#include "../bench.h"
+
+
+struct node
+{
+    struct sbtree_entry entry;
+    unsigned long key;
+    unsigned len, lines, width, folded, end;
+    unsigned long bytes, nl, folds;
+    unsigned max_width, max_end;
+};
+
+#define NODE(ptr) SBTREE_ENTRY(ptr, struct node, entry)
+
+
+static int node_cmp(struct sbtree_entry const *node, void const *key)
+{
+    unsigned long lhs = NODE(node)->key, rhs = *(unsigned long const*)key;
+    return lhs < rhs ? -1 : lhs > rhs;
+}
+
+static void update1(struct sbtree_entry *node)
+{
+    struct node *n = NODE(node);
+
+    n->bytes = n->len;
+    if (node->left != &sbtree_nil)
+        n->bytes += NODE(node->left)->bytes;
+    if (node->right != &sbtree_nil)
+        n->bytes += NODE(node->right)->bytes;
+}
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+static void update5(struct sbtree_entry *node)
+{
+    struct node *n = NODE(node), *c;
+
+    n->bytes = n->len;
+    n->nl = n->lines;
+    n->folds = n->folded;
+    n->max_width = n->width;
+    n->max_end = n->end;
+    if (node->left != &sbtree_nil)
+    {
+        c = NODE(node->left);
+        n->bytes += c->bytes;
+        n->nl += c->nl;
+        n->folds += c->folds;
+        n->max_width = MAX(n->max_width, c->max_width);
+        n->max_end = MAX(n->max_end, c->max_end);
+    }
+    if (node->right != &sbtree_nil)
+    {
+        c = NODE(node->right);
+        n->bytes += c->bytes;
+        n->nl += c->nl;
+        n->folds += c->folds;
+        n->max_width = MAX(n->max_width, c->max_width);
+        n->max_end = MAX(n->max_end, c->max_end);
+    }
+}
+
+DEFINE_SBTREE_AUG_ROUTINES(node1, update1)
+DEFINE_SBTREE_AUG_ROUTINES(node5, update5)
+
+
+static struct node *nodes;
+static size_t *removes;
+
+enum
+{
+    PLAIN, CALLBACK1, GENERATED1, CALLBACK5, GENERATED5
+};
+
+static char const *names[] = {
+    "plain", "callback 1", "generated 1", "callback 5", "generated 5"
+};
+
+/*
+ * insert and remove all nodes, add ns per insert and remove to t, and
+ * return the bytes of the tree.
+ */
+static unsigned long run(int kind, size_t count, double *t)
+{
+    struct sbtree_entry *root = &sbtree_nil, *node;
+    unsigned long bytes = 0;
+    size_t i;
+    double start;
+
+    for (i = 0; i < count; ++i)
+    {
+        node = sbtree_init(&nodes[i].entry);
+        if (kind == CALLBACK1 || kind == GENERATED1)
+            update1(node);
+        else if (kind != PLAIN)
+            update5(node);
+    }
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        node = &nodes[i].entry;
+        switch (kind)
+        {
+            case PLAIN:
+                sbtree_insert(&root, node, &nodes[i].key, node_cmp);
+                break;
+            case CALLBACK1:
+                sbtree_aug_insert(&root, node, &nodes[i].key, node_cmp,
+                        update1);
+                break;
+            case GENERATED1:
+                node1_insert(&root, node, &nodes[i].key, node_cmp);
+                break;
+            case CALLBACK5:
+                sbtree_aug_insert(&root, node, &nodes[i].key, node_cmp,
+                        update5);
+                break;
+            case GENERATED5:
+                node5_insert(&root, node, &nodes[i].key, node_cmp);
+                break;
+        }
+    }
+    t[0] += (bench_now() - start) * 1e9 / count;
+    if (kind != PLAIN)
+        bytes = NODE(root)->bytes;
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        node = &nodes[removes[i]].entry;
+        switch (kind)
+        {
+            case PLAIN:
+                sbtree_remove(&root, node);
+                break;
+            case CALLBACK1:
+                sbtree_aug_remove(&root, node, update1);
+                break;
+            case GENERATED1:
+                node1_remove(&root, node);
+                break;
+            case CALLBACK5:
+                sbtree_aug_remove(&root, node, update5);
+                break;
+            case GENERATED5:
+                node5_remove(&root, node);
+                break;
+        }
+    }
+    t[1] += (bench_now() - start) * 1e9 / count;
+
+    if (root != &sbtree_nil)
+        printf("broken tree\n");
+    return bytes;
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 3;
+    size_t i, k, r, tmp;
+    unsigned long sum = 0;
+    double t[2];
+    int kind;
+
+    nodes = malloc(count * sizeof(struct node));
+    removes = malloc(count * sizeof(size_t));
+    if (nodes == NULL || removes == NULL || count == 0)
+        return 1;
+
+    for (i = 0; i < count; ++i)
+    {
+        nodes[i].key = bench_rand();
+        nodes[i].len = (unsigned)(bench_rand() % 80);
+        nodes[i].lines = (unsigned)(bench_rand() % 4);
+        nodes[i].width = (unsigned)(bench_rand() % 200);
+        nodes[i].folded = (unsigned)(bench_rand() % 2);
+        nodes[i].end = (unsigned)(nodes[i].key % 100000);
+        removes[i] = i;
+    }
+    for (i = count; i > 1; --i)
+    {
+        k = (size_t)(bench_rand() % i);
+        tmp = removes[i - 1], removes[i - 1] = removes[k], removes[k] = tmp;
+    }
+
+    printf("%lu keys, %lu rounds, per operation:\n",
+            (unsigned long)count, (unsigned long)rounds);
+    printf("%-14s %12s %12s\n", "", "insert", "remove");
+    for (kind = PLAIN; kind <= GENERATED5; ++kind)
+    {
+        t[0] = t[1] = 0;
+        for (r = 0; r < rounds; ++r)
+            sum += run(kind, count, t);
+        printf("%-14s %9.1f ns %9.1f ns\n", names[kind],
+                t[0] / rounds, t[1] / rounds);
+    }
+
+    printf("(%lu)\n", sum);
+
+    free(removes);
+    free(nodes);
+    return 0;
+}
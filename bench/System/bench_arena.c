@@ -0,0 +1,80 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * arena benchmark: simulate the temporary allocations of commands,
+ * every command allocates some small blocks that all die when it's
+ * done, with vime_malloc()/vime_free() and with a arena.
+ *
+ * usage: bench_arena [command-count] [allocations-per-command]
+ */
+
+
+#include <stdio.h>
+#include <System/mem.h>
+#include "../bench.h"
+
+
+int main(int argc, char **argv)
+{
+    size_t commands = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t per = argc > 2 ? strtoul(argv[2], NULL, 10) : 32;
+    void **blocks = malloc(per * sizeof(void*));
+    size_t i, k, size, sum = 0;
+    double start, heap, arena_time;
+    arena_t arena = arena_create(0);
+
+    if (blocks == NULL || arena == NULL)
+        return 1;
+
+    bench_seed = 1;
+    start = bench_now();
+    for (i = 0; i < commands; ++i)
+    {
+        for (k = 0; k < per; ++k)
+        {
+            size = 16 + (size_t)(bench_rand() % 240);
+            blocks[k] = vime_malloc(size);
+            *(char*)blocks[k] = (char)k;
+        }
+        for (k = 0; k < per; ++k)
+        {
+            sum += *(char*)blocks[k];
+            vime_free(blocks[k]);
+        }
+    }
+    heap = bench_now() - start;
+
+    bench_seed = 1;
+    start = bench_now();
+    for (i = 0; i < commands; ++i)
+    {
+        size_t mark = arena_mark(arena);
+
+        for (k = 0; k < per; ++k)
+        {
+            size = 16 + (size_t)(bench_rand() % 240);
+            blocks[k] = arena_alloc(arena, size);
+            *(char*)blocks[k] = (char)k;
+        }
+        for (k = 0; k < per; ++k)
+            sum += *(char*)blocks[k];
+        arena_rewind(arena, mark);
+    }
+    arena_time = bench_now() - start;
+
+    printf("%lu commands, %lu allocations each:\n",
+            (unsigned long)commands, (unsigned long)per);
+    printf("vime_malloc/free: %.3f s, %.1f ns per allocation\n",
+            heap, heap * 1e9 / commands / per);
+    printf("arena:            %.3f s, %.1f ns per allocation\n",
+            arena_time, arena_time * 1e9 / commands / per);
+    printf("speedup: %.1fx (%lu)\n", heap / arena_time,
+            (unsigned long)(sum & 0xF));
+
+    arena_destroy(arena);
+    free(blocks);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * fixed allocator benchmark: allocate, churn and walk tree-node sized
+ * blocks with the fixed allocator and with vime_malloc().
+ *
+ * usage: bench_fixed [block-count] [block-size]
+ */
+
+
+#include <stdio.h>
+#include <System/mem.h>
+#include "../bench.h"
+
+
+/* the node used to walk the blocks, like a list or a tree node. */
+struct node
+{
+    struct node *next;
+    size_t value;
+};
+
+
+/* the allocator used by the benchmark. */
+static fixed_alloc_t fa;
+
+static void *use_fixed(size_t size)
+{
+    return fixed_acquire(fa);
+}
+
+static void drop_fixed(void *mem)
+{
+    fixed_release(fa, mem);
+}
+
+
+static void run(char const *name, size_t count, size_t size,
+        void *(*acquire)(size_t), void (*release)(void*))
+{
+    struct node **nodes = malloc(count * sizeof(struct node*)), *iter;
+    size_t i, k, sum = 0;
+    double start, alloc, churn, walk, drop;
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        nodes[i] = acquire(size);
+    alloc = bench_now() - start;
+
+    /* free and allocate random nodes, like edits on a tree. */
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+    {
+        k = (size_t)(bench_rand() % count);
+        release(nodes[k]);
+        nodes[k] = acquire(size);
+    }
+    churn = bench_now() - start;
+
+    /* link nodes in allocation order and walk them. */
+    for (i = 0; i < count; ++i)
+    {
+        nodes[i]->next = i + 1 < count ? nodes[i + 1] : NULL;
+        nodes[i]->value = i;
+    }
+    start = bench_now();
+    for (k = 0; k < 8; ++k)
+        for (iter = nodes[0]; iter != NULL; iter = iter->next)
+            sum += iter->value;
+    walk = bench_now() - start;
+
+    start = bench_now();
+    for (i = 0; i < count; ++i)
+        release(nodes[i]);
+    drop = bench_now() - start;
+
+    printf("%-12s alloc %6.1f ns  churn %6.1f ns  walk %6.2f ns"
+            "  free %6.1f ns  (%lu)\n", name,
+            alloc * 1e9 / count, churn * 1e9 / count,
+            walk * 1e9 / count / 8, drop * 1e9 / count,
+            (unsigned long)(sum & 0xF));
+    free(nodes);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000000;
+    size_t size = argc > 2 ? strtoul(argv[2], NULL, 10) : 48;
+
+    if (size < sizeof(struct node))
+        size = sizeof(struct node);
+    printf("%lu blocks of %lu bytes, per block:\n",
+            (unsigned long)count, (unsigned long)size);
+
+    run("vime_malloc", count, size, vime_malloc, vime_free);
+
+    fa = fixed_alloc(size, 0);
+    run("fixed_alloc", count, size, use_fixed, drop_fixed);
+    fixed_free(fa);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * scanning kernel benchmark: run every scanning routine of every
+ * kernel the CPU supports over a large block of text, and report the
+ * throughput in GB/s.
+ *
+ * usage: bench_scan [block-size-in-MiB] [rounds]
+ */
+
+
+#include <stdio.h>
+#include <System/scan.h>
+#include "../bench.h"
+
+
+static char const *names[] = { "scalar", "sse2", "avx2" };
+
+
+/* fill text with lines of mostly ASCII and some UTF-8 text. */
+static void fill(char *text, size_t len)
+{
+    static char const utf8[] = "\xE4\xB8\xAD\xE6\x96\x87";
+    size_t i;
+
+    bench_fill_text(text, len, 80);
+    for (i = 0; i + sizeof(utf8) < len; i += 512)
+        memcpy(text + i, utf8, sizeof(utf8) - 1);
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 256) << 20;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 10) : 8;
+    size_t i, k, nl = 0, result = 0;
+    double start, gb = (double)size * rounds / 1e9;
+    char *text;
+
+    if ((text = malloc(size)) == NULL)
+    {
+        fprintf(stderr, "can't allocate %lu MiB\n",
+                (unsigned long)(size >> 20));
+        return 1;
+    }
+    fill(text, size);
+
+    printf("%-8s %12s %12s %12s %12s\n", "kernel",
+            "newlines", "nth_newline", "utf8_count", "utf8_valid");
+
+    for (k = 0; k < sizeof(names) / sizeof(names[0]); ++k)
+    {
+        double t[4];
+
+        if (scan_use(names[k]) != OK)
+        {
+            printf("%-8s (not supported)\n", names[k]);
+            continue;
+        }
+
+        start = bench_now();
+        for (i = 0; i < rounds; ++i)
+            result += nl = scan_newlines(text, size);
+        t[0] = bench_now() - start;
+
+        /* the last newline, so the whole block is scanned. */
+        start = bench_now();
+        for (i = 0; i < rounds; ++i)
+            result += scan_nth_newline(text, size, nl);
+        t[1] = bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < rounds; ++i)
+            result += scan_utf8_count(text, size);
+        t[2] = bench_now() - start;
+
+        start = bench_now();
+        for (i = 0; i < rounds; ++i)
+            result += scan_utf8_valid(text, size);
+        t[3] = bench_now() - start;
+
+        printf("%-8s %7.2f GB/s %7.2f GB/s %7.2f GB/s %7.2f GB/s\n",
+                names[k], gb / t[0], gb / t[1], gb / t[2], gb / t[3]);
+    }
+
+    /* keep the compiler from removing the scans. */
+    if (result == 0)
+        printf("(no result)\n");
+
+    free(text);
+    return 0;
+}
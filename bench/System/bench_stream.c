@@ -0,0 +1,172 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * stream benchmark: count the lines of a large file, read by plain
+ * read() into a buffer of the caller, or borrowed from a stream in
+ * place. the file is mapped by the stream, or read by read() if it's
+ * opened by stream_fdopen(). then the same text is fed through a pipe
+ * by a child process. the file is in the page cache, so the disk is
+ * not measured.
+ *
+ * usage: bench_stream [megabytes] [file]
+ */
+
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <System/stream.h>
+#include "../bench.h"
+
+
+#define CHUNK STREAM_BUFSIZE
+
+
+/* count the newlines of text. */
+static size_t count_lines(char const *text, size_t len)
+{
+    char const *end = text + len;
+    size_t n = 0;
+
+    while ((text = memchr(text, '\n', end - text)) != NULL)
+        ++n, ++text;
+    return n;
+}
+
+
+/* count the lines read by read(). */
+static size_t plain_read(int fd)
+{
+    static char buf[CHUNK];
+    ssize_t n;
+    size_t lines = 0;
+
+    while ((n = read(fd, buf, CHUNK)) > 0)
+        lines += count_lines(buf, (size_t)n);
+    close(fd);
+    return lines;
+}
+
+
+/* count the lines borrowed from stream. */
+static size_t borrow(struct stream *s)
+{
+    char const *window;
+    size_t len, lines = 0;
+
+    while ((window = stream_borrow(s, 1, &len)) != NULL)
+    {
+        lines += count_lines(window, len);
+        stream_release(s, len);
+    }
+    stream_close(s);
+    return lines;
+}
+
+
+/* feed the file through a pipe by a child process. */
+static int open_pipe(char const *name, pid_t *pid)
+{
+    struct stream in;
+    char const *window;
+    size_t len;
+    int fds[2];
+
+    if (pipe(fds) != 0 || (*pid = fork()) < 0)
+        return -1;
+
+    if (*pid == 0)
+    {
+        close(fds[0]);
+        if (stream_open(&in, name, STREAM_READ) == FAIL)
+            _exit(1);
+        while ((window = stream_borrow(&in, 1, &len)) != NULL)
+        {
+            ssize_t n = write(fds[1], window, len < CHUNK ? len : CHUNK);
+
+            if (n <= 0)
+                _exit(1);
+            stream_release(&in, (size_t)n);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    return fds[0];
+}
+
+
+static void report(char const *what, size_t size, size_t lines,
+        size_t expect, double t)
+{
+    printf("%-28s %8.0f MB/s%s\n", what, size / t / 1e6,
+            lines == expect ? "" : "  (lines mismatch)");
+}
+
+
+int main(int argc, char **argv)
+{
+    size_t size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 1024) << 20;
+    char const *name = argc > 2 ? argv[2] : "bench_stream.tmp";
+    size_t i, n, lines, expect = 0;
+    struct stream s;
+    double start;
+    pid_t pid;
+    char *text;
+    FILE *fp;
+
+    if ((text = malloc(CHUNK * 16)) == NULL
+            || (fp = fopen(name, "wb")) == NULL)
+    {
+        fprintf(stderr, "can't create %s\n", name);
+        return 1;
+    }
+    for (i = 0; i < size; i += n)
+    {
+        n = size - i < CHUNK * 16 ? size - i : CHUNK * 16;
+        bench_fill_text(text, n, 80);
+        expect += count_lines(text, n);
+        fwrite(text, 1, n, fp);
+    }
+    fclose(fp);
+    free(text);
+    printf("%lu MiB, %lu lines\n", (unsigned long)(size >> 20),
+            (unsigned long)expect);
+
+    /* warm up the page cache. */
+    plain_read(open(name, O_RDONLY));
+
+    start = bench_now();
+    lines = plain_read(open(name, O_RDONLY));
+    report("file, read()", size, lines, expect, bench_now() - start);
+
+    start = bench_now();
+    stream_open(&s, name, STREAM_READ);
+    lines = borrow(&s);
+    report("file, borrow mapped", size, lines, expect, bench_now() - start);
+
+    start = bench_now();
+    stream_fdopen(&s, open(name, O_RDONLY), STREAM_READ);
+    lines = borrow(&s);
+    report("file, borrow buffered", size, lines, expect,
+            bench_now() - start);
+
+    start = bench_now();
+    lines = plain_read(open_pipe(name, &pid));
+    waitpid(pid, NULL, 0);
+    report("pipe, read()", size, lines, expect, bench_now() - start);
+
+    start = bench_now();
+    stream_fdopen(&s, open_pipe(name, &pid), STREAM_READ);
+    lines = borrow(&s);
+    waitpid(pid, NULL, 0);
+    report("pipe, borrow buffered", size, lines, expect,
+            bench_now() - start);
+
+    if (argc <= 2)
+        remove(name);
+    return 0;
+}
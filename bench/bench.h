@@ -0,0 +1,111 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+#include <stdio.h>
+
+#ifdef VIME_ON_UNIX
+#  include <time.h>
+#  include <unistd.h>
+#  include <sys/resource.h>
+#else /* VIME_ON_UNIX */
+#  include <time.h>
+#endif /* VIME_ON_UNIX */
+
+
+/**
+ * \file bench.h
+ *
+ * the helper routines for VimE benchmark programs.
+ *
+ * benchmarks are not part of VimE, so they can use the routines of
+ * the operating system directly.
+ */
+
+
+#ifndef VIME_BENCH_H
+#define VIME_BENCH_H
+
+
+/**
+ * get the current time in seconds, used to measure elapsed time.
+ */
+#ifdef VIME_ON_UNIX
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+#else /* VIME_ON_UNIX */
+static inline double bench_now(void)
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+#endif /* VIME_ON_UNIX */
+
+
+/**
+ * get the resident memory of current process in KiB, or the peak
+ * resident memory if the current one is not available.
+ */
+#ifdef VIME_ON_UNIX
+static inline size_t bench_rss_kb(void)
+{
+    struct rusage usage;
+    unsigned long pages, resident;
+    FILE *fp = fopen("/proc/self/statm", "r");
+
+    if (fp != NULL)
+    {
+        int count = fscanf(fp, "%lu %lu", &pages, &resident);
+        fclose(fp);
+        if (count == 2)
+            return resident * (size_t)sysconf(_SC_PAGESIZE) / 1024;
+    }
+
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss;
+}
+#else /* VIME_ON_UNIX */
+static inline size_t bench_rss_kb(void)
+{
+    return 0;
+}
+#endif /* VIME_ON_UNIX */
+
+
+/**
+ * a small and fast random generator (xorshift64), benchmarks need
+ * reproducible input.
+ */
+static uint64_t bench_seed = 88172645463325252ULL;
+
+static inline uint64_t bench_rand(void)
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 7;
+    bench_seed ^= bench_seed << 17;
+    return bench_seed;
+}
+
+
+/**
+ * fill a buffer with lines of random printable text, about avglen
+ * bytes per line.
+ */
+static inline void bench_fill_text(char *buf, size_t len, size_t avglen)
+{
+    size_t i;
+
+    for (i = 0; i < len; ++i)
+    {
+        uint64_t r = bench_rand();
+        buf[i] = r % avglen == 0 ? '\n' : (char)(' ' + (r >> 8) % 95);
+    }
+}
+
+
+#endif /* VIME_BENCH_H */
@@ -4,7 +4,9 @@
 
 
 #include <defs.h>
-#include <Support/array.h>
+#include <Support/hook.h>
+#include <Core/mappings.h>
+#include <Core/operator.h>
 
 
 /**
@@ -18,6 +20,93 @@
  * modified into the mappinged text. e.g. if a mapping maps text `foo'
  * into `bar', then if you input abcfooabc, it will change to
  * abcbarabc.
+ *
+ * the keys not mapped are executed by op_exec(). but a paste or a
+ * :normal may feed megabytes of keys at once, so with #KC_BATCH (in
+ * insert mode) a run of literal keys -- keys without operator and
+ * without mapping starts with them, they would only reach the default
+ * operation one by one -- is passed to insert_hook at once. the hook
+ * inserts the run as one edit, with one undo entry and one redraw.
+ */
+
+
+#ifndef VIME_KEYCACHE_H
+#define VIME_KEYCACHE_H
+
+
+/** no flags in key cache. */
+#define KC_FLAGS_CLEAR  0x00000000
+
+/** pass the runs of literal keys to insert_hook. */
+#define KC_BATCH        0x00000001
+
+/** the max depth of mappings expanded in mappings. */
+#define KC_MAP_DEPTH    100
+
+
+/**
+ * the argument of insert_hook of #keycache.
+ */
+struct kc_text
+{
+    char const *text;   /**< the literal keys. */
+    size_t len;         /**< the count of keys. */
+};
+
+
+/**
+ * the key cache struction.
+ */
+struct keycache
+{
+    struct map_trie *maps;  /**< the mappings of current mode, or NULL. */
+    struct op_table *ops;   /**< the operators of current mode. */
+    int flags;              /**< the flags of key cache. */
+
+    struct hook insert_hook;    /**< hooks to insert literal keys. */
+
+    char *keys;         /**< the keys pending, a prefix of some lhs. */
+    size_t len;         /**< the count of keys pending. */
+    size_t size;        /**< the size of keys. */
+    int depth;          /**< the depth of mappings expanding. */
+};
+
+/** the default constructor of #keycache. */
+#define KEYCACHE_INIT {NULL, NULL, KC_FLAGS_CLEAR, HOOK_INIT, NULL, 0, 0, 0}
+
+
+/**
+ * initialize a key cache.
+ */
+struct keycache *kc_init(struct keycache *kc, struct map_trie *maps,
+        struct op_table *ops);
+
+
+/**
+ * drop a key cache, the keys pending are discarded.
+ */
+void kc_drop(struct keycache *kc);
+
+
+/**
+ * feed keys to key cache.
+ *
+ * the keys are mapped and executed, except the keys at end that are a
+ * prefix of some lhs, they are kept until more keys are fed, or
+ * kc_timeout() is called.
+ *
+ * \param kc the key cache.
+ * \param keys the keys.
+ * \param len the count of keys.
+ * \return OK for success, or FAIL if no memory to keep the keys.
+ */
+int kc_feed(struct keycache *kc, char const *keys, size_t len);
+
+
+/**
+ * the keys pending are timeout, map (or not map) and execute them.
  */
+void kc_timeout(struct keycache *kc);
 
 
+#endif /* VIME_KEYCACHE_H */
@@ -0,0 +1,155 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+#include <Core/memcache.h>
+#include <System/stream.h>
+#include <System/thread.h>
+
+
+/**
+ * \file loader.h
+ *
+ * the asynchronous loader of buffer text.
+ *
+ * opening a file of several GB must show the first screen at once. the
+ * loader reads the file in a background thread, by chunks of
+ * #LD_CHUNK bytes, and counts the newlines of each chunk. the chunks
+ * read are handed to the main thread, vime_step() calls ld_poll() to
+ * attach them into the memcache (see mc_attach()), it only links a
+ * piece for each chunk, so the input is never blocked by the file.
+ * the view shows the text already in memcache, and ld_progress() tells
+ * how much text and lines are read.
+ *
+ * a regular file is mapped, the chunks point into the mapping, and the
+ * thread only touches the pages to count newlines. a pipe, or a file
+ * can't be mapped, is read by a #stream, and the chunks are copied
+ * into blocks owned by the memcache (see mc_adopt()).
+ *
+ * the memcache is only touched by the main thread. the text is always
+ * attached at the end of text loaded, which is a mark, so the text
+ * can be edited while it's loading. if the thread can't be created,
+ * ld_poll() reads some chunks itself.
+ */
+
+
+#ifndef VIME_LOADER_H
+#define VIME_LOADER_H
+
+
+/** the max length of a chunk read by loader. */
+#define LD_CHUNK        MC_PIECE_MAX
+
+/** the count of chunks read by ld_poll() if there is no thread. */
+#define LD_POLL_CHUNKS  16
+
+
+/** all text is loaded. */
+#define LD_DONE         0
+
+/** the loader is reading the text. */
+#define LD_BUSY         1
+
+/** the loader failed, by read error or no memory. */
+#define LD_FAIL         2
+
+
+/**
+ * a chunk of text read by loader.
+ */
+struct ld_chunk
+{
+    struct ld_chunk *next;  /**< the next chunk read. */
+    char const *text;       /**< the text of chunk. */
+    size_t len;             /**< the length of text. */
+    size_t nl;              /**< the count of newlines in text. */
+    struct mc_block *block; /**< the block holds the text, or NULL if
+                                 text is in the mapped file. */
+};
+
+
+/**
+ * the loader struction.
+ */
+struct loader
+{
+    struct memcache *mc;    /**< the memcache loaded into. */
+    struct mc_mark end;     /**< the end of text attached. */
+    size_t size;            /**< the size of file, or #MC_NPOS if it's
+                                 not known, e.g. a pipe. */
+
+    /* used by the thread only. */
+    struct stream stream;   /**< the stream, if file is not mapped. */
+    char const *text;       /**< the mapped text not read. */
+    size_t left;            /**< the length of mapped text not read. */
+
+    struct thread thread;   /**< the thread reads the text. */
+    int threaded;           /**< whether the thread is running. */
+
+    /* shared with the thread, under lock. */
+    struct mutex lock;      /**< the lock of the fields below. */
+    struct ld_chunk *ready; /**< the chunks read, not attached yet. */
+    struct ld_chunk **tail; /**< the next of last chunk in ready. */
+    size_t bytes;           /**< the count of bytes read. */
+    size_t lines;           /**< the count of newlines read. */
+    int state;              /**< #LD_BUSY, #LD_DONE or #LD_FAIL. */
+    int cancel;             /**< whether the thread should stop. */
+};
+
+
+/**
+ * open a file and start loading it into a empty memcache.
+ *
+ * \param ld the loader.
+ * \param mc the memcache, must be empty.
+ * \param name the file name.
+ * \return OK for success, or FAIL if the file can't be opened.
+ */
+int ld_open(struct loader *ld, struct memcache *mc, char const *name);
+
+
+/**
+ * start loading a file descriptor into a empty memcache, e.g. a pipe.
+ *
+ * \param ld the loader.
+ * \param mc the memcache, must be empty.
+ * \param fd the file descriptor, it's closed by ld_close().
+ * \return OK for success, or FAIL if no memory.
+ */
+int ld_fdopen(struct loader *ld, struct memcache *mc, int fd);
+
+
+/**
+ * attach the chunks read into memcache, it never waits for the
+ * thread.
+ *
+ * \param ld the loader.
+ * \return #LD_BUSY if more text will be read, #LD_DONE if all text is
+ *         attached, or #LD_FAIL.
+ */
+int ld_poll(struct loader *ld);
+
+
+/**
+ * get the progress of loader.
+ *
+ * \param ld the loader.
+ * \param pbytes the count of bytes read is stored here, or NULL.
+ * \param plines the count of newlines read is stored here, or NULL.
+ * \return #LD_BUSY, #LD_DONE or #LD_FAIL, the state of the thread.
+ */
+int ld_progress(struct loader *ld, size_t *pbytes, size_t *plines);
+
+
+/**
+ * stop loading, the text attached is kept in memcache, the chunks not
+ * attached are discarded.
+ *
+ * \param ld the loader.
+ */
+void ld_close(struct loader *ld);
+
+
+#endif /* VIME_LOADER_H */
@@ -3,3 +3,199 @@
  */
 
 
+#include <defs.h>
+#include <Support/hashtab.h>
+#include <Support/sbtree.h>
+
+
+/**
+ * \file mappings.h
+ *
+ * the mappings matcher of VimE.
+ *
+ * the mappings of a mode are compiled into a byte trie (#map_trie).
+ * the input in key-cache is matched by advancing a #map_match one
+ * node per keystroke, so the cost of a keystroke doesn't depend on
+ * the count of mappings, or the length of their lhs.
+ *
+ * the children of the root are found in a flat array indexed by the
+ * byte, the other edges are found in a hashtable keyed by the parent
+ * node and the byte. :map and :unmap only add or remove the nodes of
+ * one lhs, the trie is never rebuilt.
+ */
+
+
+#ifndef VIME_MAPPINGS_H
+#define VIME_MAPPINGS_H
+
+
+/**
+ * the mappings keys struction.
+ */
+struct mapping_key
+{
+    struct sbtree_entry node; /**< the sbtree node. */
+    char    *key;   /**< the lhs text of this mappings. */
+    char    *value; /**< the text mappings to map. */
+    int     flags;  /**< the flags of this mappings. */
+};
+
+
+/** the default constructor of mappings */
+#define MAPPING_KEY_INIT {SBTREE_INIT, NULL, NULL, MAP_FLAGS_CLEAR}
+
+
+/** no flags in mappings */
+#define MAP_FLAGS_CLEAR     0x00000000
+
+/** a silent mappings. */
+#define MAP_FLAGS_SILENT    0x00000001
+
+
+/**
+ * the edge from a node to its child.
+ */
+struct map_edge
+{
+    struct map_node *from;  /**< the parent node. */
+    int byte;               /**< the byte of edge. */
+};
+
+
+/**
+ * the node of #map_trie, a prefix of some lhs.
+ */
+struct map_node
+{
+    struct hash_entry entry;    /**< the node in edges of #map_trie. */
+    struct map_edge edge;       /**< the key of entry. */
+
+    struct map_node *child;     /**< the first child, or NULL. */
+    struct map_node *next;      /**< the next sibling, or NULL. */
+    struct mapping_key *map;    /**< the mapping of this lhs, or NULL. */
+};
+
+
+/**
+ * the trie of the lhs of mappings.
+ */
+struct map_trie
+{
+    struct map_node root;           /**< the empty prefix. */
+    struct map_node *first[256];    /**< the children of root. */
+    struct hashtable edges;         /**< the other nodes, by edge. */
+    size_t count;                   /**< the count of mappings. */
+};
+
+/** the default constructor of #map_trie. */
+#define MAP_TRIE_INIT {{HASH_ENTRY_INIT, {NULL, 0}, NULL, NULL, NULL}, \
+    {NULL}, HASHTABLE_INIT, 0}
+
+
+/** the keys fed is not a prefix of any lhs. */
+#define MAP_NONE        0
+
+/** the keys fed is a prefix of some longer lhs, wait for more keys. */
+#define MAP_PREFIX      1
+
+/**
+ * the keys fed is a lhs, and a prefix of some longer lhs. wait for
+ * more keys, or use the mapping if timeout.
+ */
+#define MAP_AMBIGUOUS   2
+
+/** the keys fed is a lhs, and not a prefix of others. */
+#define MAP_FULL        3
+
+
+/**
+ * the state of matching the input against a #map_trie.
+ *
+ * after #MAP_NONE, the keys fed are resolved by the caller: if full
+ * is not NULL, the first full_len keys are mapped and the others are
+ * fed again, or the first key is not mapped. the match must be reset
+ * before feeding again, and after the trie is changed.
+ */
+struct map_match
+{
+    struct map_trie *trie;      /**< the trie to match. */
+    struct map_node *node;      /**< the node of the keys fed. */
+    size_t len;                 /**< the count of keys fed. */
+    struct mapping_key *full;   /**< the longest mapping matched. */
+    size_t full_len;            /**< the length of lhs of full. */
+};
+
+
+/**
+ * initialize a mapping trie.
+ */
+struct map_trie *map_trie_init(struct map_trie *trie);
+
+
+/**
+ * drop a mapping trie, free all nodes.
+ *
+ * the mappings are not freed, they are owned by the user.
+ */
+void map_trie_drop(struct map_trie *trie);
+
+
+/**
+ * add a mapping into trie.
+ *
+ * \param trie the mapping trie.
+ * \param map the mapping, the key must be set and not empty.
+ * \return OK for success, or FAIL if the lhs is mapped already, or no
+ *         memory.
+ */
+int map_trie_add(struct map_trie *trie, struct mapping_key *map);
+
+
+/**
+ * remove a mapping from trie, and free the nodes not used.
+ *
+ * \param trie the mapping trie.
+ * \param map the mapping.
+ * \return OK for success, or FAIL if map is not in trie.
+ */
+int map_trie_remove(struct map_trie *trie, struct mapping_key *map);
+
+
+/**
+ * find the mapping of a lhs.
+ *
+ * \return the mapping, or NULL if lhs is not mapped.
+ */
+struct mapping_key *map_trie_lookup(struct map_trie *trie, char const *lhs);
+
+
+/**
+ * get the child of a node.
+ *
+ * \param trie the mapping trie.
+ * \param node the node, or &trie->root.
+ * \param byte the byte of the edge.
+ * \return the child, or NULL if there is no such prefix.
+ */
+struct map_node *map_trie_next(struct map_trie *trie,
+        struct map_node *node, int byte);
+
+
+/**
+ * initialize (or reset) a match, nothing is fed.
+ */
+struct map_match *map_match_init(struct map_match *match,
+        struct map_trie *trie);
+
+
+/**
+ * feed a key to a match.
+ *
+ * \param match the match.
+ * \param byte the key.
+ * \return #MAP_NONE, #MAP_PREFIX, #MAP_AMBIGUOUS or #MAP_FULL.
+ */
+int map_match_feed(struct map_match *match, int byte);
+
+
+#endif /* VIME_MAPPINGS_H */
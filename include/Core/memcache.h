@@ -3,3 +3,454 @@
  */
 
 
+#include <defs.h>
+#include <Support/itree.h>
+#include <Support/sbtree.h>
+#include <System/fmap.h>
+#include <System/fsave.h>
+#include <System/mem.h>
+
+
+/**
+ * \file memcache.h
+ *
+ * the text cache of a buffer.
+ *
+ * memcache holds all text of a buffer, and does all raw operations
+ * on it: insert, delete and replace a range of bytes, and read the
+ * text back. the upper encoding layer only talks with memcache, and
+ * never touches the text itself.
+ *
+ * memcache is a piece table. the original text of the buffer is never
+ * modified, and all text inserted later is appended into add blocks,
+ * which are never moved or modified once written. the buffer text is
+ * a sequence of pieces, each piece points to a run of text in the
+ * original text or in a add block. pieces are kept in a sbtree
+ * ordered by their position in the buffer, and every piece remembers
+ * the text length of its subtree, so a byte offset can be found in
+ * O(log n), and inserting or deleting text never copies existed text.
+ *
+ * every piece also remembers the count of newlines in itself and in
+ * its subtree, so memcache is a line index, too: the offset of a line
+ * and the line of a offset are both found in O(log n), and the index
+ * is updated with every change of text.
+ *
+ * the original text is loaded lazily: loading only splits it into
+ * pieces, and never touches the text itself. the newlines of a
+ * original piece are counted at the first time a line query needs
+ * them, so jumping to a line only scans the text before that line
+ * once. a file can be mapped into memory by mc_open(), so the
+ * original text is never copied into the heap, and the pages never
+ * touched are never read at all.
+ *
+ * no piece is longer than #MC_PIECE_MAX, so any operation that needs
+ * scan a piece (e.g. split it or count its newlines) only touches a
+ * single small chunk of text, even for a very large file.
+ *
+ * memcache also keeps the marks of the buffer. a mark is a position
+ * in the text, it's moved with the text when text is inserted or
+ * deleted before it. marks are kept in a #itree with relative
+ * offsets, so a edit moves all marks after it in O(log n), instead of
+ * adjusting every mark, see mc_mark_add().
+ *
+ * if memcache has a swapfile, every change is logged into it after
+ * the piece tree is changed, see swapfile.h.
+ */
+
+
+#ifndef VIME_MEMCACHE_H
+#define VIME_MEMCACHE_H
+
+
+/** the maximum length of a piece. */
+#define MC_PIECE_MAX (1 << 16)
+
+/** the size of a add block. */
+#define MC_BLOCK_SIZE (1 << 16)
+
+
+/** the invalid offset or line number. */
+#define MC_NPOS ((size_t)-1)
+
+
+/**
+ * the piece struction of memcache.
+ */
+struct mc_piece
+{
+    struct sbtree_entry node; /**< the sbtree node, ordered by position. */
+    size_t bytes;       /**< the text length of the subtree. */
+    size_t newlines;    /**< the count of newlines of the subtree. */
+    char const *text;   /**< the text of this piece. */
+    size_t len;         /**< the length of text. */
+    size_t nl;          /**< the count of newlines in text, or #MC_NPOS
+                             if it isn't counted yet. */
+    size_t lazy;        /**< the count of pieces in the subtree that
+                             newlines are not counted. */
+};
+
+/** get the piece from the sbtree node. */
+#define MC_PIECE_ENTRY(ptr) SBTREE_ENTRY((ptr), struct mc_piece, node)
+
+
+/**
+ * the add block struction of memcache.
+ *
+ * all text inserted into memcache is stored in add blocks, text
+ * written into a block will never change, so pieces can point to it
+ * safely.
+ */
+struct mc_block
+{
+    struct mc_block *next;  /**< the elder block. */
+    size_t used;            /**< the used bytes of the block. */
+    char text[1];           /**< the text of the block, it's
+                                 #MC_BLOCK_SIZE bytes actually. */
+};
+
+
+/**
+ * the mark struction of memcache.
+ *
+ * the mark is embedded in the struction of user, e.g. a named mark or
+ * a extmark of a plugin, memcache never allocates or frees it.
+ */
+struct mc_mark
+{
+    struct itree_entry entry;   /**< the entry in the mark tree, ordered
+                                     by offset. */
+};
+
+/** get the container of the mark. */
+#define MC_MARK_ENTRY(ptr, type, field) container_of(ptr, type, field)
+
+
+struct swapfile;
+
+
+/**
+ * the memcache struction.
+ */
+struct memcache
+{
+    struct sbtree_entry *root;  /**< the piece tree. */
+    struct mc_block *blocks;    /**< the add blocks, newest first. */
+    struct mc_block *loaded;    /**< the blocks of original text, see
+                                     mc_adopt(). */
+    fixed_alloc_t piece_alloc;  /**< the allocator of pieces. */
+    struct fmap file;           /**< the mapped original file. */
+    struct itree marks;         /**< the marks of text. */
+    struct swapfile *swap;      /**< the swapfile logs the changes, or
+                                     NULL, see swp_create(). */
+};
+
+/** the default constructor of #memcache. */
+#define MEMCACHE_INIT {&sbtree_nil, NULL, NULL, NULL, FMAP_INIT, \
+    ITREE_INIT, NULL}
+
+
+/**
+ * initialize a memcache.
+ *
+ * \param mc the memcache need to initialize.
+ * \return the memcache, or NULL if no memory.
+ */
+struct memcache *mc_init(struct memcache *mc);
+
+
+/**
+ * destroy a memcache, free all pieces and add blocks, and unmap the
+ * original file if it's opened by mc_open(). all marks are removed.
+ *
+ * \param mc the memcache to destroy.
+ */
+void mc_drop(struct memcache *mc);
+
+
+/**
+ * load the original text into a empty memcache.
+ *
+ * the text is not copied, so it must be alive until the memcache is
+ * dropped.
+ *
+ * \param mc the memcache, must be empty.
+ * \param text the original text.
+ * \param len the length of text.
+ * \return OK for success, or FAIL if no memory.
+ */
+int mc_load(struct memcache *mc, char const *text, size_t len);
+
+
+/**
+ * map a file into a empty memcache as the original text.
+ *
+ * the file is mapped read-only, and no text of it is read when it's
+ * opened, the cost is O(1) in the file size except splitting it into
+ * pieces. the file is unmapped when the memcache is dropped.
+ *
+ * \param mc the memcache, must be empty.
+ * \param name the file name.
+ * \return OK for success, or FAIL if the file can't be mapped or no
+ *         memory.
+ */
+int mc_open(struct memcache *mc, char const *name);
+
+
+/**
+ * insert text into memcache without copying it, e.g. the text loaded
+ * from a stream piece by piece.
+ *
+ * \param mc the memcache.
+ * \param offset the position text inserted, must not bigger than
+ *        mc_size().
+ * \param text the text, it must be alive until the memcache is
+ *        dropped, see mc_adopt().
+ * \param len the length of text.
+ * \param nl the count of newlines in text, or #MC_NPOS if it's not
+ *        counted yet. it's only used if text fits in one piece.
+ * \return OK for success, or FAIL if offset is out of range or no
+ *         memory.
+ */
+int mc_attach(struct memcache *mc, size_t offset,
+        char const *text, size_t len, size_t nl);
+
+
+/**
+ * give a block of original text to memcache, the block is freed when
+ * the memcache is dropped. the block is not a add block, no text is
+ * appended into it.
+ *
+ * \param mc the memcache.
+ * \param block the block alloced by vime_malloc().
+ */
+void mc_adopt(struct memcache *mc, struct mc_block *block);
+
+
+/**
+ * write all text of memcache into a file, atomically.
+ *
+ * the runs of original text mapped by mc_open() are copied from the
+ * original file by the kernel, the other pieces are written by a
+ * gathering write, see fsave.h. the file can be the original file
+ * mapped, then the memcache maps the new one, all pieces point into
+ * it, and the swapfile gets a new checkpoint, see swp_saved(). it's
+ * not called while a loader is loading the memcache.
+ *
+ * \param mc the memcache.
+ * \param name the file name.
+ * \return OK for success, or FAIL if the file can't be written, it's
+ *         not changed then.
+ */
+int mc_save(struct memcache *mc, char const *name);
+
+
+/**
+ * get the text length of the memcache.
+ *
+ * \param mc the memcache.
+ * \return the length of all text in memcache.
+ */
+size_t mc_size(struct memcache const *mc);
+
+
+/**
+ * insert text into memcache.
+ *
+ * \param mc the memcache.
+ * \param offset the position text inserted, must not bigger than
+ *        mc_size().
+ * \param text the text to insert, it will be copied.
+ * \param len the length of text.
+ * \return OK for success, or FAIL if offset is invalid or no memory.
+ *
+ * \remark when no memory, a part of text may be inserted.
+ */
+int mc_insert(struct memcache *mc, size_t offset,
+        char const *text, size_t len);
+
+
+/**
+ * delete text from memcache.
+ *
+ * \param mc the memcache.
+ * \param offset the beginning of text to delete.
+ * \param len the length of text to delete.
+ * \return OK for success, or FAIL if the range is invalid or no
+ *         memory.
+ */
+int mc_delete(struct memcache *mc, size_t offset, size_t len);
+
+
+/**
+ * replace a range of text in memcache.
+ *
+ * \param mc the memcache.
+ * \param offset the beginning of text to replace.
+ * \param len the length of text to replace.
+ * \param text the new text.
+ * \param textlen the length of new text.
+ * \return OK for success, or FAIL if the range is invalid or no
+ *         memory.
+ */
+int mc_replace(struct memcache *mc, size_t offset, size_t len,
+        char const *text, size_t textlen);
+
+
+/**
+ * read text from memcache.
+ *
+ * \param mc the memcache.
+ * \param offset the beginning of text to read.
+ * \param buf the buffer received the text.
+ * \param buflen the length of buf.
+ * \return the count of bytes read.
+ */
+size_t mc_read(struct memcache *mc, size_t offset,
+        char *buf, size_t buflen);
+
+
+/**
+ * get the text at the offset without copy.
+ *
+ * \param mc the memcache.
+ * \param offset the offset of text.
+ * \param plen points to the variable received the length of the
+ *        returned text.
+ * \return the pointer to the text at offset, the text is continuous
+ *         until *plen bytes, or NULL if offset is out of range.
+ *
+ * \remark the text returned is valid until next change of memcache.
+ */
+char const *mc_chunk(struct memcache *mc, size_t offset, size_t *plen);
+
+
+/**
+ * get the count of lines in memcache.
+ *
+ * lines are separated by newlines, so a text with n newlines has n + 1
+ * lines, and the last line is empty if the text ends with a newline.
+ *
+ * \param mc the memcache.
+ * \return the count of lines, at least 1.
+ *
+ * \remark all newlines not counted yet are counted here, so it scans
+ *         the whole original text at the first call.
+ */
+size_t mc_line_count(struct memcache *mc);
+
+
+/**
+ * get the offset of a line.
+ *
+ * \param mc the memcache.
+ * \param lnum the line number, count from zero.
+ * \return the offset of the first byte of the line, or #MC_NPOS if
+ *         there is no such line.
+ */
+size_t mc_line_offset(struct memcache *mc, size_t lnum);
+
+
+/**
+ * get the line contains a offset.
+ *
+ * \param mc the memcache.
+ * \param offset the offset, must not bigger than mc_size().
+ * \return the line number count from zero, or #MC_NPOS if the offset
+ *         is out of range.
+ */
+size_t mc_offset_line(struct memcache *mc, size_t offset);
+
+
+/**
+ * get the length of a line, not include the newline.
+ *
+ * \param mc the memcache.
+ * \param lnum the line number, count from zero.
+ * \return the length of the line, or #MC_NPOS if there is no such
+ *         line.
+ */
+size_t mc_line_length(struct memcache *mc, size_t lnum);
+
+
+/**
+ * add a mark at a offset.
+ *
+ * the mark is moved when text is inserted or deleted before it, text
+ * inserted at the offset of mark is before it, so a mark at the start
+ * of a line moves with the line when lines are inserted above. when
+ * the text contains the mark is deleted, the mark is moved to where
+ * the text was (after the text inserted by mc_replace()).
+ *
+ * \param mc the memcache.
+ * \param mark the mark, must not be in memcache.
+ * \param offset the offset of mark, must not bigger than mc_size().
+ * \return OK for success, or FAIL if offset is out of range.
+ */
+int mc_mark_add(struct memcache *mc, struct mc_mark *mark, size_t offset);
+
+
+/**
+ * remove a mark from memcache.
+ *
+ * \param mc the memcache.
+ * \param mark the mark, must be in memcache.
+ */
+void mc_mark_remove(struct memcache *mc, struct mc_mark *mark);
+
+
+/**
+ * get the offset of a mark, in O(log n).
+ *
+ * \param mark the mark, must be in memcache.
+ * \return the offset of mark.
+ */
+size_t mc_mark_offset(struct mc_mark const *mark);
+
+
+/**
+ * get the count of marks in memcache.
+ */
+size_t mc_mark_count(struct memcache const *mc);
+
+
+/**
+ * get the mark of a rank, i.e. the rank + 1 th mark in the order of
+ * offset, in O(log n).
+ *
+ * \param mc the memcache.
+ * \param rank the rank of mark, count from zero.
+ * \return the mark, or NULL if rank is out of range.
+ */
+struct mc_mark *mc_mark_select(struct memcache *mc, size_t rank);
+
+
+/**
+ * get the rank of a mark, i.e. the count of marks before it, in
+ * O(log n).
+ *
+ * \param mark the mark, must be in memcache.
+ * \return the rank of mark.
+ */
+size_t mc_mark_rank(struct mc_mark *mark);
+
+
+/**
+ * find the first mark at or after a offset, in O(log n).
+ *
+ * \param mc the memcache.
+ * \param offset the offset.
+ * \return the mark found, or NULL if there is no such mark.
+ */
+struct mc_mark *mc_mark_find(struct memcache *mc, size_t offset);
+
+
+/**
+ * get the next mark in the order of offset.
+ *
+ * \param mark the mark, must be in memcache.
+ * \return the next mark, or NULL if mark is the last one.
+ */
+struct mc_mark *mc_mark_next(struct mc_mark *mark);
+
+
+#endif /* VIME_MEMCACHE_H */
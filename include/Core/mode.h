@@ -5,6 +5,8 @@
 
 #include <defs.h>
 #include <Support/sbtree.h>
+#include <Support/list.h>
+#include <Core/mappings.h>
 
 
 /**
@@ -34,34 +36,11 @@
 #define VIME_MODE_H
 
 
-/**
- * the mappings keys struction.
- */
-struct mapping_key
-{
-    struct sbtree_entry node; /**< the sbtree node. */
-    char    *key;   /**< the lhs text of this mappings. */
-    char    *value; /**< the text mappings to map. */
-    int     flags;  /**< the flags of this mappings. */
-};
-
-
-/** the default constructor of mappings */
-#define MAPPING_KEY_INIT {SBTREE_INIT, NULL, NULL, MAP_FLAGS_CLEAR}
-
-
-/** no flags in mappings */
-#define MAP_FLAGS_CLEAR     0x00000000
-
-/** a silent mappings. */
-#define MAP_FLAGS_SILENT    0x00000001
-
-
 /** the operator process function argument structions. */
 struct op_argument
 {
     int     count;      /**< the count of operator. */
-    int     register;   /**< the register of operator. */
+    int     regname;    /**< the register of operator. */
     int     flags;      /**< the flags of operator. */
 
     char    *text;      /**< the argument string text. */
@@ -77,7 +56,7 @@ struct op_argument
 
 
 /** the operator process function type */
-typedef void (*op_proc_t) __ARGS((struct op_argument *args));
+typedef void (*op_proc_t)(struct op_argument *args);
 
 
 /**
@@ -87,7 +66,7 @@ struct operator_key
 {
     struct sbtree_entry node; /**< the sbtree node */
     int         key;        /**< the key value of the operator */
-    op_func_t   proc_func;  /**< the process function for operator */
+    op_proc_t   proc_func;  /**< the process function for operator */
     void        *args;      /**< user argument for process function */
 };
 
@@ -104,11 +83,13 @@ struct vime_mode
     char    *mode_name;         /**< the name of mode. */
 
     struct sbtree_entry *op_entry; /**< the operator entries of the mode. */
-    struct sbtree_entry *map_entry; /**< the map entries of the mode. */
+    struct map_trie map_trie;   /**< the map entries of the mode, by
+                                     their lhs. it's the only place keeps
+                                     them, see map_trie_add(). */
 };
 
 /** the default constructor of #vime_mode */
-#define VIME_MODE_INIT {LIST_ENTRY_INIT, NULL, &sbtree_nil, &sbtree_nil}
+#define VIME_MODE_INIT {LIST_ENTRY_INIT, NULL, &sbtree_nil, MAP_TRIE_INIT}
 
 
 #endif /* VIME_MODE_H */
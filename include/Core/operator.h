@@ -4,6 +4,8 @@
 
 
 #include <defs.h>
+#include <Support/hashtab.h>
+#include <Support/hook.h>
 
 
 /**
@@ -13,12 +15,18 @@
  *
  * `operator' is a table that contain all actions. actions can be
  * emited by charactor command. e.g. when you press "l", a operator
- * named "forward_char" will be emited. and you will find cursor 
+ * named "forward_char" will be emited. and you will find cursor
  * advanced a charactor on screen.
  *
  * action is a hook struction. if a command can find in operator
  * table, then the action will be called. so you can add, remove,
  * modify action list easily -- they are just #list.
+ *
+ * every keystroke is a operator, even in insert mode, so finding the
+ * operator of a command must be cheap. the commands below
+ * #OP_FAST_MAX (the bytes, and the bytes with #OP_META) are kept in a
+ * flat array indexed by the command, and found with one load; only
+ * the other commands (e.g. special keys) are found in cmd_ht.
  */
 
 
@@ -26,6 +34,13 @@
 #define VIME_OPERATOR_H
 
 
+/** the meta modifier bit of a byte command. */
+#define OP_META 0x100
+
+/** the commands below it are found in the flat array of #op_table. */
+#define OP_FAST_MAX 0x200
+
+
 /**
  * operator entry struction.
  */
@@ -42,10 +57,10 @@ struct op_entry
 #define OP_ENTRY_INIT {NULL, 0, HOOK_INIT, HASH_ENTRY_INIT, HASH_ENTRY_INIT}
 
 /** convert from command hash_entry to op_entry. */
-#define OP_CMD_ENTRY(ptr) HASH_ENTRY((ptr), struct hash_entry, cmd_node)
+#define OP_CMD_ENTRY(ptr) HASH_ENTRY((ptr), struct op_entry, cmd_node)
 
 /** convert from name hash_entry to op_entry. */
-#define OP_NAME_ENTRY(ptr) HASH_ENTRY((ptr), struct hash_entry, name_node)
+#define OP_NAME_ENTRY(ptr) HASH_ENTRY((ptr), struct op_entry, name_node)
 
 
 /**
@@ -56,6 +71,9 @@ struct op_table
     struct hashtable cmd_ht;    /**< command hashtable. */
     struct hashtable name_ht;   /**< op name hashtable. */
 
+    /** the operators of commands below #OP_FAST_MAX, or NULL. */
+    struct op_entry *fast[OP_FAST_MAX];
+
     /* hooks */
     struct hook default_hook;   /**< hooks for default behavior. */
     struct hook remain_hook;    /**< hooks for action remain from
@@ -63,11 +81,13 @@ struct op_table
 };
 
 /** default static constructor for op_entry. */
-#define OP_INIT {HASHTABLE_INIT, HASHTABLE_INIT, HOOK_INIT, HOOK_INIT}
+#define OP_INIT {HASHTABLE_INIT, HASHTABLE_INIT, {NULL}, HOOK_INIT, HOOK_INIT}
 
 
 /**
  * alloc a new operator table.
+ *
+ * \return the table, or NULL if no memory.
  */
 struct op_table *op_table_alloc(void);
 
@@ -81,17 +101,68 @@ void op_table_free(struct op_table *table);
 /**
  * initialize a operator table.
  */
-static op_table *op_table_init(struct op_table *table);
+struct op_table *op_table_init(struct op_table *table);
 
 
 /**
  * drop a operator table.
+ *
+ * the operators are not freed, they are owned by the user.
  */
-void op_table_drop(struct op_table *drop);
+void op_table_drop(struct op_table *table);
+
+
+/**
+ * add a operator into table.
+ *
+ * \param table the operator table.
+ * \param op the operator, the name and command must be set, the name
+ *        may be NULL.
+ * \return OK for success, or FAIL if the command or the name is in
+ *         table already, or no memory.
+ */
+int op_add(struct op_table *table, struct op_entry *op);
+
+
+/**
+ * remove a operator from table.
+ *
+ * \param table the operator table.
+ * \param op the operator, must be in table.
+ */
+void op_remove(struct op_table *table, struct op_entry *op);
+
+
+/**
+ * find the operator of a command.
+ *
+ * \param table the operator table.
+ * \param command the command.
+ * \return the operator, or NULL if not found.
+ */
+struct op_entry *op_lookup(struct op_table *table, int command);
+
+
+/**
+ * find the operator of a name.
+ *
+ * \param table the operator table.
+ * \param name the name of operator.
+ * \return the operator, or NULL if not found.
+ */
+struct op_entry *op_find(struct op_table *table, char const *name);
 
 
 /**
  * exec a operaotr.
+ *
+ * the actions of the operator of command are called with a pointer to
+ * command. if there is no such operator, or its actions don't return
+ * OK, the default hook is called.
+ *
+ * \param table the operator table.
+ * \param command the command.
+ * \return the value returned by the hook called last.
  */
 int op_exec(struct op_table *table, int command);
 
@@ -3,3 +3,208 @@
  */
 
 
+#include <defs.h>
+#include <Core/memcache.h>
+#include <System/stream.h>
+
+
+/**
+ * \file swapfile.h
+ *
+ * the swapfile of a buffer, to recover the edits after a crash.
+ *
+ * the swapfile is a log. every change of memcache appends a compact
+ * record into it: the offset and the text inserted, the offset and
+ * the length deleted, or the offset of the original text attached by
+ * loader. a record is only encoded into the buffer of a #stream, so
+ * logging a keystroke costs a memcpy(), it's written by one write()
+ * call for many records, and synced by swp_sync() when VimE is idle.
+ *
+ * the file begins with a checkpoint of the piece table: the runs of
+ * original text are referred by their offset in the original file,
+ * and the other pieces are stored in place. when the records logged
+ * are larger than the checkpoint, swp_sync() writes a new checkpoint
+ * into a new file and renames it over the swapfile, so the swapfile
+ * is never much larger than the text not in the original file, and
+ * the log replayed by recovery is short.
+ *
+ * the layout of swapfile is the magic #SWP_MAGIC, and a sequence of
+ * records, the first one is the header, the second one is the
+ * checkpoint:
+ *
+ *   type (1 byte) | payload length (varint) | payload | crc32 (4 bytes)
+ *
+ * the numbers in payload are varints, 7 bits in a byte, little end
+ * first. the crc32 covers the type, length and payload, so a record
+ * written partly by a crash is found, swp_recover() replays the
+ * records before it.
+ *
+ * the original file is mapped (see fmap.h), it's never paged into the
+ * swapfile, the kernel pages it out when the memory is needed. the
+ * header records the identity of the original file, a file replaced
+ * or changed by others is not recovered. when mc_save() replaces the
+ * original file, the memcache maps the new one, and a new checkpoint
+ * refers to it, see swp_saved().
+ */
+
+
+#ifndef VIME_SWAPFILE_H
+#define VIME_SWAPFILE_H
+
+
+/** the magic of swapfile. */
+#define SWP_MAGIC       "VimESwp2"
+
+/** the length of #SWP_MAGIC. */
+#define SWP_MAGIC_LEN   8
+
+/** the min count of bytes logged before a new checkpoint. */
+#define SWP_CHECKPOINT_MIN  (1024 * 1024)
+
+
+/** the header record: the size, device, inode, modify time and name of
+ * the original file. */
+#define SWP_HEADER      'H'
+
+/** the checkpoint record: the size of text, and the pieces. */
+#define SWP_CHECKPOINT  'C'
+
+/** the insert record: the offset, and the text inserted. */
+#define SWP_INSERT      'I'
+
+/** the original text record: the offset, and the offset and length of
+ * the text in the original file. */
+#define SWP_ORIGINAL    'O'
+
+/** the delete record: the offset, and the length deleted. */
+#define SWP_DELETE      'D'
+
+
+/**
+ * the swapfile struction.
+ */
+struct swapfile
+{
+    struct memcache *mc;    /**< the memcache logged. */
+    struct stream stream;   /**< the stream appends records. */
+    char *name;             /**< the name of swapfile. */
+    char *orig;             /**< the name of original file, or NULL. */
+    size_t logged;          /**< the bytes logged after the checkpoint. */
+    size_t checkpoint;      /**< the size of the checkpoint. */
+};
+
+
+/**
+ * create a swapfile for a memcache, and log all changes of it.
+ *
+ * the current text of memcache is written as the checkpoint, so the
+ * swapfile is created after the file is opened by mc_open() or
+ * ld_open(). the swapfile must not exist, it may be the swapfile of
+ * a crashed VimE, or another VimE is editing the file.
+ * swp_close() must be called before the memcache is dropped.
+ *
+ * \param sw the swapfile.
+ * \param mc the memcache, must not have a swapfile.
+ * \param name the name of swapfile.
+ * \param orig the name of original file mapped by memcache, or NULL.
+ * \return OK for success, or FAIL if the swapfile exists or can't be
+ *         written.
+ */
+int swp_create(struct swapfile *sw, struct memcache *mc, char const *name,
+        char const *orig);
+
+
+/**
+ * close the swapfile, the changes of memcache are not logged any more.
+ *
+ * \param sw the swapfile.
+ * \param remove_file whether the swapfile is removed, e.g. the buffer
+ *        is saved.
+ * \return OK for success, or FAIL if the records can't be written.
+ */
+int swp_close(struct swapfile *sw, int remove_file);
+
+
+/**
+ * log the text inserted, it's called by mc_insert().
+ *
+ * \return OK for success, or FAIL if write failed.
+ */
+int swp_insert(struct swapfile *sw, size_t offset, char const *text,
+        size_t len);
+
+
+/**
+ * log the text attached, it's called by mc_attach(). the original text
+ * mapped is logged by its offset in the file.
+ *
+ * \return OK for success, or FAIL if write failed.
+ */
+int swp_attach(struct swapfile *sw, size_t offset, char const *text,
+        size_t len);
+
+
+/**
+ * log the text deleted, it's called by mc_delete().
+ *
+ * \return OK for success, or FAIL if write failed.
+ */
+int swp_delete(struct swapfile *sw, size_t offset, size_t len);
+
+
+/**
+ * write the records logged into the disk, and write a new checkpoint
+ * if the records are too many. it's called when VimE is idle.
+ *
+ * if a record failed to be written, no record is logged after it, and
+ * a new checkpoint is written here, the changes are lost if it fails.
+ *
+ * \param sw the swapfile.
+ * \return OK for success, or FAIL if write failed.
+ */
+int swp_sync(struct swapfile *sw);
+
+
+/**
+ * write a new checkpoint of the current text, and replace the
+ * swapfile atomically.
+ *
+ * \param sw the swapfile.
+ * \return OK for success, or FAIL if write failed, the old swapfile
+ *         is still used.
+ */
+int swp_checkpoint(struct swapfile *sw);
+
+
+/**
+ * write a new checkpoint after the original file is replaced by
+ * mc_save(), it's called by mc_save(). the checkpoint refers to the
+ * new file mapped by memcache, or stores the text of the old file if
+ * the new one can't be mapped.
+ *
+ * \param sw the swapfile.
+ * \return OK for success, or FAIL if write failed, the old swapfile
+ *         is still used, and it can't be recovered.
+ */
+int swp_saved(struct swapfile *sw);
+
+
+/**
+ * recover the text from a swapfile into a empty memcache.
+ *
+ * the original file in the header is mapped by the memcache, it must
+ * be the same file, with the same size and modify time, as the one
+ * when the checkpoint is written. the records after a broken one are
+ * lost by the crash, they are ignored.
+ *
+ * \param mc the memcache, must be empty.
+ * \param name the name of swapfile.
+ * \param pcount the count of records replayed after the checkpoint is
+ *        stored here, if it's not NULL.
+ * \return OK for success, or FAIL if the swapfile or original file is
+ *         broken, or no memory.
+ */
+int swp_recover(struct memcache *mc, char const *name, size_t *pcount);
+
+
+#endif /* VIME_SWAPFILE_H */
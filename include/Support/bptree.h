@@ -0,0 +1,877 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+#include <System/mem.h>
+
+
+/**
+ * \file bptree.h
+ *
+ * B+ tree for VimE.
+ *
+ * #sbtree_entry costs four words in every item, and a lookup chases a
+ * pointer for every level of the tree, so a lookup in a tree of 1M
+ * items misses the cache about 20 times. the B+ tree keeps sorted keys
+ * in wide nodes of #BPT_NODE_SIZE bytes: a lookup touches a few cache
+ * lines of a node, then goes to the next level, so a tree of 1M items
+ * is only 5 levels high. the items are kept in the leaves, which are
+ * linked together for ordered iteration.
+ *
+ * like sbtree, the tree keeps the amount of items of every subtree (in
+ * the inner nodes), so the rank of a key and the item of a rank are
+ * both found in O(log n), see bpt_lower_bound() and bpt_select().
+ *
+ * the keys are integers (#bpt_key_t), e.g. line numbers, offsets or
+ * sequence numbers, and each key has a pointer as value. equal keys
+ * are allowed, they are kept in the order they are inserted.
+ *
+ * nodes are allocated from a fixed allocator of the tree, which aligns
+ * them to cache lines, iterators are invalid after the tree is changed.
+ */
+
+
+#ifndef VIME_BPTREE_H
+#define VIME_BPTREE_H
+
+
+/** the type of keys of #bptree. */
+typedef size_t bpt_key_t;
+
+/** the size of nodes, in bytes. */
+#define BPT_NODE_SIZE 512
+
+/** the max items in a leaf. */
+#define BPT_LEAF_MAX ((BPT_NODE_SIZE - 3 * sizeof(size_t)) \
+        / (sizeof(bpt_key_t) + sizeof(void*)))
+
+/** the max children of a inner node. */
+#define BPT_INNER_MAX ((BPT_NODE_SIZE - sizeof(size_t) + sizeof(bpt_key_t)) \
+        / (sizeof(bpt_key_t) + sizeof(size_t) + sizeof(void*)))
+
+/** the min items in a leaf, except the root. */
+#define BPT_LEAF_MIN (BPT_LEAF_MAX / 2)
+
+/** the min children of a inner node, except the root. */
+#define BPT_INNER_MIN ((BPT_INNER_MAX + 1) / 2)
+
+/** the max levels of inner nodes. */
+#define BPT_MAX_HEIGHT 24
+
+
+/**
+ * the leaf node of #bptree.
+ */
+struct bpt_leaf
+{
+    size_t count;               /**< the amount of items. */
+    struct bpt_leaf *prev;      /**< the previous leaf, or NULL. */
+    struct bpt_leaf *next;      /**< the next leaf, or NULL. */
+    bpt_key_t keys[BPT_LEAF_MAX];   /**< the sorted keys. */
+    void *values[BPT_LEAF_MAX];     /**< the values of keys. */
+};
+
+
+/**
+ * the inner node of #bptree.
+ *
+ * keys[i] separates children[i] and children[i + 1]: the keys in
+ * children[i] are not bigger than it, and the keys in children[i + 1]
+ * are not smaller than it.
+ */
+struct bpt_inner
+{
+    size_t count;               /**< the amount of children. */
+    bpt_key_t keys[BPT_INNER_MAX - 1];  /**< the separator keys. */
+    size_t sizes[BPT_INNER_MAX];        /**< the items of children. */
+    void *children[BPT_INNER_MAX];      /**< the children. */
+};
+
+
+/** the block allocated for every node. */
+union bpt_node
+{
+    struct bpt_leaf leaf;
+    struct bpt_inner inner;
+    char bytes[BPT_NODE_SIZE];  /**< pads the node to a multiple of cache
+                                     lines, so it's aligned to them. */
+};
+
+
+/**
+ * B+ tree struction.
+ *
+ * use bpt_init() to initialize a tree, and bpt_drop() to destroy it.
+ * the nodes are allocated when the first item is inserted.
+ */
+struct bptree
+{
+    void *root;         /**< the root node, or NULL if empty. */
+    size_t size;        /**< number of items. */
+    size_t height;      /**< levels of inner nodes, 0 if root is leaf. */
+    fixed_alloc_t alloc;    /**< the allocator of nodes. */
+};
+
+/** the default constructor of #bptree. */
+#define BPTREE_INIT {NULL, 0, 0, NULL}
+
+
+/**
+ * the position of a item in #bptree.
+ *
+ * the iterator is at the end of tree if leaf is NULL.
+ */
+struct bpt_iter
+{
+    struct bpt_leaf *leaf;  /**< the leaf of the item. */
+    size_t pos;             /**< the index of the item in leaf. */
+};
+
+/** get the key of the item at a iterator. */
+#define bpt_iter_key(it) ((it)->leaf->keys[(it)->pos])
+
+/** get the value of the item at a iterator. */
+#define bpt_iter_value(it) ((it)->leaf->values[(it)->pos])
+
+
+INLINE struct bptree *bpt_init(struct bptree *bpt);
+INLINE void bpt_drop(struct bptree *bpt);
+INLINE struct bptree *bpt_clear(struct bptree *bpt);
+INLINE size_t bpt_key_bound(bpt_key_t const *keys, size_t count,
+        bpt_key_t key, int upper);
+INLINE size_t bpt_bound(struct bptree *bpt, bpt_key_t key, int upper,
+        struct bpt_iter *it);
+INLINE size_t bpt_lower_bound(struct bptree *bpt, bpt_key_t key,
+        struct bpt_iter *it);
+INLINE size_t bpt_upper_bound(struct bptree *bpt, bpt_key_t key,
+        struct bpt_iter *it);
+INLINE int bpt_find(struct bptree *bpt, bpt_key_t key,
+        struct bpt_iter *it);
+INLINE void *bpt_lookup(struct bptree *bpt, bpt_key_t key);
+INLINE int bpt_select(struct bptree *bpt, size_t rank,
+        struct bpt_iter *it);
+INLINE int bpt_first(struct bptree *bpt, struct bpt_iter *it);
+INLINE int bpt_last(struct bptree *bpt, struct bpt_iter *it);
+INLINE int bpt_next(struct bpt_iter *it);
+INLINE int bpt_prev(struct bpt_iter *it);
+INLINE void bpt_inner_put(struct bpt_inner *inner, size_t idx,
+        bpt_key_t key, void *child, size_t size);
+INLINE int bpt_insert(struct bptree *bpt, bpt_key_t key, void *value);
+INLINE void bpt_rebalance(struct bptree *bpt, struct bpt_inner **path,
+        size_t *idx);
+INLINE int bpt_remove_rank(struct bptree *bpt, size_t rank,
+        void **pvalue);
+INLINE int bpt_remove(struct bptree *bpt, bpt_key_t key, void **pvalue);
+
+
+#if defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES)
+
+/**
+ * initialize a B+ tree.
+ *
+ * \param bpt the tree need to initialize.
+ * \return the bpt.
+ */
+    INLINE struct bptree*
+bpt_init(struct bptree *bpt)
+{
+    assert(bpt != NULL);
+    bpt->root = NULL;
+    bpt->size = 0;
+    bpt->height = 0;
+    bpt->alloc = NULL;
+    return bpt;
+}
+
+
+/**
+ * destroy a B+ tree, free all nodes.
+ *
+ * \param bpt the tree need to destroy.
+ */
+    INLINE void
+bpt_drop(struct bptree *bpt)
+{
+    assert(bpt != NULL);
+    if (bpt->alloc != NULL)
+        fixed_free(bpt->alloc);
+    bpt_init(bpt);
+}
+
+
+/**
+ * remove all items of a B+ tree.
+ *
+ * \param bpt the tree need to clear.
+ * \return the bpt.
+ */
+    INLINE struct bptree*
+bpt_clear(struct bptree *bpt)
+{
+    bpt_drop(bpt);
+    return bpt;
+}
+
+
+/**
+ * find the first key bigger than key, or not smaller than key, in a
+ * sorted array of keys.
+ *
+ * \param keys the sorted keys.
+ * \param count the amount of keys.
+ * \param key the key to find.
+ * \param upper find the first key bigger than key if nonzero, or the
+ *        first key not smaller than key.
+ * \return the index of the key found, or count if not found.
+ */
+    INLINE size_t
+bpt_key_bound(bpt_key_t const *keys, size_t count, bpt_key_t key, int upper)
+{
+    size_t low = 0, mid;
+
+    while (count > 0)
+    {
+        mid = count / 2;
+        if (keys[low + mid] < key || (upper && keys[low + mid] == key))
+        {
+            low += mid + 1;
+            count -= mid + 1;
+        }
+        else
+            count = mid;
+    }
+    return low;
+}
+
+
+/**
+ * find the first item which key is bigger than key, or not smaller
+ * than key.
+ *
+ * \param bpt the tree.
+ * \param key the key to find.
+ * \param upper find the first key bigger than key if nonzero.
+ * \param it the iterator set to the item found, or the end of tree.
+ * \return the rank of the item found, i.e. the amount of items before
+ *         it.
+ */
+    INLINE size_t
+bpt_bound(struct bptree *bpt, bpt_key_t key, int upper, struct bpt_iter *it)
+{
+    void *node = bpt->root;
+    struct bpt_inner *inner;
+    size_t h, i, idx, rank = 0;
+
+    it->leaf = NULL;
+    it->pos = 0;
+    if (node == NULL)
+        return 0;
+
+    for (h = 0; h < bpt->height; ++h)
+    {
+        inner = node;
+        idx = bpt_key_bound(inner->keys, inner->count - 1, key, upper);
+        for (i = 0; i < idx; ++i)
+            rank += inner->sizes[i];
+        node = inner->children[idx];
+    }
+
+    it->leaf = node;
+    it->pos = bpt_key_bound(it->leaf->keys, it->leaf->count, key, upper);
+    if (it->pos == it->leaf->count)
+    {
+        /* all keys in leaf are smaller, the item is in next leaf. */
+        rank += it->pos;
+        it->leaf = it->leaf->next;
+        it->pos = 0;
+        return rank;
+    }
+    return rank + it->pos;
+}
+
+
+/**
+ * find the first item which key is not smaller than key.
+ *
+ * \return the amount of items which key is smaller than key, see
+ *         bpt_bound().
+ */
+    INLINE size_t
+bpt_lower_bound(struct bptree *bpt, bpt_key_t key, struct bpt_iter *it)
+{
+    return bpt_bound(bpt, key, FALSE, it);
+}
+
+
+/**
+ * find the first item which key is bigger than key.
+ *
+ * \return the amount of items which key is not bigger than key, see
+ *         bpt_bound().
+ */
+    INLINE size_t
+bpt_upper_bound(struct bptree *bpt, bpt_key_t key, struct bpt_iter *it)
+{
+    return bpt_bound(bpt, key, TRUE, it);
+}
+
+
+/**
+ * find the first item of key.
+ *
+ * \param bpt the tree.
+ * \param key the key to find.
+ * \param it the iterator set to the item found.
+ * \return TRUE if found, or FALSE.
+ */
+    INLINE int
+bpt_find(struct bptree *bpt, bpt_key_t key, struct bpt_iter *it)
+{
+    bpt_bound(bpt, key, FALSE, it);
+    return it->leaf != NULL && bpt_iter_key(it) == key;
+}
+
+
+/**
+ * lookup the value of the first item of key.
+ *
+ * \return the value, or NULL if not found.
+ */
+    INLINE void*
+bpt_lookup(struct bptree *bpt, bpt_key_t key)
+{
+    struct bpt_iter it;
+    return bpt_find(bpt, key, &it) ? bpt_iter_value(&it) : NULL;
+}
+
+
+/**
+ * find the item of a rank.
+ *
+ * \param bpt the tree.
+ * \param rank the rank of item, from 0.
+ * \param it the iterator set to the item found, or the end of tree.
+ * \return OK if found, or FAIL if rank is out of range.
+ */
+    INLINE int
+bpt_select(struct bptree *bpt, size_t rank, struct bpt_iter *it)
+{
+    void *node = bpt->root;
+    struct bpt_inner *inner;
+    size_t h, idx;
+
+    it->leaf = NULL;
+    it->pos = 0;
+    if (rank >= bpt->size)
+        return FAIL;
+
+    for (h = 0; h < bpt->height; ++h)
+    {
+        inner = node;
+        for (idx = 0; rank >= inner->sizes[idx]; ++idx)
+            rank -= inner->sizes[idx];
+        node = inner->children[idx];
+    }
+
+    it->leaf = node;
+    it->pos = rank;
+    return OK;
+}
+
+
+/**
+ * get the first item of tree.
+ *
+ * \return OK, or FAIL if the tree is empty.
+ */
+    INLINE int
+bpt_first(struct bptree *bpt, struct bpt_iter *it)
+{
+    return bpt_select(bpt, 0, it);
+}
+
+
+/**
+ * get the last item of tree.
+ *
+ * \return OK, or FAIL if the tree is empty.
+ */
+    INLINE int
+bpt_last(struct bptree *bpt, struct bpt_iter *it)
+{
+    return bpt_select(bpt, bpt->size - 1, it);
+}
+
+
+/**
+ * move the iterator to the next item.
+ *
+ * \return TRUE if there is next item, or FALSE and the iterator is at
+ *         the end of tree.
+ */
+    INLINE int
+bpt_next(struct bpt_iter *it)
+{
+    if (++it->pos == it->leaf->count)
+    {
+        it->leaf = it->leaf->next;
+        it->pos = 0;
+    }
+    return it->leaf != NULL;
+}
+
+
+/**
+ * move the iterator to the previous item.
+ *
+ * \return TRUE if there is previous item, or FALSE and the iterator is
+ *         at the end of tree.
+ */
+    INLINE int
+bpt_prev(struct bpt_iter *it)
+{
+    if (it->pos-- == 0)
+    {
+        it->leaf = it->leaf->prev;
+        it->pos = it->leaf == NULL ? 0 : it->leaf->count - 1;
+    }
+    return it->leaf != NULL;
+}
+
+
+/**
+ * put a child into a inner node which isn't full.
+ *
+ * \param inner the inner node.
+ * \param idx the index of new child, not zero.
+ * \param key the separator of new child and the child before it.
+ * \param child the new child.
+ * \param size the items of new child.
+ */
+    INLINE void
+bpt_inner_put(struct bpt_inner *inner, size_t idx, bpt_key_t key,
+        void *child, size_t size)
+{
+    size_t count = inner->count - idx;
+
+    assert(idx > 0 && inner->count < BPT_INNER_MAX);
+    memmove(&inner->children[idx + 1], &inner->children[idx],
+            count * sizeof(void*));
+    memmove(&inner->sizes[idx + 1], &inner->sizes[idx],
+            count * sizeof(size_t));
+    memmove(&inner->keys[idx], &inner->keys[idx - 1],
+            count * sizeof(bpt_key_t));
+    inner->children[idx] = child;
+    inner->sizes[idx] = size;
+    inner->keys[idx - 1] = key;
+    ++inner->count;
+}
+
+
+/**
+ * insert a item into B+ tree, after all items with the same key.
+ *
+ * \param bpt the tree.
+ * \param key the key of item.
+ * \param value the value of item.
+ * \return OK, or FAIL if no memory, and the tree isn't changed.
+ */
+    INLINE int
+bpt_insert(struct bptree *bpt, bpt_key_t key, void *value)
+{
+    struct bpt_inner *path[BPT_MAX_HEIGHT], *inner, *right;
+    size_t idx[BPT_MAX_HEIGHT];
+    void *spare[BPT_MAX_HEIGHT + 2], *node;
+    size_t h, pos, nspare, need = 0, left_size, right_size, i;
+    bpt_key_t keys[BPT_LEAF_MAX + 1];
+    void *values[BPT_LEAF_MAX + 1];
+    struct bpt_leaf *leaf, *next;
+
+    if (bpt->alloc == NULL
+            && (bpt->alloc = fixed_alloc(sizeof(union bpt_node), 0)) == NULL)
+        return FAIL;
+    if (bpt->root == NULL)
+    {
+        if ((leaf = fixed_acquire(bpt->alloc)) == NULL)
+            return FAIL;
+        leaf->count = 0;
+        leaf->prev = leaf->next = NULL;
+        bpt->root = leaf;
+    }
+
+    for (node = bpt->root, h = 0; h < bpt->height; ++h)
+    {
+        path[h] = inner = node;
+        idx[h] = bpt_key_bound(inner->keys, inner->count - 1, key, TRUE);
+        node = inner->children[idx[h]];
+    }
+    leaf = node;
+    pos = bpt_key_bound(leaf->keys, leaf->count, key, TRUE);
+
+    /* allocate all nodes for splits first, so it can fail cleanly. */
+    if (leaf->count == BPT_LEAF_MAX)
+    {
+        for (need = 1, h = bpt->height; h > 0
+                && path[h - 1]->count == BPT_INNER_MAX; --h)
+            ++need;
+        if (h == 0)
+            ++need;
+    }
+    for (nspare = 0; nspare < need; ++nspare)
+        if ((spare[nspare] = fixed_acquire(bpt->alloc)) == NULL)
+        {
+            while (nspare > 0)
+                fixed_release(bpt->alloc, spare[--nspare]);
+            return FAIL;
+        }
+
+    for (h = 0; h < bpt->height; ++h)
+        ++path[h]->sizes[idx[h]];
+    ++bpt->size;
+
+    if (leaf->count < BPT_LEAF_MAX)
+    {
+        memmove(&leaf->keys[pos + 1], &leaf->keys[pos],
+                (leaf->count - pos) * sizeof(bpt_key_t));
+        memmove(&leaf->values[pos + 1], &leaf->values[pos],
+                (leaf->count - pos) * sizeof(void*));
+        leaf->keys[pos] = key;
+        leaf->values[pos] = value;
+        ++leaf->count;
+        return OK;
+    }
+
+    /* split the leaf, the new leaf gets the upper half. */
+    memcpy(keys, leaf->keys, pos * sizeof(bpt_key_t));
+    memcpy(values, leaf->values, pos * sizeof(void*));
+    keys[pos] = key;
+    values[pos] = value;
+    memcpy(&keys[pos + 1], &leaf->keys[pos],
+            (BPT_LEAF_MAX - pos) * sizeof(bpt_key_t));
+    memcpy(&values[pos + 1], &leaf->values[pos],
+            (BPT_LEAF_MAX - pos) * sizeof(void*));
+
+    next = spare[--nspare];
+    leaf->count = (BPT_LEAF_MAX + 1) / 2;
+    next->count = BPT_LEAF_MAX + 1 - leaf->count;
+    memcpy(leaf->keys, keys, leaf->count * sizeof(bpt_key_t));
+    memcpy(leaf->values, values, leaf->count * sizeof(void*));
+    memcpy(next->keys, &keys[leaf->count], next->count * sizeof(bpt_key_t));
+    memcpy(next->values, &values[leaf->count], next->count * sizeof(void*));
+
+    next->prev = leaf;
+    next->next = leaf->next;
+    if (leaf->next != NULL)
+        leaf->next->prev = next;
+    leaf->next = next;
+
+    /* put the new node into parent, split the parent if it's full. */
+    node = next;
+    key = next->keys[0];
+    left_size = leaf->count;
+    right_size = next->count;
+    for (h = bpt->height; h > 0; --h)
+    {
+        bpt_key_t ikeys[BPT_INNER_MAX];
+        void *children[BPT_INNER_MAX + 1];
+        size_t sizes[BPT_INNER_MAX + 1];
+
+        inner = path[h - 1];
+        pos = idx[h - 1];
+        inner->sizes[pos] = left_size;
+        if (inner->count < BPT_INNER_MAX)
+        {
+            bpt_inner_put(inner, pos + 1, key, node, right_size);
+            return OK;
+        }
+
+        memcpy(children, inner->children, (pos + 1) * sizeof(void*));
+        memcpy(sizes, inner->sizes, (pos + 1) * sizeof(size_t));
+        memcpy(ikeys, inner->keys, pos * sizeof(bpt_key_t));
+        children[pos + 1] = node;
+        sizes[pos + 1] = right_size;
+        ikeys[pos] = key;
+        memcpy(&children[pos + 2], &inner->children[pos + 1],
+                (BPT_INNER_MAX - pos - 1) * sizeof(void*));
+        memcpy(&sizes[pos + 2], &inner->sizes[pos + 1],
+                (BPT_INNER_MAX - pos - 1) * sizeof(size_t));
+        memcpy(&ikeys[pos + 1], &inner->keys[pos],
+                (BPT_INNER_MAX - pos - 1) * sizeof(bpt_key_t));
+
+        /* the separator between the two halves goes to the parent. */
+        right = spare[--nspare];
+        inner->count = (BPT_INNER_MAX + 1) / 2;
+        right->count = BPT_INNER_MAX + 1 - inner->count;
+        memcpy(inner->children, children, inner->count * sizeof(void*));
+        memcpy(inner->sizes, sizes, inner->count * sizeof(size_t));
+        memcpy(inner->keys, ikeys, (inner->count - 1) * sizeof(bpt_key_t));
+        memcpy(right->children, &children[inner->count],
+                right->count * sizeof(void*));
+        memcpy(right->sizes, &sizes[inner->count],
+                right->count * sizeof(size_t));
+        memcpy(right->keys, &ikeys[inner->count],
+                (right->count - 1) * sizeof(bpt_key_t));
+
+        node = right;
+        key = ikeys[inner->count - 1];
+        for (left_size = 0, i = 0; i < inner->count; ++i)
+            left_size += inner->sizes[i];
+        for (right_size = 0, i = 0; i < right->count; ++i)
+            right_size += right->sizes[i];
+    }
+
+    /* the root is split, make a new root. */
+    inner = spare[--nspare];
+    inner->count = 2;
+    inner->keys[0] = key;
+    inner->children[0] = bpt->root;
+    inner->children[1] = node;
+    inner->sizes[0] = left_size;
+    inner->sizes[1] = right_size;
+    bpt->root = inner;
+    ++bpt->height;
+    return OK;
+}
+
+
+/**
+ * fix the nodes in a path after a item removed from the leaf at the
+ * end of path, a node with too few items borrows from its sibling, or
+ * merges with it.
+ *
+ * \param bpt the tree.
+ * \param path the inner nodes from the root.
+ * \param idx the index of the next node of path in path nodes.
+ */
+    INLINE void
+bpt_rebalance(struct bptree *bpt, struct bpt_inner **path, size_t *idx)
+{
+    struct bpt_inner *parent, *inner, *sib;
+    struct bpt_leaf *leaf, *lsib;
+    size_t h, j, k, n;
+
+    for (h = bpt->height; h > 0; --h)
+    {
+        parent = path[h - 1];
+        j = idx[h - 1];
+
+        if (h == bpt->height)
+        {
+            struct bpt_leaf *left, *right;
+
+            leaf = parent->children[j];
+            if (leaf->count >= BPT_LEAF_MIN)
+                return;
+
+            if (j > 0 && (lsib = parent->children[j - 1])->count
+                    > BPT_LEAF_MIN)
+            {
+                /* borrow the last item of left sibling. */
+                memmove(&leaf->keys[1], leaf->keys,
+                        leaf->count * sizeof(bpt_key_t));
+                memmove(&leaf->values[1], leaf->values,
+                        leaf->count * sizeof(void*));
+                leaf->keys[0] = lsib->keys[--lsib->count];
+                leaf->values[0] = lsib->values[lsib->count];
+                ++leaf->count;
+                ++parent->sizes[j];
+                --parent->sizes[j - 1];
+                parent->keys[j - 1] = leaf->keys[0];
+                return;
+            }
+
+            if (j + 1 < parent->count && (lsib = parent->children[j + 1])
+                    ->count > BPT_LEAF_MIN)
+            {
+                /* borrow the first item of right sibling. */
+                leaf->keys[leaf->count] = lsib->keys[0];
+                leaf->values[leaf->count++] = lsib->values[0];
+                --lsib->count;
+                memmove(lsib->keys, &lsib->keys[1],
+                        lsib->count * sizeof(bpt_key_t));
+                memmove(lsib->values, &lsib->values[1],
+                        lsib->count * sizeof(void*));
+                ++parent->sizes[j];
+                --parent->sizes[j + 1];
+                parent->keys[j] = lsib->keys[0];
+                return;
+            }
+
+            /* merge the right one of two leaves into the left one. */
+            k = j > 0 ? j - 1 : j;
+            left = parent->children[k];
+            right = parent->children[k + 1];
+            memcpy(&left->keys[left->count], right->keys,
+                    right->count * sizeof(bpt_key_t));
+            memcpy(&left->values[left->count], right->values,
+                    right->count * sizeof(void*));
+            left->count += right->count;
+            left->next = right->next;
+            if (right->next != NULL)
+                right->next->prev = left;
+            fixed_release(bpt->alloc, right);
+        }
+        else
+        {
+            struct bpt_inner *left, *right;
+
+            inner = parent->children[j];
+            if (inner->count >= BPT_INNER_MIN)
+                return;
+
+            if (j > 0 && (sib = parent->children[j - 1])->count
+                    > BPT_INNER_MIN)
+            {
+                /* rotate the last child of left sibling. */
+                n = sib->sizes[--sib->count];
+                memmove(&inner->children[1], inner->children,
+                        inner->count * sizeof(void*));
+                memmove(&inner->sizes[1], inner->sizes,
+                        inner->count * sizeof(size_t));
+                memmove(&inner->keys[1], inner->keys,
+                        (inner->count - 1) * sizeof(bpt_key_t));
+                inner->children[0] = sib->children[sib->count];
+                inner->sizes[0] = n;
+                inner->keys[0] = parent->keys[j - 1];
+                parent->keys[j - 1] = sib->keys[sib->count - 1];
+                ++inner->count;
+                parent->sizes[j] += n;
+                parent->sizes[j - 1] -= n;
+                return;
+            }
+
+            if (j + 1 < parent->count && (sib = parent->children[j + 1])
+                    ->count > BPT_INNER_MIN)
+            {
+                /* rotate the first child of right sibling. */
+                n = sib->sizes[0];
+                inner->children[inner->count] = sib->children[0];
+                inner->sizes[inner->count] = n;
+                inner->keys[inner->count - 1] = parent->keys[j];
+                parent->keys[j] = sib->keys[0];
+                ++inner->count;
+                --sib->count;
+                memmove(sib->children, &sib->children[1],
+                        sib->count * sizeof(void*));
+                memmove(sib->sizes, &sib->sizes[1],
+                        sib->count * sizeof(size_t));
+                memmove(sib->keys, &sib->keys[1],
+                        (sib->count - 1) * sizeof(bpt_key_t));
+                parent->sizes[j] += n;
+                parent->sizes[j + 1] -= n;
+                return;
+            }
+
+            /* merge the right one, and the separator, into the left. */
+            k = j > 0 ? j - 1 : j;
+            left = parent->children[k];
+            right = parent->children[k + 1];
+            left->keys[left->count - 1] = parent->keys[k];
+            memcpy(&left->keys[left->count], right->keys,
+                    (right->count - 1) * sizeof(bpt_key_t));
+            memcpy(&left->children[left->count], right->children,
+                    right->count * sizeof(void*));
+            memcpy(&left->sizes[left->count], right->sizes,
+                    right->count * sizeof(size_t));
+            left->count += right->count;
+            fixed_release(bpt->alloc, right);
+        }
+
+        /* remove the right one of merged nodes from parent. */
+        parent->sizes[k] += parent->sizes[k + 1];
+        n = parent->count - k - 2;
+        memmove(&parent->children[k + 1], &parent->children[k + 2],
+                n * sizeof(void*));
+        memmove(&parent->sizes[k + 1], &parent->sizes[k + 2],
+                n * sizeof(size_t));
+        memmove(&parent->keys[k], &parent->keys[k + 1],
+                n * sizeof(bpt_key_t));
+        --parent->count;
+    }
+
+    /* the root has only one child, or no item. */
+    if (bpt->height > 0 && (inner = bpt->root)->count == 1)
+    {
+        bpt->root = inner->children[0];
+        --bpt->height;
+        fixed_release(bpt->alloc, inner);
+    }
+    else if (bpt->height == 0 && (leaf = bpt->root)->count == 0)
+    {
+        bpt->root = NULL;
+        fixed_release(bpt->alloc, leaf);
+    }
+}
+
+
+/**
+ * remove the item of a rank.
+ *
+ * \param bpt the tree.
+ * \param rank the rank of item, from 0.
+ * \param pvalue the value of the removed item is stored in it, if it
+ *        isn't NULL.
+ * \return OK, or FAIL if rank is out of range.
+ */
+    INLINE int
+bpt_remove_rank(struct bptree *bpt, size_t rank, void **pvalue)
+{
+    struct bpt_inner *path[BPT_MAX_HEIGHT], *inner;
+    size_t idx[BPT_MAX_HEIGHT], h, j;
+    struct bpt_leaf *leaf;
+    void *node;
+
+    if (rank >= bpt->size)
+        return FAIL;
+
+    for (node = bpt->root, h = 0; h < bpt->height; ++h)
+    {
+        path[h] = inner = node;
+        for (j = 0; rank >= inner->sizes[j]; ++j)
+            rank -= inner->sizes[j];
+        --inner->sizes[j];
+        idx[h] = j;
+        node = inner->children[j];
+    }
+
+    leaf = node;
+    if (pvalue != NULL)
+        *pvalue = leaf->values[rank];
+    --leaf->count;
+    memmove(&leaf->keys[rank], &leaf->keys[rank + 1],
+            (leaf->count - rank) * sizeof(bpt_key_t));
+    memmove(&leaf->values[rank], &leaf->values[rank + 1],
+            (leaf->count - rank) * sizeof(void*));
+    --bpt->size;
+
+    bpt_rebalance(bpt, path, idx);
+    return OK;
+}
+
+
+/**
+ * remove the first item of a key.
+ *
+ * \param bpt the tree.
+ * \param key the key of item.
+ * \param pvalue the value of the removed item is stored in it, if it
+ *        isn't NULL.
+ * \return OK, or FAIL if not found.
+ */
+    INLINE int
+bpt_remove(struct bptree *bpt, bpt_key_t key, void **pvalue)
+{
+    struct bpt_iter it;
+    size_t rank = bpt_bound(bpt, key, FALSE, &it);
+
+    if (it.leaf == NULL || bpt_iter_key(&it) != key)
+        return FAIL;
+    return bpt_remove_rank(bpt, rank, pvalue);
+}
+
+#endif /* defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES) */
+
+
+#endif /* VIME_BPTREE_H */
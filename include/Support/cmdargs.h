@@ -78,11 +78,14 @@ struct cmdarg_table
 
     struct hook unknow_arg_hook;
     struct hook invalid_arg_hook;
+    struct list_entry unknow_arg_list;
+    struct list_entry invalid_arg_list;
 };
 
 /** the default static constructor of #cmdarg_table. */
 #define CMDARG_TABLE_INIT \
-    {HASHTABLE_INIT, HASHTABLE_INIT, HOOK_INIT, HOOK_INIT}
+    {HASHTABLE_INIT, HASHTABLE_INIT, HOOK_INIT, HOOK_INIT, \
+        LIST_ENTRY_INIT, LIST_ENTRY_INIT}
 
 
 struct cmdarg_table *cmdarg_table_init(struct cmdarg_table *table);
@@ -102,8 +105,8 @@ cmdarg_table_init(struct cmdarg_table *table)
 {
     hashtable_init(&table->long_name_ht);
     hashtable_init(&table->short_name_ht);
-    hook_init(&table->unknow_arg_hook);
-    hook_init(&table->invalid_arg_hook);
+    hook_init(&table->unknow_arg_hook, &table->unknow_arg_list);
+    hook_init(&table->invalid_arg_hook, &table->invalid_arg_list);
 
     return table;
 }
@@ -40,7 +40,7 @@ struct hash_entry
 };
 
 /** the default constructor of #hash_entry. */
-#define HASH_ENTRY_INIT  {NULL, NULL}
+#define HASH_ENTRY_INIT  {NULL, 0}
 
 /**
  * get the entry of a hash item.
@@ -109,10 +109,15 @@ struct hashtable
     int      flags;     /**< counter for hash_lock(). */
 
     hashitem_t *array;  /**< points to the array. */
+
+    hashitem_t *oldarray;   /**< the array items are moving from in
+                                 a incremental resize, or NULL. */
+    size_t   oldcapacity;   /**< nr of items in oldarray. */
+    size_t   moved;         /**< nr of items in oldarray moved. */
 };
 
 /** the default constructor of #hashtable */
-#define HASHTABLE_INIT {0, 0, 0, HF_DEFAULT, NULL}
+#define HASHTABLE_INIT {0, 0, 0, HF_DEFAULT, NULL, NULL, 0, 0}
 
 /** flags for default #hashtable. */
 #define HF_DEFAULT          (0)
@@ -123,11 +128,14 @@ struct hashtable
 /** flags for #fast_hashtable that has smallarray. */
 #define HF_HAS_SMALLARRAY   (1 << 1)
 
+/** flags for resize incrementally, see ht_may_resize(). */
+#define HF_INCREMENTAL      (1 << 2)
+
 /** whether a #hashtable needn't free its array. */
-#define ht_no_free(hashtab) (((hashtab)->flags & HF_NO_FREE) == 0)
+#define ht_no_free(hashtab) (((hashtab)->flags & HF_NO_FREE) != 0)
 
 /** whether a #hashtable hash a small array. */
-#define ht_has_smallarray(hashtab) (((hashtab)->flags & HF_HAS_SMALLARRAY) == 0)
+#define ht_has_smallarray(hashtab) (((hashtab)->flags & HF_HAS_SMALLARRAY) != 0)
 
 
 /** Initial size for a hashtable.
@@ -137,6 +145,10 @@ struct hashtable
  */
 #define HT_INIT_SIZE (1 << 4)
 
+/** nr of items in the old array moved in every operation, when a
+ * #hashtable is resizing incrementally. */
+#define HT_MIGRATE_STEP 8
+
 /**
  * a static fast hashtable.
  *
@@ -152,21 +164,39 @@ struct fast_hashtable
 };
 
 /** the default constructor of #fast_hashtable */
-#define FAST_HASHTABLE_INIT {{0, 0, 0, HF_HAS_SMALLARRAY, NULL}, {}}
+#define FAST_HASHTABLE_INIT \
+    {{0, 0, 0, HF_HAS_SMALLARRAY, NULL, NULL, 0, 0}, {}}
 
 /** convert a fast_hashtable to hashtable. */
 #define HASHTABLE(ptr) (&(ptr)->hashtab)
 
 /** convert a hashtable to fast hashtable. */
 #define FAST_HT_ENTRY(ptr) \
-    container_of(hashtab, struct fast_hashtable, hashtab)
+    container_of((ptr), struct fast_hashtable, hashtab)
 
 /** get static array of a static hashtable. */
 #define ht_get_smallarray(hashtab) (FAST_HT_ENTRY(hashtab)->smallarray)
 
+/** whether a array is the static array of a hashtable. */
+#define ht_is_smallarray(hashtab, array) (ht_has_smallarray(hashtab) \
+        && (array) == ht_get_smallarray(hashtab))
+
 
 #define PERTURB_SHIFT 5
 
+/** the primes used by ht_hash_bytes(). */
+#define HT_HASH_P0 UINT64_C(0xa0761d6478bd642f)
+#define HT_HASH_P1 UINT64_C(0xe7037ed1a0b428db)
+
+/**
+ * the seed of ht_hash_bytes(), chosen when the first key is hashed,
+ * so hash values are different in every process, and keys can't be
+ * made to collide from outside.
+ *
+ * \sa ht_set_hash_seed
+ */
+EXTERN(uint64_t ht_hash_seed, = 0);
+
 #define IS_POWER_OF_2(x) ((x & (x - 1)) == 0)
 
 
@@ -183,8 +213,8 @@ struct fast_hashtable
  */
 #define DEFINE_HT_ENTRY_BODY(hashtab, item, hash_expr, cmp_expr) \
 {                                                               \
-    hash_t _hash;                                               \
-    int _idx, _mask, _perturb;                                  \
+    hash_t _hash, _perturb;                                     \
+    size_t _idx, _mask;                                         \
     hashitem_t *item, *_freeitem = NULL;                        \
                                                                 \
     assert((hashtab) != NULL);                                  \
@@ -192,9 +222,26 @@ struct fast_hashtable
         return NULL;                                            \
     assert((hashtab)->size < (hashtab)->capacity);              \
                                                                 \
-    _mask = (hashtab)->capacity - 1;                            \
     _hash = (hash_expr);                                        \
-    _idx = (int)(_hash & _mask);                                \
+    if ((hashtab)->oldarray != NULL)                            \
+    {                                                           \
+        /* the item may not be moved to the new array yet. */   \
+        _mask = (hashtab)->oldcapacity - 1;                     \
+        _idx = (size_t)(_hash & _mask);                         \
+        for (_perturb = _hash; ; _perturb >>= PERTURB_SHIFT)    \
+        {                                                       \
+            item = &(hashtab)->oldarray[_idx & _mask];          \
+            if (*item == HI_NULL)                               \
+                break;                                          \
+            else if (*item != HI_TOMB && (*item)->hash == _hash \
+                    && (cmp_expr) == 0)                         \
+                return item;                                    \
+            _idx = (size_t)((_idx << 2) + _idx + _perturb + 1); \
+        }                                                       \
+    }                                                           \
+                                                                \
+    _mask = (hashtab)->capacity - 1;                            \
+    _idx = (size_t)(_hash & _mask);                             \
     item = &(hashtab)->array[_idx];                             \
                                                                 \
     if (*item == HI_NULL)                                       \
@@ -206,13 +253,16 @@ struct fast_hashtable
                                                                 \
     for (_perturb = _hash; ; _perturb >>= PERTURB_SHIFT)        \
     {                                                           \
-        _idx = (int)((_idx << 2) + _idx + _perturb + 1);        \
+        _idx = (size_t)((_idx << 2) + _idx + _perturb + 1);     \
         item = &(hashtab)->array[_idx & _mask];                 \
                                                                 \
         if (*item == HI_NULL)                                   \
             return _freeitem == NULL ? item : _freeitem;        \
-        else if (*item == HI_TOMB && _freeitem == NULL)         \
-            _freeitem = item;                                   \
+        else if (*item == HI_TOMB)                              \
+        {                                                       \
+            if (_freeitem == NULL)                              \
+                _freeitem = item;                               \
+        }                                                       \
         else if ((*item)->hash == _hash && (cmp_expr) == 0)     \
             return item;                                        \
     }                                                           \
@@ -264,6 +314,18 @@ struct fast_hashtable
     return hi_is_empty(*entry) ? (fail_expr) : (succ_expr); }
 
 
+/**
+ * set the seed of ht_hash_bytes(). all hash values change with the
+ * seed, so it can only be set before any key is hashed, e.g. to make
+ * the hash values of a test stable.
+ *
+ * \param seed the new seed, or 0 to choose one from the address of
+ *        the seed (that changes with ASLR) and the time.
+ * \return the seed.
+ */
+uint64_t ht_set_hash_seed(uint64_t seed);
+
+
 /* public routine prototypes. */
 INLINE struct hashtable *ht_init(struct hashtable *hashtab);
 INLINE void ht_drop(struct hashtable *hashtab);
@@ -271,6 +333,11 @@ INLINE struct hashtable *ht_safe_init(struct hashtable *hashtab);
 INLINE struct hashtable *fast_ht_init(struct fast_hashtable *hashtab);
 INLINE struct hashtable *ht_clear(struct hashtable *hashtab);
 INLINE int ht_may_resize(struct hashtable *hashtab, size_t minitems);
+INLINE void ht_move_items(struct hashtable *hashtab,
+        hashitem_t *oldarray, size_t from, size_t to);
+INLINE void ht_migrate(struct hashtable *hashtab, size_t count);
+INLINE void ht_mum(uint64_t *a, uint64_t *b);
+INLINE hash_t ht_hash_bytes(void const *key, size_t len);
 INLINE hash_t ht_default_hash(char const *key);
 INLINE hashitem_t *ht_entry(struct hashtable *hashtab,
         void const *key, hash_t hash, hash_compare_t cmp_func);
@@ -283,6 +350,10 @@ INLINE hashitem_t *ht_default_entry(struct hashtable *hashtab, void const *key,
 INLINE struct hash_entry *ht_insert(struct hashtable *hashtab, struct hash_entry *value);
 INLINE struct hash_entry *ht_lookup(struct hashtable *hashtab, void const *key);
 INLINE struct hash_entry *ht_remove(struct hashtable *hashtab, void const *key);
+INLINE hashitem_t *ht_len_entry(struct hashtable *hashtab,
+        void const *key, size_t len, hash_t *phash);
+INLINE struct hash_entry *ht_lookup_len(struct hashtable *hashtab,
+        void const *key, size_t len);
 
 
 #if defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES)
@@ -322,14 +393,15 @@ ht_drop(struct hashtable *hashtab)
 {
     assert(hashtab != NULL);
 
+    /* the old array of a incremental resize is always allocated. */
+    if (hashtab->oldarray != NULL)
+        vime_free(hashtab->oldarray);
+
     /*
-     * if table hasn't DONT_FREE flags, and it's not have a small
-     * table, or it has a smallarray, but array don't point to
-     * smallarray: free the array.
+     * if table hasn't DONT_FREE flags, the array is allocated by
+     * ht_may_resize(): free the array.
      */
-    if (!ht_no_free(hashtab)
-            && (!ht_has_smallarray(hashtab)
-            || hashtab->array != ht_get_smallarray(hashtab)))
+    if (!ht_no_free(hashtab) && hashtab->array != NULL)
         vime_free(hashtab->array);
 }
 
@@ -368,7 +440,8 @@ ht_safe_init(struct hashtable *hashtab)
     INLINE struct hashtable*
 fast_ht_init(struct fast_hashtable *hashtab)
 {
-    ht_init(HASHTABLE(hashtab))->flags = HF_NO_FREE | HF_HAS_SMALLARRAY;
+    ht_safe_init(HASHTABLE(hashtab))->flags = HF_NO_FREE | HF_HAS_SMALLARRAY;
+    memset(hashtab->smallarray, 0, sizeof(hashitem_t) * HT_INIT_SIZE);
     HASHTABLE(hashtab)->array = hashtab->smallarray;
     HASHTABLE(hashtab)->capacity = HT_INIT_SIZE;
     return HASHTABLE(hashtab);
@@ -376,31 +449,36 @@ fast_ht_init(struct fast_hashtable *hashtab)
 
 
 /**
- * clear a #hashtable.
+ * clear a #hashtable. the flags of the table are kept.
  *
  * \param hashtab a hash table to cleared.
  */
     INLINE struct hashtable*
 ht_clear(struct hashtable *hashtab)
 {
+    int flags;
+
     assert(hashtab != NULL);
 
     if (ht_has_smallarray(hashtab))
     {
+        flags = hashtab->flags & HF_INCREMENTAL;
         ht_drop(hashtab);
-        ht_safe_init(hashtab);
-        hashtab->array = ht_get_smallarray(hashtab);
-        memset(hashtab->array, 0, sizeof(hashitem_t) * HT_INIT_SIZE);
+        fast_ht_init(FAST_HT_ENTRY(hashtab))->flags |= flags;
         return hashtab;
     }
 
-    if (hashtab->array != NULL)
+    if (hashtab->oldarray != NULL)
     {
-        hashitem_t *array = hashtab->array;
-        memset(array, 0, sizeof(hashitem_t) * hashtab->capacity);
-        ht_safe_init(hashtab)->array = array;
+        vime_free(hashtab->oldarray);
+        hashtab->oldarray = NULL;
+        hashtab->oldcapacity = hashtab->moved = 0;
     }
 
+    if (hashtab->array != NULL)
+        memset(hashtab->array, 0, sizeof(hashitem_t) * hashtab->capacity);
+    hashtab->size = hashtab->fillsize = 0;
+
     return hashtab;
 }
 
@@ -408,6 +486,12 @@ ht_clear(struct hashtable *hashtab)
 /**
  * detect whether a hashtable need resize, and resize it if needed.
  *
+ * if the table has HF_INCREMENTAL flag, the items are not moved to
+ * the new array at once: the old array is kept, and every operation
+ * on the table moves HT_MIGRATE_STEP items of it, so a large table
+ * doesn't stop on the operation that makes it grow. lookups search
+ * both arrays until all items are moved.
+ *
  * \param hashtab the hashtable need to resize.
  * \param minitems the notify value of mininal items in the hashtab.
  * \return OK for success, and FAIL for no memory error.
@@ -415,29 +499,46 @@ ht_clear(struct hashtable *hashtab)
     INLINE int
 ht_may_resize(struct hashtable *hashtab, size_t minitems)
 {
-    size_t minsize, newsize;
+    size_t minsize, newsize, oldsize;
     hashitem_t *newarray, *oldarray, temparray[HT_INIT_SIZE];
-    hashitem_t *iter, *item;
-    int idx, todo, mask, perturb;
+    int owned;
 
     assert(hashtab != NULL
             && IS_POWER_OF_2(hashtab->capacity));
 
     if (minitems == 0)
     {
+        /*
+         * a incremental resize is going: move some items, or all of
+         * them if the new array is full already.
+         */
+        if (hashtab->oldarray != NULL)
+        {
+            if (hashtab->fillsize * 3 < hashtab->capacity * 2)
+            {
+                ht_migrate(hashtab, HT_MIGRATE_STEP);
+                return OK;
+            }
+            ht_migrate(hashtab, hashtab->oldcapacity);
+        }
+
         /*
          * quickly return for fast hashtable.
          * NOTICE that the lookup algorithm in ht_entry() required
          * hashtable has mininally one empty entry, so we need make sure
          * fillsize small than HT_INIT_SIZE - 1.
          */
-        if (ht_has_smallarray(hashtab)
-                && hashtab->fillsize < HT_INIT_SIZE - 1
-                && ht_get_smallarray(hashtab) == hashtab->array)
+        if (ht_is_smallarray(hashtab, hashtab->array)
+                && hashtab->fillsize < HT_INIT_SIZE - 1)
             return OK;
 
+        /*
+         * a table grows to 8 times of its size at most, so it never
+         * shrinks just after growing.
+         */
         if (hashtab->fillsize * 3 < hashtab->capacity * 2
-                && hashtab->size > hashtab->capacity / 5)
+                && (hashtab->size > hashtab->capacity / 8
+                    || hashtab->capacity <= HT_INIT_SIZE))
             return OK;
 
         if (hashtab->size > 1000)
@@ -447,6 +548,7 @@ ht_may_resize(struct hashtable *hashtab, size_t minitems)
     }
     else
     {
+        ht_migrate(hashtab, hashtab->oldcapacity);
         if (minitems < hashtab->size)
             minitems = hashtab->size;
         minsize = minitems * 3 / 2;
@@ -474,48 +576,220 @@ ht_may_resize(struct hashtable *hashtab, size_t minitems)
         }
         else
             oldarray = hashtab->array;
+        memset(newarray, 0, sizeof(hashitem_t) * HT_INIT_SIZE);
     }
     else
     {
-        newarray = vime_malloc(sizeof(hashitem_t) * newsize);
+        /* a large array comes zeroed, its pages are touched later. */
+        newarray = vime_calloc(newsize, sizeof(hashitem_t));
         if (newarray == NULL)
             return (hashtab->fillsize < hashtab->capacity) ? OK : FAIL;
         oldarray = hashtab->array;
     }
-    memset(newarray, 0, sizeof(hashitem_t) * newsize);
+
+    /* the old array is allocated by us, if it isn't a static one. */
+    owned = oldarray != NULL && !ht_no_free(hashtab);
+    oldsize = hashtab->capacity;
 
     hashtab->capacity = newsize;
     hashtab->fillsize = hashtab->size;
     hashtab->array = newarray;
+    if (ht_is_smallarray(hashtab, newarray))
+        hashtab->flags |= HF_NO_FREE;
+    else
+        hashtab->flags &= ~HF_NO_FREE;
     if (oldarray == NULL)
         return OK;
 
+    /* only a allocated array can be moved incrementally. */
+    if ((hashtab->flags & HF_INCREMENTAL) && owned)
+    {
+        hashtab->oldarray = oldarray;
+        hashtab->oldcapacity = oldsize;
+        hashtab->moved = 0;
+        return OK;
+    }
+
     /* Move all items from the old array to the new array.  */
-    todo = hashtab->size;
-    mask = newsize - 1;
-    for (iter = oldarray; todo > 0; ++iter)
+    ht_move_items(hashtab, oldarray, 0, oldsize);
+    if (owned)
+        vime_free(oldarray);
+
+    return OK;
+}
+
+
+/**
+ * move the items in a range of a old array to the array of a
+ * #hashtable, the moved items are marked as removed in the old
+ * array.
+ *
+ * \param hashtab the hashtable.
+ * \param oldarray the old array.
+ * \param from the first index of items to move.
+ * \param to the index after the last item to move.
+ */
+    INLINE void
+ht_move_items(
+        struct hashtable *hashtab,
+        hashitem_t *oldarray,
+        size_t from,
+        size_t to)
+{
+    size_t idx, mask = hashtab->capacity - 1;
+    hash_t perturb;
+    hashitem_t *iter, *item;
+
+    for (iter = oldarray + from; iter != oldarray + to; ++iter)
     {
-        if (*iter == HI_NULL)
+        if (hi_is_empty(*iter))
             continue;
 
         /*
          * this algorithm is same as the algorithm in ht_entry,
-         * but simpler than it. because we only need find a HI_NULL
+         * but simpler than it. because we only need find a empty
          * entry.
          */
-        idx = (int)((*iter)->hash & mask);
-        item = &newarray[idx];
-        
-        for (perturb = (*iter)->hash; item != NULL; perturb >>= PERTURB_SHIFT)
+        idx = (size_t)((*iter)->hash & mask);
+        item = &hashtab->array[idx];
+
+        for (perturb = (*iter)->hash; !hi_is_empty(*item);
+                perturb >>= PERTURB_SHIFT)
         {
-            idx = (int)((idx << 2) + idx + perturb + 1);
-            item = &newarray[idx & mask];
+            idx = (size_t)((idx << 2) + idx + perturb + 1);
+            item = &hashtab->array[idx & mask];
         }
         *item = *iter;
-        --todo;
+        *iter = HI_TOMB;
     }
+}
 
-    return OK;
+
+/**
+ * move items of the old array in a incremental resize, and free the
+ * old array when all items are moved.
+ *
+ * \param hashtab the hashtable.
+ * \param count the nr of items in the old array to move.
+ */
+    INLINE void
+ht_migrate(struct hashtable *hashtab, size_t count)
+{
+    size_t to;
+
+    if (hashtab->oldarray == NULL)
+        return;
+
+    to = hashtab->oldcapacity - hashtab->moved > count
+        ? hashtab->moved + count : hashtab->oldcapacity;
+    ht_move_items(hashtab, hashtab->oldarray, hashtab->moved, to);
+    hashtab->moved = to;
+
+    if (to == hashtab->oldcapacity)
+    {
+        vime_free(hashtab->oldarray);
+        hashtab->oldarray = NULL;
+        hashtab->oldcapacity = hashtab->moved = 0;
+    }
+}
+
+
+/**
+ * multiply two 64 bit values, and put the low and high 64 bits of
+ * the 128 bit result back.
+ */
+#if defined(__SIZEOF_INT128__)
+    INLINE void
+ht_mum(uint64_t *a, uint64_t *b)
+{
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+#else /* defined(__SIZEOF_INT128__) */
+    INLINE void
+ht_mum(uint64_t *a, uint64_t *b)
+{
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl, lo;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+#endif /* defined(__SIZEOF_INT128__) */
+
+
+
+/**
+ * compute a hash value for a block of bytes.
+ *
+ * the key is read 8 or 16 bytes a time, and mixed with the 128 bit
+ * multiply, the same way as wyhash does.
+ *
+ * \param key the bytes used to compute.
+ * \param len the length of key.
+ * \return hash the hash value of the bytes.
+ */
+    INLINE hash_t
+ht_hash_bytes(void const *key, size_t len)
+{
+    unsigned char const *p = key;
+    uint64_t seed, a, b;
+    uint32_t w[4];
+    size_t i = len;
+
+    if ((seed = ht_hash_seed) == 0)
+        seed = ht_set_hash_seed(0);
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            /* the first and last 4 bytes, and 4 bytes in middle. */
+            size_t mid = (len >> 3) << 2;
+            memcpy(&w[0], p, 4);
+            memcpy(&w[1], p + mid, 4);
+            memcpy(&w[2], p + len - 4, 4);
+            memcpy(&w[3], p + len - 4 - mid, 4);
+            a = (uint64_t)w[0] << 32 | w[1];
+            b = (uint64_t)w[2] << 32 | w[3];
+        }
+        else if (len > 0)
+        {
+            a = (uint64_t)p[0] << 16 | (uint64_t)p[len >> 1] << 8
+                | p[len - 1];
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        for (; i > 16; i -= 16, p += 16)
+        {
+            memcpy(&a, p, 8);
+            memcpy(&b, p + 8, 8);
+            a ^= HT_HASH_P1;
+            b ^= seed;
+            ht_mum(&a, &b);
+            seed = a ^ b;
+        }
+        memcpy(&a, p + i - 16, 8);
+        memcpy(&b, p + i - 8, 8);
+    }
+
+    a ^= HT_HASH_P1;
+    b ^= seed;
+    ht_mum(&a, &b);
+    a ^= HT_HASH_P0 ^ len;
+    b ^= HT_HASH_P1;
+    ht_mum(&a, &b);
+
+    return (hash_t)(a ^ b);
 }
 
 
@@ -524,19 +798,13 @@ ht_may_resize(struct hashtable *hashtab, size_t minitems)
  *
  * \param key the str used to compute.
  * \return hash the hash value of the string.
+ * \sa ht_hash_bytes
  */
     INLINE hash_t
 ht_default_hash(char const *key)
 {
-    hash_t hash;
-
-    assert(key != NULL && *key != '\0');
-
-    hash = *key;
-    while (*++key != '\0')
-        hash = (hash << 5) + hash + *key;
-
-    return hash;
+    assert(key != NULL);
+    return ht_hash_bytes(key, strlen(key));
 }
 
 
@@ -630,7 +898,9 @@ DEFINE_HT_INSERT_BODY(hashtab, value,
 ht_del(struct hashtable *hashtab, hashitem_t *entry)
 {
     hashitem_t del_entry = *entry;
-    assert(entry - hashtab->array < hashtab->capacity);
+    assert((size_t)(entry - hashtab->array) < hashtab->capacity
+            || (hashtab->oldarray != NULL && (size_t)(entry
+                    - hashtab->oldarray) < hashtab->oldcapacity));
     --hashtab->size;
     *entry = HI_TOMB;
     return del_entry;
@@ -679,6 +949,48 @@ ht_remove(struct hashtable *hashtab, void const *key)
 DEFINE_HT_LOOKUP_BODY(hashtab, entry,
         ht_default_entry(hashtab, key, NULL), ht_del(hashtab, entry), NULL)
 
+
+/**
+ * get the hashtable entry of a key with length, the key needn't be
+ * NUL terminated (e.g. a word in the text), but the keys in the table
+ * must be.
+ *
+ * \param hashtab   the #hashtable.
+ * \param key       the key value should in the entry.
+ * \param len       the length of the key.
+ * \param phash     points to the variable received the hash value
+ *                  computed form key, or NULL.
+ * \return the pointer to entry we need.
+ * \sa ht_default_entry
+ */
+    INLINE hashitem_t*
+ht_len_entry(
+        struct hashtable *hashtab,
+        void const *key,
+        size_t len,
+        hash_t *phash)
+DEFINE_HT_ENTRY_BODY(hashtab, item,
+        phash == NULL ? ht_hash_bytes(key, len)
+            : (*phash = ht_hash_bytes(key, len)),
+        strlen((*item)->key) != len
+            || memcmp((*item)->key, key, len) != 0)
+
+
+/**
+ * lookup a item from hashtable by a key with length, the hash value
+ * is the same as ht_default_hash() of the NUL terminated key.
+ *
+ * \param hashtab the hashtable.
+ * \param key the key which look up in the hashtable.
+ * \param len the length of the key.
+ * \return the entry if found, or NULL if not found.
+ * \sa ht_lookup
+ */
+    INLINE struct hash_entry*
+ht_lookup_len(struct hashtable *hashtab, void const *key, size_t len)
+DEFINE_HT_LOOKUP_BODY(hashtab, entry,
+        ht_len_entry(hashtab, key, len, NULL), *entry, NULL)
+
 #endif /* defined(ENABLE_INLINE) || defined(DEFINE_INLINE_FUNCS) */
 
 
@@ -23,8 +23,21 @@
  * modify  function in this list, when needed, you can use hook_call()
  * to call all function in list.
  *
- * if a function return a value OK, then the list will break, unless
- * pass HOOK_FORCE flag to hook_call, or all the function return FAIL.
+ * if a function return a negtive value, then the list will break,
+ * unless pass HF_FORCE flag to hook_call.
+ *
+ * some hooks are called for every keystroke or every step, so the
+ * entries are compiled into a array of function/entry pairs (a
+ * #hook_chain) when they are added or removed with hook_add() and
+ * hook_remove(), and hook_call() only loops over the array. if you
+ * change hook_list directly, call hook_update() after that, or the
+ * hook is called by walking the list.
+ *
+ * a entry has a priority, the entries with higher priority are called
+ * first. a entry also has a event mask and a key (e.g. a filetype),
+ * hook_call_filter() only calls the entries matched, and the masks
+ * and keys are checked in the chain, without calling the functions
+ * of entries not matched.
  */
 
 
@@ -42,10 +55,19 @@ struct hook_entry
 
     /** the hook function. */
     int (*hook_func)(struct hook_entry *self, void *args);
+
+    int priority;           /**< the entries with higher are called first. */
+    unsigned long mask;     /**< the events the entry is called for, or
+                                 0 for all events. */
+    unsigned long key;      /**< the key the entry is called for, or 0
+                                 for all keys. */
 };
 
 /** the default static constructor of #hook_entry. */
-#define HOOK_ENTRY_INIT {LIST_ENTRY_INIT, NULL}
+#define HOOK_ENTRY_INIT {LIST_ENTRY_INIT, NULL, 0, 0, 0}
+
+/** the mask of all events, used to call all entries. */
+#define HOOK_MASK_ALL (~0UL)
 
 /** get the hook struction from list node. */
 #define HOOK_ENTRY(ptr) LIST_ENTRY((ptr), struct hook_entry, node)
@@ -53,22 +75,70 @@ struct hook_entry
 /**
  * whether the hook link is break.
  *
- * if return value is negtive and not pass HF_FORCE to hook_init()
+ * if return value is negtive and not pass HF_FORCE to hook_call()
  * function, the remain hooks will ignore.
  */
 #define hook_is_break(ret) ((ret) < 0)
 
 
+/**
+ * a compiled function of hook.
+ */
+struct hook_item
+{
+    /** the hook function. */
+    int (*hook_func)(struct hook_entry *self, void *args);
+
+    /** the entry passed to function. */
+    struct hook_entry *entry;
+
+    unsigned long mask;     /**< the mask of entry. */
+    unsigned long key;      /**< the key of entry. */
+    size_t next;            /**< the next item with the same key. */
+};
+
+
+/**
+ * the first item of a key in #hook_chain.
+ */
+struct hook_key
+{
+    unsigned long key;      /**< the key. */
+    size_t first;           /**< the index of first item. */
+};
+
+
+/**
+ * the compiled entries of hook, never changed after compiled.
+ *
+ * the items with the same key are linked by the next field, so a call
+ * with a key only visits the items of the key and the items for all
+ * keys.
+ */
+struct hook_chain
+{
+    struct hook_chain *retired; /**< the next chain to free. */
+    size_t count;               /**< the count of items. */
+    size_t first_any;           /**< the first item for all keys. */
+    size_t nkeys;               /**< the count of keys. */
+    struct hook_key *keys;      /**< the keys, sorted. */
+    struct hook_item items[1];  /**< the functions, in list order. */
+};
+
+
 /**
  * hook struction.
  */
 struct hook
 {
-    struct list_entry *hook_list;
+    struct list_entry *hook_list;   /**< the head of entries list. */
+    struct hook_chain *chain;       /**< the compiled entries, or NULL. */
+    struct hook_chain *retired;     /**< the chains replaced in a call. */
+    int busy;                       /**< the depth of hook_call(). */
 };
 
 /** the default static constructor of #hook_entry. */
-#define HOOK_INIT {NULL}
+#define HOOK_INIT {NULL, NULL, NULL, 0}
 
 
 /** the default flag. */
@@ -77,19 +147,317 @@ struct hook
 /** the flags force call all function in hook list. */
 #define HF_FORCE        (1 << 0)
 
+
+/*
+ * the memory routines include this file, so include them after the
+ * hook struction is defined.
+ */
+#include <System/mem.h>
+
+
 /**
- * call the hook.
+ * initialize a hook with a empty list.
+ *
+ * \param hook the hook.
+ * \param list the head of entries list.
  */
 #if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
-int hook_call(struct hook *hook,  int flags, void *args);
+struct hook *hook_init(struct hook *hook, struct list_entry *list);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE struct hook*
+hook_init(struct hook *hook, struct list_entry *list)
+{
+    list_init(list);
+    hook->hook_list = list;
+    hook->chain = hook->retired = NULL;
+    hook->busy = 0;
+    return hook;
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
+/**
+ * free the compiled entries of hook.
+ *
+ * a hook_call() running may still use the chain, then it's freed when
+ * the call returns.
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+void hook_drop(struct hook *hook);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE void
+hook_drop(struct hook *hook)
+{
+    struct hook_chain *chain;
+
+    if (hook->chain != NULL)
+    {
+        hook->chain->retired = hook->retired;
+        hook->retired = hook->chain;
+        hook->chain = NULL;
+    }
+
+    while (hook->busy == 0 && (chain = hook->retired) != NULL)
+    {
+        hook->retired = chain->retired;
+        vime_free(chain);
+    }
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
+/**
+ * compare the keys of #hook_key, then the first items.
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+int hook_key_compare(void const *lhs, void const *rhs);
 #else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
 
     INLINE int
-hook_call(struct hook *hook, int flags, void *args)
+hook_key_compare(void const *lhs, void const *rhs)
+{
+    struct hook_key const *l = lhs, *r = rhs;
+
+    if (l->key != r->key)
+        return l->key < r->key ? -1 : 1;
+    return l->first < r->first ? -1 : l->first > r->first;
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
+/**
+ * compile the entries of hook again, after hook_list is changed.
+ *
+ * \return OK for success, or FAIL if no memory, then the hook is
+ *         called by walking the list.
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+int hook_update(struct hook *hook);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE int
+hook_update(struct hook *hook)
+{
+    struct hook_chain *chain;
+    struct hook_item *item;
+    struct list_entry *iter;
+    size_t count = 0, i, last_any;
+
+    hook_drop(hook);
+    if (hook->hook_list == NULL)
+        return OK;
+    list_for_each(iter, hook->hook_list)
+        ++count;
+    if (count == 0)
+        return OK;
+
+    chain = vime_malloc(offsetof(struct hook_chain, items)
+            + count * (sizeof(struct hook_item) + sizeof(struct hook_key)));
+    if (chain == NULL)
+        return FAIL;
+    chain->retired = NULL;
+    chain->count = count;
+    chain->first_any = last_any = count;
+    chain->nkeys = 0;
+    chain->keys = (struct hook_key *)&chain->items[count];
+
+    /* the items for all keys are linked here, the others are sorted by
+     * key then linked. */
+    i = 0;
+    list_for_each(iter, hook->hook_list)
+    {
+        item = &chain->items[i];
+        item->hook_func = HOOK_ENTRY(iter)->hook_func;
+        item->entry = HOOK_ENTRY(iter);
+        item->mask = item->entry->mask;
+        item->key = item->entry->key;
+        item->next = count;
+        if (item->key == 0)
+        {
+            if (last_any == count)
+                chain->first_any = i;
+            else
+                chain->items[last_any].next = i;
+            last_any = i;
+        }
+        else
+        {
+            chain->keys[chain->nkeys].key = item->key;
+            chain->keys[chain->nkeys++].first = i;
+        }
+        ++i;
+    }
+
+    qsort(chain->keys, chain->nkeys, sizeof(struct hook_key),
+            hook_key_compare);
+    for (i = count = 0; i < chain->nkeys; ++i)
+        if (count != 0 && chain->keys[count - 1].key == chain->keys[i].key)
+            chain->items[chain->keys[i - 1].first].next
+                = chain->keys[i].first;
+        else
+            chain->keys[count++] = chain->keys[i];
+    chain->nkeys = count;
+
+    hook->chain = chain;
+    return OK;
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
+/**
+ * add a entry to hook, after the entries with the same or higher
+ * priority.
+ *
+ * \return the same as hook_update(), the entry is added anyway.
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+int hook_add(struct hook *hook, struct hook_entry *entry);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE int
+hook_add(struct hook *hook, struct hook_entry *entry)
+{
+    struct list_entry *iter = hook->hook_list->prev;
+
+    while (iter != hook->hook_list
+            && HOOK_ENTRY(iter)->priority < entry->priority)
+        iter = iter->prev;
+    list_append(iter, &entry->node);
+    return hook_update(hook);
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
+/**
+ * remove a entry from hook.
+ *
+ * \return the same as hook_update(), the entry is removed anyway.
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+int hook_remove(struct hook *hook, struct hook_entry *entry);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE int
+hook_remove(struct hook *hook, struct hook_entry *entry)
+{
+    list_remove(&entry->node);
+    return hook_update(hook);
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
+/**
+ * whether the mask of a entry is matched by mask, the entries with mask
+ * 0 are matched by any mask, even 0. it's used by the chain and the
+ * list both, so they call the same entries.
+ */
+#define hook_match_mask(em, m) ((em) == 0 || ((em) & (m)) != 0)
+
+/** whether a entry is matched by mask and key. */
+#define hook_match(entry, m, k) \
+    (hook_match_mask((entry)->mask, (m)) \
+        && ((entry)->key == 0 || (k) == 0 || (entry)->key == (k)))
+
+
+/**
+ * call the entries of hook matched by mask and key.
+ *
+ * a entry is matched if its mask is 0 or has a event in mask (so a
+ * call with mask 0 only calls the entries with mask 0), and its
+ * key is 0, or key is 0, or they are the same. a call uses the entries of
+ * hook when it starts, the entries added or removed by the functions
+ * called are used from the next call.
+ *
+ * \return the value returned by the last entry called, or OK if no
+ *         entry is called.
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+int hook_call_filter(struct hook *hook, int flags, unsigned long mask,
+        unsigned long key, void *args);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE int
+hook_call_filter(
+        struct hook *hook,
+        int flags,
+        unsigned long mask,
+        unsigned long key,
+        void *args)
 {
     int retv = OK;
+    struct hook_chain *chain = hook->chain;
+    struct hook_item *item;
     struct list_entry *iter, *next;
+    size_t i, j, low, high, mid;
+
+    if (chain != NULL)
+    {
+        ++hook->busy;
+
+        /* the items for all keys, and the items of key. */
+        i = chain->first_any;
+        j = chain->count;
+        for (low = 0, high = key == 0 ? 0 : chain->nkeys; low < high; )
+        {
+            mid = low + (high - low) / 2;
+            if (chain->keys[mid].key < key)
+                low = mid + 1;
+            else if (chain->keys[mid].key > key)
+                high = mid;
+            else
+            {
+                j = chain->keys[mid].first;
+                break;
+            }
+        }
 
+        if (key == 0)
+        {
+            for (i = 0; i < chain->count; ++i)
+                if (hook_match_mask(chain->items[i].mask, mask)
+                        && hook_is_break(retv = chain->items[i].hook_func(
+                                chain->items[i].entry, args))
+                        && (flags & HF_FORCE) == 0)
+                    break;
+        }
+        else while (i < chain->count || j < chain->count)
+        {
+            if (i < j)
+            {
+                item = &chain->items[i];
+                i = item->next;
+            }
+            else
+            {
+                item = &chain->items[j];
+                j = item->next;
+            }
+            if (hook_match_mask(item->mask, mask)
+                    && hook_is_break(retv = item->hook_func(item->entry,
+                            args))
+                    && (flags & HF_FORCE) == 0)
+                break;
+        }
+
+        /* free the chains replaced in the call. */
+        if (--hook->busy == 0)
+            while ((chain = hook->retired) != NULL)
+            {
+                hook->retired = chain->retired;
+                vime_free(chain);
+            }
+        return retv;
+    }
+
+    /* not compiled, walk the list. */
     if (hook->hook_list == NULL)
         return retv;
 
@@ -97,8 +465,9 @@ hook_call(struct hook *hook, int flags, void *args)
     {
         struct hook_entry *entry = HOOK_ENTRY(iter);
 
-        if (hook_is_break(retv = entry->hook_func(entry, args))
-                && flags & HF_FORCE == 0)
+        if (hook_match(entry, mask, key)
+                && hook_is_break(retv = entry->hook_func(entry, args))
+                && (flags & HF_FORCE) == 0)
             break;
     }
 
@@ -108,4 +477,22 @@ hook_call(struct hook *hook, int flags, void *args)
 #endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
 
 
+/**
+ * call the hook, all the entries are called.
+ *
+ * \sa hook_call_filter
+ */
+#if !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES)
+int hook_call(struct hook *hook,  int flags, void *args);
+#else /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+    INLINE int
+hook_call(struct hook *hook, int flags, void *args)
+{
+    return hook_call_filter(hook, flags, HOOK_MASK_ALL, 0, args);
+}
+
+#endif /* !defined(ENABLE_INLINE) && !defined(DEFINE_INLINE_ROUTINES) */
+
+
 #endif /* VIME_HOOK_H */
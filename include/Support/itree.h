@@ -0,0 +1,692 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+#include <Support/sbtree.h>
+
+
+/**
+ * \file itree.h
+ *
+ * interval tree for VimE.
+ *
+ * the text properties, highlights and extmarks are intervals of byte
+ * offsets in a buffer. the screen needs the intervals overlap with the
+ * visible text, and every edit moves the intervals after it. #itree
+ * keeps the intervals in a sbtree ordered by their start, every node
+ * keeps the max end of its subtree, so the intervals overlap with a
+ * range are found without scanning all of them, see itree_overlap().
+ *
+ * the start of a node is stored relative to the start of its parent
+ * (the start of the root is absolute), so the intervals after a
+ * position are all moved by changing the offsets in one path of the
+ * tree, in O(log n), see itree_shift() and itree_adjust(). the
+ * absolute start of a node is the sum of the offsets from it to the
+ * root, itree_start() and the iterators compute it.
+ *
+ * like sbtree, #itree_entry is embedded in the struction of user, and
+ * the tree never allocates memory. intervals are half-open, [start,
+ * end), equal starts are allowed.
+ */
+
+
+#ifndef VIME_ITREE_H
+#define VIME_ITREE_H
+
+
+/**
+ * the entry struction of #itree.
+ */
+struct itree_entry
+{
+    struct sbtree_entry node;   /**< the sbtree node, ordered by start. */
+    ptrdiff_t off;      /**< the start, relative to the start of parent. */
+    size_t len;         /**< the length of interval, i.e. end - start. */
+    ptrdiff_t max_end;  /**< the max end of subtree, relative to the
+                          start of this node. */
+};
+
+/** get the #itree_entry of a sbtree node. */
+#define ITREE_NODE(ptr) container_of(ptr, struct itree_entry, node)
+
+/** get the container of the #itree_entry. */
+#define ITREE_ENTRY(ptr, type, field) container_of(ptr, type, field)
+
+
+/**
+ * interval tree struction.
+ */
+struct itree
+{
+    struct sbtree_entry *root;  /**< the root of the tree. */
+};
+
+/** the default constructor of #itree. */
+#define ITREE_INIT {&sbtree_nil}
+
+
+/**
+ * the iterator of #itree.
+ *
+ * the iterator is at the end if node is &sbtree_nil.
+ */
+struct itree_iter
+{
+    struct sbtree_entry *node;  /**< the node of the interval. */
+    size_t start;       /**< the absolute start of the interval. */
+    size_t low;         /**< the range to find, see itree_overlap(). */
+    size_t high;
+};
+
+/** get the #itree_entry at a iterator. */
+#define itree_iter_entry(it) ITREE_NODE((it)->node)
+
+/** get the absolute end of the interval at a iterator. */
+#define itree_iter_end(it) ((it)->start + itree_iter_entry(it)->len)
+
+
+INLINE struct itree *itree_init(struct itree *tree);
+INLINE size_t itree_size(struct itree const *tree);
+INLINE size_t itree_start(struct itree_entry const *entry);
+INLINE size_t itree_end(struct itree_entry const *entry);
+INLINE void itree_update(struct sbtree_entry *node);
+INLINE void itree_propagate(struct sbtree_entry *node);
+INLINE void itree_left_rotate(struct sbtree_entry **pnode);
+INLINE void itree_right_rotate(struct sbtree_entry **pnode);
+INLINE void itree_maintain(struct sbtree_entry **pnode, int care_left);
+INLINE void itree_insert_fixup(struct sbtree_entry **pnode,
+        struct sbtree_entry *new_node);
+INLINE struct itree_entry *itree_insert(struct itree *tree,
+        struct itree_entry *entry, size_t start, size_t end);
+INLINE struct itree_entry *itree_remove(struct itree *tree,
+        struct itree_entry *entry);
+INLINE void itree_set_end(struct itree_entry *entry, size_t end);
+INLINE struct sbtree_entry *itree_lower_bound(struct itree *tree,
+        size_t pos, size_t *pstart);
+INLINE struct sbtree_entry *itree_find_overlap(struct sbtree_entry *node,
+        size_t start, size_t low, size_t high, size_t *pstart);
+INLINE int itree_overlap(struct itree *tree, size_t low, size_t high,
+        struct itree_iter *it);
+INLINE int itree_overlap_next(struct itree_iter *it);
+INLINE void itree_shift(struct itree *tree, size_t from, ptrdiff_t delta);
+INLINE void itree_adjust(struct itree *tree, size_t pos, size_t del,
+        size_t ins);
+
+
+#if defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES)
+
+/**
+ * initialize a interval tree.
+ *
+ * \param tree the tree need to initialize.
+ * \return the tree.
+ */
+    INLINE struct itree*
+itree_init(struct itree *tree)
+{
+    tree->root = &sbtree_nil;
+    return tree;
+}
+
+
+/**
+ * get the amount of intervals in tree.
+ */
+    INLINE size_t
+itree_size(struct itree const *tree)
+{
+    return tree->root->size;
+}
+
+
+/**
+ * get the absolute start of a interval in tree, in O(log n).
+ */
+    INLINE size_t
+itree_start(struct itree_entry const *entry)
+{
+    struct sbtree_entry const *node = &entry->node;
+    size_t start = 0;
+
+    for (; node != &sbtree_nil; node = node->parent)
+        start += (size_t)ITREE_NODE(node)->off;
+    return start;
+}
+
+
+/**
+ * get the absolute end of a interval in tree, in O(log n).
+ */
+    INLINE size_t
+itree_end(struct itree_entry const *entry)
+{
+    return itree_start(entry) + entry->len;
+}
+
+
+/*
+ * recompute the max end of a node, from its children. the size is
+ * not changed.
+ */
+    INLINE void
+itree_update(struct sbtree_entry *node)
+{
+    struct itree_entry *entry = ITREE_NODE(node), *child;
+    ptrdiff_t max_end = (ptrdiff_t)entry->len;
+
+    if (node->left != &sbtree_nil)
+    {
+        child = ITREE_NODE(node->left);
+        if (child->off + child->max_end > max_end)
+            max_end = child->off + child->max_end;
+    }
+    if (node->right != &sbtree_nil)
+    {
+        child = ITREE_NODE(node->right);
+        if (child->off + child->max_end > max_end)
+            max_end = child->off + child->max_end;
+    }
+    entry->max_end = max_end;
+}
+
+
+/*
+ * recompute the size and max end of a node and all its ancestors.
+ */
+    INLINE void
+itree_propagate(struct sbtree_entry *node)
+{
+    for (; node != &sbtree_nil; node = node->parent)
+    {
+        node->size = node->left->size + node->right->size + 1;
+        itree_update(node);
+    }
+}
+
+
+/*
+ * left rotate node, the offsets of the nodes moved are changed to be
+ * relative to their new parents.
+ */
+    INLINE void
+itree_left_rotate(struct sbtree_entry **pnode)
+{
+    struct sbtree_entry *node = *pnode, *right = node->right;
+    ptrdiff_t off = ITREE_NODE(right)->off;
+
+    if (right->left != &sbtree_nil)
+        ITREE_NODE(right->left)->off += off;
+    ITREE_NODE(right)->off += ITREE_NODE(node)->off;
+    ITREE_NODE(node)->off = -off;
+
+    sbtree_set_parent(right, node->parent);
+    sbtree_set_right(node, right->left);
+    sbtree_set_left(right, node);
+
+    right->size = node->size;
+    node->size = node->left->size + node->right->size + 1;
+    itree_update(node);
+    itree_update(right);
+    *pnode = right;
+}
+
+
+/*
+ * right rotate node, see itree_left_rotate().
+ */
+    INLINE void
+itree_right_rotate(struct sbtree_entry **pnode)
+{
+    struct sbtree_entry *node = *pnode, *left = node->left;
+    ptrdiff_t off = ITREE_NODE(left)->off;
+
+    if (left->right != &sbtree_nil)
+        ITREE_NODE(left->right)->off += off;
+    ITREE_NODE(left)->off += ITREE_NODE(node)->off;
+    ITREE_NODE(node)->off = -off;
+
+    sbtree_set_parent(left, node->parent);
+    sbtree_set_left(node, left->right);
+    sbtree_set_right(left, node);
+
+    left->size = node->size;
+    node->size = node->left->size + node->right->size + 1;
+    itree_update(node);
+    itree_update(left);
+    *pnode = left;
+}
+
+
+/*
+ * keep the balance of tree, see sbtree_maintain().
+ */
+    INLINE void
+itree_maintain(struct sbtree_entry **pnode, int care_left)
+{
+    if (care_left)
+    {
+        if ((*pnode)->left->left->size > (*pnode)->right->size)
+            itree_right_rotate(pnode);
+        else if ((*pnode)->left->right->size > (*pnode)->right->size)
+        {
+            itree_left_rotate(&(*pnode)->left);
+            itree_right_rotate(pnode);
+        }
+        else return;
+    }
+    else
+    {
+        if ((*pnode)->right->right->size > (*pnode)->left->size)
+            itree_left_rotate(pnode);
+        else if ((*pnode)->right->left->size > (*pnode)->left->size)
+        {
+            itree_right_rotate(&(*pnode)->right);
+            itree_left_rotate(pnode);
+        }
+        else return;
+    }
+
+    itree_maintain(&(*pnode)->left, TRUE);
+    itree_maintain(&(*pnode)->right, FALSE);
+    itree_maintain(pnode, TRUE);
+    itree_maintain(pnode, FALSE);
+}
+
+
+/*
+ * fix the tree after link new node, see sbtree_aug_insert_fixup().
+ */
+    INLINE void
+itree_insert_fixup(struct sbtree_entry **pnode,
+        struct sbtree_entry *cur_node)
+{
+    struct sbtree_entry *parent, *child = cur_node;
+    int care_left, is_left;
+
+    if ((cur_node = child->parent) == &sbtree_nil)
+        return;
+
+    care_left = child == cur_node->left;
+    while ((parent = cur_node->parent) != &sbtree_nil)
+    {
+        is_left = cur_node == parent->left;
+        itree_maintain(is_left ? &parent->left : &parent->right,
+                care_left);
+        care_left = is_left;
+        cur_node = parent;
+    }
+
+    itree_maintain(pnode, care_left);
+}
+
+
+/**
+ * insert a interval into tree.
+ *
+ * \param tree the tree.
+ * \param entry the entry of interval, needn't be initialized.
+ * \param start the start of interval.
+ * \param end the end of interval, not smaller than start.
+ * \return the entry.
+ *
+ * \remark the interval is inserted after the intervals have the same
+ * start.
+ */
+    INLINE struct itree_entry*
+itree_insert(struct itree *tree, struct itree_entry *entry,
+        size_t start, size_t end)
+{
+    struct sbtree_entry **plink = &tree->root, *node = &sbtree_nil;
+    size_t base = 0;
+
+    while (*plink != &sbtree_nil)
+    {
+        node = *plink;
+        base += (size_t)ITREE_NODE(node)->off;
+        plink = start < base ? &node->left : &node->right;
+    }
+
+    sbtree_init(&entry->node);
+    entry->off = (ptrdiff_t)(start - base);
+    entry->len = end - start;
+    entry->max_end = (ptrdiff_t)entry->len;
+
+    *plink = &entry->node;
+    sbtree_set_parent(&entry->node, node);
+    itree_propagate(node);
+    itree_insert_fixup(&tree->root, &entry->node);
+    return entry;
+}
+
+
+/**
+ * remove a interval from tree.
+ *
+ * \param tree the tree.
+ * \param entry the entry of interval need to remove.
+ * \return the entry.
+ */
+    INLINE struct itree_entry*
+itree_remove(struct itree *tree, struct itree_entry *entry)
+{
+    struct sbtree_entry *del_node = &entry->node, *succ, *fix, *node;
+    ptrdiff_t off;
+
+    if (del_node->left == &sbtree_nil || del_node->right == &sbtree_nil)
+    {
+        succ = del_node->left == &sbtree_nil ?
+            del_node->right : del_node->left;
+        fix = del_node->parent;
+        if (succ != &sbtree_nil)
+            ITREE_NODE(succ)->off += entry->off;
+    }
+    else
+    {
+        /* off is the start of succ, relative to del_node. */
+        succ = del_node->right;
+        off = ITREE_NODE(succ)->off;
+        while (succ->left != &sbtree_nil)
+        {
+            succ = succ->left;
+            off += ITREE_NODE(succ)->off;
+        }
+
+        if (succ->parent == del_node)
+            fix = succ;
+        else
+        {
+            fix = succ->parent;
+            if ((node = succ->right) != &sbtree_nil)
+                ITREE_NODE(node)->off += ITREE_NODE(succ)->off;
+            sbtree_set_left(succ->parent, succ->right);
+            sbtree_set_right(succ, del_node->right);
+            ITREE_NODE(succ->right)->off -= off;
+        }
+        sbtree_set_left(succ, del_node->left);
+        ITREE_NODE(succ->left)->off -= off;
+        ITREE_NODE(succ)->off = entry->off + off;
+    }
+
+    sbtree_set_parent(succ, del_node->parent);
+    if (del_node->parent == &sbtree_nil)
+        tree->root = succ;
+    else
+        *sbtree_get_parent_field(del_node) = succ;
+
+    itree_propagate(fix);
+    return entry;
+}
+
+
+/**
+ * change the end of a interval in tree, in O(log n).
+ *
+ * \param entry the entry of interval.
+ * \param end the new end, not smaller than the start.
+ */
+    INLINE void
+itree_set_end(struct itree_entry *entry, size_t end)
+{
+    entry->len = end - itree_start(entry);
+    itree_propagate(&entry->node);
+}
+
+
+/**
+ * find the first interval which start is not smaller than pos.
+ *
+ * \param tree the tree.
+ * \param pos the position.
+ * \param pstart used to return the start of interval found.
+ * \return the node of interval found, or &sbtree_nil.
+ */
+    INLINE struct sbtree_entry*
+itree_lower_bound(struct itree *tree, size_t pos, size_t *pstart)
+{
+    struct sbtree_entry *node = tree->root, *found = &sbtree_nil;
+    size_t start = 0;
+
+    for (; node != &sbtree_nil; )
+    {
+        start += (size_t)ITREE_NODE(node)->off;
+        if (start < pos)
+            node = node->right;
+        else
+        {
+            found = node;
+            *pstart = start;
+            node = node->left;
+        }
+    }
+    return found;
+}
+
+
+/**
+ * find the first interval overlap with [low, high) in a subtree.
+ *
+ * \param node the root of subtree.
+ * \param start the absolute start of node.
+ * \param low the range to find, see itree_overlap().
+ * \param high
+ * \param pstart used to return the start of interval found.
+ * \return the node of interval found, or &sbtree_nil.
+ */
+    INLINE struct sbtree_entry*
+itree_find_overlap(struct sbtree_entry *node, size_t start,
+        size_t low, size_t high, size_t *pstart)
+{
+    struct sbtree_entry *found;
+
+    /* skip the subtrees end before low. */
+    while (node != &sbtree_nil
+            && start + (size_t)ITREE_NODE(node)->max_end > low)
+    {
+        if (node->left != &sbtree_nil && (found = itree_find_overlap(
+                        node->left, start + (size_t)ITREE_NODE(
+                            node->left)->off, low, high, pstart))
+                != &sbtree_nil)
+            return found;
+
+        /* the node and its right subtree all start after high. */
+        if (start >= high)
+            break;
+        if (start + ITREE_NODE(node)->len > low)
+        {
+            *pstart = start;
+            return node;
+        }
+
+        node = node->right;
+        if (node != &sbtree_nil)
+            start += (size_t)ITREE_NODE(node)->off;
+    }
+    return &sbtree_nil;
+}
+
+
+/**
+ * find the first interval overlap with [low, high), i.e. start before
+ * high and end after low, in the order of start.
+ *
+ * the first interval is found in O(log n), and every next interval
+ * with itree_overlap_next() in O(log n) at most, much less when the
+ * intervals found are near each other, so all intervals in the screen
+ * are found without touching other intervals in the buffer.
+ *
+ * \param tree the tree.
+ * \param low the begin of range.
+ * \param high the end of range. if it's the same as low, the
+ *        intervals contain low (but not start at low) are found.
+ * \param it the iterator set to the interval found.
+ * \return TRUE if found, or FALSE.
+ */
+    INLINE int
+itree_overlap(struct itree *tree, size_t low, size_t high,
+        struct itree_iter *it)
+{
+    it->low = low;
+    it->high = high;
+    it->node = tree->root;
+    if (it->node != &sbtree_nil)
+        it->node = itree_find_overlap(it->node,
+                (size_t)ITREE_NODE(it->node)->off, low, high, &it->start);
+    return it->node != &sbtree_nil;
+}
+
+
+/**
+ * find the next interval overlap with the range of iterator.
+ *
+ * \param it the iterator, set to the interval found, or the end.
+ * \return TRUE if found, or FALSE.
+ */
+    INLINE int
+itree_overlap_next(struct itree_iter *it)
+{
+    struct sbtree_entry *node = it->node, *parent, *found;
+    size_t start = it->start;
+
+    /* the right subtree first, then the ancestors after node. */
+    if (node->right != &sbtree_nil && (found = itree_find_overlap(
+                    node->right, start + (size_t)ITREE_NODE(
+                        node->right)->off, it->low, it->high, &it->start))
+            != &sbtree_nil)
+    {
+        it->node = found;
+        return TRUE;
+    }
+
+    for (; (parent = node->parent) != &sbtree_nil; node = parent)
+    {
+        start -= (size_t)ITREE_NODE(node)->off;
+        if (node != parent->left)
+            continue;
+        if (start >= it->high)
+            break;
+        if (start + ITREE_NODE(parent)->len > it->low)
+        {
+            it->node = parent;
+            it->start = start;
+            return TRUE;
+        }
+        if (parent->right != &sbtree_nil && (found = itree_find_overlap(
+                        parent->right, start + (size_t)ITREE_NODE(
+                            parent->right)->off, it->low, it->high,
+                        &it->start)) != &sbtree_nil)
+        {
+            it->node = found;
+            return TRUE;
+        }
+    }
+
+    it->node = &sbtree_nil;
+    return FALSE;
+}
+
+
+/**
+ * move all intervals start at or after a position, in O(log n).
+ *
+ * \param tree the tree.
+ * \param from the intervals which start is not smaller than from are
+ *        moved.
+ * \param delta the distance to move, the intervals mustn't be moved
+ *        before the intervals start before from.
+ */
+    INLINE void
+itree_shift(struct itree *tree, size_t from, ptrdiff_t delta)
+{
+    struct sbtree_entry *node = tree->root, *last = &sbtree_nil;
+    size_t start = 0;
+    int moved = FALSE, move;
+
+    /*
+     * walk down the tree, the offset of a node moves the whole subtree,
+     * so fix the offset of node only when it should be moved and its
+     * parent is not, or reversely.
+     */
+    while (node != &sbtree_nil)
+    {
+        start += (size_t)ITREE_NODE(node)->off;
+        move = start >= from;
+        if (move != moved)
+            ITREE_NODE(node)->off += move ? delta : -delta;
+        moved = move;
+        last = node;
+        node = move ? node->left : node->right;
+    }
+
+    for (; last != &sbtree_nil; last = last->parent)
+        itree_update(last);
+}
+
+
+/**
+ * adjust the intervals after text changed: del bytes at pos are
+ * replaced by ins bytes.
+ *
+ * the intervals after the text changed are moved, the intervals
+ * contain pos are resized, and the starts (and ends) in the deleted
+ * text are moved to the end (and the start) of the inserted text. so
+ * the text inserted strictly inside a interval is in it, and the text
+ * inserted at its start or at its end is not: the interval is moved
+ * after it, or left before it.
+ *
+ * it costs O(log n) to move the intervals after pos, and O(log n) for
+ * every interval contains pos or starts in the deleted text.
+ *
+ * \param tree the tree.
+ * \param pos the position of text changed.
+ * \param del the bytes deleted.
+ * \param ins the bytes inserted.
+ */
+    INLINE void
+itree_adjust(struct itree *tree, size_t pos, size_t del, size_t ins)
+{
+    struct sbtree_entry *node, *list, **ptail = &list, *next;
+    struct itree_iter it;
+    size_t start = 0, end;
+
+    /* resize the intervals contain pos. */
+    for (itree_overlap(tree, pos, pos, &it); it.node != &sbtree_nil;
+            itree_overlap_next(&it))
+    {
+        end = itree_iter_end(&it);
+        end = end >= pos + del ? end - del + ins : pos;
+        itree_iter_entry(&it)->len = end - it.start;
+        itree_propagate(it.node);
+    }
+
+    /*
+     * remove the intervals start in deleted text, linked by parent in
+     * order, their starts relative to pos are kept in off.
+     */
+    while ((node = itree_lower_bound(tree, pos, &start)) != &sbtree_nil
+            && start < pos + del)
+    {
+        itree_remove(tree, ITREE_NODE(node));
+        ITREE_NODE(node)->off = (ptrdiff_t)(start - pos);
+        *ptail = node;
+        ptail = &node->parent;
+    }
+    *ptail = &sbtree_nil;
+
+    if (del != ins)
+        itree_shift(tree, pos + del, (ptrdiff_t)(ins - del));
+
+    for (node = list; node != &sbtree_nil; node = next)
+    {
+        next = node->parent;
+        end = (size_t)ITREE_NODE(node)->off + ITREE_NODE(node)->len;
+        end = end >= del ? end - del + ins : ins;
+        itree_insert(tree, ITREE_NODE(node), pos + ins, pos + end);
+    }
+}
+
+#endif /* defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES) */
+
+
+#endif /* VIME_ITREE_H */
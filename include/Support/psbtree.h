@@ -0,0 +1,693 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+
+
+/**
+ * \file psbtree.h
+ *
+ * persistent Size Balanced Tree routines.
+ *
+ * a persistent sbtree never changes a node that can be seen from
+ * another version of the tree. every change copies the nodes in the
+ * path from the root to the changed node (path copying), and returns a
+ * new root, which shares all other nodes with the old root. so a
+ * snapshot of a tree is just a reference to its root, it's taken in
+ * O(1), and can be read while the tree is changed, e.g. kept as a undo
+ * state, or read by a background task.
+ *
+ * nodes are reference counted: a reference is held by every parent
+ * and every root pointer. a node only referenced once can only be seen
+ * from the tree being changed, so it's changed in place instead of
+ * copied. a tree without snapshots is changed just like a plain sbtree.
+ *
+ * #psbtree_entry has no parent field (a shared node has many parents),
+ * so it must be embedded into your struction just like
+ * #sbtree_entry, and you must tell psbtree how to copy and free your
+ * struction with #psbtree_ops:
+ *
+ * \code
+ * struct my_data
+ * {
+ *     struct psbtree_entry entry;
+ *     int data;
+ * };
+ *
+ *     struct psbtree_entry*
+ * my_data_copy(struct psbtree_entry const *node)
+ * {
+ *     struct my_data *copy = vime_malloc(sizeof(struct my_data));
+ *     if (copy == NULL)
+ *         return NULL;
+ *     *copy = *MY_DATA_PSBTREE_ENTRY(node);
+ *     return &copy->entry;
+ * }
+ *
+ * struct psbtree_ops const my_data_ops = {my_data_copy, my_data_free};
+ * \endcode
+ *
+ * the copy routine only copies your data, the fields of entry are set
+ * by psbtree.
+ *
+ * taking a snapshot and dropping it:
+ *
+ * \code
+ * struct psbtree_entry *snapshot = psbtree_retain(root);
+ * ...
+ * psbtree_release(snapshot, &my_data_ops);
+ * \endcode
+ *
+ * the reference counts are changed atomically if the compiler supports
+ * it, so a snapshot can be released in another thread. only one thread
+ * may change a tree, the trees of snapshots are never changed.
+ */
+
+
+#ifndef VIME_PSBTREE_H
+#define VIME_PSBTREE_H
+
+
+/**
+ * the entry struction of persistent sbtree.
+ */
+struct psbtree_entry
+{
+    size_t size;    /**< the amount of the children + 1. */
+    size_t ref;     /**< the references of current node. */
+
+    struct psbtree_entry *left;     /**< the left child. */
+    struct psbtree_entry *right;    /**< the right child. */
+};
+
+
+/** the static initiallizer for the global leaf node of psbtree. */
+#define PSBTREE_NIL_INIT {0, 1, &psbtree_nil, &psbtree_nil}
+
+/** the default static initiallizer for struct #psbtree_entry. */
+#define PSBTREE_INIT {1, 1, &psbtree_nil, &psbtree_nil}
+
+/** the leaf node of psbtree, it's never reference counted. */
+EXTERN(struct psbtree_entry psbtree_nil, = PSBTREE_NIL_INIT);
+
+/** get the container of the psbtree */
+#define PSBTREE_ENTRY(ptr, type, field) container_of(ptr, type, field)
+
+/** the max height of psbtree, the height of a sbtree with n nodes is
+ * less than 1.44 log2(n). */
+#define PSBTREE_MAX_HEIGHT 128
+
+
+/** increase the references of a node. */
+#if defined(__GNUC__)
+#  define psbtree_ref_inc(node) ((void)__sync_add_and_fetch(&(node)->ref, 1))
+#else /* defined(__GNUC__) */
+#  define psbtree_ref_inc(node) ((void)++(node)->ref)
+#endif /* defined(__GNUC__) */
+
+/** decrease the references of a node, return the references left. */
+#if defined(__GNUC__)
+#  define psbtree_ref_dec(node) __sync_sub_and_fetch(&(node)->ref, 1)
+#else /* defined(__GNUC__) */
+#  define psbtree_ref_dec(node) (--(node)->ref)
+#endif /* defined(__GNUC__) */
+
+
+/**
+ * compare function, used to compare two keys.
+ *
+ * the same as #sbtree_compare_t: return key[entry] - key.
+ */
+typedef int (*psbtree_compare_t)(struct psbtree_entry const *entry,
+        void const *key);
+
+
+/**
+ * the routines used to copy and free the struction contains the
+ * #psbtree_entry.
+ */
+struct psbtree_ops
+{
+    /** copy the container of node, return the entry of the copy, or
+     * NULL if no memory. the fields of the entry needn't be set. */
+    struct psbtree_entry *(*copy)(struct psbtree_entry const *node);
+
+    /** free the container of node, it's not referenced any more. */
+    void (*free)(struct psbtree_entry *node);
+};
+
+
+/**
+ * the iterator of psbtree, visits nodes in order.
+ *
+ * there is no parent field in the nodes, so the iterator keeps the
+ * path itself.
+ */
+struct psbtree_iter
+{
+    size_t depth;   /**< the amount of nodes in path. */
+    struct psbtree_entry *path[PSBTREE_MAX_HEIGHT]; /**< the ancestors
+                    of current node not visited, and the current node. */
+};
+
+
+INLINE struct psbtree_entry *psbtree_init(struct psbtree_entry *node);
+INLINE struct psbtree_entry *psbtree_retain(struct psbtree_entry *node);
+INLINE void psbtree_release(struct psbtree_entry *node,
+        struct psbtree_ops const *ops);
+INLINE int psbtree_own(struct psbtree_entry **pnode,
+        struct psbtree_ops const *ops);
+INLINE int psbtree_left_rotate(struct psbtree_entry **pnode,
+        struct psbtree_ops const *ops);
+INLINE int psbtree_right_rotate(struct psbtree_entry **pnode,
+        struct psbtree_ops const *ops);
+INLINE void psbtree_maintain(struct psbtree_entry **pnode, int care_left,
+        struct psbtree_ops const *ops);
+INLINE struct psbtree_entry *psbtree_insert(struct psbtree_entry **pnode,
+        struct psbtree_entry *new_node, void const *key,
+        psbtree_compare_t cmp_func, struct psbtree_ops const *ops);
+INLINE int psbtree_unlink(struct psbtree_entry **pnode,
+        struct psbtree_entry ***path, size_t depth,
+        struct psbtree_ops const *ops);
+INLINE int psbtree_remove(struct psbtree_entry **pnode, void const *key,
+        psbtree_compare_t cmp_func, struct psbtree_ops const *ops);
+INLINE struct psbtree_entry *psbtree_lookup(struct psbtree_entry *node,
+        void const *key, psbtree_compare_t cmp_func);
+INLINE struct psbtree_entry *psbtree_select(struct psbtree_entry *node,
+        size_t rank);
+INLINE size_t psbtree_rank(struct psbtree_entry *node, void const *key,
+        psbtree_compare_t cmp_func);
+INLINE struct psbtree_entry *psbtree_iter_init(struct psbtree_iter *it,
+        struct psbtree_entry *node);
+INLINE struct psbtree_entry *psbtree_iter_next(struct psbtree_iter *it);
+
+
+/**
+ * defined a new insert function \b body that use cmp for compare.
+ *
+ * \param pnode the \b name of tree root pointer used to inserted.
+ * \param node the \b name of \b current tree root pointer compare
+ *             with the key.
+ * \param new_node the \b name of new node to insert to pnode.
+ * \param cmp the compare \b expression used in the function body, just
+ *        like key[node] - key[new_node].
+ * \param ops the \b expression of #psbtree_ops used to copy nodes.
+ *
+ * see the implement of #psbtree_insert for details usage.
+ */
+#define DEFINE_PSBTREE_INSERT_BODY(pnode, node, new_node, cmp, ops)  \
+{                                                               \
+    struct psbtree_entry **_path[PSBTREE_MAX_HEIGHT];           \
+    int _left[PSBTREE_MAX_HEIGHT];                              \
+    size_t _depth = 0;                                          \
+    struct psbtree_entry *node;                                 \
+                                                                \
+    psbtree_init(new_node);                                     \
+    while (*pnode != &psbtree_nil)                              \
+    {                                                           \
+        if (_depth == PSBTREE_MAX_HEIGHT                        \
+                || psbtree_own(pnode, ops) == FAIL)             \
+        {                                                       \
+            /* the copies are the same as the old nodes. */     \
+            while (_depth > 0)                                  \
+                --(*_path[--_depth])->size;                     \
+            return NULL;                                        \
+        }                                                       \
+                                                                \
+        node = *pnode;                                          \
+        ++node->size;                                           \
+        _path[_depth] = pnode;                                  \
+        _left[_depth] = (cmp) >= 0;                             \
+        pnode = _left[_depth++] ? &node->left : &node->right;   \
+    }                                                           \
+                                                                \
+    *pnode = new_node;                                          \
+    while (_depth > 0)                                          \
+    {                                                           \
+        --_depth;                                               \
+        psbtree_maintain(_path[_depth], _left[_depth], ops);    \
+    }                                                           \
+    return new_node;                                            \
+}
+
+
+/**
+ * defined a new remove function \b body that use cmp for compare.
+ *
+ * \param pnode the \b name of tree root pointer.
+ * \param node the \b name of \b current tree node compare with the
+ *             key.
+ * \param cmp the compare \b expression used in the function body, just
+ *        like key[node] - key.
+ * \param ops the \b expression of #psbtree_ops used to copy nodes.
+ *
+ * see the implement of #psbtree_remove for details usage.
+ */
+#define DEFINE_PSBTREE_REMOVE_BODY(pnode, node, cmp, ops)       \
+{                                                               \
+    struct psbtree_entry **_path[PSBTREE_MAX_HEIGHT];           \
+    size_t _depth = 0;                                          \
+    struct psbtree_entry *node = *pnode;                        \
+    int _cmp;                                                   \
+                                                                \
+    /* find the node first, nothing is copied if not found. */  \
+    while (node != &psbtree_nil && (_cmp = (cmp)) != 0)         \
+        node = _cmp < 0 ? node->right : node->left;             \
+    if (node == &psbtree_nil)                                   \
+        return FAIL;                                            \
+                                                                \
+    /* own the path to the node, then unlink it. */             \
+    for (;;)                                                    \
+    {                                                           \
+        if (_depth == PSBTREE_MAX_HEIGHT                        \
+                || psbtree_own(pnode, ops) == FAIL)             \
+            return FAIL;                                        \
+        node = *pnode;                                          \
+        _path[_depth++] = pnode;                                \
+        if ((_cmp = (cmp)) == 0)                                \
+            break;                                              \
+        pnode = _cmp < 0 ? &node->right : &node->left;          \
+    }                                                           \
+                                                                \
+    return psbtree_unlink(pnode, _path, _depth, ops);           \
+}
+
+
+#if defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES)
+
+/**
+ * initialize the psbtree_entry node.
+ *
+ * \param node the node need to initialize.
+ * \return the node initialized.
+ */
+    INLINE struct psbtree_entry*
+psbtree_init(struct psbtree_entry *node)
+{
+    node->size = 1;
+    node->ref = 1;
+    node->left = &psbtree_nil;
+    node->right = &psbtree_nil;
+    return node;
+}
+
+
+/**
+ * add a reference to a tree, e.g. take a snapshot.
+ *
+ * \param node the root of the tree.
+ * \return the node.
+ */
+    INLINE struct psbtree_entry*
+psbtree_retain(struct psbtree_entry *node)
+{
+    if (node != &psbtree_nil)
+        psbtree_ref_inc(node);
+    return node;
+}
+
+
+/**
+ * drop a reference to a tree, the nodes not referenced any more are
+ * freed.
+ *
+ * \param node the root of the tree.
+ * \param ops the routines used to free nodes.
+ */
+    INLINE void
+psbtree_release(struct psbtree_entry *node, struct psbtree_ops const *ops)
+{
+    struct psbtree_entry *left, *right;
+
+    while (node != &psbtree_nil && psbtree_ref_dec(node) == 0)
+    {
+        left = node->left;
+        right = node->right;
+        ops->free(node);
+        psbtree_release(left, ops);
+        node = right;
+    }
+}
+
+
+/**
+ * make sure a node is only referenced by *pnode, copy it if it's
+ * shared, so it can be changed.
+ *
+ * \param pnode the pointer to the node, the container of the pointer
+ *        must be owned already.
+ * \param ops the routines used to copy nodes.
+ * \return OK, or FAIL if no memory.
+ */
+    INLINE int
+psbtree_own(struct psbtree_entry **pnode, struct psbtree_ops const *ops)
+{
+    struct psbtree_entry *node = *pnode, *copy;
+
+    if (node->ref == 1)
+        return OK;
+    if ((copy = ops->copy(node)) == NULL)
+        return FAIL;
+
+    copy->size = node->size;
+    copy->ref = 1;
+    copy->left = psbtree_retain(node->left);
+    copy->right = psbtree_retain(node->right);
+    *pnode = copy;
+
+    /* the node may be released by other thread at the same time. */
+    psbtree_release(node, ops);
+    return OK;
+}
+
+
+/*
+ * left rotate node, the node and its right child are owned first, and
+ * nothing is changed if they can't be owned.
+ */
+    INLINE int
+psbtree_left_rotate(struct psbtree_entry **pnode,
+        struct psbtree_ops const *ops)
+{
+    struct psbtree_entry *node, *right;
+
+    if (psbtree_own(pnode, ops) == FAIL
+            || psbtree_own(&(*pnode)->right, ops) == FAIL)
+        return FAIL;
+
+    /* the references are moved with the pointers. */
+    node = *pnode;
+    right = node->right;
+    node->right = right->left;
+    right->left = node;
+
+    right->size = node->size;
+    node->size = node->left->size + node->right->size + 1;
+    *pnode = right;
+    return OK;
+}
+
+
+/*
+ * right rotate node, see psbtree_left_rotate().
+ */
+    INLINE int
+psbtree_right_rotate(struct psbtree_entry **pnode,
+        struct psbtree_ops const *ops)
+{
+    struct psbtree_entry *node, *left;
+
+    if (psbtree_own(pnode, ops) == FAIL
+            || psbtree_own(&(*pnode)->left, ops) == FAIL)
+        return FAIL;
+
+    node = *pnode;
+    left = node->left;
+    node->left = left->right;
+    left->right = node;
+
+    left->size = node->size;
+    node->size = node->left->size + node->right->size + 1;
+    *pnode = left;
+    return OK;
+}
+
+
+/*
+ * keep the psbtree, just like sbtree_maintain(). if a node can't be
+ * copied, the tree is left less balanced, but still valid.
+ */
+    INLINE void
+psbtree_maintain(struct psbtree_entry **pnode, int care_left,
+        struct psbtree_ops const *ops)
+{
+    struct psbtree_entry *node = *pnode;
+
+    if (care_left)
+    {
+        if (node->left->left->size > node->right->size)
+        {
+            if (psbtree_right_rotate(pnode, ops) == FAIL)
+                return;
+        }
+        else if (node->left->right->size > node->right->size)
+        {
+            if (psbtree_own(pnode, ops) == FAIL
+                    || psbtree_left_rotate(&(*pnode)->left, ops) == FAIL
+                    || psbtree_right_rotate(pnode, ops) == FAIL)
+                return;
+        }
+        else return;
+    }
+    else
+    {
+        if (node->right->right->size > node->left->size)
+        {
+            if (psbtree_left_rotate(pnode, ops) == FAIL)
+                return;
+        }
+        else if (node->right->left->size > node->left->size)
+        {
+            if (psbtree_own(pnode, ops) == FAIL
+                    || psbtree_right_rotate(&(*pnode)->right, ops) == FAIL
+                    || psbtree_left_rotate(pnode, ops) == FAIL)
+                return;
+        }
+        else return;
+    }
+
+    psbtree_maintain(&(*pnode)->left, TRUE, ops);
+    psbtree_maintain(&(*pnode)->right, FALSE, ops);
+    psbtree_maintain(pnode, TRUE, ops);
+    psbtree_maintain(pnode, FALSE, ops);
+}
+
+
+/**
+ * insert node into psbtree.
+ *
+ * \param pnode     the root of the tree, it's set to the new root.
+ * \param new_node  new node will be inserted, it's initialized here.
+ * \param key       the key of the new node inserted.
+ * \param cmp_func  the compare function used to compare nodes.
+ * \param ops       the routines used to copy and free nodes.
+ * \return new_node, or NULL if no memory, and the tree isn't changed.
+ *
+ * \remark the reference of *pnode is moved to the new root. take a
+ *         snapshot with psbtree_retain() before, if the old version of
+ *         the tree is needed.
+ */
+    INLINE struct psbtree_entry*
+psbtree_insert(
+    struct psbtree_entry **pnode,
+    struct psbtree_entry *new_node,
+    void const *key,
+    psbtree_compare_t cmp_func,
+    struct psbtree_ops const *ops)
+DEFINE_PSBTREE_INSERT_BODY(pnode, node, new_node, cmp_func(node, key), ops)
+
+
+/**
+ * unlink a node from psbtree, the path to it is owned.
+ *
+ * \param pnode the pointer to the node, in its parent.
+ * \param path the pointers to the nodes in the path, from the root.
+ * \param depth the amount of pointers in path, the last one is pnode.
+ * \param ops the routines used to copy and free nodes.
+ * \return OK, or FAIL if the path to the successor can't be owned, and
+ *         nothing is unlinked.
+ */
+    INLINE int
+psbtree_unlink(struct psbtree_entry **pnode, struct psbtree_entry ***path,
+        size_t depth, struct psbtree_ops const *ops)
+{
+    struct psbtree_entry *node = *pnode, *succ, **psucc;
+    size_t i;
+
+    if (node->left == &psbtree_nil || node->right == &psbtree_nil)
+    {
+        /* the child takes the reference of node in parent. */
+        *pnode = node->left == &psbtree_nil ? node->right : node->left;
+    }
+    else
+    {
+        /* own the path to the successor, before change anything. */
+        for (psucc = &node->right; ; psucc = &(*psucc)->left)
+        {
+            if (psbtree_own(psucc, ops) == FAIL)
+                return FAIL;
+            if ((*psucc)->left == &psbtree_nil)
+                break;
+        }
+        for (succ = node->right; succ != *psucc; succ = succ->left)
+            --succ->size;
+
+        /* the successor takes the place and the children of node. */
+        succ = *psucc;
+        *psucc = succ->right;
+        succ->left = node->left;
+        succ->right = node->right;
+        succ->size = node->size - 1;
+        *pnode = succ;
+    }
+
+    for (i = 0; i + 1 < depth; ++i)
+        --(*path[i])->size;
+    node->left = node->right = &psbtree_nil;
+    psbtree_release(node, ops);
+    return OK;
+}
+
+
+/**
+ * remove a node of key from psbtree.
+ *
+ * \param pnode     the root of the tree, it's set to the new root.
+ * \param key       the key of node to remove.
+ * \param cmp_func  the compare function used to compare nodes.
+ * \param ops       the routines used to copy and free nodes.
+ * \return OK, or FAIL if not found or no memory, and the tree isn't
+ *         changed.
+ *
+ * \remark the tree isn't maintained after remove, just like the plain
+ *         sbtree: the height is still O(log n) of the max size of the
+ *         tree.
+ */
+    INLINE int
+psbtree_remove(
+    struct psbtree_entry **pnode,
+    void const *key,
+    psbtree_compare_t cmp_func,
+    struct psbtree_ops const *ops)
+DEFINE_PSBTREE_REMOVE_BODY(pnode, node, cmp_func(node, key), ops)
+
+
+/**
+ * find node from psbtree.
+ *
+ * \param node      root node of the tree used to find.
+ * \param key       the key used in cmp_func.
+ * \param cmp_func  the compare function used to compare nodes.
+ * \return the tree node found, or &psbtree_nil when no found.
+ */
+    INLINE struct psbtree_entry*
+psbtree_lookup(
+    struct psbtree_entry *node,
+    void const *key,
+    psbtree_compare_t cmp_func)
+{
+    int cmp_res;
+
+    while (node != &psbtree_nil)
+    {
+        if ((cmp_res = cmp_func(node, key)) == 0)
+            return node;
+        node = cmp_res < 0 ? node->right : node->left;
+    }
+
+    return &psbtree_nil;
+}
+
+
+/**
+ * find the nth node in the tree.
+ *
+ * \param node the root node of the tree.
+ * \param rank the rank of node want to find, from 0.
+ * \return the node found, or &psbtree_nil when rank is out of range.
+ */
+    INLINE struct psbtree_entry*
+psbtree_select(struct psbtree_entry *node, size_t rank)
+{
+    if (rank >= node->size)
+        return &psbtree_nil;
+
+    while (rank != node->left->size)
+    {
+        if (rank < node->left->size)
+            node = node->left;
+        else
+        {
+            rank -= node->left->size + 1;
+            node = node->right;
+        }
+    }
+    return node;
+}
+
+
+/**
+ * get the amount of nodes smaller than the key.
+ *
+ * \param node      root node of the tree.
+ * \param key       the key used in cmp_func.
+ * \param cmp_func  the compare function used to compare nodes.
+ * \return the rank of the first node not smaller than key.
+ */
+    INLINE size_t
+psbtree_rank(
+    struct psbtree_entry *node,
+    void const *key,
+    psbtree_compare_t cmp_func)
+{
+    size_t rank = 0;
+
+    while (node != &psbtree_nil)
+    {
+        if (cmp_func(node, key) < 0)
+        {
+            rank += node->left->size + 1;
+            node = node->right;
+        }
+        else
+            node = node->left;
+    }
+    return rank;
+}
+
+
+/**
+ * start a in-order iteration of a tree.
+ *
+ * \param it the iterator.
+ * \param node the root of the tree, the caller must keep a reference
+ *        of it during the iteration.
+ * \return the first node, or &psbtree_nil if the tree is empty.
+ */
+    INLINE struct psbtree_entry*
+psbtree_iter_init(struct psbtree_iter *it, struct psbtree_entry *node)
+{
+    for (it->depth = 0; node != &psbtree_nil; node = node->left)
+        it->path[it->depth++] = node;
+    return it->depth == 0 ? &psbtree_nil : it->path[it->depth - 1];
+}
+
+
+/**
+ * move the iterator to the next node.
+ *
+ * \param it the iterator.
+ * \return the next node, or &psbtree_nil at the end of tree.
+ */
+    INLINE struct psbtree_entry*
+psbtree_iter_next(struct psbtree_iter *it)
+{
+    struct psbtree_entry *node;
+
+    if (it->depth == 0)
+        return &psbtree_nil;
+
+    /* the current node is done, go to the left most of its right. */
+    node = it->path[--it->depth]->right;
+    for (; node != &psbtree_nil; node = node->left)
+        it->path[it->depth++] = node;
+    return it->depth == 0 ? &psbtree_nil : it->path[it->depth - 1];
+}
+
+
+#endif /* defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES) */
+
+
+#endif /* VIME_PSBTREE_H */
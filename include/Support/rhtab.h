@@ -0,0 +1,509 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+#include <System/mem.h>
+#include <Support/hashtab.h>
+
+
+/**
+ * \file rhtab.h
+ *
+ * Robin Hood hash table for VimE.
+ *
+ * #hashtable only keeps pointers in its array, so every probe has to
+ * dereference the entry to compare the hash value, and removed items
+ * stay as HI_TOMB until the next resize. the Robin Hood table keeps a
+ * metadata word for every slot beside the array: the probe distance of
+ * the item in the slot, and a fingerprint of its hash value. a lookup
+ * walks the metadata words (16 of them in a cache line), and only
+ * touches a entry when the fingerprint matches.
+ *
+ * items along a probe sequence are kept ordered by their probe
+ * distance (the "Robin Hood" rule: a item far from its home slot takes
+ * the slot of a item nearer to its home). so a lookup stops as soon as
+ * it meets a slot nearer to home than the key would be, and a removal
+ * shifts the following items back instead of leaving a tombstone.
+ *
+ * the table holds the same #hash_entry as #hashtable, so a struction
+ * can be put into either of them.
+ */
+
+
+#ifndef VIME_RHTAB_H
+#define VIME_RHTAB_H
+
+
+/**
+ * Robin Hood hash table struction.
+ *
+ * use rht_init() to initialize a table, and rht_drop() to destroy it.
+ * the arrays are allocated when the first item is inserted.
+ */
+struct rh_hashtable
+{
+    size_t capacity;    /**< nr of slots, zero or a power of 2. */
+    size_t size;        /**< number of items used. */
+    uint32_t *meta;     /**< metadata of slots, 0 for empty slot. */
+    hashitem_t *array;  /**< items of slots, shares block with meta. */
+};
+
+/** the default constructor of #rh_hashtable. */
+#define RH_HASHTABLE_INIT {0, 0, NULL, NULL}
+
+/** the slot value returned when a key isn't in the table. */
+#define RHT_NPOS ((size_t)-1)
+
+/** the bits of probe distance in metadata word. */
+#define RH_DIST_BITS 8
+
+/** the max probe distance can be kept in metadata word, a slot with
+ * this distance is "far", the real distance is computed from its
+ * hash value. */
+#define RH_DIST_MAX ((1 << RH_DIST_BITS) - 1)
+
+/** get the probe distance (1 for home slot) of a metadata word. */
+#define rh_dist(meta) ((size_t)((meta) & RH_DIST_MAX))
+
+/** get the fingerprint of a hash value, the high bits of a mixed
+ * hash, because the low bits are used to find the home slot. */
+#define rh_fingerprint(hash) ((uint32_t)(((uint64_t)(hash) \
+            * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & ~(uint32_t)RH_DIST_MAX)
+
+/** make the metadata word for a hash value at a probe distance. */
+#define RH_META(hash, dist) (rh_fingerprint(hash) \
+        | (uint32_t)((dist) < RH_DIST_MAX ? (dist) : RH_DIST_MAX))
+
+/** the max load factor of #rh_hashtable, in 1/8. */
+#define RH_MAX_LOAD 6
+
+
+/**
+ * define the function \b body for finding slot of a key.
+ *
+ * \param rhtab the \b name of #rh_hashtable.
+ * \param item the \b name of the item that used in cmp_expr.
+ * \param hash_expr the \b expression that used to compute hash value.
+ * \param cmp_expr the \b expression that used to compare item and
+ *        the key used to find.
+ * \return the slot of the item if found, or RHT_NPOS if not found.
+ * \sa rht_find
+ */
+#define DEFINE_RHT_FIND_BODY(rhtab, item, hash_expr, cmp_expr) \
+{                                                               \
+    hash_t _hash;                                               \
+    size_t _idx, _mask, _dist, _near;                           \
+    uint32_t _meta, _fp;                                        \
+    hashitem_t item;                                            \
+                                                                \
+    assert((rhtab) != NULL);                                    \
+    _hash = (hash_expr);                                        \
+    if ((rhtab)->size == 0)                                     \
+        return RHT_NPOS;                                        \
+                                                                \
+    _mask = (rhtab)->capacity - 1;                              \
+    _idx = (size_t)(_hash & _mask);                             \
+    _fp = rh_fingerprint(_hash);                                \
+                                                                \
+    for (_dist = 1; ; ++_dist, _idx = (_idx + 1) & _mask)       \
+    {                                                           \
+        _meta = (rhtab)->meta[_idx];                            \
+        _near = _dist < RH_DIST_MAX ? _dist : RH_DIST_MAX;      \
+        if (rh_dist(_meta) < _near)                             \
+            return RHT_NPOS;                                    \
+        if (_meta == (_fp | (uint32_t)_near)                    \
+                && (item = (rhtab)->array[_idx])->hash == _hash \
+                && (cmp_expr) == 0)                             \
+            return _idx;                                        \
+    }                                                           \
+                                                                \
+    /* can not reach here. */                                   \
+}
+
+/**
+ * define the function \b body of Robin Hood table insert routines.
+ *
+ * \param rhtab the \b name of #rh_hashtable.
+ * \param value the \b name of the item that used to insert.
+ * \param find_expr the \b expression to find the slot of the key of
+ *        value, usually a call to rht_find() or other routines
+ *        generated from DEFINE_RHT_FIND_BODY().
+ * \return value if insert success, the elder item if there is another
+ *         item in the table, or NULL if no memory.
+ * \sa rht_set rht_insert
+ */
+#define DEFINE_RHT_INSERT_BODY(rhtab, value, find_expr) \
+{                                               \
+    size_t _slot = (find_expr);                 \
+    if (_slot != RHT_NPOS)                      \
+        return (rhtab)->array[_slot];           \
+                                                \
+    if (rht_may_resize((rhtab), 0) == FAIL)     \
+        return NULL;                            \
+    rht_place((rhtab), (value));                \
+    return (value);                             \
+}
+
+/**
+ * define the function \b body of Robin Hood table lookup routines.
+ *
+ * \param rhtab the \b name of #rh_hashtable.
+ * \param slot the \b name of the slot found.
+ * \param find_expr the \b expression to find the slot, see
+ *        DEFINE_RHT_INSERT_BODY().
+ * \param succ_expr the \b expression that returned when find a item.
+ * \param fail_expr the \b expression that returned when can't find.
+ * \return succ_expr or fail_expr.
+ * \sa rht_get rht_lookup rht_remove
+ */
+#define DEFINE_RHT_LOOKUP_BODY(rhtab, slot, find_expr, succ_expr, fail_expr) \
+{   size_t slot = (find_expr);                  \
+    return slot == RHT_NPOS ? (fail_expr) : (succ_expr); }
+
+
+/* public routine prototypes. */
+INLINE struct rh_hashtable *rht_init(struct rh_hashtable *rhtab);
+INLINE void rht_drop(struct rh_hashtable *rhtab);
+INLINE struct rh_hashtable *rht_clear(struct rh_hashtable *rhtab);
+INLINE int rht_may_resize(struct rh_hashtable *rhtab, size_t minitems);
+INLINE size_t rht_slot_dist(struct rh_hashtable *rhtab, size_t idx);
+INLINE void rht_place(struct rh_hashtable *rhtab, struct hash_entry *value);
+INLINE size_t rht_find(struct rh_hashtable *rhtab,
+        void const *key, hash_t hash, hash_compare_t cmp_func);
+INLINE size_t rht_default_find(struct rh_hashtable *rhtab,
+        void const *key, hash_t *phash);
+INLINE struct hash_entry *rht_get(struct rh_hashtable *rhtab,
+        void const *key, hash_t hash, hash_compare_t cmp_func);
+INLINE struct hash_entry *rht_set(struct rh_hashtable *rhtab,
+        struct hash_entry *value, hash_compare_t cmp_func);
+INLINE struct hash_entry *rht_del(struct rh_hashtable *rhtab, size_t slot);
+INLINE struct hash_entry *rht_insert(struct rh_hashtable *rhtab,
+        struct hash_entry *value);
+INLINE struct hash_entry *rht_lookup(struct rh_hashtable *rhtab,
+        void const *key);
+INLINE struct hash_entry *rht_remove(struct rh_hashtable *rhtab,
+        void const *key);
+
+
+#if defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES)
+
+/**
+ * initialize a #rh_hashtable, no memory is allocated.
+ *
+ * \param rhtab a uninitialized table.
+ * \return the table initialized.
+ */
+    INLINE struct rh_hashtable*
+rht_init(struct rh_hashtable *rhtab)
+{
+    assert(rhtab != NULL);
+    memset(rhtab, 0, sizeof(struct rh_hashtable));
+    return rhtab;
+}
+
+
+/**
+ * destroy a #rh_hashtable, the items in it are not touched.
+ *
+ * \param rhtab the table to destroy.
+ */
+    INLINE void
+rht_drop(struct rh_hashtable *rhtab)
+{
+    assert(rhtab != NULL);
+    if (rhtab->array != NULL)
+        vime_free(rhtab->array);
+    rht_init(rhtab);
+}
+
+
+/**
+ * remove all items from a #rh_hashtable, but keep its arrays.
+ *
+ * \param rhtab the table to clear.
+ */
+    INLINE struct rh_hashtable*
+rht_clear(struct rh_hashtable *rhtab)
+{
+    assert(rhtab != NULL);
+    if (rhtab->meta != NULL)
+        memset(rhtab->meta, 0, sizeof(uint32_t) * rhtab->capacity);
+    rhtab->size = 0;
+    return rhtab;
+}
+
+
+/**
+ * make sure a #rh_hashtable has room for a new item (minitems is 0),
+ * or for minitems items, grow the table if needed. the table never
+ * shrinks, because removals leave no tombstones.
+ *
+ * \param rhtab the table.
+ * \param minitems the notify value of mininal items in the table.
+ * \return OK for success, and FAIL for no memory error.
+ */
+    INLINE int
+rht_may_resize(struct rh_hashtable *rhtab, size_t minitems)
+{
+    size_t newsize, oldsize, i;
+    hashitem_t *oldarray;
+    uint32_t *oldmeta;
+    void *block;
+
+    assert(rhtab != NULL);
+    oldsize = rhtab->capacity;
+
+    if (minitems < rhtab->size + 1)
+        minitems = rhtab->size + 1;
+    if (minitems * 8 <= oldsize * RH_MAX_LOAD)
+        return OK;
+
+    newsize = HT_INIT_SIZE;
+    while (newsize * RH_MAX_LOAD < minitems * 8)
+    {
+        newsize <<= 1;
+
+        /* over flow. */
+        if (newsize == 0)
+            return FAIL;
+    }
+
+    block = vime_malloc((sizeof(hashitem_t) + sizeof(uint32_t)) * newsize);
+    if (block == NULL)
+        return (rhtab->size + 1 < oldsize) ? OK : FAIL;
+
+    oldarray = rhtab->array;
+    oldmeta = rhtab->meta;
+    rhtab->capacity = newsize;
+    rhtab->size = 0;
+    rhtab->array = block;
+    rhtab->meta = (uint32_t*)(rhtab->array + newsize);
+    memset(rhtab->meta, 0, sizeof(uint32_t) * newsize);
+
+    for (i = 0; i < oldsize; ++i)
+        if (oldmeta[i] != 0)
+            rht_place(rhtab, oldarray[i]);
+    if (oldarray != NULL)
+        vime_free(oldarray);
+
+    return OK;
+}
+
+
+/**
+ * get the probe distance of a used slot, 1 for the home slot of the
+ * item in it, 0 for a empty slot.
+ *
+ * \param rhtab the table.
+ * \param idx the slot.
+ * \return the probe distance.
+ */
+    INLINE size_t
+rht_slot_dist(struct rh_hashtable *rhtab, size_t idx)
+{
+    size_t dist = rh_dist(rhtab->meta[idx]);
+
+    if (dist < RH_DIST_MAX)
+        return dist;
+
+    /* a far slot, it's rare, compute the distance from the hash. */
+    return ((idx - (size_t)rhtab->array[idx]->hash)
+            & (rhtab->capacity - 1)) + 1;
+}
+
+
+/**
+ * put a item into the table, the key of the item must not in the
+ * table, and the table must have room for it.
+ *
+ * \param rhtab the table.
+ * \param value the item to put, its hash field must be set up.
+ */
+    INLINE void
+rht_place(struct rh_hashtable *rhtab, struct hash_entry *value)
+{
+    size_t mask = rhtab->capacity - 1;
+    size_t idx = (size_t)(value->hash & mask);
+    size_t dist, slot_dist;
+    hashitem_t item;
+
+    assert(rhtab->size < rhtab->capacity);
+
+    for (dist = 1; ; ++dist, idx = (idx + 1) & mask)
+    {
+        if (rhtab->meta[idx] == 0)
+        {
+            rhtab->meta[idx] = RH_META(value->hash, dist);
+            rhtab->array[idx] = value;
+            ++rhtab->size;
+            return;
+        }
+
+        /* take the slot from a item nearer to its home. */
+        slot_dist = rht_slot_dist(rhtab, idx);
+        if (slot_dist < dist)
+        {
+            item = rhtab->array[idx];
+            rhtab->meta[idx] = RH_META(value->hash, dist);
+            rhtab->array[idx] = value;
+            value = item;
+            dist = slot_dist;
+        }
+    }
+}
+
+
+/**
+ * find the slot of a key in the table.
+ *
+ * \param rhtab     the #rh_hashtable.
+ * \param key       the key value should in the slot.
+ * \param hash      the hash value of the key.
+ * \param cmp_func  the compare function for compare entry and key.
+ * \return the slot, or RHT_NPOS if the key isn't in the table.
+ */
+    INLINE size_t
+rht_find(
+        struct rh_hashtable *rhtab,
+        void const *key,
+        hash_t hash,
+        hash_compare_t cmp_func)
+DEFINE_RHT_FIND_BODY(rhtab, item, hash, cmp_func(item->key, key))
+
+
+/**
+ * find the slot of a key, but use ht_default_hash() and strcmp().
+ *
+ * \param rhtab     the #rh_hashtable.
+ * \param key       the key value should in the slot.
+ * \param phash     points to the variable received the hash value
+ *                  computed form key, or NULL.
+ * \return the slot, or RHT_NPOS if the key isn't in the table.
+ */
+    INLINE size_t
+rht_default_find(struct rh_hashtable *rhtab, void const *key, hash_t *phash)
+DEFINE_RHT_FIND_BODY(rhtab, item,
+        phash == NULL ? ht_default_hash(key)
+            : (*phash = ht_default_hash(key)),
+        strcmp(item->key, key))
+
+
+/**
+ * get a item from the table.
+ *
+ * \param rhtab     the table.
+ * \param key       the key value of the item.
+ * \param hash      the hash value of the key.
+ * \param cmp_func  the compare function for compare entry and key.
+ * \return the item, or NULL if non found.
+ */
+    INLINE struct hash_entry*
+rht_get(
+        struct rh_hashtable *rhtab,
+        void const *key,
+        hash_t hash,
+        hash_compare_t cmp_func)
+DEFINE_RHT_LOOKUP_BODY(rhtab, slot,
+        rht_find(rhtab, key, hash, cmp_func), rhtab->array[slot], NULL)
+
+
+/**
+ * set a item to the table, use key and hash in the entry.
+ *
+ * \param rhtab     the table.
+ * \param value     the item to insert, the key and hash field
+ *                  \b must set up before call this function.
+ * \param cmp_func  the compare function for compare entry and key.
+ * \return value, the elder item with the same key, or NULL if fail.
+ */
+    INLINE struct hash_entry*
+rht_set(
+        struct rh_hashtable *rhtab,
+        struct hash_entry *value,
+        hash_compare_t cmp_func)
+DEFINE_RHT_INSERT_BODY(rhtab, value,
+        rht_find(rhtab, value->key, value->hash, cmp_func))
+
+
+/**
+ * remove the item in a slot, and shift the following items of the
+ * probe sequence back.
+ *
+ * \param rhtab     the table.
+ * \param slot      the slot, returned by rht_find().
+ * \return the item removed.
+ */
+    INLINE struct hash_entry*
+rht_del(struct rh_hashtable *rhtab, size_t slot)
+{
+    hashitem_t del_item = rhtab->array[slot];
+    size_t mask = rhtab->capacity - 1, next, dist;
+
+    assert(slot < rhtab->capacity && rhtab->meta[slot] != 0);
+
+    for (;; slot = next)
+    {
+        next = (slot + 1) & mask;
+        if ((dist = rht_slot_dist(rhtab, next)) <= 1)
+            break;
+        rhtab->array[slot] = rhtab->array[next];
+        rhtab->meta[slot] = RH_META(rhtab->array[slot]->hash, dist - 1);
+    }
+
+    rhtab->meta[slot] = 0;
+    rhtab->array[slot] = NULL;
+    --rhtab->size;
+    return del_item;
+}
+
+
+/**
+ * set a item to the table, use ht_default_hash() to compute hash
+ * value.
+ *
+ * \param rhtab     the table.
+ * \param value     the item to insert.
+ * \return value, the elder item with the same key, or NULL if fail.
+ * \sa rht_set
+ */
+    INLINE struct hash_entry*
+rht_insert(struct rh_hashtable *rhtab, struct hash_entry *value)
+DEFINE_RHT_INSERT_BODY(rhtab, value,
+        rht_default_find(rhtab, value->key, &value->hash))
+
+
+/**
+ * lookup a item from the table, use ht_default_hash() to compute
+ * hash value.
+ *
+ * \param rhtab the table.
+ * \param key the key which look up in the table.
+ * \return the item if found, or NULL if not found.
+ * \sa rht_get
+ */
+    INLINE struct hash_entry*
+rht_lookup(struct rh_hashtable *rhtab, void const *key)
+DEFINE_RHT_LOOKUP_BODY(rhtab, slot,
+        rht_default_find(rhtab, key, NULL), rhtab->array[slot], NULL)
+
+
+/**
+ * remove a item from the table, use ht_default_hash() to compute
+ * hash value.
+ *
+ * \param rhtab the table.
+ * \param key the key of the item to remove.
+ * \return the item removed, or NULL if not found.
+ */
+    INLINE struct hash_entry*
+rht_remove(struct rh_hashtable *rhtab, void const *key)
+DEFINE_RHT_LOOKUP_BODY(rhtab, slot,
+        rht_default_find(rhtab, key, NULL), rht_del(rhtab, slot), NULL)
+
+#endif /* defined(ENABLE_INLINE) || defined(DEFINE_INLINE_ROUTINES) */
+
+
+#endif /* VIME_RHTAB_H */
+/* vim: set ft=c: */
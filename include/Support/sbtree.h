@@ -387,7 +387,7 @@ sbtree_maintain(struct sbtree_entry **pnode, int care_left)
 }
 
 
-    void
+    INLINE void
 sbtree_insert_fixup(struct sbtree_entry **pnode,
         struct sbtree_entry *cur_node)
 {
@@ -567,8 +567,8 @@ sbtree_remove(
  * \return the tree node found from tree, or &sbtree_nil when no found.
  */
 #if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
-struct sbtree_entry *sbtree_lookup __ARGS((struct sbtree_entry *node,
-        void const *key, sbtree_compare_t cmp_func));
+struct sbtree_entry *sbtree_lookup(struct sbtree_entry *node,
+        void const *key, sbtree_compare_t cmp_func);
 #else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
 
     INLINE struct sbtree_entry*
@@ -624,8 +624,8 @@ DEFINE_SBTREE_LOOKUP_BODY(node, cmp_func(node, key))
  * the key.
  */
 #if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
-struct sbtree_entry *sbtree_lower_bound __ARGS((struct sbtree_entry *node,
-            void const *key, sbtree_compare_t cmp_func));
+struct sbtree_entry *sbtree_lower_bound(struct sbtree_entry *node,
+            void const *key, sbtree_compare_t cmp_func);
 #else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
 
     INLINE struct sbtree_entry *
@@ -681,8 +681,8 @@ DEFINE_SBTREE_LOWER_BOUND_BODY(node, cmp_func(node, key))
  *         the tree if found.
  */
 #if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
-struct sbtree_entry *sbtree_upper_bound __ARGS((struct sbtree_entry *node,
-            void const *key, sbtree_compare_t cmp_func));
+struct sbtree_entry *sbtree_upper_bound(struct sbtree_entry *node,
+            void const *key, sbtree_compare_t cmp_func);
 #else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
 
     INLINE struct sbtree_entry *
@@ -754,4 +754,770 @@ sbtree_rank(struct sbtree_entry *node)
 #endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
 
 
+/*
+ * bulk build.
+ *
+ * inserting n nodes one by one costs O(n log n) compares and a lot of
+ * rotations. when all nodes are known and sorted, e.g. when a mapping
+ * file is loaded, the tree can be built in O(n) without any compare:
+ * the middle node is the root, and the two halves are its subtrees.
+ * the tree built is perfectly balanced, so it is a valid sbtree, and
+ * can be inserted and removed as usual.
+ *
+ * the sorted nodes can be given as an array of pointers, or as a list
+ * linked by the right field of nodes -- this list needn't any memory,
+ * and is what sbtree_flatten() gives, so two trees can be merged in
+ * O(n + m).
+ */
+
+
+/**
+ * build a tree from an array of nodes.
+ *
+ * \param nodes the nodes sorted by key, their fields are all set.
+ * \param count the amount of nodes.
+ * \return the root of the tree, or &sbtree_nil if count is zero.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_build(struct sbtree_entry **nodes,
+        size_t count);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry*
+sbtree_build(struct sbtree_entry **nodes, size_t count)
+{
+    struct sbtree_entry *node;
+    size_t mid = count / 2;
+
+    if (count == 0)
+        return &sbtree_nil;
+
+    /* the left half has the extra node, if any. */
+    node = nodes[mid];
+    node->parent = &sbtree_nil;
+    node->size = count;
+    sbtree_set_left(node, sbtree_build(nodes, mid));
+    sbtree_set_right(node, sbtree_build(nodes + mid + 1, count - mid - 1));
+    return node;
+}
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * build a tree from the first count nodes of a list, linked by the
+ * right field.
+ *
+ * \param phead points to the head of the list, it is set to the node
+ *        after the nodes used.
+ * \param count the amount of nodes used, the list must have so many
+ *        nodes.
+ * \return the root of the tree, or &sbtree_nil if count is zero.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_build_list(struct sbtree_entry **phead,
+        size_t count);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry*
+sbtree_build_list(struct sbtree_entry **phead, size_t count)
+{
+    struct sbtree_entry *node, *left;
+
+    if (count == 0)
+        return &sbtree_nil;
+
+    /* build the left half first, then the root is the next node. */
+    left = sbtree_build_list(phead, count / 2);
+    node = *phead;
+    *phead = node->right;
+
+    node->parent = &sbtree_nil;
+    node->size = count;
+    sbtree_set_left(node, left);
+    sbtree_set_right(node, sbtree_build_list(phead, count - count / 2 - 1));
+    return node;
+}
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * flatten a tree into a sorted list, linked by the right field.
+ *
+ * \param node the root of the tree.
+ * \return the head of the list, or &sbtree_nil if the tree is empty.
+ *
+ * \remark only the right field of nodes is changed, the nodes must be
+ *         built into a tree again before use.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_flatten(struct sbtree_entry *node);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry*
+sbtree_flatten(struct sbtree_entry *node)
+{
+    struct sbtree_entry *head, *next;
+
+    if (node == &sbtree_nil)
+        return &sbtree_nil;
+
+    /*
+     * sbtree_get_succ() only reads the right field of the node it
+     * starts from, so the visited nodes can be relinked.
+     */
+    head = node = sbtree_get_min(node);
+    while ((next = sbtree_get_succ(node)) != &sbtree_nil)
+        node = node->right = next;
+    return head;
+}
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * compare function, used to compare the keys of two nodes.
+ *
+ * \return negative value if the key of lhs is smaller, positive value
+ *         if it is bigger, or zero if they are equal. (just like
+ *         key[lhs] - key[rhs])
+ */
+typedef int (*sbtree_node_compare_t)(struct sbtree_entry const *lhs,
+        struct sbtree_entry const *rhs);
+
+
+/**
+ * defined a new merge function \b body that use cmp for compare.
+ *
+ * \param pnode the \b name of tree root pointer merged into.
+ * \param other the \b name of the root of the other tree.
+ * \param lhs the \b name of the node from pnode compared.
+ * \param rhs the \b name of the node from other compared.
+ * \param cmp the compare \b expression of lhs and rhs, just like
+ *        key[lhs] - key[rhs].
+ *
+ * see the implement of #sbtree_merge for details usage.
+ */
+#define DEFINE_SBTREE_MERGE_BODY(pnode, other, lhs, rhs, cmp)   \
+{                                                               \
+    size_t count = (*pnode)->size + other->size;                \
+    struct sbtree_entry *lhs = sbtree_flatten(*pnode);          \
+    struct sbtree_entry *rhs = sbtree_flatten(other);           \
+    struct sbtree_entry *head = &sbtree_nil, **ptail = &head;   \
+                                                                \
+    while (lhs != &sbtree_nil && rhs != &sbtree_nil)            \
+    {                                                           \
+        if ((cmp) <= 0)                                         \
+        {                                                       \
+            *ptail = lhs;                                       \
+            lhs = lhs->right;                                   \
+        }                                                       \
+        else                                                    \
+        {                                                       \
+            *ptail = rhs;                                       \
+            rhs = rhs->right;                                   \
+        }                                                       \
+        ptail = &(*ptail)->right;                               \
+    }                                                           \
+                                                                \
+    *ptail = lhs != &sbtree_nil ? lhs : rhs;                    \
+    return *pnode = sbtree_build_list(&head, count);            \
+}
+
+
+/**
+ * merge all nodes of other tree into a tree, in O(n + m).
+ *
+ * \param pnode     the root of the tree merged into.
+ * \param other     the root of the other tree, it is invalid after
+ *                  merged.
+ * \param cmp_func  the compare function used to compare nodes.
+ * \return the new root of the tree.
+ *
+ * \remark the nodes with equal keys are all kept, the nodes from
+ *         pnode come first.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_merge(struct sbtree_entry **pnode,
+        struct sbtree_entry *other, sbtree_node_compare_t cmp_func);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry*
+sbtree_merge(
+    struct sbtree_entry **pnode,
+    struct sbtree_entry *other,
+    sbtree_node_compare_t cmp_func)
+DEFINE_SBTREE_MERGE_BODY(pnode, other, lhs, rhs, cmp_func(lhs, rhs))
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/*
+ * augmented sbtree.
+ *
+ * sbtree only keeps the size of subtrees in the nodes, but sometimes
+ * we want to keep other summary of subtree in nodes, e.g. the text
+ * length of all pieces in memcache. the summary is stored in the
+ * container of #sbtree_entry, and must be recomputed whenever the
+ * children of a node changed, include the rotations when the tree is
+ * maintained.
+ *
+ * the sbtree_aug_* routines are just like the plain routines, but call
+ * a #sbtree_update_t function to recompute the summary of all nodes
+ * changed. they also keep the size field of nodes, so the update
+ * function needn't care about it.
+ *
+ * notice that the sbtree_aug_* routines don't use keys, new nodes are
+ * linked just before or after a given node. this is the common case
+ * for augmented trees: the position of node is the key.
+ */
+
+
+/**
+ * update function, used to recompute the summary of a node.
+ *
+ * \param node the node need to update, its children are all updated.
+ *
+ * \remark remember that sbtree_nil is not embedded in any struction,
+ * so don't get the container of it.
+ */
+typedef void (*sbtree_update_t)(struct sbtree_entry *node);
+
+
+/*
+ * the body of augmented routines.
+ *
+ * every augmented routine is defined by a DEFINE_SBTREE_AUG_*_BODY
+ * macro, both the sbtree_aug_* routines and the routines defined by
+ * DEFINE_SBTREE_AUG_ROUTINES(), so they are always the same. the
+ * macros take these parameters:
+ *
+ * \param prefix the prefix of the routines called in the body, e.g.
+ *        sbtree_aug for sbtree_aug_maintain().
+ * \param update the \b name of the update function, or a function-like
+ *        macro, see #sbtree_update_t.
+ * \param args the arguments appended when the body calls the other
+ *        routines of prefix: SBTREE_AUG_ARG(update) for sbtree_aug_*
+ *        routines, which take the update function as argument, or
+ *        empty for the routines of DEFINE_SBTREE_AUG_ROUTINES().
+ */
+#define SBTREE_AUG_ARG(update) , update
+
+
+/**
+ * defined a augmented propagate function \b body.
+ *
+ * \param node the \b name of the node its data changed.
+ * \param update the update function, see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_PROPAGATE_BODY(node, update)          \
+{                                                               \
+    for (; node != &sbtree_nil; node = node->parent)            \
+    {                                                           \
+        node->size = node->left->size + node->right->size + 1;  \
+        update(node);                                           \
+    }                                                           \
+}
+
+
+/**
+ * recompute the summary of a node and all its ancestors.
+ *
+ * call it after the data of node changed.
+ *
+ * \param node the node its data changed.
+ * \param update the update function.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+void sbtree_aug_propagate(struct sbtree_entry *node,
+        sbtree_update_t update);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE void
+sbtree_aug_propagate(struct sbtree_entry *node, sbtree_update_t update)
+DEFINE_SBTREE_AUG_PROPAGATE_BODY(node, update)
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * defined a augmented rotate function \b body.
+ *
+ * \param pnode the \b name of the pointer to the node rotated.
+ * \param left the \b name of the child moved up, left or right.
+ * \param right the \b name of the other child.
+ * \param update the update function, see SBTREE_AUG_ARG().
+ *
+ * DEFINE_SBTREE_AUG_ROTATE_BODY(pnode, right, left, update) is the
+ * body of left rotate, and (pnode, left, right, update) is the body of
+ * right rotate.
+ */
+#define DEFINE_SBTREE_AUG_ROTATE_BODY(pnode, left, right, update) \
+{                                                               \
+    struct sbtree_entry *node = *pnode, *child = node->left;    \
+                                                                \
+    sbtree_set_parent(child, node->parent);                     \
+    sbtree_set_##left(node, child->right);                      \
+    sbtree_set_##right(child, node);                            \
+                                                                \
+    child->size = node->size;                                   \
+    node->size = node->left->size + node->right->size + 1;      \
+    update(node);                                               \
+    update(child);                                              \
+    *pnode = child;                                             \
+}
+
+
+/**
+ * defined a augmented maintain function \b body.
+ *
+ * \param prefix the prefix of rotate and maintain routines called.
+ * \param pnode the \b name of the pointer to the node maintained.
+ * \param care_left the \b name of the flag of the side to maintain.
+ * \param args see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_MAINTAIN_BODY(prefix, pnode, care_left, args) \
+{                                                               \
+    if (care_left)                                              \
+    {                                                           \
+        if ((*pnode)->left->left->size > (*pnode)->right->size) \
+            prefix##_right_rotate(pnode args);                  \
+        else if ((*pnode)->left->right->size                    \
+                > (*pnode)->right->size)                        \
+        {                                                       \
+            prefix##_left_rotate(&(*pnode)->left args);         \
+            prefix##_right_rotate(pnode args);                  \
+        }                                                       \
+        else return;                                            \
+    }                                                           \
+    else                                                        \
+    {                                                           \
+        if ((*pnode)->right->right->size > (*pnode)->left->size)\
+            prefix##_left_rotate(pnode args);                   \
+        else if ((*pnode)->right->left->size                    \
+                > (*pnode)->left->size)                         \
+        {                                                       \
+            prefix##_right_rotate(&(*pnode)->right args);       \
+            prefix##_left_rotate(pnode args);                   \
+        }                                                       \
+        else return;                                            \
+    }                                                           \
+                                                                \
+    prefix##_maintain(&(*pnode)->left, TRUE args);              \
+    prefix##_maintain(&(*pnode)->right, FALSE args);            \
+    prefix##_maintain(pnode, TRUE args);                        \
+    prefix##_maintain(pnode, FALSE args);                       \
+}
+
+
+/**
+ * defined a augmented insert fixup function \b body.
+ *
+ * \param prefix the prefix of maintain routine called.
+ * \param pnode the \b name of the root of the tree.
+ * \param cur_node the \b name of the new node linked.
+ * \param args see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_INSERT_FIXUP_BODY(prefix, pnode, cur_node, args) \
+{                                                               \
+    struct sbtree_entry *parent, *child = cur_node;             \
+    int care_left, is_left;                                     \
+                                                                \
+    /* new node needn't maintain */                             \
+    if ((cur_node = child->parent) == &sbtree_nil)              \
+        return;                                                 \
+                                                                \
+    /* maintain every node in the path, from bottom to root. */ \
+    care_left = child == cur_node->left;                        \
+    while ((parent = cur_node->parent) != &sbtree_nil)          \
+    {                                                           \
+        is_left = cur_node == parent->left;                     \
+        prefix##_maintain(is_left ? &parent->left               \
+                : &parent->right, care_left args);              \
+        care_left = is_left;                                    \
+        cur_node = parent;                                      \
+    }                                                           \
+                                                                \
+    prefix##_maintain(pnode, care_left args);                   \
+}
+
+
+/**
+ * fix the augmented sbtree after link new node.
+ *
+ * \param pnode the root of the tree.
+ * \param new_node the new node linked into the tree, the ancestors of
+ *        it must be updated before call this function.
+ * \param update the update function.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+void sbtree_aug_insert_fixup(struct sbtree_entry **pnode,
+        struct sbtree_entry *new_node, sbtree_update_t update);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/*
+ * left rotate augmented node.
+ */
+    INLINE void
+sbtree_aug_left_rotate(struct sbtree_entry **pnode, sbtree_update_t update)
+DEFINE_SBTREE_AUG_ROTATE_BODY(pnode, right, left, update)
+
+
+/*
+ * right rotate augmented node.
+ */
+    INLINE void
+sbtree_aug_right_rotate(struct sbtree_entry **pnode, sbtree_update_t update)
+DEFINE_SBTREE_AUG_ROTATE_BODY(pnode, left, right, update)
+
+
+/*
+ * keep the augmented sbtree.
+ */
+    INLINE void
+sbtree_aug_maintain(struct sbtree_entry **pnode, int care_left,
+        sbtree_update_t update)
+DEFINE_SBTREE_AUG_MAINTAIN_BODY(sbtree_aug, pnode, care_left,
+        SBTREE_AUG_ARG(update))
+
+
+    INLINE void
+sbtree_aug_insert_fixup(struct sbtree_entry **pnode,
+        struct sbtree_entry *cur_node, sbtree_update_t update)
+DEFINE_SBTREE_AUG_INSERT_FIXUP_BODY(sbtree_aug, pnode, cur_node,
+        SBTREE_AUG_ARG(update))
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * defined a augmented link function \b body.
+ *
+ * \param prefix the prefix of propagate and insert fixup routines
+ *        called.
+ * \param pnode the \b name of the root of the tree.
+ * \param pos the \b name of the node new_node linked beside.
+ * \param new_node the \b name of the new node.
+ * \param after the \b name of the flag to link after pos.
+ * \param args see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_LINK_BODY(prefix, pnode, pos, new_node, after, \
+        args)                                                   \
+{                                                               \
+    if (pos == &sbtree_nil)                                     \
+    {                                                           \
+        *pnode = new_node;                                      \
+        return;                                                 \
+    }                                                           \
+                                                                \
+    /* notice that sbtree_set_* macros evaluate node more than once. */ \
+    if (after && pos->right != &sbtree_nil)                     \
+    {                                                           \
+        pos = sbtree_get_min(pos->right);                       \
+        sbtree_set_left(pos, new_node);                         \
+    }                                                           \
+    else if (after)                                             \
+        sbtree_set_right(pos, new_node);                        \
+    else if (pos->left != &sbtree_nil)                          \
+    {                                                           \
+        pos = sbtree_get_max(pos->left);                        \
+        sbtree_set_right(pos, new_node);                        \
+    }                                                           \
+    else                                                        \
+        sbtree_set_left(pos, new_node);                         \
+                                                                \
+    prefix##_propagate(pos args);                               \
+    prefix##_insert_fixup(pnode, new_node args);                \
+}
+
+
+/**
+ * link a new node into augmented sbtree, just before or after a node
+ * in the tree.
+ *
+ * \param pnode the root of the tree.
+ * \param pos the node in the tree, or &sbtree_nil if the tree is
+ *        empty.
+ * \param new_node the new node, it must be initialized and its summary
+ *        must be computed.
+ * \param after link new_node after pos if nonzero, or before pos.
+ * \param update the update function.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+void sbtree_aug_link(struct sbtree_entry **pnode,
+        struct sbtree_entry *pos, struct sbtree_entry *new_node,
+        int after, sbtree_update_t update);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE void
+sbtree_aug_link(
+    struct sbtree_entry **pnode,
+    struct sbtree_entry *pos,
+    struct sbtree_entry *new_node,
+    int after,
+    sbtree_update_t update)
+DEFINE_SBTREE_AUG_LINK_BODY(sbtree_aug, pnode, pos, new_node, after,
+        SBTREE_AUG_ARG(update))
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * defined a augmented insert function \b body that use cmp for
+ * compare.
+ *
+ * \param prefix the prefix of propagate and insert fixup routines
+ *        called.
+ * \param pnode the \b name of the root of the tree.
+ * \param node the \b name of the node compared with the key.
+ * \param new_node the \b name of the new node.
+ * \param cmp the compare \b expression, see DEFINE_SBTREE_INSERT_BODY().
+ * \param args see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_INSERT_BODY(prefix, pnode, node, new_node, cmp, \
+        args)                                                   \
+{                                                               \
+    struct sbtree_entry **plink = pnode, *node = &sbtree_nil;   \
+                                                                \
+    while (*plink != &sbtree_nil)                               \
+    {                                                           \
+        node = *plink;                                          \
+        plink = (cmp) < 0 ? &node->right : &node->left;         \
+    }                                                           \
+                                                                \
+    *plink = new_node;                                          \
+    sbtree_set_parent(new_node, node);                          \
+    prefix##_propagate(node args);                              \
+    prefix##_insert_fixup(pnode, new_node args);                \
+    return new_node;                                            \
+}
+
+
+/**
+ * insert a new node into augmented sbtree by key, for the augmented
+ * trees ordered by keys, e.g. the intervals ordered by their start.
+ *
+ * \param pnode the root of the tree.
+ * \param new_node the new node, it must be initialized and its summary
+ *        must be computed.
+ * \param key the key of the new node.
+ * \param cmp_func the compare function, see sbtree_insert().
+ * \param update the update function.
+ * \return new_node.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_aug_insert(struct sbtree_entry **pnode,
+        struct sbtree_entry *new_node, void const *key,
+        sbtree_compare_t cmp_func, sbtree_update_t update);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry*
+sbtree_aug_insert(
+    struct sbtree_entry **pnode,
+    struct sbtree_entry *new_node,
+    void const *key,
+    sbtree_compare_t cmp_func,
+    sbtree_update_t update)
+DEFINE_SBTREE_AUG_INSERT_BODY(sbtree_aug, pnode, node, new_node,
+        cmp_func(node, key), SBTREE_AUG_ARG(update))
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * defined a augmented remove function \b body.
+ *
+ * \param prefix the prefix of propagate routine called.
+ * \param pnode the \b name of the root of the tree.
+ * \param del_node the \b name of the node removed.
+ * \param args see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_REMOVE_BODY(prefix, pnode, del_node, args) \
+{                                                               \
+    struct sbtree_entry *succ, *fix;                            \
+                                                                \
+    if (del_node->left == &sbtree_nil                           \
+            || del_node->right == &sbtree_nil)                  \
+    {                                                           \
+        succ = del_node->left == &sbtree_nil ?                  \
+            del_node->right : del_node->left;                   \
+        fix = del_node->parent;                                 \
+    }                                                           \
+    else                                                        \
+    {                                                           \
+        succ = sbtree_get_min(del_node->right);                 \
+        if (succ->parent == del_node)                           \
+            fix = succ;                                         \
+        else                                                    \
+        {                                                       \
+            fix = succ->parent;                                 \
+            sbtree_set_left(succ->parent, succ->right);         \
+            sbtree_set_right(succ, del_node->right);            \
+        }                                                       \
+        sbtree_set_left(succ, del_node->left);                  \
+    }                                                           \
+                                                                \
+    sbtree_set_parent(succ, del_node->parent);                  \
+    if (del_node->parent == &sbtree_nil)                        \
+        *pnode = succ;                                          \
+    else                                                        \
+        *sbtree_get_parent_field(del_node) = succ;              \
+                                                                \
+    prefix##_propagate(fix args);                               \
+    return del_node;                                            \
+}
+
+
+/**
+ * remove node from augmented sbtree.
+ *
+ * \param pnode the root of the tree.
+ * \param del_node the node need to delete from the tree.
+ * \param update the update function.
+ * \return the node deleted from the tree.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_aug_remove(struct sbtree_entry **pnode,
+        struct sbtree_entry *del_node, sbtree_update_t update);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry *
+sbtree_aug_remove(
+    struct sbtree_entry **pnode,
+    struct sbtree_entry *del_node,
+    sbtree_update_t update)
+DEFINE_SBTREE_AUG_REMOVE_BODY(sbtree_aug, pnode, del_node,
+        SBTREE_AUG_ARG(update))
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * defined a augmented build function \b body.
+ *
+ * \param prefix the prefix of build routine called.
+ * \param nodes the \b name of the array of nodes.
+ * \param count the \b name of the amount of nodes.
+ * \param update the update function.
+ * \param args see SBTREE_AUG_ARG().
+ */
+#define DEFINE_SBTREE_AUG_BUILD_BODY(prefix, nodes, count, update, args) \
+{                                                               \
+    struct sbtree_entry *node;                                  \
+    size_t mid = count / 2;                                     \
+                                                                \
+    if (count == 0)                                             \
+        return &sbtree_nil;                                     \
+                                                                \
+    node = nodes[mid];                                          \
+    node->parent = &sbtree_nil;                                 \
+    node->size = count;                                         \
+    sbtree_set_left(node, prefix##_build(nodes, mid args));     \
+    sbtree_set_right(node, prefix##_build(nodes + mid + 1,      \
+                count - mid - 1 args));                         \
+    update(node);                                               \
+    return node;                                                \
+}
+
+
+/**
+ * build a augmented tree from an array of nodes, just like
+ * sbtree_build(), the summary of every node is computed once.
+ *
+ * \param nodes the nodes in order.
+ * \param count the amount of nodes.
+ * \param update the update function.
+ * \return the root of the tree, or &sbtree_nil if count is zero.
+ */
+#if !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE)
+struct sbtree_entry *sbtree_aug_build(struct sbtree_entry **nodes,
+        size_t count, sbtree_update_t update);
+#else /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+    INLINE struct sbtree_entry*
+sbtree_aug_build(
+    struct sbtree_entry **nodes,
+    size_t count,
+    sbtree_update_t update)
+DEFINE_SBTREE_AUG_BUILD_BODY(sbtree_aug, nodes, count, update,
+        SBTREE_AUG_ARG(update))
+
+#endif /* !defined(ENABLE_INLINE) || defined(VIME_ONLY_PROTOTYPE) */
+
+
+/**
+ * define the augmented sbtree routines specialised for a update
+ * function.
+ *
+ * the sbtree_aug_* routines call the update function through a
+ * pointer, for every node in the path and every rotation. this macro
+ * defines copies of them which call update directly, so it can be
+ * inlined, just like the DEFINE_SBTREE_*_BODY macros do for the
+ * compare functions. for a summary keeps many fields, e.g. the bytes,
+ * newlines and max line width of text, it's much faster. the copies
+ * share the bodies of sbtree_aug_* routines, see
+ * DEFINE_SBTREE_AUG_*_BODY.
+ *
+ * \param prefix the prefix of the routines defined, the routines are
+ *        prefix_propagate(), prefix_link(), prefix_insert(),
+ *        prefix_remove() and prefix_build(), the same as the
+ *        sbtree_aug_* routines without the update argument.
+ * \param update the \b name of the update function, or a function-like
+ *        macro, see #sbtree_update_t.
+ *
+ * \code
+ * static void my_data_update(struct sbtree_entry *node);
+ * DEFINE_SBTREE_AUG_ROUTINES(my_data, my_data_update)
+ *
+ * my_data_link(&root, pos, &data->entry, TRUE);
+ * \endcode
+ */
+#define DEFINE_SBTREE_AUG_ROUTINES(prefix, update)              \
+                                                                \
+    INLINE void                                                 \
+prefix##_propagate(struct sbtree_entry *node)                   \
+DEFINE_SBTREE_AUG_PROPAGATE_BODY(node, update)                  \
+                                                                \
+    INLINE void                                                 \
+prefix##_left_rotate(struct sbtree_entry **pnode)               \
+DEFINE_SBTREE_AUG_ROTATE_BODY(pnode, right, left, update)       \
+                                                                \
+    INLINE void                                                 \
+prefix##_right_rotate(struct sbtree_entry **pnode)              \
+DEFINE_SBTREE_AUG_ROTATE_BODY(pnode, left, right, update)       \
+                                                                \
+    INLINE void                                                 \
+prefix##_maintain(struct sbtree_entry **pnode, int care_left)   \
+DEFINE_SBTREE_AUG_MAINTAIN_BODY(prefix, pnode, care_left, )     \
+                                                                \
+    INLINE void                                                 \
+prefix##_insert_fixup(struct sbtree_entry **pnode,              \
+        struct sbtree_entry *cur_node)                          \
+DEFINE_SBTREE_AUG_INSERT_FIXUP_BODY(prefix, pnode, cur_node, )  \
+                                                                \
+    INLINE void                                                 \
+prefix##_link(struct sbtree_entry **pnode,                      \
+        struct sbtree_entry *pos, struct sbtree_entry *new_node,\
+        int after)                                              \
+DEFINE_SBTREE_AUG_LINK_BODY(prefix, pnode, pos, new_node, after, ) \
+                                                                \
+    INLINE struct sbtree_entry*                                 \
+prefix##_insert(struct sbtree_entry **pnode,                    \
+        struct sbtree_entry *new_node, void const *key,         \
+        sbtree_compare_t cmp_func)                              \
+DEFINE_SBTREE_AUG_INSERT_BODY(prefix, pnode, node, new_node,    \
+        cmp_func(node, key), )                                  \
+                                                                \
+    INLINE struct sbtree_entry*                                 \
+prefix##_remove(struct sbtree_entry **pnode,                    \
+        struct sbtree_entry *del_node)                          \
+DEFINE_SBTREE_AUG_REMOVE_BODY(prefix, pnode, del_node, )        \
+                                                                \
+    INLINE struct sbtree_entry*                                 \
+prefix##_build(struct sbtree_entry **nodes, size_t count)       \
+DEFINE_SBTREE_AUG_BUILD_BODY(prefix, nodes, count, update, )
+
+
 #endif /* VIME_SBTREE_H */
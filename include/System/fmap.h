@@ -0,0 +1,97 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+
+
+/**
+ * \file fmap.h
+ *
+ * read-only file mapping of VimE.
+ *
+ * a file is mapped into memory instead of read into the heap, so
+ * opening a file is O(1) in the file size, and the pages of the file
+ * are only read by the system when they are touched at the first
+ * time. the pages are clean and shared with the page cache, so the
+ * system can drop them freely when memory is tight.
+ */
+
+
+#ifndef VIME_FMAP_H
+#define VIME_FMAP_H
+
+
+/**
+ * the file mapping struction.
+ */
+struct fmap
+{
+    char const *base;   /**< the mapped text, NULL if file is empty. */
+    size_t size;        /**< the size of the file. */
+    void *handle;       /**< the system handle of the mapping. */
+    int fd;             /**< the file descriptor kept to copy the text
+                             in kernel, or -1. */
+};
+
+/** the default constructor of #fmap. */
+#define FMAP_INIT {NULL, 0, NULL, -1}
+
+
+/**
+ * the identity of a file, to find a file replaced or changed by
+ * others. the fields the system doesn't have are zero.
+ */
+struct fmap_id
+{
+    uint64_t dev;       /**< the device of the file. */
+    uint64_t ino;       /**< the inode of the file. */
+    uint64_t mtime;     /**< the modify time of the file, in seconds. */
+};
+
+
+/**
+ * map a file into memory, read-only.
+ *
+ * \param fm the file mapping struction.
+ * \param name the file name.
+ * \return OK for success, or FAIL if the file can't be opened or
+ *         mapped.
+ *
+ * \remark the file must not be truncated by others when it's mapped.
+ */
+int fmap_open(struct fmap *fm, char const *name);
+
+
+/**
+ * unmap a file mapped by fmap_open().
+ *
+ * \param fm the file mapping struction, it's reset to empty.
+ */
+void fmap_close(struct fmap *fm);
+
+
+/**
+ * get the identity of the file mapped.
+ *
+ * \param fm the file mapping struction.
+ * \param id the identity is stored here, it's all zero if the system
+ *        can't tell it.
+ */
+void fmap_id(struct fmap const *fm, struct fmap_id *id);
+
+
+/**
+ * whether a file name refers to the file mapped now, i.e. it's not
+ * replaced by a rename().
+ *
+ * \param fm the file mapping struction.
+ * \param name the file name.
+ * \return TRUE if it's the file mapped, or FALSE if it isn't, or the
+ *         system can't tell it.
+ */
+int fmap_same(struct fmap const *fm, char const *name);
+
+
+#endif /* VIME_FMAP_H */
@@ -0,0 +1,119 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+#include <System/fmap.h>
+
+
+/**
+ * \file fsave.h
+ *
+ * the atomic file writer of VimE.
+ *
+ * a file is never overwritten in place: the text is written into a
+ * temporary file in the same directory, synced once, and renamed over
+ * the file, so a crash leaves either the old or the new file, never a
+ * half of them.
+ *
+ * a edited buffer is mostly the original text, so the runs of it are
+ * copied from the mapped original file by the kernel (copy_file_range()
+ * or sendfile()), the pages are never read into VimE. the other text
+ * is gathered and written by one pwritev() call for many pieces. all
+ * writes have explicit offsets, so the order of them doesn't matter.
+ *
+ * only UNIX is supported now.
+ */
+
+
+#ifndef VIME_FSAVE_H
+#define VIME_FSAVE_H
+
+
+/** the max count of text gathered in a write. */
+#define FSAVE_VEC_MAX   64
+
+
+/**
+ * a text gathered to write.
+ */
+struct fsave_vec
+{
+    char const *text;   /**< the text. */
+    size_t len;         /**< the length of text. */
+};
+
+
+/**
+ * the atomic file writer struction.
+ */
+struct fsave
+{
+    char *name;         /**< the file replaced. */
+    char *tmpname;      /**< the temporary file. */
+    int fd;             /**< the descriptor of the temporary file. */
+    size_t offset;      /**< the end of text written or gathered. */
+
+    struct fsave_vec vec[FSAVE_VEC_MAX];    /**< the text gathered. */
+    int nvec;           /**< the count of text gathered. */
+    size_t pending;     /**< the length of text gathered. */
+};
+
+
+/**
+ * create the temporary file to replace a file.
+ *
+ * the temporary file has the permission of the file, if it exists. if
+ * the file is a symbolic link, the file linked is replaced.
+ *
+ * \param fs the writer.
+ * \param name the file name.
+ * \return OK for success, or FAIL if the temporary file can't be
+ *         created.
+ */
+int fsave_open(struct fsave *fs, char const *name);
+
+
+/**
+ * append text into the file.
+ *
+ * the text is gathered and written later, it must be alive until
+ * next fsave_copy() or fsave_commit().
+ *
+ * \return OK for success, or FAIL if write failed.
+ */
+int fsave_write(struct fsave *fs, char const *text, size_t len);
+
+
+/**
+ * append a part of a mapped file into the file, the text is copied
+ * by the kernel if possible.
+ *
+ * \param fs the writer.
+ * \param src the mapped file.
+ * \param offset the beginning of text in src.
+ * \param len the length of text.
+ * \return OK for success, or FAIL if write failed.
+ */
+int fsave_copy(struct fsave *fs, struct fmap const *src,
+        size_t offset, size_t len);
+
+
+/**
+ * finish the file: write the text gathered, sync the temporary file
+ * and rename it over the file.
+ *
+ * \return OK for success, or FAIL, the temporary file is removed, and
+ *         the file is not changed.
+ */
+int fsave_commit(struct fsave *fs);
+
+
+/**
+ * give up writing, the temporary file is removed.
+ */
+void fsave_abort(struct fsave *fs);
+
+
+#endif /* VIME_FSAVE_H */
@@ -19,18 +19,186 @@
 
 
 void *vime_malloc(size_t size);
+void *vime_calloc(size_t count, size_t size);
 void vime_free(void *mem);
 void *vime_realloc(void *mem, size_t size);
 struct hook *vime_set_nomem_hook(struct hook *nomem_hook);
 struct hook *vime_get_nomem_hook(void);
 
 
+/**
+ * allocate memory for a allocation site.
+ *
+ * the same as vime_malloc(), but the block is counted into the
+ * statistics of tag when #ENABLE_MEMSTAT is defined. tags are looked
+ * up by address, so they should be string literals.
+ */
+void *vime_malloc_tag(size_t size, char const *tag);
+
+/**
+ * allocate zeroed memory for a allocation site, see vime_malloc_tag().
+ *
+ * large blocks come from the system already zeroed, so their pages
+ * are only touched when they are used.
+ */
+void *vime_calloc_tag(size_t count, size_t size, char const *tag);
+
+/**
+ * realloc memory for a allocation site, see vime_malloc_tag().
+ */
+void *vime_realloc_tag(void *mem, size_t size, char const *tag);
+
+
+/*
+ * when #ENABLE_MEMSTAT is defined, every allocation is tagged with the
+ * source position it's made, so leaks can be found by position.
+ */
+#if defined(ENABLE_MEMSTAT) && !defined(DEFINE_MEM_ROUTINES)
+#  define MEM_TAG_STR(x) #x
+#  define MEM_TAG_LINE(x) MEM_TAG_STR(x)
+#  define MEM_TAG __FILE__ ":" MEM_TAG_LINE(__LINE__)
+#  define vime_malloc(size) vime_malloc_tag((size), MEM_TAG)
+#  define vime_calloc(count, size) \
+    vime_calloc_tag((count), (size), MEM_TAG)
+#  define vime_realloc(mem, size) vime_realloc_tag((mem), (size), MEM_TAG)
+#endif /* defined(ENABLE_MEMSTAT) && !defined(DEFINE_MEM_ROUTINES) */
+
+
+/** the count of bins of the size histogram. */
+#define MEM_HIST_SIZE 16
+
+/**
+ * the allocation statistics of a site, or of all blocks.
+ */
+struct mem_stat
+{
+    char const *tag;        /**< the tag of site. */
+    size_t live_bytes;      /**< the bytes of blocks not freed. */
+    size_t live_count;      /**< the count of blocks not freed. */
+    size_t peak_bytes;      /**< the peak of live_bytes. */
+    size_t allocs;          /**< the count of allocations. */
+    size_t frees;           /**< the count of frees. */
+    size_t hist[MEM_HIST_SIZE]; /**< the histogram of sizes, bin n
+                                     counts blocks less than 16 << n
+                                     bytes, the last bin counts all
+                                     bigger blocks. */
+};
+
+/**
+ * get the allocation statistics.
+ *
+ * \param tag the tag of site, or NULL for all blocks.
+ * \param stat the struction received the statistics.
+ * \return OK for success, or FAIL if the site is unknown, or
+ *         #ENABLE_MEMSTAT is not defined.
+ */
+int vime_mem_stat(char const *tag, struct mem_stat *stat);
+
+/**
+ * get the allocation statistics of all sites.
+ *
+ * \param stats the array received the statistics.
+ * \param count the count of stats.
+ * \return the count of all sites, it may be bigger than count.
+ */
+size_t vime_mem_sites(struct mem_stat *stats, size_t count);
+
+/**
+ * print the allocation statistics to stderr, the sites still have
+ * live blocks are marked as leak. it's called at exit automatically
+ * when #ENABLE_MEMSTAT is defined.
+ */
+void vime_mem_dump(void);
+
+
+/**
+ * the fixed allocator.
+ *
+ * a fixed allocator hands out blocks of the same size, carved from
+ * page-sized slabs, and keeps released blocks in a free list, so
+ * acquiring and releasing a block are both O(1), and the blocks are
+ * packed together. it's used for the nodes of trees and lists.
+ * blocks of a multiple of 64 bytes are aligned to a cache line.
+ * slabs are only freed by fixed_free(), and the allocator is not
+ * thread-safe.
+ */
 typedef struct fixed_allocator *fixed_alloc_t;
 
+/**
+ * create a fixed allocator.
+ *
+ * \param size the size of blocks.
+ * \param prealloc_size the count of blocks allocated at once, can be
+ *        zero.
+ * \return the allocator, or NULL if no memory.
+ */
 fixed_alloc_t fixed_alloc(size_t size, size_t prealloc_size);
+
+/**
+ * free a fixed allocator, and all blocks acquired from it.
+ */
 void fixed_free(fixed_alloc_t fa);
+
+/**
+ * acquire a block from a fixed allocator.
+ *
+ * \return the block, or NULL if no memory.
+ */
 void *fixed_acquire(fixed_alloc_t fa);
+
+/**
+ * release a block to the fixed allocator it's acquired from.
+ */
 void fixed_release(fixed_alloc_t fa, void *mem);
 
 
+/**
+ * the arena.
+ *
+ * a arena allocates memory by bumping a pointer in big chunks, and
+ * frees it all at once, by rewinding to a mark taken before, or by
+ * destroying the arena. it's used for the temporary memory of a
+ * command, e.g. parsing a ex-command or compiling a regex, that all
+ * dies when the command is done. if no memory, the nomem hook is
+ * called with the name "arena".
+ */
+typedef struct arena *arena_t;
+
+/**
+ * create a arena.
+ *
+ * \param chunk_size the size of chunks, zero for the default size.
+ * \return the arena, or NULL if no memory.
+ */
+arena_t arena_create(size_t chunk_size);
+
+/**
+ * destroy a arena, and free all memory allocated from it.
+ */
+void arena_destroy(arena_t arena);
+
+/**
+ * allocate memory from a arena, it's aligned for a pointer, a double
+ * or a uint64_t (8 bytes on most systems), not as strictly as malloc().
+ *
+ * \return the memory, or NULL if no memory.
+ */
+void *arena_alloc(arena_t arena, size_t size);
+
+/**
+ * get the mark of the current position of a arena.
+ *
+ * \return the mark, it's 0 for a new arena.
+ */
+size_t arena_mark(arena_t arena);
+
+/**
+ * free all memory allocated after a mark is taken.
+ *
+ * \param mark the mark taken by arena_mark(), must not be rewound
+ *        over before.
+ */
+void arena_rewind(arena_t arena, size_t mark);
+
+
 #endif /* VIME_MEM_H */
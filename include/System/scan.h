@@ -0,0 +1,97 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+
+
+/**
+ * \file scan.h
+ *
+ * the text scanning kernels of VimE.
+ *
+ * building the line index and counting characters both boil down to
+ * scanning bytes for newlines and UTF-8 lead bytes. these routines do
+ * that over large blocks of text, with SIMD instructions if the CPU
+ * supports them. the kernel is selected at the first call, and a
+ * portable kernel is always available.
+ */
+
+
+#ifndef VIME_SCAN_H
+#define VIME_SCAN_H
+
+
+/**
+ * count the newlines in text.
+ *
+ * \param text the text to scan.
+ * \param len the length of text.
+ * \return the count of newlines in text.
+ */
+size_t scan_newlines(char const *text, size_t len);
+
+
+/**
+ * find the nth newline in text.
+ *
+ * \param text the text to scan.
+ * \param len the length of text.
+ * \param n which newline to find, count from 1.
+ * \return the offset of the nth newline, or len if there are less
+ *         than n newlines in text.
+ */
+size_t scan_nth_newline(char const *text, size_t len, size_t n);
+
+
+/**
+ * count the code points in UTF-8 text.
+ *
+ * every byte that is not a continuation byte begins a code point, so
+ * the result is exact for valid text, and never more than len.
+ *
+ * \param text the UTF-8 text to scan.
+ * \param len the length of text.
+ * \return the count of code points.
+ */
+size_t scan_utf8_count(char const *text, size_t len);
+
+
+/**
+ * validate UTF-8 text.
+ *
+ * overlong forms, surrogates and code points above U+10FFFF are
+ * invalid.
+ *
+ * \param text the UTF-8 text to scan.
+ * \param len the length of text.
+ * \return the length of the longest valid prefix of text, it's len if
+ *         the whole text is valid. a sequence cut by the end of text
+ *         is not included.
+ */
+size_t scan_utf8_valid(char const *text, size_t len);
+
+
+/**
+ * get the name of the kernel in use.
+ *
+ * \return the name of kernel, e.g. "avx2", "sse2" or "scalar".
+ */
+char const *scan_kernel(void);
+
+
+/**
+ * select the kernel to use. it's not thread-safe, the kernel is
+ * selected by the main thread before other threads scan text, a call
+ * of scan_kernel() selects the fastest one if none is selected.
+ *
+ * \param name the name of kernel, or NULL for the fastest one the CPU
+ *        supports.
+ * \return OK for success, or FAIL if the kernel is unknown or not
+ *         supported by the CPU.
+ */
+int scan_use(char const *name);
+
+
+#endif /* VIME_SCAN_H */
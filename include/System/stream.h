@@ -4,10 +4,27 @@
 
 
 #include <defs.h>
+#include <System/fmap.h>
 
 
 /**
  * \file stream.h
+ *
+ * the buffered stream of VimE.
+ *
+ * a file of several GB can't be read byte by byte, or copied into a
+ * buffer of the caller and then copied again into the memcache. so a
+ * stream lends its text in place: stream_borrow() returns a window of
+ * the text not read yet, it points into the internal buffer, or into
+ * the mapping of a regular file, and stream_release() marks the
+ * beginning of the window used. the caller parses the lines in the
+ * window directly, and borrows a larger window if the last line is not
+ * complete.
+ *
+ * a regular file opened for reading is mapped (see fmap.h), the window
+ * is the whole rest of the file, and nothing is copied at all. pipes,
+ * terminals and the files can't be mapped are read into the internal
+ * buffer, a chunk by a read() call.
  */
 
 
@@ -15,19 +32,194 @@
 #define VIME_STREAM_H
 
 
+/** the stream is readable. */
+#define STREAM_READ     0x00000001
+
+/** the stream is writable. */
+#define STREAM_WRITE    0x00000002
+
+/** with #STREAM_WRITE, the file is created, and it must not exist. */
+#define STREAM_EXCL     0x00000004
+
+/** the end of stream is reached. */
+#define STREAM_EOF      0x00000100
+
+/** a read or write of stream failed. */
+#define STREAM_ERROR    0x00000200
+
+/** the default size of the internal buffer. */
+#define STREAM_BUFSIZE  (64 * 1024)
+
+
+struct stream;
+
+
 /**
- * the stream operation struction.
+ * the stream operation struction, the system routines of a kind of
+ * stream. the buffering is done by stream routines, so the operations
+ * only move the text in bulk.
  */
 struct stream_ops
 {
-    int (*open)(char *name, flag_t flags, flag_t mode, stream stream_ops *self);
-    int (*close)(stream stream_ops *self);
-    int (*getc)(struct stream_ops *self);
-    int (*putc)(int ch, struct stream_ops *self);
-    ssize_t (*read)(void *buf, size_t buflen, stream stream_ops *self);
-    ssize_t (*write)(void *buf, size_t buflen, stream stream_ops *self);
-    ssize_t (*seek)(int whence, ssize_t offset, struct stream_ops *self);
+    /**
+     * read at most len bytes into buf, return the count read, 0 at the
+     * end of stream, or -1 for error.
+     */
+    ssize_t (*read)(struct stream *self, void *buf, size_t len);
+
+    /**
+     * write at most len bytes from buf, return the count written, or -1
+     * for error.
+     */
+    ssize_t (*write)(struct stream *self, void const *buf, size_t len);
+
+    /** write the data of file into the disk, return OK or FAIL. */
+    int (*sync)(struct stream *self);
+
+    /** close the system handle, return OK or FAIL. */
+    int (*close)(struct stream *self);
+};
+
+
+/**
+ * the buffered stream struction.
+ *
+ * for reading, the text not read is [buf + pos, buf + end). for
+ * writing, the text not written is [buf, buf + end).
+ */
+struct stream
+{
+    struct stream_ops const *ops;   /**< the operations of stream. */
+    int flags;          /**< the flags of stream. */
+    int fd;             /**< the file descriptor, or -1. */
+    struct fmap map;    /**< the mapping of a regular file. */
+
+    char *buf;          /**< the internal buffer, or the mapped text. */
+    size_t size;        /**< the size of buf. */
+    size_t pos;         /**< the beginning of text not read. */
+    size_t end;         /**< the end of text in buf. */
 };
 
+/** the default constructor of #stream. */
+#define STREAM_INIT {NULL, 0, -1, FMAP_INIT, NULL, 0, 0, 0}
+
+
+/** whether the end of stream is reached. */
+#define stream_eof(s)   (((s)->flags & STREAM_EOF) != 0)
+
+/** whether a read or write of stream failed. */
+#define stream_error(s) (((s)->flags & STREAM_ERROR) != 0)
+
+
+/**
+ * initialize a stream with its operations.
+ *
+ * \param s the stream.
+ * \param ops the operations of stream.
+ * \param flags #STREAM_READ or #STREAM_WRITE.
+ * \return the stream.
+ */
+struct stream *stream_init(struct stream *s, struct stream_ops const *ops,
+        int flags);
+
+
+/**
+ * open a file as a stream.
+ *
+ * a regular file opened for reading is mapped, if it can't be mapped
+ * it's read by read(). a file opened for writing is created, or
+ * truncated if it exists, unless #STREAM_EXCL is given.
+ *
+ * \param s the stream.
+ * \param name the file name.
+ * \param flags #STREAM_READ, or #STREAM_WRITE, maybe with #STREAM_EXCL.
+ * \return OK for success, or FAIL if file can't be opened.
+ */
+int stream_open(struct stream *s, char const *name, int flags);
+
+
+/**
+ * open a file descriptor as a stream, e.g. a pipe.
+ *
+ * \param s the stream.
+ * \param fd the file descriptor, it's closed by stream_close().
+ * \param flags #STREAM_READ or #STREAM_WRITE.
+ * \return OK for success.
+ */
+int stream_fdopen(struct stream *s, int fd, int flags);
+
+
+/**
+ * close a stream, the text not written is flushed.
+ *
+ * \param s the stream.
+ * \return OK for success, or FAIL if flush or close failed.
+ */
+int stream_close(struct stream *s);
+
+
+/**
+ * borrow the window of text not read.
+ *
+ * the window contains at least want bytes, unless the end of stream
+ * is reached, and maybe more. the window is valid until next borrow,
+ * read or close of the stream.
+ *
+ * \param s the stream opened for reading.
+ * \param want the count of bytes wanted, 0 means 1.
+ * \param plen the length of window is stored here.
+ * \return the window, or NULL if nothing is left or error.
+ */
+char const *stream_borrow(struct stream *s, size_t want, size_t *plen);
+
+
+/**
+ * release the beginning of the window borrowed, they are read.
+ *
+ * \param s the stream.
+ * \param used the count of bytes read, must not bigger than the length
+ *        of window.
+ */
+void stream_release(struct stream *s, size_t used);
+
+
+/**
+ * read text from stream into a buffer of the caller.
+ *
+ * \return the count of bytes read, less than len only at the end of
+ *         stream or error.
+ */
+size_t stream_read(struct stream *s, void *buf, size_t len);
+
+
+/**
+ * write text into stream, the text is buffered.
+ *
+ * once a write failed, the stream is in error, and no text is written
+ * any more, so the text written later never follows a gap.
+ *
+ * \return OK for success, or FAIL for error, or the stream is in
+ *         error already.
+ */
+int stream_write(struct stream *s, void const *buf, size_t len);
+
+
+/**
+ * write the text buffered into system.
+ *
+ * \return OK for success, or FAIL for error, or the stream is in
+ *         error already.
+ */
+int stream_flush(struct stream *s);
+
+
+/**
+ * write the text buffered, and the data of file into the disk, so it
+ * survives a crash of system.
+ *
+ * \return OK for success, or FAIL for error.
+ */
+int stream_sync(struct stream *s);
+
 
 #endif /* VIME_STREAM_H */
@@ -0,0 +1,102 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <defs.h>
+
+#if defined(UNIX)
+#  include <pthread.h>
+#elif defined(WIN32)
+#  include <windows.h>
+#endif /* defined(UNIX) */
+
+
+/**
+ * \file thread.h
+ *
+ * the threads of VimE.
+ *
+ * VimE runs in one thread, the editing state is never shared. a
+ * thread is only used for the slow work that doesn't touch the
+ * editing state, e.g. reading a large file, and the result is handed
+ * to the main thread under a #mutex.
+ */
+
+
+#ifndef VIME_THREAD_H
+#define VIME_THREAD_H
+
+
+/**
+ * the thread struction.
+ */
+struct thread
+{
+#if defined(UNIX)
+    pthread_t handle;       /**< the system handle of thread. */
+#elif defined(WIN32)
+    HANDLE handle;          /**< the system handle of thread. */
+#endif /* defined(UNIX) */
+    void (*func)(void *arg);    /**< the function run by thread. */
+    void *arg;                  /**< the argument of func. */
+};
+
+
+/**
+ * the mutex struction.
+ */
+struct mutex
+{
+#if defined(UNIX)
+    pthread_mutex_t handle; /**< the system handle of mutex. */
+#elif defined(WIN32)
+    CRITICAL_SECTION handle; /**< the system handle of mutex. */
+#endif /* defined(UNIX) */
+};
+
+
+/**
+ * start a new thread.
+ *
+ * \param t the thread struction, it must be alive until joined.
+ * \param func the function run by thread.
+ * \param arg the argument of func.
+ * \return OK for success, or FAIL if thread can't be created.
+ */
+int thread_start(struct thread *t, void (*func)(void *arg), void *arg);
+
+
+/**
+ * wait a thread to exit.
+ */
+void thread_join(struct thread *t);
+
+
+/**
+ * initialize a mutex.
+ *
+ * \return OK for success, or FAIL.
+ */
+int mutex_init(struct mutex *m);
+
+
+/**
+ * destroy a mutex, it must be unlocked.
+ */
+void mutex_drop(struct mutex *m);
+
+
+/**
+ * lock a mutex, wait if it's locked by other thread.
+ */
+void mutex_lock(struct mutex *m);
+
+
+/**
+ * unlock a mutex.
+ */
+void mutex_unlock(struct mutex *m);
+
+
+#endif /* VIME_THREAD_H */
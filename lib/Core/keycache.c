@@ -0,0 +1,181 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <Core/keycache.h>
+#include <System/mem.h>
+
+
+/* whether a key only reaches the default operation, the operators of
+ * bytes are always in the flat array of op_table. */
+#define is_literal(kc, c) ((kc)->ops->fast[(c)] == NULL \
+        && ((kc)->maps == NULL || (kc)->maps->first[(c)] == NULL))
+
+
+static size_t process(struct keycache *kc, char const *keys, size_t len,
+        int timeout);
+
+
+/*
+ * match the keys with mappings, and execute the mapping found.
+ *
+ * return the count of keys used, 0 if keys are not mapped, or
+ * (size_t)-1 if keys are a prefix of some lhs and not timeout.
+ */
+static size_t map_keys(struct keycache *kc, char const *keys, size_t len,
+        int timeout)
+{
+    struct map_match match;
+    size_t i;
+    int r = MAP_NONE;
+
+    map_match_init(&match, kc->maps);
+    for (i = 0; i < len; ++i)
+        if ((r = map_match_feed(&match, (unsigned char)keys[i])) == MAP_NONE
+                || r == MAP_FULL)
+            break;
+    if (i == len && !timeout)
+        return (size_t)-1;
+    if (match.full == NULL)
+        return 0;
+
+    /* the rhs is mapped again, unless it's too deep. */
+    ++kc->depth;
+    process(kc, match.full->value, strlen(match.full->value), TRUE);
+    --kc->depth;
+    return match.full_len;
+}
+
+
+/*
+ * process the keys, return the count of keys used, the others are a
+ * prefix of some lhs.
+ */
+static size_t process(struct keycache *kc, char const *keys, size_t len,
+        int timeout)
+{
+    struct kc_text run;
+    size_t i = 0, used;
+    int c;
+
+    while (i < len)
+    {
+        c = (unsigned char)keys[i];
+        if (kc->flags & KC_BATCH && is_literal(kc, c))
+        {
+            run.text = keys + i;
+            while (++i < len && is_literal(kc, (unsigned char)keys[i]))
+                ;
+            run.len = keys + i - run.text;
+            hook_call(&kc->insert_hook, HF_DEFAULT, &run);
+            continue;
+        }
+
+        if (kc->maps != NULL && kc->maps->first[c] != NULL
+                && kc->depth < KC_MAP_DEPTH)
+        {
+            if ((used = map_keys(kc, keys + i, len - i, timeout))
+                    == (size_t)-1)
+                return i;
+            if (used != 0)
+            {
+                i += used;
+                continue;
+            }
+        }
+
+        op_exec(kc->ops, c);
+        ++i;
+    }
+    return i;
+}
+
+
+/*
+ * keep the keys pending.
+ */
+static int keep(struct keycache *kc, char const *keys, size_t len)
+{
+    char *newkeys;
+    size_t size;
+
+    if (len == 0)
+        return OK;
+    if (kc->len + len > kc->size)
+    {
+        size = kc->size == 0 ? 64 : kc->size;
+        while (size < kc->len + len)
+            size *= 2;
+        newkeys = kc->keys == NULL ? vime_malloc(size)
+            : vime_realloc(kc->keys, size);
+        if (newkeys == NULL)
+            return FAIL;
+        kc->keys = newkeys;
+        kc->size = size;
+    }
+    memmove(kc->keys + kc->len, keys, len);
+    kc->len += len;
+    return OK;
+}
+
+
+/**
+ * initialize a key cache.
+ */
+struct keycache *kc_init(struct keycache *kc, struct map_trie *maps,
+        struct op_table *ops)
+{
+    static struct keycache const init = KEYCACHE_INIT;
+
+    *kc = init;
+    kc->maps = maps;
+    kc->ops = ops;
+    return kc;
+}
+
+
+/**
+ * drop a key cache, the keys pending are discarded.
+ */
+void kc_drop(struct keycache *kc)
+{
+    if (kc->keys != NULL)
+        vime_free(kc->keys);
+    kc->keys = NULL;
+    kc->len = kc->size = 0;
+    hook_drop(&kc->insert_hook);
+}
+
+
+/**
+ * feed keys to key cache.
+ */
+int kc_feed(struct keycache *kc, char const *keys, size_t len)
+{
+    size_t used;
+
+    /* nothing pending, use the keys in place. */
+    if (kc->len == 0)
+    {
+        used = process(kc, keys, len, FALSE);
+        return keep(kc, keys + used, len - used);
+    }
+
+    if (keep(kc, keys, len) == FAIL)
+        return FAIL;
+    used = process(kc, kc->keys, kc->len, FALSE);
+    memmove(kc->keys, kc->keys + used, kc->len - used);
+    kc->len -= used;
+    return OK;
+}
+
+
+/**
+ * the keys pending are timeout, map (or not map) and execute them.
+ */
+void kc_timeout(struct keycache *kc)
+{
+    process(kc, kc->keys, kc->len, TRUE);
+    kc->len = 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <Core/loader.h>
+#include <System/scan.h>
+
+#if defined(UNIX)
+#  include <sys/stat.h>
+#endif /* defined(UNIX) */
+
+
+/*
+ * read a chunk of text, return #LD_BUSY and store the chunk into
+ * *pchunk, or return #LD_DONE at the end of text, or #LD_FAIL.
+ */
+static int read_chunk(struct loader *ld, struct ld_chunk **pchunk)
+{
+    struct ld_chunk *chunk;
+    struct mc_block *block = NULL;
+    char const *text;
+    size_t len;
+
+    /* the mapped text is used in place. */
+    if (ld->stream.ops == NULL)
+    {
+        if (ld->left == 0)
+            return LD_DONE;
+        text = ld->text;
+        len = ld->left < LD_CHUNK ? ld->left : LD_CHUNK;
+        ld->text += len;
+        ld->left -= len;
+    }
+    else
+    {
+        if ((text = stream_borrow(&ld->stream, 1, &len)) == NULL)
+            return stream_error(&ld->stream) ? LD_FAIL : LD_DONE;
+        if (len > LD_CHUNK)
+            len = LD_CHUNK;
+
+        block = vime_malloc(offsetof(struct mc_block, text) + len);
+        if (block == NULL)
+            return LD_FAIL;
+        block->next = NULL;
+        block->used = len;
+        memcpy(block->text, text, len);
+        stream_release(&ld->stream, len);
+        text = block->text;
+    }
+
+    if ((chunk = vime_malloc(sizeof(struct ld_chunk))) == NULL)
+    {
+        if (block != NULL)
+            vime_free(block);
+        return LD_FAIL;
+    }
+    chunk->next = NULL;
+    chunk->text = text;
+    chunk->len = len;
+    chunk->nl = scan_newlines(text, len);
+    chunk->block = block;
+    *pchunk = chunk;
+    return LD_BUSY;
+}
+
+
+/*
+ * read at most count chunks and hand them to the main thread, stop at
+ * the end of text, error, or cancel.
+ */
+static void produce(struct loader *ld, size_t count)
+{
+    struct ld_chunk *chunk = NULL;
+    int state = LD_BUSY, cancel = FALSE;
+
+    while (state == LD_BUSY && !cancel && count-- != 0)
+    {
+        state = read_chunk(ld, &chunk);
+
+        mutex_lock(&ld->lock);
+        if (state == LD_BUSY)
+        {
+            *ld->tail = chunk;
+            ld->tail = &chunk->next;
+            ld->bytes += chunk->len;
+            ld->lines += chunk->nl;
+        }
+        else if (ld->state == LD_BUSY)
+            ld->state = state;
+        cancel = ld->cancel;
+        mutex_unlock(&ld->lock);
+    }
+}
+
+
+/*
+ * the routine of the thread.
+ */
+static void run(void *arg)
+{
+    produce(arg, (size_t)-1);
+}
+
+
+/*
+ * free the chunks and their blocks.
+ */
+static void free_chunks(struct ld_chunk *chunk)
+{
+    struct ld_chunk *next;
+
+    for (; chunk != NULL; chunk = next)
+    {
+        next = chunk->next;
+        if (chunk->block != NULL)
+            vime_free(chunk->block);
+        vime_free(chunk);
+    }
+}
+
+
+/*
+ * start loading, the stream or the mapped text is set already.
+ */
+static int start(struct loader *ld, struct memcache *mc)
+{
+    ld->mc = mc;
+    ld->ready = NULL;
+    ld->tail = &ld->ready;
+    ld->bytes = ld->lines = 0;
+    ld->state = LD_BUSY;
+    ld->cancel = FALSE;
+
+    if (mutex_init(&ld->lock) == FAIL)
+        return FAIL;
+    mc_mark_add(mc, &ld->end, 0);
+
+    /* the kernel is selected before the thread scans with it, so only
+     * the main thread writes it. without the thread, ld_poll() reads
+     * the text. */
+    scan_kernel();
+    ld->threaded = thread_start(&ld->thread, run, ld) == OK;
+    return OK;
+}
+
+
+/**
+ * open a file and start loading it into a empty memcache.
+ */
+int ld_open(struct loader *ld, struct memcache *mc, char const *name)
+{
+#if defined(UNIX)
+    struct stat st;
+#endif /* defined(UNIX) */
+
+    assert(mc->root == &sbtree_nil && mc->file.base == NULL);
+
+    stream_init(&ld->stream, NULL, 0);
+    ld->text = NULL;
+    ld->left = 0;
+    ld->size = MC_NPOS;
+
+#if defined(UNIX)
+    /* a pipe is opened as a empty file by fmap_open(). */
+    if (stat(name, &st) == 0 && S_ISREG(st.st_mode)
+            && fmap_open(&mc->file, name) == OK)
+#else /* defined(UNIX) */
+    if (fmap_open(&mc->file, name) == OK)
+#endif /* defined(UNIX) */
+    {
+        ld->text = mc->file.base;
+        ld->left = ld->size = mc->file.size;
+    }
+    else if (stream_open(&ld->stream, name, STREAM_READ) == FAIL)
+        return FAIL;
+
+    if (start(ld, mc) == FAIL)
+    {
+        if (ld->stream.ops != NULL)
+            stream_close(&ld->stream);
+        fmap_close(&mc->file);
+        return FAIL;
+    }
+    return OK;
+}
+
+
+/**
+ * start loading a file descriptor into a empty memcache, e.g. a pipe.
+ */
+int ld_fdopen(struct loader *ld, struct memcache *mc, int fd)
+{
+    assert(mc->root == &sbtree_nil);
+
+    ld->text = NULL;
+    ld->left = 0;
+    ld->size = MC_NPOS;
+    if (stream_fdopen(&ld->stream, fd, STREAM_READ) == FAIL)
+        return FAIL;
+
+    if (start(ld, mc) == FAIL)
+    {
+        stream_close(&ld->stream);
+        return FAIL;
+    }
+    return OK;
+}
+
+
+/**
+ * attach the chunks read into memcache.
+ */
+int ld_poll(struct loader *ld)
+{
+    struct ld_chunk *chunk, *next;
+    int state;
+
+    if (!ld->threaded && ld->state == LD_BUSY)
+        produce(ld, LD_POLL_CHUNKS);
+
+    mutex_lock(&ld->lock);
+    chunk = ld->ready;
+    ld->ready = NULL;
+    ld->tail = &ld->ready;
+    state = ld->state;
+    mutex_unlock(&ld->lock);
+
+    for (; chunk != NULL; chunk = next)
+    {
+        next = chunk->next;
+        if (chunk->block != NULL)
+            mc_adopt(ld->mc, chunk->block);
+        chunk->block = NULL;
+
+        if (mc_attach(ld->mc, mc_mark_offset(&ld->end), chunk->text,
+                    chunk->len, chunk->nl) == FAIL)
+        {
+            vime_free(chunk);
+            free_chunks(next);
+
+            mutex_lock(&ld->lock);
+            ld->state = LD_FAIL;
+            ld->cancel = TRUE;
+            mutex_unlock(&ld->lock);
+            return LD_FAIL;
+        }
+        vime_free(chunk);
+    }
+    return state;
+}
+
+
+/**
+ * get the progress of loader.
+ */
+int ld_progress(struct loader *ld, size_t *pbytes, size_t *plines)
+{
+    int state;
+
+    mutex_lock(&ld->lock);
+    if (pbytes != NULL)
+        *pbytes = ld->bytes;
+    if (plines != NULL)
+        *plines = ld->lines;
+    state = ld->state;
+    mutex_unlock(&ld->lock);
+    return state;
+}
+
+
+/**
+ * stop loading, the text attached is kept in memcache.
+ */
+void ld_close(struct loader *ld)
+{
+    mutex_lock(&ld->lock);
+    ld->cancel = TRUE;
+    mutex_unlock(&ld->lock);
+    if (ld->threaded)
+        thread_join(&ld->thread);
+    ld->threaded = FALSE;
+
+    free_chunks(ld->ready);
+    ld->ready = NULL;
+    ld->tail = &ld->ready;
+    if (ld->stream.ops != NULL)
+        stream_close(&ld->stream);
+
+    mc_mark_remove(ld->mc, &ld->end);
+    mutex_drop(&ld->lock);
+}
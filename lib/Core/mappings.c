@@ -0,0 +1,256 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <Core/mappings.h>
+#include <System/mem.h>
+
+
+/* the hash of a edge, spread the bits of node with the golden ratio. */
+#define edge_hash(from, byte) \
+    ((hash_t)((uintptr_t)(from) >> 3) * 0x9E3779B1UL + (hash_t)(byte))
+
+
+/*
+ * compare the edges of trie.
+ */
+static int edge_compare(void const *lhs, void const *rhs)
+{
+    struct map_edge const *l = lhs, *r = rhs;
+
+    return l->from != r->from || l->byte != r->byte;
+}
+
+
+/*
+ * get the child of a node, from first or edges.
+ */
+static struct map_node *get_child(struct map_trie *trie,
+        struct map_node *from, int byte)
+{
+    struct map_edge edge;
+    struct hash_entry *entry;
+
+    if (from == &trie->root)
+        return trie->first[byte];
+
+    edge.from = from;
+    edge.byte = byte;
+    entry = ht_get(&trie->edges, &edge, edge_hash(from, byte),
+            edge_compare);
+    return entry == NULL ? NULL : container_of(entry, struct map_node, entry);
+}
+
+
+/*
+ * add a child to a node.
+ */
+static struct map_node *add_child(struct map_trie *trie,
+        struct map_node *from, int byte)
+{
+    struct map_node *node = vime_malloc(sizeof(struct map_node));
+
+    if (node == NULL)
+        return NULL;
+    node->edge.from = from;
+    node->edge.byte = byte;
+    node->entry.key = &node->edge;
+    node->entry.hash = edge_hash(from, byte);
+    node->child = NULL;
+    node->map = NULL;
+
+    if (from == &trie->root)
+        trie->first[byte] = node;
+    else if (ht_set(&trie->edges, &node->entry, edge_compare)
+            != &node->entry)
+    {
+        vime_free(node);
+        return NULL;
+    }
+    node->next = from->child;
+    from->child = node;
+    return node;
+}
+
+
+/*
+ * remove the nodes without mapping and children, from node to root.
+ */
+static void prune(struct map_trie *trie, struct map_node *node)
+{
+    struct map_node *from, **pnode;
+    hashitem_t *item;
+
+    while (node != &trie->root && node->map == NULL && node->child == NULL)
+    {
+        from = node->edge.from;
+        for (pnode = &from->child; *pnode != node; pnode = &(*pnode)->next)
+            ;
+        *pnode = node->next;
+
+        if (from == &trie->root)
+            trie->first[node->edge.byte] = NULL;
+        else if ((item = ht_entry(&trie->edges, &node->edge,
+                        node->entry.hash, edge_compare)) != NULL
+                && !hi_is_empty(*item))
+            ht_del(&trie->edges, item);
+        vime_free(node);
+        node = from;
+    }
+}
+
+
+/*
+ * free a node and all its children.
+ */
+static void free_nodes(struct map_node *node)
+{
+    struct map_node *next;
+
+    for (; node != NULL; node = next)
+    {
+        next = node->next;
+        free_nodes(node->child);
+        vime_free(node);
+    }
+}
+
+
+/*
+ * find the node of a lhs.
+ */
+static struct map_node *find_node(struct map_trie *trie, char const *lhs)
+{
+    struct map_node *node = &trie->root;
+
+    while (node != NULL && *lhs != '\0')
+        node = get_child(trie, node, (unsigned char)*lhs++);
+    return node;
+}
+
+
+/**
+ * initialize a mapping trie.
+ */
+struct map_trie *map_trie_init(struct map_trie *trie)
+{
+    static struct map_trie const init = MAP_TRIE_INIT;
+
+    *trie = init;
+    ht_init(&trie->edges);
+    return trie;
+}
+
+
+/**
+ * drop a mapping trie, free all nodes.
+ */
+void map_trie_drop(struct map_trie *trie)
+{
+    free_nodes(trie->root.child);
+    ht_drop(&trie->edges);
+    map_trie_init(trie);
+}
+
+
+/**
+ * add a mapping into trie.
+ */
+int map_trie_add(struct map_trie *trie, struct mapping_key *map)
+{
+    struct map_node *node = &trie->root, *child;
+    unsigned char const *lhs = (unsigned char const *)map->key;
+
+    if (*lhs == '\0')
+        return FAIL;
+    for (; *lhs != '\0'; node = child, ++lhs)
+        if ((child = get_child(trie, node, *lhs)) == NULL
+                && (child = add_child(trie, node, *lhs)) == NULL)
+        {
+            prune(trie, node);
+            return FAIL;
+        }
+
+    if (node->map != NULL)
+        return FAIL;
+    node->map = map;
+    ++trie->count;
+    return OK;
+}
+
+
+/**
+ * remove a mapping from trie, and free the nodes not used.
+ */
+int map_trie_remove(struct map_trie *trie, struct mapping_key *map)
+{
+    struct map_node *node = find_node(trie, map->key);
+
+    if (node == NULL || node->map != map)
+        return FAIL;
+    node->map = NULL;
+    --trie->count;
+    prune(trie, node);
+    return OK;
+}
+
+
+/**
+ * find the mapping of a lhs.
+ */
+struct mapping_key *map_trie_lookup(struct map_trie *trie, char const *lhs)
+{
+    struct map_node *node = find_node(trie, lhs);
+
+    return node == NULL ? NULL : node->map;
+}
+
+
+/**
+ * get the child of a node.
+ */
+struct map_node *map_trie_next(struct map_trie *trie,
+        struct map_node *node, int byte)
+{
+    return get_child(trie, node, byte & 0xFF);
+}
+
+
+/**
+ * initialize (or reset) a match, nothing is fed.
+ */
+struct map_match *map_match_init(struct map_match *match,
+        struct map_trie *trie)
+{
+    match->trie = trie;
+    match->node = &trie->root;
+    match->len = 0;
+    match->full = NULL;
+    match->full_len = 0;
+    return match;
+}
+
+
+/**
+ * feed a key to a match.
+ */
+int map_match_feed(struct map_match *match, int byte)
+{
+    struct map_node *node = match->node;
+
+    if (node == NULL || (node = get_child(match->trie, node, byte & 0xFF))
+            == NULL)
+    {
+        match->node = NULL;
+        return MAP_NONE;
+    }
+
+    match->node = node;
+    ++match->len;
+    if (node->map == NULL)
+        return MAP_PREFIX;
+    match->full = node->map;
+    match->full_len = match->len;
+    return node->child == NULL ? MAP_FULL : MAP_AMBIGUOUS;
+}
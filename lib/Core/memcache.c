@@ -0,0 +1,972 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <Core/memcache.h>
+#include <Core/swapfile.h>
+#include <System/scan.h>
+
+
+/* the text length of a subtree, sbtree_nil has no text. */
+#define piece_bytes(node) \
+    ((node) == &sbtree_nil ? 0 : MC_PIECE_ENTRY(node)->bytes)
+
+/* the count of counted newlines of a subtree. */
+#define piece_newlines(node) \
+    ((node) == &sbtree_nil ? 0 : MC_PIECE_ENTRY(node)->newlines)
+
+/* the count of pieces that newlines are not counted in a subtree. */
+#define piece_lazy(node) \
+    ((node) == &sbtree_nil ? 0 : MC_PIECE_ENTRY(node)->lazy)
+
+
+/*
+ * recompute the summary of a node from its children, it's the
+ * update function of the piece tree.
+ */
+static void piece_update(struct sbtree_entry *node)
+{
+    struct mc_piece *piece = MC_PIECE_ENTRY(node);
+    int lazy = piece->nl == MC_NPOS;
+
+    piece->bytes = piece_bytes(node->left)
+        + piece_bytes(node->right) + piece->len;
+    piece->newlines = piece_newlines(node->left)
+        + piece_newlines(node->right) + (lazy ? 0 : piece->nl);
+    piece->lazy = piece_lazy(node->left) + piece_lazy(node->right) + lazy;
+}
+
+
+/*
+ * count the newlines of all lazy pieces in a subtree, the summary of
+ * the ancestors of the subtree is not updated.
+ */
+static void piece_index(struct sbtree_entry *node)
+{
+    struct mc_piece *piece = MC_PIECE_ENTRY(node);
+
+    if (node == &sbtree_nil || piece->lazy == 0)
+        return;
+
+    piece_index(node->left);
+    piece_index(node->right);
+    if (piece->nl == MC_NPOS)
+        piece->nl = scan_newlines(piece->text, piece->len);
+    piece_update(node);
+}
+
+
+/*
+ * make sure the newlines of a node and its left subtree are counted,
+ * so the line number before the end of the node is known.
+ */
+static void piece_index_left(struct sbtree_entry *node)
+{
+    struct mc_piece *piece = MC_PIECE_ENTRY(node);
+
+    if (piece_lazy(node->left) == 0 && piece->nl != MC_NPOS)
+        return;
+
+    piece_index(node->left);
+    if (piece->nl == MC_NPOS)
+        piece->nl = scan_newlines(piece->text, piece->len);
+    sbtree_aug_propagate(node, piece_update);
+}
+
+
+/*
+ * the newlines of a piece after len bytes removed from the piece at
+ * text, or #MC_NPOS if the piece is lazy.
+ */
+static size_t piece_nl_remove(struct mc_piece *piece,
+        char const *text, size_t len)
+{
+    if (piece->nl == MC_NPOS)
+        return MC_NPOS;
+    return piece->nl - scan_newlines(text, len);
+}
+
+
+/*
+ * link a new piece into the tree, just before or after the given
+ * piece, or as root if pos is NULL.
+ */
+static void piece_link(struct memcache *mc, struct mc_piece *pos,
+        struct mc_piece *piece, int after)
+{
+    sbtree_aug_link(&mc->root, pos == NULL ? &sbtree_nil : &pos->node,
+            &piece->node, after, piece_update);
+}
+
+
+/*
+ * change the text of a piece, nl is the newlines of the new text.
+ */
+static void piece_resize(struct mc_piece *piece,
+        char const *text, size_t len, size_t nl)
+{
+    piece->text = text;
+    piece->len = len;
+    piece->nl = nl;
+    sbtree_aug_propagate(&piece->node, piece_update);
+}
+
+
+/*
+ * alloc a new piece. if nl is #MC_NPOS, the piece is lazy, and its
+ * newlines will be counted when needed.
+ */
+static struct mc_piece *piece_alloc(struct memcache *mc,
+        char const *text, size_t len, size_t nl)
+{
+    struct mc_piece *piece = fixed_acquire(mc->piece_alloc);
+
+    if (piece == NULL)
+        return NULL;
+
+    sbtree_init(&piece->node);
+    piece->text = text;
+    piece->len = len;
+    piece->nl = nl;
+    piece_update(&piece->node);
+    return piece;
+}
+
+
+/*
+ * split a piece at in, the piece keeps the text before in, and return
+ * the new piece contains the text after in, it is linked after the
+ * piece. only the shorter part is scanned for newlines, and nothing
+ * is scanned if the piece is lazy.
+ */
+static struct mc_piece *piece_split(struct memcache *mc,
+        struct mc_piece *piece, size_t in)
+{
+    struct mc_piece *tail;
+    size_t nl;
+
+    if (piece->nl == MC_NPOS)
+        nl = MC_NPOS;
+    else if (in <= piece->len / 2)
+        nl = piece->nl - scan_newlines(piece->text, in);
+    else
+        nl = scan_newlines(piece->text + in, piece->len - in);
+
+    tail = piece_alloc(mc, piece->text + in, piece->len - in, nl);
+    if (tail == NULL)
+        return NULL;
+
+    piece_resize(piece, piece->text, in,
+            nl == MC_NPOS ? MC_NPOS : piece->nl - nl);
+    piece_link(mc, piece, tail, TRUE);
+    return tail;
+}
+
+
+/*
+ * find the piece contains offset. if offset is zero, return the first
+ * piece, and set *pin to zero, or return the piece contains the byte
+ * just before offset, and *pin is the offset in the piece, that is
+ * in (0, len]. return NULL if memcache is empty.
+ */
+static struct mc_piece *piece_locate(struct memcache *mc,
+        size_t offset, size_t *pin)
+{
+    struct sbtree_entry *node = mc->root;
+
+    if (node == &sbtree_nil)
+        return NULL;
+
+    if (offset == 0)
+    {
+        *pin = 0;
+        return MC_PIECE_ENTRY(sbtree_get_min(node));
+    }
+
+    for (;;)
+    {
+        size_t left_bytes = piece_bytes(node->left);
+        struct mc_piece *piece = MC_PIECE_ENTRY(node);
+
+        if (offset <= left_bytes)
+            node = node->left;
+        else if (offset <= left_bytes + piece->len)
+        {
+            *pin = offset - left_bytes;
+            return piece;
+        }
+        else
+        {
+            offset -= left_bytes + piece->len;
+            node = node->right;
+        }
+    }
+}
+
+
+/*
+ * whether the text of a piece ends at the end of the newest add
+ * block, so text can be appended to the piece in place.
+ */
+static int piece_is_tail(struct memcache *mc, struct mc_piece *piece)
+{
+    return mc->blocks != NULL
+        && piece->text + piece->len == mc->blocks->text + mc->blocks->used;
+}
+
+
+/*
+ * store text into add blocks. return the pointer to stored text, and
+ * set *plen the length stored, it's less than len if there is no
+ * enough room in the block.
+ */
+static char const *block_store(struct memcache *mc,
+        char const *text, size_t len, size_t *plen)
+{
+    struct mc_block *block = mc->blocks;
+    char *stored;
+
+    if (block == NULL || block->used == MC_BLOCK_SIZE)
+    {
+        block = vime_malloc(offsetof(struct mc_block, text)
+                + MC_BLOCK_SIZE);
+        if (block == NULL)
+            return NULL;
+        block->next = mc->blocks;
+        block->used = 0;
+        mc->blocks = block;
+    }
+
+    if (len > MC_BLOCK_SIZE - block->used)
+        len = MC_BLOCK_SIZE - block->used;
+    if (len > MC_PIECE_MAX)
+        len = MC_PIECE_MAX;
+
+    stored = &block->text[block->used];
+    memcpy(stored, text, len);
+    block->used += len;
+    *plen = len;
+    return stored;
+}
+
+
+/*
+ * free all pieces in the tree.
+ */
+static void piece_free_all(struct memcache *mc)
+{
+    struct sbtree_entry *node = mc->root, *parent;
+
+    /* post-order walk, free a node after its children. */
+    while (node != &sbtree_nil)
+    {
+        if (node->left != &sbtree_nil)
+            node = node->left;
+        else if (node->right != &sbtree_nil)
+            node = node->right;
+        else
+        {
+            parent = node->parent;
+            if (parent != &sbtree_nil)
+            {
+                if (parent->left == node)
+                    parent->left = &sbtree_nil;
+                else
+                    parent->right = &sbtree_nil;
+            }
+            fixed_release(mc->piece_alloc, MC_PIECE_ENTRY(node));
+            node = parent;
+        }
+    }
+
+    mc->root = &sbtree_nil;
+}
+
+
+/**
+ * initialize a memcache.
+ */
+struct memcache *mc_init(struct memcache *mc)
+{
+    mc->root = &sbtree_nil;
+    mc->blocks = NULL;
+    mc->loaded = NULL;
+    mc->file.base = NULL;
+    mc->file.size = 0;
+    mc->file.handle = NULL;
+    mc->file.fd = -1;
+    itree_init(&mc->marks);
+    mc->swap = NULL;
+    mc->piece_alloc = fixed_alloc(sizeof(struct mc_piece),
+            MC_BLOCK_SIZE / sizeof(struct mc_piece));
+    return mc->piece_alloc == NULL ? NULL : mc;
+}
+
+
+/**
+ * destroy a memcache.
+ */
+void mc_drop(struct memcache *mc)
+{
+    struct mc_block *block, *next;
+
+    piece_free_all(mc);
+    for (block = mc->blocks; block != NULL; block = next)
+    {
+        next = block->next;
+        vime_free(block);
+    }
+    mc->blocks = NULL;
+    for (block = mc->loaded; block != NULL; block = next)
+    {
+        next = block->next;
+        vime_free(block);
+    }
+    mc->loaded = NULL;
+
+    fixed_free(mc->piece_alloc);
+    mc->piece_alloc = NULL;
+    fmap_close(&mc->file);
+    itree_init(&mc->marks);
+}
+
+
+/**
+ * load the original text into a empty memcache.
+ */
+int mc_load(struct memcache *mc, char const *text, size_t len)
+{
+    struct mc_piece *last = NULL, *piece;
+    size_t n;
+
+    assert(mc->root == &sbtree_nil);
+
+    for (; len != 0; text += n, len -= n)
+    {
+        n = len < MC_PIECE_MAX ? len : MC_PIECE_MAX;
+        if ((piece = piece_alloc(mc, text, n, MC_NPOS)) == NULL)
+        {
+            piece_free_all(mc);
+            return FAIL;
+        }
+
+        piece_link(mc, last, piece, TRUE);
+        last = piece;
+    }
+
+    return OK;
+}
+
+
+/**
+ * map a file into a empty memcache as the original text.
+ */
+int mc_open(struct memcache *mc, char const *name)
+{
+    assert(mc->root == &sbtree_nil && mc->file.base == NULL);
+
+    if (fmap_open(&mc->file, name) == FAIL)
+        return FAIL;
+
+    if (mc_load(mc, mc->file.base, mc->file.size) == FAIL)
+    {
+        fmap_close(&mc->file);
+        return FAIL;
+    }
+
+    return OK;
+}
+
+
+/**
+ * insert text into memcache without copying it.
+ */
+int mc_attach(struct memcache *mc, size_t offset,
+        char const *text, size_t len, size_t nl)
+{
+    struct mc_piece *piece, *new_piece;
+    size_t in = 0, n, left = len;
+    int ret = OK;
+
+    if (offset > mc_size(mc))
+        return FAIL;
+    if (len > MC_PIECE_MAX)
+        nl = MC_NPOS;
+
+    piece = piece_locate(mc, offset, &in);
+    if (len != 0 && piece != NULL && in != 0 && in < piece->len
+            && piece_split(mc, piece, in) == NULL)
+        return FAIL;
+
+    for (; left != 0; text += n, left -= n)
+    {
+        n = left < MC_PIECE_MAX ? left : MC_PIECE_MAX;
+        if ((new_piece = piece_alloc(mc, text, n, nl)) == NULL)
+        {
+            ret = FAIL;
+            break;
+        }
+
+        piece_link(mc, piece, new_piece, in != 0);
+        piece = new_piece;
+        in = n;
+    }
+
+    if (left != len)
+    {
+        itree_adjust(&mc->marks, offset, 0, len - left);
+        if (mc->swap != NULL)
+            swp_attach(mc->swap, offset, text - (len - left), len - left);
+    }
+    return ret;
+}
+
+
+/**
+ * give a block of original text to memcache.
+ */
+void mc_adopt(struct memcache *mc, struct mc_block *block)
+{
+    block->next = mc->loaded;
+    mc->loaded = block;
+}
+
+
+/*
+ * whether a piece is the original text in the mapped file.
+ */
+static int piece_is_mapped(struct memcache *mc, struct mc_piece *piece)
+{
+    return mc->file.base != NULL && piece->text >= mc->file.base
+        && piece->text < mc->file.base + mc->file.size;
+}
+
+
+/*
+ * map the file just saved from memcache, and move all pieces into it,
+ * the text is the same. the replaced original file is unmapped, so
+ * its space is freed.
+ */
+static int remap(struct memcache *mc, char const *name)
+{
+    struct fmap file = FMAP_INIT;
+    struct sbtree_entry *node;
+    struct mc_piece *piece;
+    size_t offset = 0;
+
+    if (fmap_open(&file, name) == FAIL)
+        return FAIL;
+    if (file.size != mc_size(mc))
+    {
+        fmap_close(&file);
+        return FAIL;
+    }
+
+    node = mc->root == &sbtree_nil ? &sbtree_nil : sbtree_get_min(mc->root);
+    for (; node != &sbtree_nil; node = sbtree_get_succ(node))
+    {
+        piece = MC_PIECE_ENTRY(node);
+        piece->text = file.base + offset;
+        offset += piece->len;
+    }
+
+    fmap_close(&mc->file);
+    mc->file = file;
+    return OK;
+}
+
+
+/**
+ * write all text of memcache into a file, atomically.
+ */
+int mc_save(struct memcache *mc, char const *name)
+{
+    struct fsave fs;
+    struct sbtree_entry *node;
+    struct mc_piece *piece;
+    char const *run = NULL;
+    size_t len = 0;
+    int retv = OK, replace = fmap_same(&mc->file, name);
+
+    if (fsave_open(&fs, name) == FAIL)
+        return FAIL;
+
+    node = mc->root == &sbtree_nil ? &sbtree_nil : sbtree_get_min(mc->root);
+    for (; node != &sbtree_nil && retv == OK; node = sbtree_get_succ(node))
+    {
+        piece = MC_PIECE_ENTRY(node);
+
+        /* the adjacent pieces of mapped text are copied at once. */
+        if (run != NULL && run + len == piece->text
+                && piece_is_mapped(mc, piece))
+        {
+            len += piece->len;
+            continue;
+        }
+
+        if (run != NULL)
+            retv = fsave_copy(&fs, &mc->file, run - mc->file.base, len);
+        run = NULL;
+
+        if (piece_is_mapped(mc, piece))
+        {
+            run = piece->text;
+            len = piece->len;
+        }
+        else if (retv == OK)
+            retv = fsave_write(&fs, piece->text, piece->len);
+    }
+
+    if (retv == OK && run != NULL)
+        retv = fsave_copy(&fs, &mc->file, run - mc->file.base, len);
+    if (retv == FAIL)
+    {
+        fsave_abort(&fs);
+        return FAIL;
+    }
+    if (fsave_commit(&fs) == FAIL)
+        return FAIL;
+
+    /* the offsets of the old file in swapfile are wrong now. */
+    if (replace)
+    {
+        remap(mc, name);
+        if (mc->swap != NULL)
+            swp_saved(mc->swap);
+    }
+    return OK;
+}
+
+
+/**
+ * get the text length of the memcache.
+ */
+size_t mc_size(struct memcache const *mc)
+{
+    return piece_bytes(mc->root);
+}
+
+
+/*
+ * insert text into the piece tree, *plen is the length of text, and
+ * the length of text not inserted is stored back.
+ */
+static int text_insert(struct memcache *mc, size_t offset,
+        char const *text, size_t *plen)
+{
+    struct mc_piece *piece, *new_piece;
+    char const *stored;
+    size_t in = 0, n;
+
+    piece = piece_locate(mc, offset, &in);
+
+    /* typing at the end of the newest text: just grow the piece. */
+    if (piece != NULL && in == piece->len && piece_is_tail(mc, piece)
+            && piece->len < MC_PIECE_MAX
+            && mc->blocks->used < MC_BLOCK_SIZE)
+    {
+        n = MC_PIECE_MAX - piece->len;
+        if (n > *plen)
+            n = *plen;
+        if ((stored = block_store(mc, text, n, &n)) == NULL)
+            return FAIL;
+        piece_resize(piece, piece->text, piece->len + n,
+                piece->nl + scan_newlines(stored, n));
+        in = piece->len;
+        text += n;
+        *plen -= n;
+    }
+
+    /* insert in the middle of a piece: split it. */
+    if (*plen != 0 && piece != NULL && in != 0 && in < piece->len
+            && piece_split(mc, piece, in) == NULL)
+        return FAIL;
+
+    while (*plen != 0)
+    {
+        if ((stored = block_store(mc, text, *plen, &n)) == NULL
+                || (new_piece = piece_alloc(mc, stored, n,
+                        scan_newlines(stored, n)))
+                    == NULL)
+            return FAIL;
+
+        piece_link(mc, piece, new_piece, in != 0);
+
+        piece = new_piece;
+        in = n;
+        text += n;
+        *plen -= n;
+    }
+
+    return OK;
+}
+
+
+/**
+ * insert text into memcache.
+ */
+int mc_insert(struct memcache *mc, size_t offset,
+        char const *text, size_t len)
+{
+    size_t left = len;
+    int ret;
+
+    if (offset > mc_size(mc))
+        return FAIL;
+    if (len == 0)
+        return OK;
+
+    /* the marks are moved by the text inserted, even if failed. */
+    ret = text_insert(mc, offset, text, &left);
+    if (left != len)
+    {
+        itree_adjust(&mc->marks, offset, 0, len - left);
+        if (mc->swap != NULL)
+            swp_insert(mc->swap, offset, text, len - left);
+    }
+    return ret;
+}
+
+
+/*
+ * delete text from the piece tree, *plen is the length of text to
+ * delete, and the length of text not deleted is stored back.
+ */
+static int text_delete(struct memcache *mc, size_t offset, size_t *plen)
+{
+    struct mc_piece *piece;
+    size_t in = 0, n, len = *plen;
+
+    while ((*plen = len) != 0)
+    {
+        /* in is the offset of the first deleted byte in the piece, the
+         * range is checked by caller, so the piece is always found. */
+        piece = piece_locate(mc, offset + 1, &in);
+        assert(piece != NULL && in != 0);
+        --in;
+
+        if (in == 0 && piece->len <= len)
+        {
+            len -= piece->len;
+            sbtree_aug_remove(&mc->root, &piece->node, piece_update);
+            fixed_release(mc->piece_alloc, piece);
+        }
+        else if (in == 0)
+        {
+            piece_resize(piece, piece->text + len, piece->len - len,
+                    piece_nl_remove(piece, piece->text, len));
+            len = 0;
+        }
+        else if (in + len >= piece->len)
+        {
+            n = piece->len - in;
+            piece_resize(piece, piece->text, in,
+                    piece_nl_remove(piece, piece->text + in, n));
+            len -= n;
+        }
+        else
+        {
+            if ((piece = piece_split(mc, piece, in)) == NULL)
+                return FAIL;
+            piece_resize(piece, piece->text + len, piece->len - len,
+                    piece_nl_remove(piece, piece->text, len));
+            len = 0;
+        }
+    }
+
+    return OK;
+}
+
+
+/**
+ * delete text from memcache.
+ */
+int mc_delete(struct memcache *mc, size_t offset, size_t len)
+{
+    size_t left = len;
+    int ret;
+
+    if (offset > mc_size(mc) || len > mc_size(mc) - offset)
+        return FAIL;
+
+    /* the marks are moved by the text deleted, even if failed. */
+    ret = text_delete(mc, offset, &left);
+    if (left != len)
+    {
+        itree_adjust(&mc->marks, offset, len - left, 0);
+        if (mc->swap != NULL)
+            swp_delete(mc->swap, offset, len - left);
+    }
+    return ret;
+}
+
+
+/**
+ * replace a range of text in memcache.
+ */
+int mc_replace(struct memcache *mc, size_t offset, size_t len,
+        char const *text, size_t textlen)
+{
+    if (mc_delete(mc, offset, len) == FAIL)
+        return FAIL;
+    return mc_insert(mc, offset, text, textlen);
+}
+
+
+/**
+ * read text from memcache.
+ */
+size_t mc_read(struct memcache *mc, size_t offset,
+        char *buf, size_t buflen)
+{
+    struct sbtree_entry *node;
+    struct mc_piece *piece;
+    size_t in, n, copied = 0;
+
+    if (offset >= mc_size(mc) || buflen == 0)
+        return 0;
+
+    piece = piece_locate(mc, offset + 1, &in);
+    --in;
+
+    for (node = &piece->node; node != &sbtree_nil && copied < buflen;
+            node = sbtree_get_succ(node), in = 0)
+    {
+        piece = MC_PIECE_ENTRY(node);
+        n = piece->len - in;
+        if (n > buflen - copied)
+            n = buflen - copied;
+        memcpy(buf + copied, piece->text + in, n);
+        copied += n;
+    }
+
+    return copied;
+}
+
+
+/**
+ * get the text at the offset without copy.
+ */
+char const *mc_chunk(struct memcache *mc, size_t offset, size_t *plen)
+{
+    struct mc_piece *piece;
+    size_t in;
+
+    if (offset >= mc_size(mc))
+        return NULL;
+
+    piece = piece_locate(mc, offset + 1, &in);
+    --in;
+    *plen = piece->len - in;
+    return piece->text + in;
+}
+
+
+/**
+ * get the count of lines in memcache.
+ */
+size_t mc_line_count(struct memcache *mc)
+{
+    piece_index(mc->root);
+    return piece_newlines(mc->root) + 1;
+}
+
+
+/*
+ * find the offset of a line in a subtree, *plnum is the count of
+ * newlines before the line in the subtree, at least 1. lazy pieces
+ * are counted in order until the line is found, so only the text
+ * before the line is scanned. return the offset from the beginning
+ * of the subtree, or #MC_NPOS if the line is not in the subtree, and
+ * *plnum is decreased by the newlines of the subtree.
+ */
+static size_t piece_line_offset(struct sbtree_entry *node, size_t *plnum)
+{
+    struct mc_piece *piece = MC_PIECE_ENTRY(node);
+    size_t offset;
+
+    if (node == &sbtree_nil)
+        return MC_NPOS;
+
+    if (piece->lazy == 0 && *plnum > piece->newlines)
+    {
+        *plnum -= piece->newlines;
+        return MC_NPOS;
+    }
+
+    offset = piece_line_offset(node->left, plnum);
+    if (offset == MC_NPOS)
+    {
+        if (piece->nl == MC_NPOS)
+            piece->nl = scan_newlines(piece->text, piece->len);
+
+        if (*plnum <= piece->nl)
+            offset = piece_bytes(node->left) + 1
+                + scan_nth_newline(piece->text, piece->len, *plnum);
+        else
+        {
+            *plnum -= piece->nl;
+            offset = piece_line_offset(node->right, plnum);
+            if (offset != MC_NPOS)
+                offset += piece_bytes(node->left) + piece->len;
+        }
+    }
+
+    /* the pieces counted in the subtree changed the summary. */
+    piece_update(node);
+    return offset;
+}
+
+
+/**
+ * get the offset of a line.
+ */
+size_t mc_line_offset(struct memcache *mc, size_t lnum)
+{
+    /* line lnum begins just after the lnum-th newline. */
+    return lnum == 0 ? 0 : piece_line_offset(mc->root, &lnum);
+}
+
+
+/**
+ * get the line contains a offset.
+ */
+size_t mc_offset_line(struct memcache *mc, size_t offset)
+{
+    struct sbtree_entry *node = mc->root;
+    size_t lnum = 0;
+
+    if (offset > mc_size(mc))
+        return MC_NPOS;
+
+    /* the line number is the count of newlines before offset. */
+    while (node != &sbtree_nil)
+    {
+        size_t left_bytes = piece_bytes(node->left);
+        struct mc_piece *piece = MC_PIECE_ENTRY(node);
+
+        if (offset <= left_bytes)
+        {
+            node = node->left;
+            continue;
+        }
+
+        piece_index_left(node);
+        if (offset <= left_bytes + piece->len)
+            return lnum + piece_newlines(node->left)
+                + scan_newlines(piece->text, offset - left_bytes);
+        else
+        {
+            lnum += piece_newlines(node->left) + piece->nl;
+            offset -= left_bytes + piece->len;
+            node = node->right;
+        }
+    }
+
+    return lnum;
+}
+
+
+/**
+ * get the length of a line, not include the newline.
+ */
+size_t mc_line_length(struct memcache *mc, size_t lnum)
+{
+    size_t begin = mc_line_offset(mc, lnum), end;
+
+    if (begin == MC_NPOS)
+        return MC_NPOS;
+
+    end = mc_line_offset(mc, lnum + 1);
+    return end == MC_NPOS ? mc_size(mc) - begin : end - begin - 1;
+}
+
+
+/**
+ * add a mark at a offset.
+ */
+int mc_mark_add(struct memcache *mc, struct mc_mark *mark, size_t offset)
+{
+    if (offset > mc_size(mc))
+        return FAIL;
+
+    itree_insert(&mc->marks, &mark->entry, offset, offset);
+    return OK;
+}
+
+
+/**
+ * remove a mark from memcache.
+ */
+void mc_mark_remove(struct memcache *mc, struct mc_mark *mark)
+{
+    itree_remove(&mc->marks, &mark->entry);
+}
+
+
+/**
+ * get the offset of a mark.
+ */
+size_t mc_mark_offset(struct mc_mark const *mark)
+{
+    return itree_start(&mark->entry);
+}
+
+
+/**
+ * get the count of marks in memcache.
+ */
+size_t mc_mark_count(struct memcache const *mc)
+{
+    return itree_size(&mc->marks);
+}
+
+
+/**
+ * get the mark of a rank.
+ */
+struct mc_mark *mc_mark_select(struct memcache *mc, size_t rank)
+{
+    struct sbtree_entry *node;
+
+    if (rank >= itree_size(&mc->marks))
+        return NULL;
+    node = sbtree_select(mc->marks.root, (int)rank);
+    return MC_MARK_ENTRY(ITREE_NODE(node), struct mc_mark, entry);
+}
+
+
+/**
+ * get the rank of a mark.
+ */
+size_t mc_mark_rank(struct mc_mark *mark)
+{
+    return (size_t)sbtree_rank(&mark->entry.node);
+}
+
+
+/**
+ * find the first mark at or after a offset.
+ */
+struct mc_mark *mc_mark_find(struct memcache *mc, size_t offset)
+{
+    struct sbtree_entry *node;
+    size_t start;
+
+    node = itree_lower_bound(&mc->marks, offset, &start);
+    return node == &sbtree_nil ? NULL
+        : MC_MARK_ENTRY(ITREE_NODE(node), struct mc_mark, entry);
+}
+
+
+/**
+ * get the next mark in the order of offset.
+ */
+struct mc_mark *mc_mark_next(struct mc_mark *mark)
+{
+    struct sbtree_entry *node = sbtree_get_succ(&mark->entry.node);
+
+    return node == &sbtree_nil ? NULL
+        : MC_MARK_ENTRY(ITREE_NODE(node), struct mc_mark, entry);
+}
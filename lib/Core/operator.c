@@ -0,0 +1,161 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <Core/operator.h>
+#include <System/mem.h>
+
+
+/* the hash of a command, spread the bits with the golden ratio. */
+#define cmd_hash(command) ((hash_t)(unsigned)(command) * 0x9E3779B1UL)
+
+/* whether a command is found in the flat array. */
+#define cmd_is_fast(command) \
+    ((unsigned)(command) < (unsigned)OP_FAST_MAX)
+
+
+/*
+ * compare the commands of cmd_ht.
+ */
+static int cmd_compare(void const *lhs, void const *rhs)
+{
+    return *(int const*)lhs != *(int const*)rhs;
+}
+
+
+/**
+ * alloc a new operator table.
+ */
+struct op_table *op_table_alloc(void)
+{
+    struct op_table *table = vime_malloc(sizeof(struct op_table));
+
+    return table == NULL ? NULL : op_table_init(table);
+}
+
+
+/**
+ * free a alloced operator table.
+ */
+void op_table_free(struct op_table *table)
+{
+    op_table_drop(table);
+    vime_free(table);
+}
+
+
+/**
+ * initialize a operator table.
+ */
+struct op_table *op_table_init(struct op_table *table)
+{
+    static struct op_table const init = OP_INIT;
+
+    *table = init;
+    ht_init(&table->cmd_ht);
+    ht_init(&table->name_ht);
+    return table;
+}
+
+
+/**
+ * drop a operator table.
+ */
+void op_table_drop(struct op_table *table)
+{
+    ht_drop(&table->cmd_ht);
+    ht_drop(&table->name_ht);
+    hook_drop(&table->default_hook);
+    hook_drop(&table->remain_hook);
+    op_table_init(table);
+}
+
+
+/**
+ * add a operator into table.
+ */
+int op_add(struct op_table *table, struct op_entry *op)
+{
+    op->cmd_node.key = &op->command;
+    op->cmd_node.hash = cmd_hash(op->command);
+    if (op_lookup(table, op->command) != NULL
+            || (op->name != NULL && op_find(table, op->name) != NULL))
+        return FAIL;
+
+    if (ht_set(&table->cmd_ht, &op->cmd_node, cmd_compare) != &op->cmd_node)
+        return FAIL;
+    if (op->name != NULL)
+    {
+        op->name_node.key = op->name;
+        if (ht_insert(&table->name_ht, &op->name_node) != &op->name_node)
+        {
+            ht_remove(&table->cmd_ht, &op->command);
+            return FAIL;
+        }
+    }
+
+    if (cmd_is_fast(op->command))
+        table->fast[op->command] = op;
+    return OK;
+}
+
+
+/**
+ * remove a operator from table.
+ */
+void op_remove(struct op_table *table, struct op_entry *op)
+{
+    hashitem_t *item;
+
+    item = ht_entry(&table->cmd_ht, &op->command, op->cmd_node.hash,
+            cmd_compare);
+    if (item != NULL && !hi_is_empty(*item))
+        ht_del(&table->cmd_ht, item);
+    if (op->name != NULL)
+        ht_remove(&table->name_ht, op->name);
+    if (cmd_is_fast(op->command))
+        table->fast[op->command] = NULL;
+}
+
+
+/**
+ * find the operator of a command.
+ */
+struct op_entry *op_lookup(struct op_table *table, int command)
+{
+    struct hash_entry *entry;
+
+    if (cmd_is_fast(command))
+        return table->fast[command];
+
+    entry = ht_get(&table->cmd_ht, &command, cmd_hash(command),
+            cmd_compare);
+    return entry == NULL ? NULL : OP_CMD_ENTRY(entry);
+}
+
+
+/**
+ * find the operator of a name.
+ */
+struct op_entry *op_find(struct op_table *table, char const *name)
+{
+    struct hash_entry *entry = ht_lookup(&table->name_ht, name);
+
+    return entry == NULL ? NULL : OP_NAME_ENTRY(entry);
+}
+
+
+/**
+ * exec a operaotr.
+ */
+int op_exec(struct op_table *table, int command)
+{
+    struct op_entry *op = op_lookup(table, command);
+    int retv;
+
+    if (op != NULL && op->action.hook_list != NULL
+            && (retv = hook_call(&op->action, HF_DEFAULT, &command)) == OK)
+        return retv;
+    return hook_call(&table->default_hook, HF_DEFAULT, &command);
+}
@@ -0,0 +1,688 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+/*
+ * the implement of VimE swapfile.
+ */
+
+
+#include <stdio.h>
+#include <Core/swapfile.h>
+
+
+/* the max length of a varint. */
+#define VARINT_MAX  10
+
+/* the max length of the numbers in a record. */
+#define NUMS_MAX    (4 * VARINT_MAX)
+
+/* the max length of the head of a record, i.e. the type and length. */
+#define HEAD_MAX    (1 + VARINT_MAX)
+
+/* the length of the crc32 of a record. */
+#define CRC_LEN     4
+
+/* the kind of checkpoint items, the original text or the text. */
+#define ITEM_ORIGINAL   0
+#define ITEM_TEXT       1
+
+
+/*
+ * a record read from swapfile.
+ */
+struct record
+{
+    int type;                       /* the type of record. */
+    unsigned char const *payload;   /* the payload. */
+    size_t len;                     /* the length of payload. */
+};
+
+
+/* the crc32 table, it's computed at the first use. */
+static uint32_t crc_table[256];
+
+
+/*
+ * update the crc32 of data, the crc begins with ~0, and is inverted at
+ * the end.
+ */
+static uint32_t crc_update(uint32_t crc, void const *data, size_t len)
+{
+    unsigned char const *p = data;
+    uint32_t c;
+    int i, k;
+
+    if (crc_table[1] == 0)
+        for (i = 0; i < 256; ++i)
+        {
+            for (c = i, k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            crc_table[i] = c;
+        }
+
+    while (len-- != 0)
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+
+/*
+ * encode a varint, return its length.
+ */
+static size_t put_varint(unsigned char *p, uint64_t n)
+{
+    size_t len = 0;
+
+    for (; n >= 0x80; n >>= 7)
+        p[len++] = (unsigned char)(n | 0x80);
+    p[len++] = (unsigned char)n;
+    return len;
+}
+
+
+/*
+ * decode a varint before end, and move *pp after it.
+ */
+static int get_varint(unsigned char const **pp, unsigned char const *end,
+        size_t *pn)
+{
+    unsigned char const *p = *pp;
+    uint64_t n = 0;
+    int shift;
+
+    for (shift = 0; p < end && shift < 64; shift += 7)
+    {
+        n |= (uint64_t)(*p & 0x7F) << shift;
+        if ((*p++ & 0x80) == 0)
+        {
+            if (n > (size_t)-1)
+                return FAIL;
+            *pp = p;
+            *pn = (size_t)n;
+            return OK;
+        }
+    }
+    return FAIL;
+}
+
+
+/*
+ * copy a string.
+ */
+static char *str_dup(char const *str)
+{
+    size_t len = strlen(str) + 1;
+    char *dup = vime_malloc(len);
+
+    if (dup != NULL)
+        memcpy(dup, str, len);
+    return dup;
+}
+
+
+/*
+ * whether the text is the original text, i.e. it's in the mapped
+ * original file named in the header.
+ */
+static int is_original(struct swapfile *sw, char const *text)
+{
+    struct fmap const *file = &sw->mc->file;
+
+    return sw->orig != NULL && file->base != NULL && text >= file->base
+        && text < file->base + file->size;
+}
+
+
+/*
+ * write the head of a record, and begin the crc. return the length of
+ * head, or 0 if write failed.
+ */
+static size_t put_head(struct stream *s, int type, size_t len,
+        uint32_t *pcrc)
+{
+    unsigned char head[HEAD_MAX];
+    size_t n;
+
+    head[0] = (unsigned char)type;
+    n = 1 + put_varint(head + 1, len);
+    *pcrc = crc_update(~(uint32_t)0, head, n);
+    return stream_write(s, head, n) == OK ? n : 0;
+}
+
+
+/*
+ * write the crc at the end of a record.
+ */
+static int put_crc(struct stream *s, uint32_t crc)
+{
+    unsigned char tail[CRC_LEN];
+
+    crc = ~crc;
+    tail[0] = (unsigned char)crc;
+    tail[1] = (unsigned char)(crc >> 8);
+    tail[2] = (unsigned char)(crc >> 16);
+    tail[3] = (unsigned char)(crc >> 24);
+    return stream_write(s, tail, CRC_LEN);
+}
+
+
+/*
+ * write a record, the payload is the numbers encoded, and the text.
+ * return the length of record, or 0 if write failed.
+ */
+static size_t put_record(struct stream *s, int type,
+        unsigned char const *nums, size_t numlen,
+        char const *text, size_t len)
+{
+    uint32_t crc;
+    size_t n;
+
+    if ((n = put_head(s, type, numlen + len, &crc)) == 0
+            || stream_write(s, nums, numlen) == FAIL
+            || (len != 0 && stream_write(s, text, len) == FAIL))
+        return 0;
+    crc = crc_update(crc_update(crc, nums, numlen), text, len);
+    if (put_crc(s, crc) == FAIL)
+        return 0;
+    return n + numlen + len + CRC_LEN;
+}
+
+
+/*
+ * append a record into the log.
+ */
+static int log_record(struct swapfile *sw, int type,
+        unsigned char const *nums, size_t numlen,
+        char const *text, size_t len)
+{
+    size_t n;
+
+    /* the records after a lost one can't be replayed. */
+    if (stream_error(&sw->stream))
+        return FAIL;
+
+    n = put_record(&sw->stream, type, nums, numlen, text, len);
+    sw->logged += n;
+    return n == 0 ? FAIL : OK;
+}
+
+
+/*
+ * write a item of checkpoint, the run of text, into s, or only count
+ * its length if s is NULL. return the length of item.
+ */
+static size_t put_item(struct swapfile *sw, struct stream *s,
+        uint32_t *pcrc, char const *text, size_t len)
+{
+    unsigned char nums[NUMS_MAX];
+    size_t n;
+    int orig = is_original(sw, text);
+
+    n = put_varint(nums, (uint64_t)len << 1
+            | (orig ? ITEM_ORIGINAL : ITEM_TEXT));
+    if (orig)
+        n += put_varint(nums + n, text - sw->mc->file.base);
+
+    if (s != NULL)
+    {
+        *pcrc = crc_update(*pcrc, nums, n);
+        stream_write(s, nums, n);
+        if (!orig)
+        {
+            *pcrc = crc_update(*pcrc, text, len);
+            stream_write(s, text, len);
+        }
+    }
+    return n + (orig ? 0 : len);
+}
+
+
+/*
+ * walk the pieces of memcache as the items of checkpoint, the adjacent
+ * pieces of the same kind are merged. the items are written into s, or
+ * only counted if s is NULL. return the length of items.
+ */
+static size_t put_items(struct swapfile *sw, struct stream *s,
+        uint32_t *pcrc)
+{
+    struct memcache *mc = sw->mc;
+    struct sbtree_entry *node;
+    struct mc_piece *piece;
+    char const *run = NULL;
+    size_t len = 0, total = 0;
+
+    node = mc->root == &sbtree_nil ? &sbtree_nil : sbtree_get_min(mc->root);
+    for (; node != &sbtree_nil; node = sbtree_get_succ(node))
+    {
+        piece = MC_PIECE_ENTRY(node);
+        if (run != NULL && run + len == piece->text
+                && is_original(sw, run) == is_original(sw, piece->text))
+        {
+            len += piece->len;
+            continue;
+        }
+
+        if (run != NULL)
+            total += put_item(sw, s, pcrc, run, len);
+        run = piece->text;
+        len = piece->len;
+    }
+
+    if (run != NULL)
+        total += put_item(sw, s, pcrc, run, len);
+    return total;
+}
+
+
+/*
+ * write the beginning of swapfile into s: the magic, the header, and
+ * the checkpoint of current text. the size of checkpoint is stored
+ * into sw->checkpoint.
+ */
+static int put_file(struct swapfile *sw, struct stream *s)
+{
+    struct memcache *mc = sw->mc;
+    unsigned char nums[NUMS_MAX];
+    char const *orig = sw->orig != NULL && mc->file.base != NULL
+        ? sw->orig : "";
+    struct fmap_id id = {0, 0, 0};
+    size_t n, len, head, size;
+    uint32_t crc;
+
+    /* the header: the size and identity of the original file mapped,
+     * and its name. */
+    if (*orig != '\0')
+        fmap_id(&mc->file, &id);
+    n = put_varint(nums, *orig == '\0' ? 0 : mc->file.size);
+    n += put_varint(nums + n, id.dev);
+    n += put_varint(nums + n, id.ino);
+    n += put_varint(nums + n, id.mtime);
+    if (stream_write(s, SWP_MAGIC, SWP_MAGIC_LEN) == FAIL
+            || (size = put_record(s, SWP_HEADER, nums, n,
+                    orig, strlen(orig))) == 0)
+        return FAIL;
+
+    /* the checkpoint is counted before written, the length is first. */
+    n = put_varint(nums, mc_size(mc));
+    len = n + put_items(sw, NULL, NULL);
+    if ((head = put_head(s, SWP_CHECKPOINT, len, &crc)) == 0
+            || stream_write(s, nums, n) == FAIL)
+        return FAIL;
+    crc = crc_update(crc, nums, n);
+    put_items(sw, s, &crc);
+    if (put_crc(s, crc) == FAIL || stream_error(s))
+        return FAIL;
+
+    sw->checkpoint = SWP_MAGIC_LEN + size + head + len + CRC_LEN;
+    sw->logged = 0;
+    return OK;
+}
+
+
+/**
+ * create a swapfile for a memcache.
+ */
+int swp_create(struct swapfile *sw, struct memcache *mc, char const *name,
+        char const *orig)
+{
+    assert(mc->swap == NULL);
+
+    sw->mc = mc;
+    sw->orig = NULL;
+    if ((sw->name = str_dup(name)) == NULL)
+        return FAIL;
+    if ((orig != NULL && (sw->orig = str_dup(orig)) == NULL)
+            || stream_open(&sw->stream, name,
+                STREAM_WRITE | STREAM_EXCL) == FAIL)
+    {
+        if (sw->orig != NULL)
+            vime_free(sw->orig);
+        vime_free(sw->name);
+        return FAIL;
+    }
+
+    if (put_file(sw, &sw->stream) == FAIL
+            || stream_sync(&sw->stream) == FAIL)
+    {
+        swp_close(sw, TRUE);
+        return FAIL;
+    }
+
+    mc->swap = sw;
+    return OK;
+}
+
+
+/**
+ * close the swapfile.
+ */
+int swp_close(struct swapfile *sw, int remove_file)
+{
+    int retv = stream_close(&sw->stream);
+
+    if (remove_file && remove(sw->name) != 0)
+        retv = FAIL;
+
+    sw->mc->swap = NULL;
+    if (sw->orig != NULL)
+        vime_free(sw->orig);
+    vime_free(sw->name);
+    sw->orig = sw->name = NULL;
+    return retv;
+}
+
+
+/**
+ * log the text inserted.
+ */
+int swp_insert(struct swapfile *sw, size_t offset, char const *text,
+        size_t len)
+{
+    unsigned char nums[NUMS_MAX];
+
+    return log_record(sw, SWP_INSERT, nums, put_varint(nums, offset),
+            text, len);
+}
+
+
+/**
+ * log the text attached.
+ */
+int swp_attach(struct swapfile *sw, size_t offset, char const *text,
+        size_t len)
+{
+    unsigned char nums[NUMS_MAX];
+    size_t n;
+
+    if (!is_original(sw, text))
+        return swp_insert(sw, offset, text, len);
+
+    n = put_varint(nums, offset);
+    n += put_varint(nums + n, text - sw->mc->file.base);
+    n += put_varint(nums + n, len);
+    return log_record(sw, SWP_ORIGINAL, nums, n, NULL, 0);
+}
+
+
+/**
+ * log the text deleted.
+ */
+int swp_delete(struct swapfile *sw, size_t offset, size_t len)
+{
+    unsigned char nums[NUMS_MAX];
+    size_t n;
+
+    n = put_varint(nums, offset);
+    n += put_varint(nums + n, len);
+    return log_record(sw, SWP_DELETE, nums, n, NULL, 0);
+}
+
+
+/**
+ * write the records logged into the disk.
+ */
+int swp_sync(struct swapfile *sw)
+{
+    /* a record is lost if write failed, the log stops at it, the new
+     * checkpoint has all text. */
+    if (stream_error(&sw->stream))
+        return swp_checkpoint(sw);
+
+    /* a checkpoint costs as much as the records logged, at most. */
+    if (sw->logged >= SWP_CHECKPOINT_MIN && sw->logged >= sw->checkpoint
+            && swp_checkpoint(sw) == OK)
+        return OK;
+    return stream_sync(&sw->stream);
+}
+
+
+/**
+ * write a new checkpoint, and replace the swapfile atomically.
+ */
+int swp_checkpoint(struct swapfile *sw)
+{
+    struct stream s;
+    size_t len = strlen(sw->name);
+    char *tmpname = vime_malloc(len + 2);
+    int retv;
+
+    if (tmpname == NULL)
+        return FAIL;
+    memcpy(tmpname, sw->name, len);
+    memcpy(tmpname + len, "~", 2);
+
+    if (stream_open(&s, tmpname, STREAM_WRITE) == FAIL)
+    {
+        vime_free(tmpname);
+        return FAIL;
+    }
+
+    /* the new swapfile is complete on the disk before it's renamed. */
+    retv = put_file(sw, &s);
+    if (retv == OK)
+        retv = stream_sync(&s);
+    if (retv == OK && rename(tmpname, sw->name) != 0)
+        retv = FAIL;
+
+    if (retv == FAIL)
+    {
+        stream_close(&s);
+        remove(tmpname);
+    }
+    else
+    {
+        /* the old records are in the checkpoint, they can be lost. */
+        stream_close(&sw->stream);
+        sw->stream = s;
+    }
+    vime_free(tmpname);
+    return retv;
+}
+
+
+/**
+ * write a new checkpoint after the original file is replaced.
+ */
+int swp_saved(struct swapfile *sw)
+{
+    /* the old file is still mapped if the new one can't be mapped, it
+     * has no name now, its text is stored in checkpoint. */
+    if (sw->orig != NULL && !fmap_same(&sw->mc->file, sw->orig))
+    {
+        vime_free(sw->orig);
+        sw->orig = NULL;
+    }
+    return swp_checkpoint(sw);
+}
+
+
+/*
+ * read a record, the payload is valid until next read. return FAIL at
+ * the end of file, or if the record is broken.
+ */
+static int get_record(struct stream *s, struct record *rec)
+{
+    unsigned char const *window, *p, *end;
+    uint32_t crc;
+    size_t n, head, len;
+
+    if ((window = (unsigned char const*)stream_borrow(s, HEAD_MAX, &n))
+            == NULL)
+        return FAIL;
+
+    p = window + 1;
+    if (get_varint(&p, window + n, &len) == FAIL
+            || len > (size_t)-1 / 2)
+        return FAIL;
+    head = p - window;
+
+    /* the record written partly by a crash is shorter. */
+    window = (unsigned char const*)stream_borrow(s, head + len + CRC_LEN,
+            &n);
+    if (window == NULL || n < head + len + CRC_LEN)
+        return FAIL;
+    p = window + head;
+    end = p + len;
+    crc = ~crc_update(~(uint32_t)0, window, end - window);
+    if (end[0] != (unsigned char)crc || end[1] != (unsigned char)(crc >> 8)
+            || end[2] != (unsigned char)(crc >> 16)
+            || end[3] != (unsigned char)(crc >> 24))
+        return FAIL;
+
+    rec->type = window[0];
+    rec->payload = p;
+    rec->len = len;
+    stream_release(s, end + CRC_LEN - window);
+    return OK;
+}
+
+
+/*
+ * map the original file named in the header.
+ */
+static int replay_header(struct memcache *mc, struct record *rec)
+{
+    unsigned char const *p = rec->payload, *end = p + rec->len;
+    struct fmap_id id;
+    size_t size, dev, ino, mtime;
+    char *name;
+    int retv;
+
+    if (get_varint(&p, end, &size) == FAIL
+            || get_varint(&p, end, &dev) == FAIL
+            || get_varint(&p, end, &ino) == FAIL
+            || get_varint(&p, end, &mtime) == FAIL)
+        return FAIL;
+    if (p == end)
+        return OK;
+
+    if ((name = vime_malloc(end - p + 1)) == NULL)
+        return FAIL;
+    memcpy(name, p, end - p);
+    name[end - p] = '\0';
+    retv = fmap_open(&mc->file, name);
+    vime_free(name);
+
+    /* the original file is replaced or changed, the offsets are
+     * wrong. */
+    if (retv == OK)
+        fmap_id(&mc->file, &id);
+    if (retv == OK && (mc->file.size != size || id.dev != dev
+                || id.ino != ino || id.mtime != mtime))
+    {
+        fmap_close(&mc->file);
+        retv = FAIL;
+    }
+    return retv;
+}
+
+
+/*
+ * rebuild the text from the checkpoint.
+ */
+static int replay_checkpoint(struct memcache *mc, struct record *rec)
+{
+    unsigned char const *p = rec->payload, *end = p + rec->len;
+    size_t size, item, len, from;
+
+    if (get_varint(&p, end, &size) == FAIL)
+        return FAIL;
+
+    while (p != end)
+    {
+        if (get_varint(&p, end, &item) == FAIL)
+            return FAIL;
+        len = item >> 1;
+
+        if ((item & 1) == ITEM_TEXT)
+        {
+            if (len > (size_t)(end - p)
+                    || mc_insert(mc, mc_size(mc), (char const*)p, len)
+                        == FAIL)
+                return FAIL;
+            p += len;
+        }
+        else if (get_varint(&p, end, &from) == FAIL
+                || from > mc->file.size || len > mc->file.size - from
+                || mc_attach(mc, mc_size(mc), mc->file.base + from, len,
+                    MC_NPOS) == FAIL)
+            return FAIL;
+    }
+
+    return mc_size(mc) == size ? OK : FAIL;
+}
+
+
+/*
+ * replay a record logged.
+ */
+static int replay(struct memcache *mc, struct record *rec)
+{
+    unsigned char const *p = rec->payload, *end = p + rec->len;
+    size_t offset, from, len;
+
+    if (get_varint(&p, end, &offset) == FAIL)
+        return FAIL;
+
+    if (rec->type == SWP_INSERT)
+        return mc_insert(mc, offset, (char const*)p, end - p);
+
+    if (rec->type == SWP_ORIGINAL)
+    {
+        if (get_varint(&p, end, &from) == FAIL
+                || get_varint(&p, end, &len) == FAIL || p != end
+                || from > mc->file.size || len > mc->file.size - from)
+            return FAIL;
+        return mc_attach(mc, offset, mc->file.base + from, len, MC_NPOS);
+    }
+
+    if (rec->type == SWP_DELETE)
+    {
+        if (get_varint(&p, end, &len) == FAIL || p != end)
+            return FAIL;
+        return mc_delete(mc, offset, len);
+    }
+    return FAIL;
+}
+
+
+/**
+ * recover the text from a swapfile into a empty memcache.
+ */
+int swp_recover(struct memcache *mc, char const *name, size_t *pcount)
+{
+    struct stream s;
+    struct record rec;
+    char const *magic;
+    size_t count = 0, n;
+    int retv;
+
+    assert(mc->root == &sbtree_nil && mc->file.base == NULL);
+    assert(mc->swap == NULL);
+
+    if (stream_open(&s, name, STREAM_READ) == FAIL)
+        return FAIL;
+
+    retv = (magic = stream_borrow(&s, SWP_MAGIC_LEN, &n)) != NULL
+        && n >= SWP_MAGIC_LEN
+        && memcmp(magic, SWP_MAGIC, SWP_MAGIC_LEN) == 0 ? OK : FAIL;
+    if (retv == OK)
+    {
+        stream_release(&s, SWP_MAGIC_LEN);
+        retv = get_record(&s, &rec) == OK && rec.type == SWP_HEADER
+            ? replay_header(mc, &rec) : FAIL;
+    }
+    if (retv == OK)
+        retv = get_record(&s, &rec) == OK && rec.type == SWP_CHECKPOINT
+            ? replay_checkpoint(mc, &rec) : FAIL;
+
+    /* the records after a broken one are lost. */
+    for (; retv == OK && get_record(&s, &rec) == OK; ++count)
+        retv = replay(mc, &rec);
+
+    stream_close(&s);
+    if (pcount != NULL)
+        *pcount = count;
+    return retv;
+}
@@ -0,0 +1,14 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * define all data declared by EXTERN() in the headers.
+ */
+#define DEFINE_EXTERN_DATA
+
+#include <defs.h>
+#include <Support/sbtree.h>
+#include <Support/psbtree.h>
+#include <Support/hashtab.h>
@@ -4,6 +4,7 @@
 
 
 #include <string.h>
+#include <time.h>
 
 
 /*
@@ -17,3 +18,22 @@
  * include sbtree implement.
  */
 #include <Support/hashtab.h>
+
+
+/**
+ * set the seed of ht_hash_bytes().
+ */
+uint64_t ht_set_hash_seed(uint64_t seed)
+{
+    uint64_t a, b;
+
+    if (seed == 0)
+    {
+        a = (uint64_t)(uintptr_t)&ht_hash_seed ^ HT_HASH_P0;
+        b = ((uint64_t)time(NULL) << 20 ^ (uint64_t)clock()) ^ HT_HASH_P1;
+        ht_mum(&a, &b);
+        seed = a ^ b;
+    }
+
+    return ht_hash_seed = seed == 0 ? HT_HASH_P0 : seed;
+}
@@ -0,0 +1,16 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * include global macro defines.
+ */
+#include <defs.h>
+
+#define DEFINE_INLINE_ROUTINES
+
+/*
+ * include interval tree implement.
+ */
+#include <Support/itree.h>
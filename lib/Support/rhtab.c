@@ -0,0 +1,24 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+#include <string.h>
+
+
+/*
+ * include global macro defines.
+ */
+#include <defs.h>
+
+/*
+ * hashtab routines are defined in hashtab.c.
+ */
+#include <Support/hashtab.h>
+
+#define DEFINE_INLINE_ROUTINES
+
+/*
+ * include Robin Hood hash table implement.
+ */
+#include <Support/rhtab.h>
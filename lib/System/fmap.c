@@ -0,0 +1,188 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+/*
+ * the implement of VimE read-only file mapping.
+ */
+
+
+#include <System/fmap.h>
+
+#if defined(UNIX)
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#elif defined(WIN32)
+#  include <windows.h>
+#endif /* defined(UNIX) */
+
+
+#if defined(UNIX)
+
+/**
+ * map a file into memory, read-only.
+ */
+int fmap_open(struct fmap *fm, char const *name)
+{
+    struct stat st;
+    void *base = NULL;
+    int fd = open(name, O_RDONLY);
+
+    if (fd < 0)
+        return FAIL;
+
+    if (fstat(fd, &st) != 0 || (uintmax_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return FAIL;
+    }
+
+    /* a empty file can't be mapped, it's just empty. */
+    if (st.st_size != 0)
+    {
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                fd, 0);
+        if (base == MAP_FAILED)
+        {
+            close(fd);
+            return FAIL;
+        }
+    }
+
+    /* the mapping keeps the file alive, the fd is kept to copy the
+     * text without touching the pages, see fsave_copy(). */
+    fm->base = base;
+    fm->size = (size_t)st.st_size;
+    fm->handle = NULL;
+    fm->fd = fd;
+    return OK;
+}
+
+
+/**
+ * unmap a file mapped by fmap_open().
+ */
+void fmap_close(struct fmap *fm)
+{
+    if (fm->base != NULL)
+        munmap((void*)fm->base, fm->size);
+    if (fm->fd >= 0)
+        close(fm->fd);
+    fm->base = NULL;
+    fm->size = 0;
+    fm->handle = NULL;
+    fm->fd = -1;
+}
+
+
+/**
+ * get the identity of the file mapped.
+ */
+void fmap_id(struct fmap const *fm, struct fmap_id *id)
+{
+    struct stat st;
+
+    memset(id, 0, sizeof(struct fmap_id));
+    if (fm->fd >= 0 && fstat(fm->fd, &st) == 0)
+    {
+        id->dev = (uint64_t)st.st_dev;
+        id->ino = (uint64_t)st.st_ino;
+        id->mtime = (uint64_t)st.st_mtime;
+    }
+}
+
+
+/**
+ * whether a file name refers to the file mapped now.
+ */
+int fmap_same(struct fmap const *fm, char const *name)
+{
+    struct stat st, mapped;
+
+    return fm->fd >= 0 && fstat(fm->fd, &mapped) == 0
+        && stat(name, &st) == 0 && st.st_dev == mapped.st_dev
+        && st.st_ino == mapped.st_ino;
+}
+
+#elif defined(WIN32)
+
+/**
+ * map a file into memory, read-only.
+ */
+int fmap_open(struct fmap *fm, char const *name)
+{
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    void *base = NULL;
+    HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return FAIL;
+
+    if (!GetFileSizeEx(file, &size)
+            || (unsigned __int64)size.QuadPart > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return FAIL;
+    }
+
+    if (size.QuadPart != 0)
+    {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL || (base = MapViewOfFile(mapping,
+                        FILE_MAP_READ, 0, 0, 0)) == NULL)
+        {
+            if (mapping != NULL)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            return FAIL;
+        }
+    }
+
+    CloseHandle(file);
+    fm->base = base;
+    fm->size = (size_t)size.QuadPart;
+    fm->handle = mapping;
+    fm->fd = -1;
+    return OK;
+}
+
+
+/**
+ * unmap a file mapped by fmap_open().
+ */
+void fmap_close(struct fmap *fm)
+{
+    if (fm->base != NULL)
+        UnmapViewOfFile(fm->base);
+    if (fm->handle != NULL)
+        CloseHandle(fm->handle);
+    fm->base = NULL;
+    fm->size = 0;
+    fm->handle = NULL;
+    fm->fd = -1;
+}
+
+
+/**
+ * get the identity of the file mapped. the file handle is closed after
+ * it's mapped, and a mapped file can't be replaced on Windows.
+ */
+void fmap_id(struct fmap const *fm, struct fmap_id *id)
+{
+    memset(id, 0, sizeof(struct fmap_id));
+}
+
+
+/**
+ * whether a file name refers to the file mapped now.
+ */
+int fmap_same(struct fmap const *fm, char const *name)
+{
+    return FALSE;
+}
+
+#endif /* defined(UNIX) */
@@ -0,0 +1,322 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+/*
+ * the implement of VimE atomic file writer.
+ */
+
+
+#include <System/fsave.h>
+#include <System/mem.h>
+
+#if defined(UNIX)
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <stdio.h>
+#  include <unistd.h>
+#  include <sys/stat.h>
+#  include <sys/uio.h>
+#  if defined(__linux__)
+#    include <sys/sendfile.h>
+#  endif /* defined(__linux__) */
+#endif /* defined(UNIX) */
+
+
+#if defined(UNIX)
+
+/* the suffix of the temporary file, see mkstemp(). */
+#define TMP_SUFFIX ".XXXXXX"
+
+
+/*
+ * copy a name with a suffix.
+ */
+static char *name_dup(char const *name, char const *suffix)
+{
+    size_t len = strlen(name), slen = strlen(suffix);
+    char *dup = vime_malloc(len + slen + 1);
+
+    if (dup != NULL)
+    {
+        memcpy(dup, name, len);
+        memcpy(dup + len, suffix, slen + 1);
+    }
+    return dup;
+}
+
+
+/*
+ * write the text gathered.
+ */
+static int flush(struct fsave *fs)
+{
+    struct iovec iov[FSAVE_VEC_MAX], *v = iov;
+    size_t offset = fs->offset - fs->pending;
+    int i, n = fs->nvec;
+    ssize_t r;
+
+    for (i = 0; i < n; ++i)
+    {
+        iov[i].iov_base = (void*)fs->vec[i].text;
+        iov[i].iov_len = fs->vec[i].len;
+    }
+    fs->nvec = 0;
+    fs->pending = 0;
+
+    while (n > 0)
+    {
+        do
+            r = pwritev(fs->fd, v, n, (off_t)offset);
+        while (r < 0 && errno == EINTR);
+        if (r <= 0)
+            return FAIL;
+        offset += r;
+
+        /* skip the text written, and the beginning of a text. */
+        for (; n > 0 && (size_t)r >= v->iov_len; ++v, --n)
+            r -= v->iov_len;
+        if (n > 0)
+        {
+            v->iov_base = (char*)v->iov_base + r;
+            v->iov_len -= r;
+        }
+    }
+    return OK;
+}
+
+
+#if defined(__linux__)
+
+/*
+ * copy text from a file in the kernel, return the count of bytes
+ * copied, it's less than len if the kernel can't copy them.
+ */
+static size_t kernel_copy(struct fsave *fs, int fd, size_t offset,
+        size_t len)
+{
+    size_t done = 0;
+    off_t in;
+    ssize_t n;
+
+#if defined(_GNU_SOURCE)
+    loff_t from = offset, to = fs->offset;
+
+    while (done < len)
+    {
+        n = copy_file_range(fd, &from, fs->fd, &to, len - done, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    if (done == len)
+        return done;
+#endif /* defined(_GNU_SOURCE) */
+
+    /* sendfile() writes at the position of file. */
+    if (lseek(fs->fd, (off_t)(fs->offset + done), SEEK_SET) < 0)
+        return done;
+    for (in = (off_t)(offset + done); done < len; done += n)
+    {
+        n = sendfile(fs->fd, fd, &in, len - done);
+        if (n < 0 && errno == EINTR)
+            n = 0;
+        else if (n <= 0)
+            break;
+    }
+    return done;
+}
+
+#endif /* defined(__linux__) */
+
+
+/**
+ * create the temporary file to replace a file.
+ */
+int fsave_open(struct fsave *fs, char const *name)
+{
+    struct stat st;
+    char *target = NULL;
+    mode_t mask;
+
+    /* replace the file linked, not the link. */
+    if (lstat(name, &st) == 0 && S_ISLNK(st.st_mode))
+        target = realpath(name, NULL);
+    fs->name = name_dup(target != NULL ? target : name, "");
+    free(target);
+    if (fs->name == NULL)
+        return FAIL;
+
+    if ((fs->tmpname = name_dup(fs->name, TMP_SUFFIX)) == NULL)
+    {
+        vime_free(fs->name);
+        return FAIL;
+    }
+    if ((fs->fd = mkstemp(fs->tmpname)) < 0)
+    {
+        vime_free(fs->tmpname);
+        vime_free(fs->name);
+        return FAIL;
+    }
+
+    /* mkstemp() creates the file only for the owner. */
+    if (stat(fs->name, &st) == 0)
+        fchmod(fs->fd, st.st_mode & 07777);
+    else
+    {
+        mask = umask(0);
+        umask(mask);
+        fchmod(fs->fd, 0666 & ~mask);
+    }
+
+    fs->offset = 0;
+    fs->nvec = 0;
+    fs->pending = 0;
+    return OK;
+}
+
+
+/**
+ * append text into the file.
+ */
+int fsave_write(struct fsave *fs, char const *text, size_t len)
+{
+    if (len == 0)
+        return OK;
+    if (fs->nvec == FSAVE_VEC_MAX && flush(fs) == FAIL)
+        return FAIL;
+
+    fs->vec[fs->nvec].text = text;
+    fs->vec[fs->nvec].len = len;
+    ++fs->nvec;
+    fs->pending += len;
+    fs->offset += len;
+    return OK;
+}
+
+
+/**
+ * append a part of a mapped file into the file.
+ */
+int fsave_copy(struct fsave *fs, struct fmap const *src,
+        size_t offset, size_t len)
+{
+    size_t done = 0;
+    ssize_t n;
+
+    assert(offset + len <= src->size);
+    if (fs->nvec != 0 && flush(fs) == FAIL)
+        return FAIL;
+
+#if defined(__linux__)
+    if (src->fd >= 0)
+        done = kernel_copy(fs, src->fd, offset, len);
+#endif /* defined(__linux__) */
+
+    /* the text can't be copied by kernel is written from the mapping. */
+    for (; done < len; done += n)
+    {
+        n = pwrite(fs->fd, src->base + offset + done, len - done,
+                (off_t)(fs->offset + done));
+        if (n < 0 && errno == EINTR)
+            n = 0;
+        else if (n <= 0)
+            return FAIL;
+    }
+
+    fs->offset += len;
+    return OK;
+}
+
+
+/**
+ * finish the file, and rename it over the file.
+ */
+int fsave_commit(struct fsave *fs)
+{
+    int retv = fs->nvec == 0 ? OK : flush(fs);
+
+    /* only the file is synced, the rename is atomic without syncing
+     * the directory, it may be lost by a crash, but never half done. */
+    if (retv == OK && fsync(fs->fd) != 0)
+        retv = FAIL;
+    if (close(fs->fd) != 0)
+        retv = FAIL;
+    fs->fd = -1;
+
+    if (retv == OK && rename(fs->tmpname, fs->name) != 0)
+        retv = FAIL;
+    if (retv == FAIL)
+        unlink(fs->tmpname);
+
+    vime_free(fs->tmpname);
+    vime_free(fs->name);
+    fs->tmpname = fs->name = NULL;
+    return retv;
+}
+
+
+/**
+ * give up writing, the temporary file is removed.
+ */
+void fsave_abort(struct fsave *fs)
+{
+    if (fs->fd >= 0)
+        close(fs->fd);
+    unlink(fs->tmpname);
+
+    vime_free(fs->tmpname);
+    vime_free(fs->name);
+    fs->tmpname = fs->name = NULL;
+    fs->fd = -1;
+}
+
+#elif defined(WIN32)
+
+/**
+ * create the temporary file to replace a file.
+ */
+int fsave_open(struct fsave *fs, char const *name)
+{
+    return FAIL;
+}
+
+
+/**
+ * append text into the file.
+ */
+int fsave_write(struct fsave *fs, char const *text, size_t len)
+{
+    return FAIL;
+}
+
+
+/**
+ * append a part of a mapped file into the file.
+ */
+int fsave_copy(struct fsave *fs, struct fmap const *src,
+        size_t offset, size_t len)
+{
+    return FAIL;
+}
+
+
+/**
+ * finish the file, and rename it over the file.
+ */
+int fsave_commit(struct fsave *fs)
+{
+    return FAIL;
+}
+
+
+/**
+ * give up writing, the temporary file is removed.
+ */
+void fsave_abort(struct fsave *fs)
+{
+}
+
+#endif /* defined(UNIX) */
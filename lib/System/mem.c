@@ -3,9 +3,14 @@
  */
 
 
+#define DEFINE_MEM_ROUTINES
 #include <System/mem.h>
 #include <nedmalloc.c>
 
+#if defined(ENABLE_MEMSTAT)
+#  include <stdio.h>
+#endif /* defined(ENABLE_MEMSTAT) */
+
 
 /* the hook of no memory error.  */
 static struct hook *no_memory_hook = NULL;
@@ -13,10 +18,345 @@ static struct hook *no_memory_hook = NULL;
 /* the argument of hook. */
 static struct no_memory_hook_arg
 {
-    char *name;
+    char const *name;
     void *mem;
     size_t size;
-} nomem_arg = {};
+} nomem_arg = {NULL, NULL, 0};
+
+
+#if defined(ENABLE_MEMSTAT)
+
+/* the max count of allocation sites tracked. */
+#define MEM_SITE_MAX 1024
+
+/* the tag of allocations without a tag. */
+static char const mem_untagged[] = "(untagged)";
+
+/* the tag of allocations when the site table is full. */
+static char const mem_others[] = "(others)";
+
+
+/* the header before every block, its size is a multiple of the
+ * alignment of nedmalloc, so the block keeps that alignment. */
+union mem_header
+{
+    struct
+    {
+        struct mem_stat *site;  /* the site allocated the block. */
+        size_t size;            /* the size asked by the caller. */
+    } h;
+    char align[(sizeof(void*) + sizeof(size_t) + MALLOC_ALIGNMENT - 1)
+        / MALLOC_ALIGNMENT * MALLOC_ALIGNMENT];
+};
+
+
+/* the statistics of all blocks, and of every site. */
+static struct mem_stat mem_total = { "(total)", 0, 0, 0, 0, 0, {0} };
+static struct mem_stat mem_sites[MEM_SITE_MAX];
+static size_t mem_site_count = 0;
+
+
+/*
+ * lock the statistics, they are shared by threads, e.g. the loader.
+ * the global lock of dlmalloc is used, as it's initialized statically,
+ * and it's never held while the statistics are locked.
+ */
+static void stat_lock(void)
+{
+    ensure_initialization();
+    ACQUIRE_MALLOC_GLOBAL_LOCK();
+}
+
+
+/*
+ * unlock the statistics.
+ */
+static void stat_unlock(void)
+{
+    RELEASE_MALLOC_GLOBAL_LOCK();
+}
+
+
+/*
+ * find the statistics of a site, sites are looked up by the address
+ * of tag, as a tag is a string literal normally.
+ */
+static struct mem_stat *stat_site(char const *tag)
+{
+    size_t i, n;
+
+    if (tag == NULL)
+        tag = mem_untagged;
+
+    i = (size_t)((uintptr_t)tag >> 3) % MEM_SITE_MAX;
+    for (n = 0; n < MEM_SITE_MAX; ++n, i = (i + 1) % MEM_SITE_MAX)
+    {
+        if (mem_sites[i].tag == tag)
+            return &mem_sites[i];
+        if (mem_sites[i].tag == NULL)
+        {
+            /* keep one slot for the others. */
+            if (mem_site_count == MEM_SITE_MAX - 1 && tag != mem_others)
+                return stat_site(mem_others);
+            ++mem_site_count;
+            mem_sites[i].tag = tag;
+            return &mem_sites[i];
+        }
+    }
+
+    return stat_site(mem_others);
+}
+
+
+/*
+ * add or remove a block in the statistics.
+ */
+static void stat_count(struct mem_stat *stat, size_t size, int add)
+{
+    size_t bin = 0;
+
+    if (add)
+    {
+        while (bin < MEM_HIST_SIZE - 1 && size >= (size_t)16 << bin)
+            ++bin;
+        ++stat->hist[bin];
+        ++stat->allocs;
+        ++stat->live_count;
+        stat->live_bytes += size;
+        if (stat->peak_bytes < stat->live_bytes)
+            stat->peak_bytes = stat->live_bytes;
+    }
+    else
+    {
+        ++stat->frees;
+        --stat->live_count;
+        stat->live_bytes -= size;
+    }
+}
+
+
+/*
+ * track a block allocated with its header, return the memory after the
+ * header, or NULL if header is NULL.
+ */
+static void *stat_track(union mem_header *header, size_t size,
+        char const *tag)
+{
+    static int dump_registered = FALSE;
+
+    if (header == NULL)
+        return NULL;
+
+    stat_lock();
+    if (!dump_registered)
+        dump_registered = atexit(vime_mem_dump) == 0;
+
+    header->h.site = stat_site(tag);
+    header->h.size = size;
+    stat_count(header->h.site, size, TRUE);
+    stat_count(&mem_total, size, TRUE);
+    stat_unlock();
+    return header + 1;
+}
+
+
+/*
+ * allocate a block, and track it.
+ */
+static void *stat_malloc(size_t size, char const *tag)
+{
+    return stat_track(nedmalloc(sizeof(union mem_header) + size), size, tag);
+}
+
+
+/*
+ * allocate a zeroed block, and track it.
+ */
+static void *stat_calloc(size_t count, size_t size, char const *tag)
+{
+    if (size != 0 && count > ((size_t)-1 - sizeof(union mem_header)) / size)
+        return NULL;
+
+    /* the large blocks of system are zeroed already, no memset(). */
+    return stat_track(nedcalloc(1, sizeof(union mem_header) + count * size),
+            count * size, tag);
+}
+
+
+/*
+ * free a tracked block.
+ */
+static void stat_free(void *mem)
+{
+    union mem_header *header = (union mem_header*)mem - 1;
+
+    if (mem == NULL)
+        return;
+
+    stat_lock();
+    stat_count(header->h.site, header->h.size, FALSE);
+    stat_count(&mem_total, header->h.size, FALSE);
+    stat_unlock();
+    nedfree(header);
+}
+
+
+/*
+ * realloc a tracked block, the block is moved to the new site.
+ */
+static void *stat_realloc(void *mem, size_t size, char const *tag)
+{
+    union mem_header *header;
+
+    if (mem == NULL)
+        return stat_malloc(size, tag);
+
+    header = (union mem_header*)mem - 1;
+    header = nedrealloc(header, sizeof(union mem_header) + size);
+    if (header == NULL)
+        return NULL;
+
+    /* the old block is gone if realloc success. */
+    stat_lock();
+    stat_count(header->h.site, header->h.size, FALSE);
+    stat_count(&mem_total, header->h.size, FALSE);
+    header->h.site = stat_site(tag);
+    header->h.size = size;
+    stat_count(header->h.site, size, TRUE);
+    stat_count(&mem_total, size, TRUE);
+    stat_unlock();
+    return header + 1;
+}
+
+
+/**
+ * get the allocation statistics.
+ */
+int vime_mem_stat(char const *tag, struct mem_stat *stat)
+{
+    size_t i;
+    int retv = FAIL;
+
+    stat_lock();
+    if (tag == NULL)
+    {
+        *stat = mem_total;
+        retv = OK;
+    }
+
+    for (i = 0; retv == FAIL && i < MEM_SITE_MAX; ++i)
+    {
+        if (mem_sites[i].tag != NULL && strcmp(mem_sites[i].tag, tag) == 0)
+        {
+            *stat = mem_sites[i];
+            retv = OK;
+        }
+    }
+    stat_unlock();
+
+    if (retv == FAIL)
+        memset(stat, 0, sizeof(struct mem_stat));
+    return retv;
+}
+
+
+/**
+ * get the allocation statistics of all sites.
+ */
+size_t vime_mem_sites(struct mem_stat *stats, size_t count)
+{
+    size_t i, n = 0;
+
+    stat_lock();
+    for (i = 0; i < MEM_SITE_MAX; ++i)
+    {
+        if (mem_sites[i].tag == NULL)
+            continue;
+        if (n < count)
+            stats[n] = mem_sites[i];
+        ++n;
+    }
+    stat_unlock();
+
+    return n;
+}
+
+
+/*
+ * print a statistics.
+ */
+static void stat_print(struct mem_stat const *stat, char const *leak)
+{
+    size_t bin;
+
+    fprintf(stderr, "%-32s %10lu bytes %8lu blocks, peak %10lu bytes, "
+            "%lu allocs %lu frees%s\n", stat->tag,
+            (unsigned long)stat->live_bytes,
+            (unsigned long)stat->live_count,
+            (unsigned long)stat->peak_bytes,
+            (unsigned long)stat->allocs,
+            (unsigned long)stat->frees,
+            stat->live_count != 0 ? leak : "");
+
+    fprintf(stderr, "%32s", "");
+    for (bin = 0; bin < MEM_HIST_SIZE; ++bin)
+        if (stat->hist[bin] != 0)
+            fprintf(stderr, " %s%lu:%lu", bin == MEM_HIST_SIZE - 1
+                    ? ">=" : "<", (unsigned long)16 << bin,
+                    (unsigned long)stat->hist[bin]);
+    fprintf(stderr, "\n");
+}
+
+
+/**
+ * print the allocation statistics to stderr.
+ */
+void vime_mem_dump(void)
+{
+    size_t i;
+
+    stat_lock();
+    fprintf(stderr, "VimE memory statistics:\n");
+    stat_print(&mem_total, "");
+    for (i = 0; i < MEM_SITE_MAX; ++i)
+        if (mem_sites[i].tag != NULL)
+            stat_print(&mem_sites[i], " (leak?)");
+    stat_unlock();
+}
+
+#else /* defined(ENABLE_MEMSTAT) */
+
+#define stat_malloc(size, tag) nedmalloc(size)
+#define stat_calloc(count, size, tag) nedcalloc((count), (size))
+#define stat_free(mem) nedfree(mem)
+#define stat_realloc(mem, size, tag) nedrealloc((mem), (size))
+
+
+/**
+ * get the allocation statistics.
+ */
+int vime_mem_stat(char const *tag, struct mem_stat *stat)
+{
+    memset(stat, 0, sizeof(struct mem_stat));
+    return FAIL;
+}
+
+
+/**
+ * get the allocation statistics of all sites.
+ */
+size_t vime_mem_sites(struct mem_stat *stats, size_t count)
+{
+    return 0;
+}
+
+
+/**
+ * print the allocation statistics to stderr.
+ */
+void vime_mem_dump(void) {}
+
+#endif /* defined(ENABLE_MEMSTAT) */
 
 
 /**
@@ -24,7 +364,16 @@ static struct no_memory_hook_arg
  */
 void *vime_malloc(size_t size)
 {
-    void *ptr = nedmalloc(size);
+    return vime_malloc_tag(size, NULL);
+}
+
+
+/**
+ * VimE main allocation function, with a site tag.
+ */
+void *vime_malloc_tag(size_t size, char const *tag)
+{
+    void *ptr = stat_malloc(size, tag);
 
     if (ptr == NULL && no_memory_hook != NULL)
     {
@@ -37,12 +386,39 @@ void *vime_malloc(size_t size)
 }
 
 
+/**
+ * VimE zeroed allocation function.
+ */
+void *vime_calloc(size_t count, size_t size)
+{
+    return vime_calloc_tag(count, size, NULL);
+}
+
+
+/**
+ * VimE zeroed allocation function, with a site tag.
+ */
+void *vime_calloc_tag(size_t count, size_t size, char const *tag)
+{
+    void *ptr = stat_calloc(count, size, tag);
+
+    if (ptr == NULL && no_memory_hook != NULL)
+    {
+        nomem_arg.name = "calloc";
+        nomem_arg.size = count * size;
+        hook_call(no_memory_hook, HF_DEFAULT, &nomem_arg);
+    }
+
+    return ptr;
+}
+
+
 /**
  * VimE main free function.
  */
 void vime_free(void *mem)
 {
-    return nedfree(mem);
+    stat_free(mem);
 }
 
 
@@ -51,7 +427,16 @@ void vime_free(void *mem)
  */
 void *vime_realloc(void *mem, size_t size)
 {
-    void *ptr = nedrealloc(mem, size);
+    return vime_realloc_tag(mem, size, NULL);
+}
+
+
+/**
+ * VimE main realloc function, with a site tag.
+ */
+void *vime_realloc_tag(void *mem, size_t size, char const *tag)
+{
+    void *ptr = stat_realloc(mem, size, tag);
 
     if (ptr == NULL && no_memory_hook != NULL)
     {
@@ -85,27 +470,130 @@ struct hook *vime_get_nomem_hook(void)
 }
 
 
+/* the size of a slab, a slab holds many blocks of a allocator. */
+#define FIXED_SLAB_SIZE 4096
+
+/* the minimum count of blocks in a slab, for big blocks. */
+#define FIXED_SLAB_MIN 8
+
+/* the size of a cache line, the blocks of a multiple of it are aligned
+ * to it, so they don't straddle one more line. */
+#define FIXED_CACHE_LINE 64
+
+
+/* the union has the strictest alignment of blocks. */
+union fixed_align
+{
+    void *ptr;
+    double d;
+    uint64_t u;
+};
+
+
+/* a slab of a fixed allocator. */
+struct fixed_slab
+{
+    struct fixed_slab *next;    /* the elder slab. */
+    union fixed_align data[1];  /* the blocks of slab. */
+};
+
+/* a free block of a fixed allocator. */
+struct fixed_block
+{
+    struct fixed_block *next;   /* the next free block. */
+};
+
+
 /**
  * VimE fixed allocator struction.
+ *
+ * blocks are carved from slabs in order, released blocks are linked
+ * into the free list and acquired again first. slabs are only freed
+ * with the allocator.
  */
 struct fixed_allocator
 {
+    size_t size;                /* the size of a block, aligned. */
+    size_t count;               /* the count of blocks of a new slab. */
+    size_t pad;                 /* the mask to align a slab, or zero. */
+    struct fixed_slab *slabs;   /* all slabs, newest first. */
+    struct fixed_block *free;   /* the released blocks. */
+    char *next;                 /* the unused blocks of newest slab. */
+    char *end;                  /* the end of newest slab. */
 };
 
 
+/*
+ * add a new slab with count blocks into a fixed allocator.
+ */
+static int fixed_add_slab(fixed_alloc_t fa, size_t count)
+{
+    struct fixed_slab *slab = vime_malloc_tag(
+            offsetof(struct fixed_slab, data) + count * fa->size + fa->pad,
+            "fixed_alloc");
+
+    if (slab == NULL)
+        return FAIL;
+
+    slab->next = fa->slabs;
+    fa->slabs = slab;
+    fa->next = (char*)(((uintptr_t)slab->data + fa->pad)
+            & ~(uintptr_t)fa->pad);
+    fa->end = fa->next + count * fa->size;
+    return OK;
+}
+
+
 /**
  * get a fixed allocator.
  */
 fixed_alloc_t fixed_alloc(size_t size, size_t prealloc_size)
 {
-    return (fixed_alloc_t)size;
+    size_t align = sizeof(union fixed_align);
+    fixed_alloc_t fa = vime_malloc(sizeof(struct fixed_allocator));
+
+    if (fa == NULL)
+        return NULL;
+
+    if (size < sizeof(struct fixed_block))
+        size = sizeof(struct fixed_block);
+    fa->size = (size + align - 1) / align * align;
+    fa->pad = fa->size % FIXED_CACHE_LINE == 0 ? FIXED_CACHE_LINE - 1 : 0;
+    fa->count = (FIXED_SLAB_SIZE - offsetof(struct fixed_slab, data))
+        / fa->size;
+    if (fa->count < FIXED_SLAB_MIN)
+        fa->count = FIXED_SLAB_MIN;
+    fa->slabs = NULL;
+    fa->free = NULL;
+    fa->next = fa->end = NULL;
+
+    if (prealloc_size != 0 && fixed_add_slab(fa, prealloc_size) == FAIL)
+    {
+        vime_free(fa);
+        return NULL;
+    }
+
+    return fa;
 }
 
 
 /**
  * free a fixed allocator.
  */
-void fixed_free(fixed_alloc_t fa) {}
+void fixed_free(fixed_alloc_t fa)
+{
+    struct fixed_slab *slab, *next;
+
+    if (fa == NULL)
+        return;
+
+    for (slab = fa->slabs; slab != NULL; slab = next)
+    {
+        next = slab->next;
+        vime_free(slab);
+    }
+    vime_free(fa);
+}
 
 
 /**
@@ -113,7 +601,20 @@ void fixed_free(fixed_alloc_t fa) {}
  */
 void *fixed_acquire(fixed_alloc_t fa)
 {
-    return vime_malloc((size_t)fa);
+    void *mem = fa->free;
+
+    if (mem != NULL)
+    {
+        fa->free = fa->free->next;
+        return mem;
+    }
+
+    if (fa->next == fa->end && fixed_add_slab(fa, fa->count) == FAIL)
+        return NULL;
+
+    mem = fa->next;
+    fa->next += fa->size;
+    return mem;
 }
 
 
@@ -122,5 +623,201 @@ void *fixed_acquire(fixed_alloc_t fa)
  */
 void fixed_release(fixed_alloc_t fa, void *mem)
 {
-    vime_free(mem);
+    struct fixed_block *block = mem;
+
+    if (block != NULL)
+    {
+        block->next = fa->free;
+        fa->free = block;
+    }
+}
+
+
+/* the default size of a arena chunk. */
+#define ARENA_CHUNK_SIZE 16384
+
+
+/* a chunk of a arena. */
+struct arena_chunk
+{
+    struct arena_chunk *prev;   /* the elder chunk. */
+    size_t base;                /* the arena position of data. */
+    size_t size;                /* the size of data. */
+    union fixed_align data[1];  /* the memory of chunk. */
+};
+
+
+/**
+ * VimE arena struction.
+ *
+ * memory is bumped from the newest chunk. the position of arena is the
+ * count of bytes bumped since created, a mark is just a position, and
+ * rewinding to it frees the chunks after it. one free chunk is kept
+ * for the next use, so a arena rewound after every command doesn't
+ * call malloc at all.
+ */
+struct arena
+{
+    size_t chunk_size;          /* the size of a normal chunk. */
+    struct arena_chunk *chunks; /* the chunks, newest first. */
+    struct arena_chunk *spare;  /* the free chunk kept for reuse. */
+    char *next;                 /* the free memory of newest chunk. */
+    char *end;                  /* the end of newest chunk. */
+};
+
+
+/*
+ * release a chunk removed from arena, the biggest free chunk is kept
+ * for reuse.
+ */
+static void arena_release_chunk(arena_t arena, struct arena_chunk *chunk)
+{
+    if (arena->spare == NULL || arena->spare->size < chunk->size)
+    {
+        if (arena->spare != NULL)
+            stat_free(arena->spare);
+        arena->spare = chunk;
+    }
+    else
+        stat_free(chunk);
+}
+
+
+/*
+ * add a new chunk into arena, with at least size bytes.
+ */
+static int arena_add_chunk(arena_t arena, size_t size)
+{
+    struct arena_chunk *chunk = arena->chunks;
+    size_t base = arena_mark(arena);
+
+    /* the newest chunk is empty, it's replaced, not kept under the new
+     * one at the same position, or it can't be rewound ever. */
+    if (chunk != NULL && arena->next == (char*)chunk->data)
+    {
+        arena->chunks = chunk->prev;
+        arena_release_chunk(arena, chunk);
+    }
+
+    chunk = arena->spare;
+    if (size < arena->chunk_size)
+        size = arena->chunk_size;
+
+    if (chunk != NULL && chunk->size >= size)
+        arena->spare = NULL;
+    else if ((chunk = stat_malloc(offsetof(struct arena_chunk, data)
+                    + size, "arena")) == NULL)
+    {
+        if (no_memory_hook != NULL)
+        {
+            nomem_arg.name = "arena";
+            nomem_arg.mem = arena;
+            nomem_arg.size = size;
+            hook_call(no_memory_hook, HF_DEFAULT, &nomem_arg);
+        }
+        return FAIL;
+    }
+    else
+        chunk->size = size;
+
+    chunk->prev = arena->chunks;
+    chunk->base = base;
+    arena->chunks = chunk;
+    arena->next = (char*)chunk->data;
+    arena->end = arena->next + chunk->size;
+    return OK;
+}
+
+
+/**
+ * create a arena.
+ */
+arena_t arena_create(size_t chunk_size)
+{
+    arena_t arena = vime_malloc(sizeof(struct arena));
+
+    if (arena == NULL)
+        return NULL;
+
+    arena->chunk_size = chunk_size != 0 ? chunk_size : ARENA_CHUNK_SIZE;
+    arena->chunks = arena->spare = NULL;
+    arena->next = arena->end = NULL;
+    return arena;
+}
+
+
+/**
+ * destroy a arena, and all memory allocated from it.
+ */
+void arena_destroy(arena_t arena)
+{
+    struct arena_chunk *chunk;
+
+    if (arena == NULL)
+        return;
+
+    while ((chunk = arena->chunks) != NULL)
+    {
+        arena->chunks = chunk->prev;
+        stat_free(chunk);
+    }
+    if (arena->spare != NULL)
+        stat_free(arena->spare);
+    vime_free(arena);
+}
+
+
+/**
+ * allocate memory from a arena.
+ */
+void *arena_alloc(arena_t arena, size_t size)
+{
+    size_t align = sizeof(union fixed_align);
+    void *mem;
+
+    size = (size + align - 1) / align * align;
+    if ((size_t)(arena->end - arena->next) < size
+            && arena_add_chunk(arena, size) == FAIL)
+        return NULL;
+
+    mem = arena->next;
+    arena->next += size;
+    return mem;
+}
+
+
+/**
+ * get the current position of a arena.
+ */
+size_t arena_mark(arena_t arena)
+{
+    struct arena_chunk *chunk = arena->chunks;
+
+    if (chunk == NULL)
+        return 0;
+    return chunk->base + (arena->next - (char*)chunk->data);
+}
+
+
+/**
+ * free all memory allocated after a mark.
+ */
+void arena_rewind(arena_t arena, size_t mark)
+{
+    struct arena_chunk *chunk;
+
+    assert(mark <= arena_mark(arena));
+    while ((chunk = arena->chunks) != NULL && chunk->base > mark)
+    {
+        arena->chunks = chunk->prev;
+        arena_release_chunk(arena, chunk);
+    }
+
+    if (chunk != NULL)
+    {
+        arena->next = (char*)chunk->data + (mark - chunk->base);
+        arena->end = (char*)chunk->data + chunk->size;
+    }
+    else
+        arena->next = arena->end = NULL;
 }
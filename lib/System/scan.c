@@ -0,0 +1,527 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+/*
+ * the implement of VimE text scanning kernels.
+ */
+
+
+#include <System/scan.h>
+
+#if defined(ENABLE_SIMD)
+#  include <immintrin.h>
+#endif /* defined(ENABLE_SIMD) */
+
+
+/* the byte patterns used by word-at-a-time routines. */
+#define SCAN_ONES ((uint64_t)0x0101010101010101ULL)
+#define SCAN_LOW7 ((uint64_t)0x7F7F7F7F7F7F7F7FULL)
+#define SCAN_HIGH ((uint64_t)0x8080808080808080ULL)
+
+
+/*
+ * the kernel struction. every kernel implements all routines.
+ */
+struct scan_kernel
+{
+    char const *name;
+    int (*supported)(void);
+    size_t (*newlines)(char const *text, size_t len);
+    size_t (*nth_newline)(char const *text, size_t len, size_t n);
+    size_t (*utf8_count)(char const *text, size_t len);
+    size_t (*utf8_valid)(char const *text, size_t len);
+};
+
+
+/*
+ * the length of a valid UTF-8 sequence at p, or 0 if it's invalid or
+ * cut by end. all kernels use it to check non-ASCII text.
+ */
+static size_t utf8_step(unsigned char const *p, unsigned char const *end)
+{
+    unsigned char lo = 0x80, hi = 0xBF;
+    size_t i, n;
+
+    if (p[0] < 0x80)
+        return 1;
+    else if (p[0] < 0xC2)
+        return 0;
+    else if (p[0] < 0xE0)
+        n = 2;
+    else if (p[0] < 0xF0)
+    {
+        n = 3;
+        if (p[0] == 0xE0)
+            lo = 0xA0;      /* overlong */
+        else if (p[0] == 0xED)
+            hi = 0x9F;      /* surrogates */
+    }
+    else if (p[0] < 0xF5)
+    {
+        n = 4;
+        if (p[0] == 0xF0)
+            lo = 0x90;      /* overlong */
+        else if (p[0] == 0xF4)
+            hi = 0x8F;      /* above U+10FFFF */
+    }
+    else
+        return 0;
+
+    if ((size_t)(end - p) < n || p[1] < lo || p[1] > hi)
+        return 0;
+    for (i = 2; i < n; ++i)
+        if ((p[i] & 0xC0) != 0x80)
+            return 0;
+
+    return n;
+}
+
+
+/*
+ * validate the UTF-8 sequences begin before stop, the text ends at
+ * end. return the end of the valid sequences, it's not less than
+ * stop if all sequences are valid.
+ */
+static unsigned char const *utf8_valid_until(unsigned char const *p,
+        unsigned char const *stop, unsigned char const *end)
+{
+    size_t n;
+
+    while (p < stop && (n = utf8_step(p, end)) != 0)
+        p += n;
+
+    return p;
+}
+
+
+/*
+ * the portable kernel. it works a word (8 bytes) at a time.
+ */
+
+static size_t scalar_newlines(char const *text, size_t len)
+{
+    char const *end = text + len;
+    size_t count = 0;
+    uint64_t w, t;
+
+    for (; end - text >= 8; text += 8)
+    {
+        /* the high bit of a byte in t is clear iff the byte is '\n'. */
+        memcpy(&w, text, 8);
+        w ^= SCAN_ONES * '\n';
+        t = ((w & SCAN_LOW7) + SCAN_LOW7) | w;
+        count += (((~t & SCAN_HIGH) >> 7) * SCAN_ONES) >> 56;
+    }
+
+    for (; text < end; ++text)
+        count += *text == '\n';
+
+    return count;
+}
+
+
+static size_t scalar_nth_newline(char const *text, size_t len, size_t n)
+{
+    char const *iter = text, *end = text + len;
+
+    while ((iter = memchr(iter, '\n', end - iter)) != NULL)
+    {
+        if (--n == 0)
+            return iter - text;
+        ++iter;
+    }
+
+    return len;
+}
+
+
+static size_t scalar_utf8_count(char const *text, size_t len)
+{
+    char const *end = text + len;
+    size_t cont = 0;
+    uint64_t w;
+
+    for (; end - text >= 8; text += 8)
+    {
+        /* a continuation byte has the high bit set and the next clear. */
+        memcpy(&w, text, 8);
+        w = w & ~(w << 1) & SCAN_HIGH;
+        cont += ((w >> 7) * SCAN_ONES) >> 56;
+    }
+
+    for (; text < end; ++text)
+        cont += (*text & 0xC0) == 0x80;
+
+    return len - cont;
+}
+
+
+static size_t scalar_utf8_valid(char const *text, size_t len)
+{
+    unsigned char const *p = (unsigned char const*)text, *end = p + len;
+    uint64_t w;
+
+    while (p < end)
+    {
+        /* skip ASCII words, and check one sequence otherwise. */
+        if (end - p >= 8 && (memcpy(&w, p, 8), (w & SCAN_HIGH) == 0))
+            p += 8;
+        else
+        {
+            unsigned char const *next = utf8_valid_until(p, p + 1, end);
+            if (next == p)
+                break;
+            p = next;
+        }
+    }
+
+    return (char const*)p - text;
+}
+
+
+#if defined(ENABLE_SIMD)
+
+#define SCAN_SSE2 __attribute__((target("sse2")))
+#define SCAN_AVX2 __attribute__((target("avx2,popcnt,bmi")))
+
+
+/*
+ * the SSE2 kernel. it works 16 bytes at a time, and the counts are
+ * accumulated in bytes for at most 255 blocks before summed up.
+ */
+
+static int sse2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+
+SCAN_SSE2 static size_t sse2_sum(__m128i acc)
+{
+    uint64_t lanes[2];
+
+    acc = _mm_sad_epu8(acc, _mm_setzero_si128());
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    return (size_t)(lanes[0] + lanes[1]);
+}
+
+
+SCAN_SSE2 static size_t sse2_newlines(char const *text, size_t len)
+{
+    char const *end = text + len;
+    __m128i nl = _mm_set1_epi8('\n');
+    size_t count = 0;
+
+    while (end - text >= 16)
+    {
+        __m128i acc = _mm_setzero_si128();
+        size_t i, blocks = (end - text) / 16;
+
+        if (blocks > 255)
+            blocks = 255;
+        for (i = 0; i < blocks; ++i, text += 16)
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(nl,
+                        _mm_loadu_si128((__m128i const*)text)));
+        count += sse2_sum(acc);
+    }
+
+    return count + scalar_newlines(text, end - text);
+}
+
+
+SCAN_SSE2 static size_t sse2_nth_newline(char const *text, size_t len,
+        size_t n)
+{
+    char const *iter = text, *end = text + len;
+    __m128i nl = _mm_set1_epi8('\n');
+    size_t off;
+
+    for (; end - iter >= 16; iter += 16)
+    {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(nl,
+                    _mm_loadu_si128((__m128i const*)iter)));
+        size_t count = (size_t)__builtin_popcount(mask);
+
+        if (count < n)
+        {
+            n -= count;
+            continue;
+        }
+
+        while (--n != 0)
+            mask &= mask - 1;
+        return (iter - text) + __builtin_ctz(mask);
+    }
+
+    off = scalar_nth_newline(iter, end - iter, n);
+    return (iter - text) + off;
+}
+
+
+SCAN_SSE2 static size_t sse2_utf8_count(char const *text, size_t len)
+{
+    char const *end = text + len;
+    /* signed, bytes not bigger than -65 (0x80 - 0xBF) are continuation. */
+    __m128i cont = _mm_set1_epi8(-65);
+    size_t count = 0;
+
+    while (end - text >= 16)
+    {
+        __m128i acc = _mm_setzero_si128();
+        size_t i, blocks = (end - text) / 16;
+
+        if (blocks > 255)
+            blocks = 255;
+        for (i = 0; i < blocks; ++i, text += 16)
+            acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(
+                        _mm_loadu_si128((__m128i const*)text), cont));
+        count += sse2_sum(acc);
+    }
+
+    return count + scalar_utf8_count(text, end - text);
+}
+
+
+SCAN_SSE2 static size_t sse2_utf8_valid(char const *text, size_t len)
+{
+    unsigned char const *p = (unsigned char const*)text, *end = p + len;
+
+    while (end - p >= 16)
+    {
+        unsigned char const *block_end = p + 16;
+
+        if (_mm_movemask_epi8(_mm_loadu_si128((__m128i const*)p)) == 0)
+        {
+            p = block_end;
+            continue;
+        }
+
+        /* check the sequences begin in this block. */
+        p = utf8_valid_until(p, block_end, end);
+        if (p < block_end)
+            return (char const*)p - text;
+    }
+
+    return (char const*)utf8_valid_until(p, end, end) - text;
+}
+
+
+/*
+ * the AVX2 kernel, the same as the SSE2 kernel but 32 bytes at a
+ * time.
+ */
+
+static int avx2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2")
+        && __builtin_cpu_supports("popcnt")
+        && __builtin_cpu_supports("bmi");
+}
+
+
+SCAN_AVX2 static size_t avx2_sum(__m256i acc)
+{
+    uint64_t lanes[4];
+
+    acc = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    return (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+
+SCAN_AVX2 static size_t avx2_newlines(char const *text, size_t len)
+{
+    char const *end = text + len;
+    __m256i nl = _mm256_set1_epi8('\n');
+    size_t count = 0;
+
+    while (end - text >= 32)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        size_t i, blocks = (end - text) / 32;
+
+        if (blocks > 255)
+            blocks = 255;
+        for (i = 0; i < blocks; ++i, text += 32)
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(nl,
+                        _mm256_loadu_si256((__m256i const*)text)));
+        count += avx2_sum(acc);
+    }
+
+    return count + scalar_newlines(text, end - text);
+}
+
+
+SCAN_AVX2 static size_t avx2_nth_newline(char const *text, size_t len,
+        size_t n)
+{
+    char const *iter = text, *end = text + len;
+    __m256i nl = _mm256_set1_epi8('\n');
+    size_t off;
+
+    for (; end - iter >= 32; iter += 32)
+    {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(nl,
+                    _mm256_loadu_si256((__m256i const*)iter)));
+        size_t count = (size_t)__builtin_popcount(mask);
+
+        if (count < n)
+        {
+            n -= count;
+            continue;
+        }
+
+        while (--n != 0)
+            mask &= mask - 1;
+        return (iter - text) + __builtin_ctz(mask);
+    }
+
+    off = scalar_nth_newline(iter, end - iter, n);
+    return (iter - text) + off;
+}
+
+
+SCAN_AVX2 static size_t avx2_utf8_count(char const *text, size_t len)
+{
+    char const *end = text + len;
+    __m256i cont = _mm256_set1_epi8(-65);
+    size_t count = 0;
+
+    while (end - text >= 32)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        size_t i, blocks = (end - text) / 32;
+
+        if (blocks > 255)
+            blocks = 255;
+        for (i = 0; i < blocks; ++i, text += 32)
+            acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(
+                        _mm256_loadu_si256((__m256i const*)text), cont));
+        count += avx2_sum(acc);
+    }
+
+    return count + scalar_utf8_count(text, end - text);
+}
+
+
+SCAN_AVX2 static size_t avx2_utf8_valid(char const *text, size_t len)
+{
+    unsigned char const *p = (unsigned char const*)text, *end = p + len;
+
+    while (end - p >= 32)
+    {
+        unsigned char const *block_end = p + 32;
+
+        if (_mm256_movemask_epi8(
+                    _mm256_loadu_si256((__m256i const*)p)) == 0)
+        {
+            p = block_end;
+            continue;
+        }
+
+        p = utf8_valid_until(p, block_end, end);
+        if (p < block_end)
+            return (char const*)p - text;
+    }
+
+    return (char const*)utf8_valid_until(p, end, end) - text;
+}
+
+#endif /* defined(ENABLE_SIMD) */
+
+
+/* all kernels, the fastest first. */
+static struct scan_kernel const kernels[] = {
+#if defined(ENABLE_SIMD)
+    { "avx2", avx2_supported, avx2_newlines, avx2_nth_newline,
+        avx2_utf8_count, avx2_utf8_valid },
+    { "sse2", sse2_supported, sse2_newlines, sse2_nth_newline,
+        sse2_utf8_count, sse2_utf8_valid },
+#endif /* defined(ENABLE_SIMD) */
+    { "scalar", NULL, scalar_newlines, scalar_nth_newline,
+        scalar_utf8_count, scalar_utf8_valid },
+};
+
+/* the kernel in use, selected at the first call. */
+static struct scan_kernel const *kernel = NULL;
+
+
+/*
+ * get the kernel in use, select the fastest one at the first call.
+ */
+static struct scan_kernel const *scan_get(void)
+{
+    if (kernel == NULL)
+        scan_use(NULL);
+    return kernel;
+}
+
+
+/**
+ * count the newlines in text.
+ */
+size_t scan_newlines(char const *text, size_t len)
+{
+    return scan_get()->newlines(text, len);
+}
+
+
+/**
+ * find the nth newline in text.
+ */
+size_t scan_nth_newline(char const *text, size_t len, size_t n)
+{
+    return n == 0 ? len : scan_get()->nth_newline(text, len, n);
+}
+
+
+/**
+ * count the code points in UTF-8 text.
+ */
+size_t scan_utf8_count(char const *text, size_t len)
+{
+    return scan_get()->utf8_count(text, len);
+}
+
+
+/**
+ * validate UTF-8 text.
+ */
+size_t scan_utf8_valid(char const *text, size_t len)
+{
+    return scan_get()->utf8_valid(text, len);
+}
+
+
+/**
+ * get the name of the kernel in use.
+ */
+char const *scan_kernel(void)
+{
+    return scan_get()->name;
+}
+
+
+/**
+ * select the kernel to use.
+ */
+int scan_use(char const *name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i)
+    {
+        if ((name == NULL || strcmp(name, kernels[i].name) == 0)
+                && (kernels[i].supported == NULL
+                    || kernels[i].supported()))
+        {
+            kernel = &kernels[i];
+            return OK;
+        }
+    }
+
+    return FAIL;
+}
@@ -0,0 +1,397 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+/*
+ * the implement of VimE buffered stream.
+ */
+
+
+#include <System/stream.h>
+#include <System/mem.h>
+
+#if defined(UNIX)
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/stat.h>
+#endif /* defined(UNIX) */
+
+
+/*
+ * the mapped text is the window already, nothing to read.
+ */
+static ssize_t map_read(struct stream *self, void *buf, size_t len)
+{
+    return 0;
+}
+
+
+/*
+ * a mapped file is read-only.
+ */
+static ssize_t map_write(struct stream *self, void const *buf, size_t len)
+{
+    return -1;
+}
+
+
+/*
+ * nothing to sync for a mapped file.
+ */
+static int map_sync(struct stream *self)
+{
+    return OK;
+}
+
+
+/*
+ * unmap the file.
+ */
+static int map_close(struct stream *self)
+{
+    fmap_close(&self->map);
+    return OK;
+}
+
+
+/* the operations of regular files mapped. */
+static struct stream_ops const map_ops =
+    { map_read, map_write, map_sync, map_close };
+
+
+/*
+ * map a regular file as a stream, the whole text is the window.
+ */
+static int map_open(struct stream *s, char const *name)
+{
+    struct fmap map = FMAP_INIT;
+
+    if (fmap_open(&map, name) == FAIL)
+        return FAIL;
+
+    stream_init(s, &map_ops, STREAM_READ);
+    s->map = map;
+    s->buf = (char*)map.base;
+    s->size = s->end = map.size;
+    s->flags |= STREAM_EOF;
+    return OK;
+}
+
+
+#if defined(UNIX)
+
+/*
+ * read from the file descriptor.
+ */
+static ssize_t fd_read(struct stream *self, void *buf, size_t len)
+{
+    ssize_t n;
+
+    do
+        n = read(self->fd, buf, len);
+    while (n < 0 && errno == EINTR);
+    return n;
+}
+
+
+/*
+ * write into the file descriptor.
+ */
+static ssize_t fd_write(struct stream *self, void const *buf, size_t len)
+{
+    ssize_t n;
+
+    do
+        n = write(self->fd, buf, len);
+    while (n < 0 && errno == EINTR);
+    return n;
+}
+
+
+/*
+ * sync the file descriptor, a pipe can't be synced, it's fine.
+ */
+static int fd_sync(struct stream *self)
+{
+    return fsync(self->fd) == 0 || errno == EINVAL ? OK : FAIL;
+}
+
+
+/*
+ * close the file descriptor.
+ */
+static int fd_close(struct stream *self)
+{
+    return close(self->fd) == 0 ? OK : FAIL;
+}
+
+
+/* the operations of files and pipes. */
+static struct stream_ops const fd_ops =
+    { fd_read, fd_write, fd_sync, fd_close };
+
+
+/**
+ * open a file as a stream.
+ */
+int stream_open(struct stream *s, char const *name, int flags)
+{
+    struct stat st;
+    int fd;
+
+    if (flags & STREAM_READ)
+    {
+        /* pipes and devices can't be mapped, read them. */
+        if (stat(name, &st) == 0 && S_ISREG(st.st_mode)
+                && map_open(s, name) == OK)
+            return OK;
+        fd = open(name, O_RDONLY);
+    }
+    else
+        fd = open(name, O_WRONLY | O_CREAT
+                | (flags & STREAM_EXCL ? O_EXCL : O_TRUNC), 0666);
+
+    if (fd < 0)
+        return FAIL;
+    return stream_fdopen(s, fd, flags);
+}
+
+
+/**
+ * open a file descriptor as a stream, e.g. a pipe.
+ */
+int stream_fdopen(struct stream *s, int fd, int flags)
+{
+    stream_init(s, &fd_ops, flags);
+    s->fd = fd;
+    return OK;
+}
+
+#elif defined(WIN32)
+
+/**
+ * open a file as a stream.
+ */
+int stream_open(struct stream *s, char const *name, int flags)
+{
+    return flags & STREAM_READ ? map_open(s, name) : FAIL;
+}
+
+
+/**
+ * open a file descriptor as a stream, e.g. a pipe.
+ */
+int stream_fdopen(struct stream *s, int fd, int flags)
+{
+    return FAIL;
+}
+
+#endif /* defined(UNIX) */
+
+
+/*
+ * write all text into system.
+ */
+static int write_all(struct stream *s, char const *text, size_t len)
+{
+    ssize_t n;
+
+    for (; len != 0; text += n, len -= n)
+        if ((n = s->ops->write(s, text, len)) <= 0)
+        {
+            s->flags |= STREAM_ERROR;
+            return FAIL;
+        }
+    return OK;
+}
+
+
+/*
+ * move the window to the beginning of buffer, and grow the buffer if
+ * it can't contain want bytes.
+ */
+static int make_room(struct stream *s, size_t want)
+{
+    size_t size = s->size == 0 ? STREAM_BUFSIZE : s->size;
+    char *buf;
+
+    if (s->pos != 0)
+    {
+        memmove(s->buf, s->buf + s->pos, s->end - s->pos);
+        s->end -= s->pos;
+        s->pos = 0;
+    }
+
+    while (size < want)
+        size *= 2;
+    if (size != s->size)
+    {
+        buf = s->buf == NULL ? vime_malloc(size) : vime_realloc(s->buf, size);
+        if (buf == NULL)
+            return FAIL;
+        s->buf = buf;
+        s->size = size;
+    }
+    return OK;
+}
+
+
+/**
+ * initialize a stream with its operations.
+ */
+struct stream *stream_init(struct stream *s, struct stream_ops const *ops,
+        int flags)
+{
+    static struct stream const init = STREAM_INIT;
+
+    *s = init;
+    s->ops = ops;
+    s->flags = flags;
+    return s;
+}
+
+
+/**
+ * close a stream, the text not written is flushed.
+ */
+int stream_close(struct stream *s)
+{
+    int retv = OK;
+
+    if ((s->flags & STREAM_WRITE) && stream_flush(s) == FAIL)
+        retv = FAIL;
+
+    /* the mapped text is not the buffer of stream. */
+    if (s->buf != NULL && s->buf != s->map.base)
+        vime_free(s->buf);
+    if (s->ops != NULL && s->ops->close(s) == FAIL)
+        retv = FAIL;
+
+    stream_init(s, NULL, 0);
+    return retv;
+}
+
+
+/**
+ * borrow the window of text not read.
+ */
+char const *stream_borrow(struct stream *s, size_t want, size_t *plen)
+{
+    ssize_t n;
+
+    if (want == 0)
+        want = 1;
+
+    /* the window is used up, fill the buffer from the beginning. */
+    if (s->pos == s->end && !(s->flags & STREAM_EOF))
+        s->pos = s->end = 0;
+
+    while (s->end - s->pos < want
+            && !(s->flags & (STREAM_EOF | STREAM_ERROR)))
+    {
+        if (s->pos + want > s->size && make_room(s, want) == FAIL)
+        {
+            s->flags |= STREAM_ERROR;
+            break;
+        }
+
+        if ((n = s->ops->read(s, s->buf + s->end, s->size - s->end)) < 0)
+            s->flags |= STREAM_ERROR;
+        else if (n == 0)
+            s->flags |= STREAM_EOF;
+        else
+            s->end += n;
+    }
+
+    *plen = s->end - s->pos;
+    return *plen == 0 ? NULL : s->buf + s->pos;
+}
+
+
+/**
+ * release the beginning of the window borrowed, they are read.
+ */
+void stream_release(struct stream *s, size_t used)
+{
+    assert(used <= s->end - s->pos);
+    s->pos += used;
+}
+
+
+/**
+ * read text from stream into a buffer of the caller.
+ */
+size_t stream_read(struct stream *s, void *buf, size_t len)
+{
+    char const *window;
+    size_t done = 0, n;
+
+    while (done < len && (window = stream_borrow(s, 1, &n)) != NULL)
+    {
+        if (n > len - done)
+            n = len - done;
+        memcpy((char*)buf + done, window, n);
+        stream_release(s, n);
+        done += n;
+    }
+    return done;
+}
+
+
+/**
+ * write text into stream, the text is buffered.
+ */
+int stream_write(struct stream *s, void const *buf, size_t len)
+{
+    /* the text after a lost one is useless, e.g. a log with a gap. */
+    if (stream_error(s))
+        return FAIL;
+
+    if (s->buf == NULL && make_room(s, STREAM_BUFSIZE) == FAIL)
+    {
+        s->flags |= STREAM_ERROR;
+        return FAIL;
+    }
+
+    if (s->end + len > s->size && stream_flush(s) == FAIL)
+        return FAIL;
+
+    /* a large text is not copied into buffer. */
+    if (len >= s->size)
+        return write_all(s, buf, len);
+
+    memcpy(s->buf + s->end, buf, len);
+    s->end += len;
+    return OK;
+}
+
+
+/**
+ * write the text buffered into system.
+ */
+int stream_flush(struct stream *s)
+{
+    if (stream_error(s))
+        return FAIL;
+
+    /* the text is kept if write failed, it's not written yet. */
+    if (s->end != 0 && write_all(s, s->buf, s->end) == FAIL)
+        return FAIL;
+    s->end = 0;
+    return OK;
+}
+
+
+/**
+ * write the text buffered, and the data of file into the disk.
+ */
+int stream_sync(struct stream *s)
+{
+    if (stream_flush(s) == FAIL || s->ops->sync(s) == FAIL)
+    {
+        s->flags |= STREAM_ERROR;
+        return FAIL;
+    }
+    return OK;
+}
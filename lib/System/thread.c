@@ -0,0 +1,154 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+/*
+ * the implement of VimE threads.
+ */
+
+
+#include <System/thread.h>
+
+
+#if defined(UNIX)
+
+/*
+ * the start routine of thread.
+ */
+static void *run(void *arg)
+{
+    struct thread *t = arg;
+
+    t->func(t->arg);
+    return NULL;
+}
+
+
+/**
+ * start a new thread.
+ */
+int thread_start(struct thread *t, void (*func)(void *arg), void *arg)
+{
+    t->func = func;
+    t->arg = arg;
+    return pthread_create(&t->handle, NULL, run, t) == 0 ? OK : FAIL;
+}
+
+
+/**
+ * wait a thread to exit.
+ */
+void thread_join(struct thread *t)
+{
+    pthread_join(t->handle, NULL);
+}
+
+
+/**
+ * initialize a mutex.
+ */
+int mutex_init(struct mutex *m)
+{
+    return pthread_mutex_init(&m->handle, NULL) == 0 ? OK : FAIL;
+}
+
+
+/**
+ * destroy a mutex, it must be unlocked.
+ */
+void mutex_drop(struct mutex *m)
+{
+    pthread_mutex_destroy(&m->handle);
+}
+
+
+/**
+ * lock a mutex, wait if it's locked by other thread.
+ */
+void mutex_lock(struct mutex *m)
+{
+    pthread_mutex_lock(&m->handle);
+}
+
+
+/**
+ * unlock a mutex.
+ */
+void mutex_unlock(struct mutex *m)
+{
+    pthread_mutex_unlock(&m->handle);
+}
+
+#elif defined(WIN32)
+
+/*
+ * the start routine of thread.
+ */
+static DWORD WINAPI run(LPVOID arg)
+{
+    struct thread *t = arg;
+
+    t->func(t->arg);
+    return 0;
+}
+
+
+/**
+ * start a new thread.
+ */
+int thread_start(struct thread *t, void (*func)(void *arg), void *arg)
+{
+    t->func = func;
+    t->arg = arg;
+    t->handle = CreateThread(NULL, 0, run, t, 0, NULL);
+    return t->handle == NULL ? FAIL : OK;
+}
+
+
+/**
+ * wait a thread to exit.
+ */
+void thread_join(struct thread *t)
+{
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+}
+
+
+/**
+ * initialize a mutex.
+ */
+int mutex_init(struct mutex *m)
+{
+    InitializeCriticalSection(&m->handle);
+    return OK;
+}
+
+
+/**
+ * destroy a mutex, it must be unlocked.
+ */
+void mutex_drop(struct mutex *m)
+{
+    DeleteCriticalSection(&m->handle);
+}
+
+
+/**
+ * lock a mutex, wait if it's locked by other thread.
+ */
+void mutex_lock(struct mutex *m)
+{
+    EnterCriticalSection(&m->handle);
+}
+
+
+/**
+ * unlock a mutex.
+ */
+void mutex_unlock(struct mutex *m)
+{
+    LeaveCriticalSection(&m->handle);
+}
+
+#endif /* defined(UNIX) */
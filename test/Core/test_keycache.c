@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <Core/keycache.h>
+#include "../test.h"
+
+#define N 20000
+
+/* everything done by keycache, as text: the keys inserted, and the
+ * operators executed as "<c>". */
+static char out[N * 8];
+static size_t out_len, runs;
+
+static struct op_table ops;
+static struct op_entry esc_op = OP_ENTRY_INIT, bs_op = OP_ENTRY_INIT;
+static struct hook_entry esc_action, bs_action, def, insert;
+static struct list_entry esc_list, bs_list, def_list, insert_list;
+
+static struct map_trie maps;
+static struct mapping_key jj = MAPPING_KEY_INIT, ab = MAPPING_KEY_INIT,
+                          abc = MAPPING_KEY_INIT, x = MAPPING_KEY_INIT;
+/* the keys and values of mappings, writable as mapping_key wants. */
+static char lhs[][4] = {"jj", "ab", "abc", "x"};
+static char rhs[][4] = {"\033", "pq", "Z", "[x]"};
+
+static int do_op(struct hook_entry *self, void *args)
+{
+    out[out_len++] = '<';
+    out[out_len++] = (char)*(int*)args;
+    out[out_len++] = '>';
+    return OK;
+}
+
+static int do_default(struct hook_entry *self, void *args)
+{
+    out[out_len++] = (char)*(int*)args;
+    return OK;
+}
+
+static int do_insert(struct hook_entry *self, void *args)
+{
+    struct kc_text *run = args;
+
+    memcpy(out + out_len, run->text, run->len);
+    out_len += run->len;
+    ++runs;
+    return OK;
+}
+
+static void add_hook(struct hook *hook, struct list_entry *list,
+        struct hook_entry *entry, int (*func)(struct hook_entry *, void *))
+{
+    hook_init(hook, list);
+    entry->hook_func = func;
+    hook_add(hook, entry);
+}
+
+static void setup(void)
+{
+    op_table_init(&ops);
+    add_hook(&ops.default_hook, &def_list, &def, do_default);
+    esc_op.command = '\033';
+    add_hook(&esc_op.action, &esc_list, &esc_action, do_op);
+    op_add(&ops, &esc_op);
+    bs_op.command = '\b';
+    add_hook(&bs_op.action, &bs_list, &bs_action, do_op);
+    op_add(&ops, &bs_op);
+
+    map_trie_init(&maps);
+    jj.key = lhs[0], jj.value = rhs[0];
+    ab.key = lhs[1], ab.value = rhs[1];
+    abc.key = lhs[2], abc.value = rhs[2];
+    x.key = lhs[3], x.value = rhs[3];   /* mapped again and again. */
+    map_trie_add(&maps, &jj);
+    map_trie_add(&maps, &ab);
+    map_trie_add(&maps, &abc);
+    map_trie_add(&maps, &x);
+}
+
+/* feed the keys in chunks of random size, return the output. */
+static char *replay(char const *keys, size_t len, int flags, int chunks)
+{
+    struct keycache kc;
+    size_t i, n;
+
+    kc_init(&kc, &maps, &ops);
+    kc.flags = flags;
+    add_hook(&kc.insert_hook, &insert_list, &insert, do_insert);
+    out_len = runs = 0;
+    for (i = 0; i < len; i += n)
+    {
+        n = chunks ? 1 + test_rand() % 64 : len;
+        if (n > len - i)
+            n = len - i;
+        if (kc_feed(&kc, keys + i, n) == FAIL)
+            return NULL;
+    }
+    kc_timeout(&kc);
+    kc_drop(&kc);
+    out[out_len] = '\0';
+    return out;
+}
+
+static int check_case(char const *keys, char const *expect)
+{
+    char *r;
+
+    if ((r = replay(keys, strlen(keys), KC_BATCH, FALSE)) == NULL
+            || strcmp(r, expect) != 0
+            || (r = replay(keys, strlen(keys), KC_FLAGS_CLEAR, TRUE))
+                == NULL || strcmp(r, expect) != 0)
+    {
+        printf("%s: %s\n", keys, r == NULL ? "(null)" : r);
+        return FAIL;
+    }
+    return OK;
+}
+
+static int run(void)
+{
+    static char keys[N], expect[N * 8];
+    size_t i;
+
+    setup();
+    if (check_case("hello", "hello") == FAIL
+            || check_case("ajjb", "a<\033>b") == FAIL
+            || check_case("jaj", "jaj") == FAIL
+            || check_case("abd", "pqd") == FAIL
+            || check_case("abc", "Z") == FAIL
+            || check_case("ab", "pq") == FAIL
+            || check_case("aab\bc", "apq<\b>c") == FAIL)
+        return FAIL;
+
+    /* "x" is mapped to itself, expanded KC_MAP_DEPTH times. */
+    strcpy(expect, "x");
+    for (i = 0; i < KC_MAP_DEPTH; ++i)
+    {
+        memmove(expect + 1, expect, strlen(expect) + 1);
+        expect[0] = '[';
+        strcat(expect, "]");
+    }
+    if (check_case("x", expect) == FAIL)
+        return FAIL;
+
+    /* a long paste is inserted in a few runs. */
+    for (i = 0; i < N; ++i)
+        keys[i] = "hello world\n"[i % 12];
+    if (replay(keys, N, KC_BATCH, FALSE) == NULL || out_len != N
+            || memcmp(out, keys, N) != 0 || runs != 1)
+        return FAIL;
+
+    /* random keys, batched or not, in chunks or not. */
+    for (i = 0; i < N; ++i)
+        keys[i] = "abcdjj\033\b \n"[test_rand() % 10];
+    if (replay(keys, N, KC_FLAGS_CLEAR, FALSE) == NULL)
+        return FAIL;
+    memcpy(expect, out, out_len + 1);
+    if (replay(keys, N, KC_BATCH, FALSE) == NULL
+            || strcmp(out, expect) != 0
+            || replay(keys, N, KC_BATCH, TRUE) == NULL
+            || strcmp(out, expect) != 0
+            || replay(keys, N, KC_FLAGS_CLEAR, TRUE) == NULL
+            || strcmp(out, expect) != 0)
+        return FAIL;
+
+    map_trie_drop(&maps);
+    op_table_drop(&ops);
+    return OK;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("keycache mismatch\n");
+        return 1;
+    }
+
+    printf("keycache ok\n");
+    return 0;
+}
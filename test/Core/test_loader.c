@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <Core/loader.h>
+#include "../test.h"
+
+#define N (4 * 1024 * 1024 + 123)
+#define NAME "test_loader.txt"
+
+static char text[N];
+static char copy[N + 16];
+
+/* lines of random length. */
+static void fill(void)
+{
+    size_t i;
+
+    for (i = 0; i < N; ++i)
+        text[i] = test_rand() % 40 == 0 ? '\n' : 'a' + test_rand() % 26;
+}
+
+/* load the text, and insert a prefix at offset 0 while it's loading. */
+static int load(struct loader *ld, struct memcache *mc)
+{
+    size_t bytes, lines, i;
+    int state, edited = FALSE;
+
+    while ((state = ld_poll(ld)) == LD_BUSY)
+        if (!edited && mc_size(mc) != 0)
+        {
+            if (mc_insert(mc, 0, "<<", 2) == FAIL)
+                return FAIL;
+            edited = TRUE;
+        }
+
+    if (state != LD_DONE || ld_progress(ld, &bytes, &lines) != LD_DONE
+            || bytes != N)
+        return FAIL;
+    for (lines = i = 0; i < N; ++i)
+        lines += text[i] == '\n';
+    ld_close(ld);
+
+    /* the text loaded at the first poll is after the prefix. */
+    if (!edited && mc_insert(mc, 0, "<<", 2) == FAIL)
+        return FAIL;
+    if (mc_size(mc) != N + 2 || mc_read(mc, 0, copy, N + 16) != N + 2
+            || memcmp(copy, "<<", 2) != 0
+            || memcmp(copy + 2, text, N) != 0
+            || mc_line_count(mc) != lines + 1)
+        return FAIL;
+    mc_drop(mc);
+    return OK;
+}
+
+int main(void)
+{
+    struct memcache mc;
+    struct loader ld;
+    struct stream out;
+    pid_t pid;
+    int fds[2], status;
+    FILE *fp;
+
+    fill();
+    if ((fp = fopen(NAME, "wb")) == NULL || fwrite(text, 1, N, fp) != N
+            || fclose(fp) != 0)
+    {
+        printf("can't write " NAME "\n");
+        return 1;
+    }
+
+    /* the file is mapped. */
+    mc_init(&mc);
+    if (ld_open(&ld, &mc, NAME) == FAIL || ld.size != N
+            || load(&ld, &mc) == FAIL)
+    {
+        printf("loader of file mismatch\n");
+        remove(NAME);
+        return 1;
+    }
+    remove(NAME);
+
+    /* the text comes from a pipe. */
+    if (pipe(fds) != 0 || (pid = fork()) < 0)
+        return 1;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        stream_fdopen(&out, fds[1], STREAM_WRITE);
+        _exit(stream_write(&out, text, N) == OK
+                && stream_close(&out) == OK ? 0 : 1);
+    }
+    close(fds[1]);
+
+    mc_init(&mc);
+    if (ld_fdopen(&ld, &mc, fds[0]) == FAIL || ld.size != MC_NPOS
+            || load(&ld, &mc) == FAIL
+            || waitpid(pid, &status, 0) != pid || status != 0)
+    {
+        printf("loader of pipe mismatch\n");
+        return 1;
+    }
+
+    printf("loader ok\n");
+    return 0;
+}
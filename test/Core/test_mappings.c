@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <Core/mappings.h>
+#include "../test.h"
+
+/* all lhs of 1 to 4 bytes from "abc", and some long ones from 'd'. */
+#define N (3 + 9 + 27 + 81 + 8)
+
+static struct mapping_key maps[N];
+static char lhs[N][40];
+static int used[N];
+
+/* the expected result of matching keys, by the model. */
+static int model_match(char const *keys, size_t len, int *pfull)
+{
+    int i, prefix = FALSE;
+
+    *pfull = -1;
+    for (i = 0; i < N; ++i)
+        if (used[i] && strncmp(lhs[i], keys, len) == 0)
+        {
+            if (lhs[i][len] == '\0')
+                *pfull = i;
+            else
+                prefix = TRUE;
+        }
+    return *pfull < 0 ? prefix ? MAP_PREFIX : MAP_NONE
+        : prefix ? MAP_AMBIGUOUS : MAP_FULL;
+}
+
+static int check(struct map_trie *trie)
+{
+    struct map_match match;
+    char keys[40];
+    size_t i, len, count = 0, full_len = 0;
+    int k, r, expect, full, last = -1;
+
+    for (k = 0; k < N; ++k)
+    {
+        if (map_trie_lookup(trie, lhs[k]) != (used[k] ? &maps[k] : NULL))
+            return FAIL;
+        count += used[k];
+    }
+    if (trie->count != count)
+        return FAIL;
+
+    /* match random input, and the long lhs. */
+    for (i = 0; i < 200; ++i)
+    {
+        if (i < 8)
+            strcpy(keys, lhs[N - 8 + i]);
+        else
+        {
+            len = 1 + test_rand() % 8;
+            for (k = 0; k < (int)len; ++k)
+                keys[k] = "abcd"[test_rand() % 4];
+            keys[len] = '\0';
+        }
+
+        map_match_init(&match, trie);
+        last = -1;
+        for (len = 1; keys[len - 1] != '\0'; ++len)
+        {
+            r = map_match_feed(&match, keys[len - 1]);
+            expect = model_match(keys, len, &full);
+            if (r != expect)
+                return FAIL;
+            if (full >= 0)
+            {
+                last = full;
+                full_len = len;
+            }
+            if (r == MAP_NONE || r == MAP_FULL)
+                break;
+        }
+        if ((last < 0 ? match.full != NULL : match.full != &maps[last]
+                    || match.full_len != full_len))
+            return FAIL;
+    }
+    return OK;
+}
+
+static int run(void)
+{
+    struct map_trie trie = MAP_TRIE_INIT;
+    struct mapping_key empty = MAPPING_KEY_INIT;
+    static char nokey[] = "";
+    int i, j, k, n;
+
+    /* fill lhs: "a".."c", "aa".."cc", ... */
+    for (n = 3, k = 0; n <= 81; n *= 3)
+        for (j = 0; j < n; ++j, ++k)
+        {
+            int v = j, len = 0;
+
+            for (i = n; i > 1; i /= 3)
+                lhs[k][len++] = "abc"[v % 3], v /= 3;
+            lhs[k][len] = '\0';
+        }
+    for (; k < N; ++k)
+    {
+        lhs[k][0] = 'd';
+        for (i = 1; i < 39; ++i)
+            lhs[k][i] = "abcd"[(k + i * i) % 4];
+        lhs[k][3 + k % 30] = '\0';
+    }
+    for (k = 0; k < N; ++k)
+        maps[k].key = lhs[k];
+
+    map_trie_init(&trie);
+    empty.key = nokey;
+    if (map_trie_add(&trie, &empty) != FAIL)
+        return FAIL;
+
+    for (i = 0; i < 5000; ++i)
+    {
+        k = (int)(test_rand() % N);
+        if (!used[k])
+        {
+            if (map_trie_add(&trie, &maps[k]) == FAIL)
+                return FAIL;
+            used[k] = TRUE;
+        }
+        else if (test_rand() % 3 == 0)
+        {
+            /* the same lhs can't be mapped twice. */
+            empty.key = lhs[k];
+            if (map_trie_add(&trie, &empty) != FAIL
+                    || map_trie_remove(&trie, &empty) != FAIL)
+                return FAIL;
+        }
+        else
+        {
+            if (map_trie_remove(&trie, &maps[k]) == FAIL)
+                return FAIL;
+            used[k] = FALSE;
+        }
+
+        if (i % 50 == 0 && check(&trie) == FAIL)
+            return FAIL;
+    }
+
+    /* all nodes are freed after all mappings are removed. */
+    for (k = 0; k < N; ++k)
+        if (used[k])
+        {
+            map_trie_remove(&trie, &maps[k]);
+            used[k] = FALSE;
+        }
+    if (check(&trie) == FAIL || trie.root.child != NULL
+            || trie.edges.size != 0)
+        return FAIL;
+
+    for (k = 0; k < N; ++k)
+        map_trie_add(&trie, &maps[k]);
+    map_trie_drop(&trie);
+    return OK;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("mappings mismatch\n");
+        return 1;
+    }
+
+    printf("mappings ok\n");
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <Core/memcache.h>
+#include "../test.h"
+
+#define N 100000
+#define MARKS 1000
+
+/* a plain copy of the text, used to check memcache. */
+static char model[N * 4], buf[N * 4];
+static size_t model_len;
+
+/* the marks, and their offsets. */
+static struct mc_mark marks[MARKS];
+static size_t mark_offs[MARKS];
+
+static int check_lines(struct memcache *mc, int step)
+{
+    size_t i, lnum = 0, begin = 0;
+
+    for (i = 0; i <= model_len; ++i)
+    {
+        if (mc_offset_line(mc, i) != lnum)
+            break;
+        if (i == model_len || model[i] == '\n')
+        {
+            if (mc_line_offset(mc, lnum) != begin
+                    || mc_line_length(mc, lnum) != i - begin)
+                break;
+            ++lnum;
+            begin = i + 1;
+        }
+    }
+
+    if (i <= model_len || mc_line_count(mc) != lnum
+            || mc_line_offset(mc, lnum) != MC_NPOS)
+    {
+        printf("memcache line index mismatch at step %d\n", step);
+        return FAIL;
+    }
+    return OK;
+}
+
+static int check_marks(struct memcache *mc, int step)
+{
+    struct mc_mark *mark, *next;
+    size_t i, rank;
+
+    for (i = 0; i < MARKS; ++i)
+        if (mc_mark_offset(&marks[i]) != mark_offs[i])
+            break;
+
+    /* marks are in order, and rank and select agree. */
+    mark = mc_mark_select(mc, 0);
+    for (rank = 0; i == MARKS && mark != NULL; mark = next, ++rank)
+    {
+        next = mc_mark_next(mark);
+        if (mc_mark_rank(mark) != rank || mc_mark_select(mc, rank) != mark
+                || (next != NULL
+                    && mc_mark_offset(next) < mc_mark_offset(mark))
+                || mc_mark_offset(mc_mark_find(mc, mc_mark_offset(mark)))
+                    != mc_mark_offset(mark))
+            break;
+    }
+
+    if (i != MARKS || rank != MARKS || mc_mark_count(mc) != MARKS
+            || mc_mark_select(mc, MARKS) != NULL
+            || mc_mark_find(mc, model_len + 1) != NULL)
+    {
+        printf("memcache marks mismatch at step %d\n", step);
+        return FAIL;
+    }
+    return OK;
+}
+
+static int check(struct memcache *mc, int step)
+{
+    if (mc_size(mc) != model_len
+            || mc_read(mc, 0, buf, sizeof(buf)) != model_len
+            || memcmp(buf, model, model_len) != 0)
+    {
+        printf("memcache mismatch at step %d\n", step);
+        return FAIL;
+    }
+    return check_lines(mc, step);
+}
+
+int main(void)
+{
+    static char orig[N];
+    struct memcache mc;
+    size_t i, k, off, len;
+    char text[16];
+    FILE *fp;
+
+    for (i = 0; i < N; ++i)
+        orig[i] = i % 61 == 60 ? '\n' : 'a' + i % 26;
+    memcpy(model, orig, N);
+    model_len = N;
+
+    mc_init(&mc);
+    mc_load(&mc, orig, N);
+    for (i = 0; i < MARKS; ++i)
+    {
+        mark_offs[i] = i * 97 % (N + 1);
+        mc_mark_add(&mc, &marks[i], mark_offs[i]);
+    }
+    if (check(&mc, -1) != OK || check_marks(&mc, -1) != OK)
+        return 1;
+
+    for (i = 0; i < 20000; ++i)
+    {
+        off = (test_rand() << 15 | test_rand()) % (model_len + 1);
+        len = test_rand() % sizeof(text);
+
+        if (i % 3 != 2)
+        {
+            memset(text, 'A' + i % 26, len);
+            if (len != 0 && i % 5 == 0)
+                text[test_rand() % len] = '\n';
+            mc_insert(&mc, off, text, len);
+            memmove(&model[off + len], &model[off], model_len - off);
+            memcpy(&model[off], text, len);
+            model_len += len;
+            for (k = 0; k < MARKS; ++k)
+                if (mark_offs[k] >= off)
+                    mark_offs[k] += len;
+        }
+        else
+        {
+            if (len > model_len - off)
+                len = model_len - off;
+            mc_delete(&mc, off, len);
+            memmove(&model[off], &model[off + len], model_len - off - len);
+            model_len -= len;
+            for (k = 0; k < MARKS; ++k)
+                if (mark_offs[k] >= off + len)
+                    mark_offs[k] -= len;
+                else if (mark_offs[k] >= off)
+                    mark_offs[k] = off;
+        }
+
+        if (i % 1000 == 0 && (check(&mc, (int)i) != OK
+                    || check_marks(&mc, (int)i) != OK))
+            return 1;
+    }
+
+    if (check(&mc, (int)i) != OK || check_marks(&mc, (int)i) != OK)
+        return 1;
+
+    /* a mark removed is not moved any more. */
+    mc_mark_remove(&mc, &marks[0]);
+    if (mc_mark_count(&mc) != MARKS - 1
+            || mc_mark_add(&mc, &marks[0], model_len + 1) != FAIL
+            || mc_mark_add(&mc, &marks[0], mark_offs[0]) != OK
+            || check_marks(&mc, -3) != OK)
+        return 1;
+
+    if (mc_delete(&mc, 0, model_len + 1) != FAIL
+            || mc_insert(&mc, model_len + 1, "x", 1) != FAIL)
+    {
+        printf("memcache accepts invalid range\n");
+        return 1;
+    }
+
+    mc_drop(&mc);
+
+    /* map the text back from a file, and edit it before any line is
+     * counted. */
+    if ((fp = fopen("test_memcache.txt", "wb")) == NULL
+            || fwrite(model, 1, model_len, fp) != model_len
+            || fclose(fp) != 0)
+    {
+        printf("can't write test_memcache.txt\n");
+        return 1;
+    }
+
+    mc_init(&mc);
+    if (mc_open(&mc, "test_memcache.txt") != OK)
+    {
+        printf("can't map test_memcache.txt\n");
+        return 1;
+    }
+
+    off = model_len / 3;
+    mc_delete(&mc, off, 100);
+    memmove(&model[off], &model[off + 100], model_len - off - 100);
+    model_len -= 100;
+    mc_insert(&mc, off, "\n", 1);
+    memmove(&model[off + 1], &model[off], model_len - off);
+    model[off] = '\n';
+    model_len += 1;
+
+    if (check(&mc, -2) != OK)
+        return 1;
+
+    /* save the edited text over the mapped file itself, the runs of
+     * original text are copied from it. */
+    if (mc_save(&mc, "test_memcache.txt") != OK
+            || (fp = fopen("test_memcache.txt", "rb")) == NULL
+            || fread(buf, 1, sizeof(buf), fp) != model_len
+            || fclose(fp) != 0
+            || memcmp(buf, model, model_len) != 0
+            || check(&mc, -3) != OK)
+    {
+        printf("memcache save mismatch\n");
+        return 1;
+    }
+
+    mc_drop(&mc);
+    remove("test_memcache.txt");
+    printf("memcache ok\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <Core/operator.h>
+
+#define N 700
+
+static struct op_entry ops[N];
+static struct hook_entry actions[N], def;
+static struct list_entry lists[N], def_list;
+static char names[N][8];
+
+/* the command executed last, and by whom. */
+static int last_cmd, last_op;
+
+static int do_action(struct hook_entry *self, void *args)
+{
+    int i = (int)(self - actions);
+
+    last_cmd = *(int*)args;
+    last_op = i;
+    /* the actions of odd operators are invalid. */
+    return i % 2 ? FAIL : OK;
+}
+
+static int do_default(struct hook_entry *self, void *args)
+{
+    last_cmd = *(int*)args;
+    last_op = -1;
+    return OK;
+}
+
+/* the command of operator i, half of them are not fast. */
+static int command(int i)
+{
+    return i < N / 2 ? i : i * 1000 + OP_FAST_MAX;
+}
+
+static int check(struct op_table *table, int removed)
+{
+    int i, expect;
+
+    for (i = 0; i < N; ++i)
+    {
+        if (op_lookup(table, command(i)) != (i < removed ? NULL : &ops[i])
+                || op_find(table, names[i])
+                    != (i < removed ? NULL : &ops[i]))
+            return FAIL;
+
+        last_cmd = last_op = -2;
+        expect = i < removed || i % 2 ? -1 : i;
+        if (op_exec(table, command(i)) != OK || last_cmd != command(i)
+                || last_op != expect)
+            return FAIL;
+    }
+    return op_lookup(table, -1) == NULL && op_lookup(table, 511) == NULL
+        ? OK : FAIL;
+}
+
+static int run(void)
+{
+    struct op_table *table = op_table_alloc();
+    struct op_entry dup = OP_ENTRY_INIT;
+    int i;
+
+    if (table == NULL)
+        return FAIL;
+    def.hook_func = do_default;
+    list_init(&def_list);
+    list_append(&def_list, &def.node);
+    table->default_hook.hook_list = &def_list;
+
+    for (i = 0; i < N; ++i)
+    {
+        sprintf(names[i], "op%d", i);
+        ops[i].name = names[i];
+        ops[i].command = command(i);
+        actions[i].hook_func = do_action;
+        list_init(&lists[i]);
+        list_append(&lists[i], &actions[i].node);
+        ops[i].action.hook_list = &lists[i];
+        if (op_add(table, &ops[i]) == FAIL)
+            return FAIL;
+    }
+    if (check(table, 0) == FAIL)
+        return FAIL;
+
+    /* the command or the name is used already. */
+    dup.command = command(3);
+    if (op_add(table, &dup) != FAIL)
+        return FAIL;
+    dup.command = command(N - 1);
+    if (op_add(table, &dup) != FAIL)
+        return FAIL;
+    dup.command = -1;
+    dup.name = names[5];
+    if (op_add(table, &dup) != FAIL || check(table, 0) == FAIL)
+        return FAIL;
+
+    for (i = 0; i < N / 4; ++i)
+    {
+        op_remove(table, &ops[i]);
+        op_remove(table, &ops[N / 2 + i]);
+    }
+    for (i = 0; i < N / 4; ++i)
+        if (op_lookup(table, command(N / 2 + i)) != NULL)
+            return FAIL;
+    for (i = 0; i < N / 4; ++i)
+        if (op_add(table, &ops[N / 2 + i]) == FAIL)
+            return FAIL;
+    if (check(table, N / 4) == FAIL)
+        return FAIL;
+
+    op_table_free(table);
+    return OK;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("operator mismatch\n");
+        return 1;
+    }
+
+    printf("operator ok\n");
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <Core/swapfile.h>
+#include "../test.h"
+
+#define N (256 * 1024)
+#define EDITS 40000
+#define MAX (8 * 1024 * 1024)
+#define ORIG "test_swapfile.txt"
+#define SWAP "test_swapfile.swp"
+
+/* a plain copy of the text, and the copy at the last sync. */
+static char model[MAX], synced[MAX], buf[MAX];
+static size_t model_len, synced_len;
+
+/* a random edit on memcache and model: insert, delete, or attach a
+ * part of the original file. */
+static int edit(struct memcache *mc)
+{
+    size_t offset = model_len == 0 ? 0 : test_rand() * 31 % model_len;
+    size_t len = test_rand() % 64, from, i;
+    char text[64];
+    int op = test_rand() % 8;
+
+    if (op < 4)
+    {
+        for (i = 0; i < len; ++i)
+            text[i] = i % 16 == 15 ? '\n' : 'a' + test_rand() % 26;
+        if (mc_insert(mc, offset, text, len) == FAIL)
+            return FAIL;
+        memmove(model + offset + len, model + offset, model_len - offset);
+        memcpy(model + offset, text, len);
+        model_len += len;
+    }
+    else if (op < 7)
+    {
+        if (len > model_len - offset)
+            len = model_len - offset;
+        if (mc_delete(mc, offset, len) == FAIL)
+            return FAIL;
+        memmove(model + offset, model + offset + len,
+                model_len - offset - len);
+        model_len -= len;
+    }
+    else
+    {
+        len *= 16;
+        from = test_rand() * 7 % (mc->file.size - len);
+        if (mc_attach(mc, offset, mc->file.base + from, len, MC_NPOS)
+                == FAIL)
+            return FAIL;
+        memmove(model + offset + len, model + offset, model_len - offset);
+        memcpy(model + offset, mc->file.base + from, len);
+        model_len += len;
+    }
+    return model_len + 4096 < MAX ? OK : FAIL;
+}
+
+/* recover the swapfile, and compare it with text. */
+static int recover(char const *text, size_t len)
+{
+    struct memcache mc;
+    int retv;
+
+    mc_init(&mc);
+    retv = swp_recover(&mc, SWAP, NULL) == OK && mc_size(&mc) == len
+        && mc_read(&mc, 0, buf, MAX) == len && memcmp(buf, text, len) == 0
+        && mc.file.base != NULL ? OK : FAIL;
+    mc_drop(&mc);
+    return retv;
+}
+
+int main(void)
+{
+    struct memcache mc;
+    struct swapfile sw, other;
+    size_t i;
+    FILE *fp;
+
+    for (i = 0; i < N; ++i)
+        model[i] = i % 80 == 79 ? '\n' : 'A' + test_rand() % 26;
+    model_len = N;
+    remove(SWAP);
+    if ((fp = fopen(ORIG, "wb")) == NULL
+            || fwrite(model, 1, N, fp) != N || fclose(fp) != 0)
+    {
+        printf("can't write " ORIG "\n");
+        return 1;
+    }
+
+    mc_init(&mc);
+    if (mc_open(&mc, ORIG) == FAIL
+            || swp_create(&sw, &mc, SWAP, ORIG) == FAIL)
+    {
+        printf("can't create " SWAP "\n");
+        return 1;
+    }
+    if (recover(model, model_len) == FAIL)
+    {
+        printf("recover of checkpoint mismatch\n");
+        return 1;
+    }
+
+    /* the swapfile of a crashed VimE is not overwritten. */
+    mc.swap = NULL;
+    if (swp_create(&other, &mc, SWAP, ORIG) == OK)
+    {
+        printf("swapfile overwritten\n");
+        return 1;
+    }
+    mc.swap = &sw;
+
+    /* the log is replayed, after the checkpoint rewritten, too. */
+    for (i = 0; i < EDITS; ++i)
+    {
+        if (edit(&mc) == FAIL)
+        {
+            printf("edit %lu failed\n", (unsigned long)i);
+            return 1;
+        }
+        if (i % 5000 == 4999)
+        {
+            if ((i % 10000 == 9999 ? swp_checkpoint(&sw) : swp_sync(&sw))
+                    == FAIL || recover(model, model_len) == FAIL)
+            {
+                printf("recover at %lu mismatch\n", (unsigned long)i);
+                return 1;
+            }
+            memcpy(synced, model, model_len);
+            synced_len = model_len;
+        }
+    }
+    /* the changes after a failed write are in the next checkpoint. */
+    sw.stream.flags |= STREAM_ERROR;
+    for (i = 0; i < 100; ++i)
+        if (edit(&mc) == FAIL)
+        {
+            printf("edit after error failed\n");
+            return 1;
+        }
+    if (swp_sync(&sw) == FAIL || stream_error(&sw.stream)
+            || recover(model, model_len) == FAIL)
+    {
+        printf("recover after failed write mismatch\n");
+        return 1;
+    }
+
+    /* the swapfile refers to the new file saved over the original. */
+    if (mc_save(&mc, ORIG) == FAIL || recover(model, model_len) == FAIL)
+    {
+        printf("recover after save mismatch\n");
+        return 1;
+    }
+    for (i = 0; i < 1000; ++i)
+        if (edit(&mc) == FAIL)
+        {
+            printf("edit after save failed\n");
+            return 1;
+        }
+    if (swp_sync(&sw) == FAIL || recover(model, model_len) == FAIL)
+    {
+        printf("recover of edits after save mismatch\n");
+        return 1;
+    }
+    memcpy(synced, model, model_len);
+    synced_len = model_len;
+
+    /* the record written partly by a crash is ignored. */
+    if (mc_insert(&mc, 0, "torn", 4) == FAIL
+            || stream_flush(&sw.stream) == FAIL
+            || truncate(SWAP, lseek(sw.stream.fd, 0, SEEK_CUR) - 2) != 0
+            || recover(synced, synced_len) == FAIL)
+    {
+        printf("recover of torn record mismatch\n");
+        return 1;
+    }
+
+    /* the original file replaced by others is not recovered. */
+    if (rename(ORIG, ORIG "~") != 0 || (fp = fopen(ORIG, "wb")) == NULL
+            || fwrite(mc.file.base, 1, mc.file.size, fp) != mc.file.size
+            || fclose(fp) != 0 || recover(synced, synced_len) == OK
+            || rename(ORIG "~", ORIG) != 0
+            || recover(synced, synced_len) == FAIL)
+    {
+        printf("recover of replaced file succeeded\n");
+        return 1;
+    }
+
+    /* a broken swapfile is not recovered. */
+    if (pwrite(sw.stream.fd, "X", 1, 0) != 1
+            || recover(synced, synced_len) == OK)
+    {
+        printf("recover of broken swapfile succeeded\n");
+        return 1;
+    }
+
+    if (swp_close(&sw, TRUE) == FAIL || mc.swap != NULL
+            || access(SWAP, F_OK) == 0)
+    {
+        printf("swapfile not removed\n");
+        return 1;
+    }
+    mc_drop(&mc);
+    remove(ORIG);
+
+    printf("swapfile ok\n");
+    return 0;
+}
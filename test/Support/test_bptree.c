@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <Support/bptree.h>
+#include "../test.h"
+
+#define N 20000
+#define KEYS 5000
+
+/* the model: keys and values in order, equal keys by insert order. */
+static bpt_key_t keys[N];
+static void *values[N];
+static size_t count = 0;
+
+/* check a subtree, return the items of it, or -1 if it's broken. */
+static long check_node(struct bptree *bpt, void *node, size_t h,
+        bpt_key_t low, bpt_key_t high, struct bpt_leaf **pleaf)
+{
+    size_t i, total = 0;
+    long size;
+
+    /* the nodes are aligned to cache lines. */
+    if ((size_t)node % 64 != 0)
+        return -1;
+
+    if (h == bpt->height)
+    {
+        struct bpt_leaf *leaf = node;
+
+        if (leaf->count == 0 || leaf->count > BPT_LEAF_MAX
+                || (node != bpt->root && leaf->count < BPT_LEAF_MIN)
+                || leaf->prev != *pleaf
+                || (*pleaf != NULL && (*pleaf)->next != leaf))
+            return -1;
+        for (i = 0; i < leaf->count; ++i)
+            if (leaf->keys[i] < low || leaf->keys[i] > high
+                    || (i > 0 && leaf->keys[i] < leaf->keys[i - 1]))
+                return -1;
+        *pleaf = leaf;
+        return (long)leaf->count;
+    }
+    else
+    {
+        struct bpt_inner *inner = node;
+
+        if (inner->count < 2 || inner->count > BPT_INNER_MAX
+                || (node != bpt->root && inner->count < BPT_INNER_MIN))
+            return -1;
+        for (i = 0; i < inner->count; ++i)
+        {
+            size = check_node(bpt, inner->children[i], h + 1,
+                    i == 0 ? low : inner->keys[i - 1],
+                    i == inner->count - 1 ? high : inner->keys[i], pleaf);
+            if (size < 0 || (size_t)size != inner->sizes[i])
+                return -1;
+            total += (size_t)size;
+        }
+        return (long)total;
+    }
+}
+
+static int check(struct bptree *bpt)
+{
+    struct bpt_leaf *leaf = NULL;
+    struct bpt_iter it;
+    size_t i;
+
+    if (bpt->size != count)
+        return FAIL;
+    if (bpt->root == NULL)
+        return count == 0 && bpt_first(bpt, &it) == FAIL ? OK : FAIL;
+    if (check_node(bpt, bpt->root, 0, 0, (bpt_key_t)-1, &leaf)
+            != (long)count || leaf->next != NULL)
+        return FAIL;
+
+    /* iterate forward and backward. */
+    if (bpt_first(bpt, &it) == FAIL)
+        return FAIL;
+    for (i = 0; i < count; ++i, bpt_next(&it))
+        if (it.leaf == NULL || bpt_iter_key(&it) != keys[i]
+                || bpt_iter_value(&it) != values[i])
+            return FAIL;
+    if (it.leaf != NULL || bpt_last(bpt, &it) == FAIL)
+        return FAIL;
+    for (i = count; i > 0; --i, bpt_prev(&it))
+        if (it.leaf == NULL || bpt_iter_value(&it) != values[i - 1])
+            return FAIL;
+    return it.leaf == NULL ? OK : FAIL;
+}
+
+/* the rank of the first key not smaller (or bigger) than key. */
+static size_t model_bound(bpt_key_t key, int upper)
+{
+    size_t low = 0, high = count, mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (keys[mid] < key || (upper && keys[mid] == key))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static int check_key(struct bptree *bpt, bpt_key_t key)
+{
+    struct bpt_iter it;
+    size_t rank;
+    int upper;
+
+    for (upper = 0; upper < 2; ++upper)
+    {
+        rank = model_bound(key, upper);
+        if (bpt_bound(bpt, key, upper, &it) != rank
+                || (rank == count ? it.leaf != NULL
+                    : it.leaf == NULL || bpt_iter_value(&it) != values[rank]))
+            return FAIL;
+    }
+    rank = model_bound(key, FALSE);
+    if (bpt_lookup(bpt, key) != (rank < count && keys[rank] == key
+                ? values[rank] : NULL))
+        return FAIL;
+    return OK;
+}
+
+static int run(void)
+{
+    struct bptree bpt = BPTREE_INIT;
+    struct bpt_iter it;
+    size_t i, k, rank;
+    void *value;
+
+    bpt_init(&bpt);
+    for (i = 0; i < 200000; ++i)
+    {
+        bpt_key_t key = (bpt_key_t)(test_rand() % KEYS);
+        unsigned long op = test_rand() % 8;
+
+        if (op < 4 + (i / 50000) % 2 && count < N)
+        {
+            rank = model_bound(key, TRUE);
+            memmove(&keys[rank + 1], &keys[rank],
+                    (count - rank) * sizeof(bpt_key_t));
+            memmove(&values[rank + 1], &values[rank],
+                    (count - rank) * sizeof(void*));
+            keys[rank] = key;
+            values[rank] = (void*)(i + 1);
+            ++count;
+            if (bpt_insert(&bpt, key, (void*)(i + 1)) == FAIL)
+                return FAIL;
+        }
+        else if (op < 6)
+        {
+            rank = model_bound(key, FALSE);
+            if (rank < count && keys[rank] == key)
+            {
+                if (bpt_remove(&bpt, key, &value) == FAIL
+                        || value != values[rank])
+                    return FAIL;
+                --count;
+                memmove(&keys[rank], &keys[rank + 1],
+                        (count - rank) * sizeof(bpt_key_t));
+                memmove(&values[rank], &values[rank + 1],
+                        (count - rank) * sizeof(void*));
+            }
+            else if (bpt_remove(&bpt, key, &value) != FAIL)
+                return FAIL;
+        }
+        else if (op < 7 && count > 0)
+        {
+            rank = (size_t)test_rand() * 7 % count;
+            if (bpt_select(&bpt, rank, &it) == FAIL
+                    || bpt_iter_value(&it) != values[rank]
+                    || bpt_remove_rank(&bpt, rank, &value) == FAIL
+                    || value != values[rank])
+                return FAIL;
+            --count;
+            memmove(&keys[rank], &keys[rank + 1],
+                    (count - rank) * sizeof(bpt_key_t));
+            memmove(&values[rank], &values[rank + 1],
+                    (count - rank) * sizeof(void*));
+        }
+        else if (check_key(&bpt, key) == FAIL)
+            return FAIL;
+
+        if (i % 5000 == 0 && check(&bpt) == FAIL)
+            return FAIL;
+    }
+    if (check(&bpt) == FAIL || bpt_select(&bpt, count, &it) != FAIL)
+        return FAIL;
+
+    /* remove all, from the middle. */
+    while (count > 0)
+    {
+        k = count / 2;
+        if (bpt_remove_rank(&bpt, k, &value) == FAIL
+                || value != values[k])
+            return FAIL;
+        --count;
+        memmove(&keys[k], &keys[k + 1], (count - k) * sizeof(bpt_key_t));
+        memmove(&values[k], &values[k + 1], (count - k) * sizeof(void*));
+    }
+    if (check(&bpt) == FAIL || bpt.root != NULL || bpt.height != 0)
+        return FAIL;
+
+    bpt_drop(&bpt);
+    return OK;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("bptree mismatch\n");
+        return 1;
+    }
+
+    printf("bptree ok\n");
+    return 0;
+}
@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <Support/hashtab.h>
+#include "../test.h"
 
 struct node
 {
     struct hash_entry entry;
+    char name[16];
 };
 
 #define NODE_ENTRY(ptr) HASH_ENTRY((ptr), struct node, entry)
@@ -11,9 +13,98 @@ struct node
 
 #define N 1000
 struct node array[N];
+
+#define M 20000
+static struct node nodes[M];
+static int present[M];
+
+/* random inserts and removes, checked against present[]. */
+static int run(int flags)
+{
+    struct fast_hashtable table = FAST_HASHTABLE_INIT;
+    struct hashtable *hashtab = HASHTABLE(&table);
+    int i, k, resized = 0;
+
+    ht_init(hashtab)->flags |= flags;
+    memset(present, 0, sizeof(present));
+    for (i = 0; i < 200000; ++i)
+    {
+        /* grow for the first half, and shrink for the second half. */
+        k = (test_rand() << 15 | test_rand()) % M;
+        if ((test_rand() % 4 != 0) == (i < 100000))
+        {
+            if (ht_insert(hashtab, &nodes[k].entry) != &nodes[k].entry)
+                return FAIL;
+            present[k] = 1;
+        }
+        else if (ht_remove(hashtab, nodes[k].name)
+                != (present[k] ? &nodes[k].entry : NULL))
+            return FAIL;
+        else
+            present[k] = 0;
+
+        resized |= hashtab->oldarray != NULL;
+        if (i % 10000 == 0)
+        {
+            size_t count = 0;
+            for (k = 0; k < M; ++k)
+            {
+                if (ht_lookup(hashtab, nodes[k].name)
+                        != (present[k] ? &nodes[k].entry : NULL))
+                    return FAIL;
+                count += present[k];
+            }
+            if (count != hashtab->size)
+                return FAIL;
+        }
+    }
+
+    ht_clear(hashtab);
+    if (ht_lookup(hashtab, nodes[0].name) != NULL
+            || (hashtab->flags & flags) != flags
+            || resized != ((flags & HF_INCREMENTAL) != 0))
+        return FAIL;
+    ht_drop(hashtab);
+    return OK;
+}
+
+/* the hash of a key with length, and lookups by a slice of text. */
+static int check_hash(void)
+{
+    static char const text[] = "let keyword = node42 + node7;";
+    struct fast_hashtable table = FAST_HASHTABLE_INIT;
+    struct hashtable *hashtab = HASHTABLE(&table);
+    size_t len, diff = 0;
+    char buf[64];
+
+    for (len = 0; len < sizeof(buf); ++len)
+    {
+        memset(buf, 'x', len);
+        buf[len] = '\0';
+        if (ht_hash_bytes(buf, len) != ht_default_hash(buf))
+            return FAIL;
+        diff += len > 0 && ht_hash_bytes(buf, len)
+            != ht_hash_bytes(buf, len - 1);
+    }
+    if (diff != sizeof(buf) - 1)
+        return FAIL;
+
+    ht_init(hashtab);
+    ht_insert(hashtab, &nodes[42].entry);
+    ht_insert(hashtab, &nodes[7].entry);
+    if (ht_lookup_len(hashtab, text + 14, 6) != &nodes[42].entry
+            || ht_lookup_len(hashtab, text + 23, 5) != &nodes[7].entry
+            || ht_lookup_len(hashtab, text + 14, 5) != NULL
+            || ht_lookup_len(hashtab, text + 4, 7) != NULL)
+        return FAIL;
+    ht_drop(hashtab);
+    return OK;
+}
+
 int main(void)
 {
     struct fast_hashtable table = FAST_HASHTABLE_INIT;
+    int i;
 
     ht_init(HASHTABLE(&table));
     ht_drop(HASHTABLE(&table));
@@ -28,6 +119,20 @@ int main(void)
     printf("%p\n",
         ht_lookup(HASHTABLE(&table), node_key(&array[0])));
     ht_drop(HASHTABLE(&table));
+
+    for (i = 0; i < M; ++i)
+    {
+        sprintf(nodes[i].name, "node%d", i);
+        nodes[i].entry.key = nodes[i].name;
+    }
+    if (run(HF_DEFAULT) == FAIL || run(HF_INCREMENTAL) == FAIL
+            || check_hash() == FAIL)
+    {
+        printf("hashtable mismatch\n");
+        return 1;
+    }
+
+    printf("hashtable ok\n");
     return 0;
 }
 /* cc: flags+='-I.. -I../../utils/nedmalloc' */
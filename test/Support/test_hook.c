@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <Support/hook.h>
+
+#define N 64
+
+static struct hook hook;
+static struct list_entry list;
+static struct hook_entry entries[N], extra;
+
+/* the entries called, in order. */
+static int called[N * 2];
+static int ncalled;
+
+/* the entry that break the call, and the entry that change hook. */
+static int breaker = -1, changer = -1;
+
+static int record(struct hook_entry *self, void *args)
+{
+    int i = (int)(self - entries);
+
+    called[ncalled++] = self == &extra ? N : i;
+    ++*(int*)args;
+    if (i == changer)
+    {
+        /* remove itself and add extra, used from the next call. */
+        hook_remove(&hook, self);
+        hook_add(&hook, &extra);
+        changer = -1;
+    }
+    return i == breaker ? -1 : OK;
+}
+
+/* the entries called by check_filter(). */
+static int filtered[N];
+
+static int record_filter(struct hook_entry *self, void *args)
+{
+    filtered[self - entries] = ++*(int*)args;
+    return OK;
+}
+
+/* check the entries called are the entries matched, in priority order. */
+static int check_filter(unsigned long mask, unsigned long key)
+{
+    int i, j, arg = 0, count = 0;
+
+    memset(filtered, 0, sizeof(filtered));
+    hook_call_filter(&hook, HF_DEFAULT, mask, key, &arg);
+    for (i = 0; i < N; ++i)
+    {
+        if (!!filtered[i] != ((entries[i].mask == 0
+                        || (entries[i].mask & mask) != 0)
+                    && (entries[i].key == 0 || key == 0
+                        || entries[i].key == key)))
+            return FAIL;
+        count += !!filtered[i];
+
+        /* higher priority first, or added first. */
+        for (j = 0; j < i && filtered[i]; ++j)
+            if (filtered[j] && (entries[j].priority < entries[i].priority)
+                    != (filtered[j] > filtered[i]))
+                return FAIL;
+    }
+    return count == arg ? OK : FAIL;
+}
+
+/* check the entries called are the entries in the list. */
+static int check(int flags, int expect_count)
+{
+    struct list_entry *iter;
+    int arg = 0, i = 0;
+
+    ncalled = 0;
+    hook_call(&hook, flags, &arg);
+    if (ncalled != expect_count || arg != ncalled)
+        return FAIL;
+    list_for_each(iter, &list)
+    {
+        if (i == ncalled)
+            break;
+        if (called[i++] != (HOOK_ENTRY(iter) == &extra ? N
+                    : (int)(HOOK_ENTRY(iter) - entries)))
+            return FAIL;
+    }
+    return i == ncalled ? OK : FAIL;
+}
+
+static int run(void)
+{
+    int i, arg = 0;
+
+    hook_init(&hook, &list);
+    if (hook_call(&hook, HF_DEFAULT, &arg) != OK || arg != 0)
+        return FAIL;
+    for (i = 0; i < N; ++i)
+    {
+        entries[i].hook_func = record;
+        if (hook_add(&hook, &entries[i]) == FAIL
+                || check(HF_DEFAULT, i + 1) == FAIL)
+            return FAIL;
+    }
+    extra.hook_func = record;
+
+    /* break, unless forced. */
+    breaker = 10;
+    if (check(HF_DEFAULT, 11) == FAIL || check(HF_FORCE, N) == FAIL)
+        return FAIL;
+    breaker = -1;
+
+    /* remove the odd entries. */
+    for (i = 1; i < N; i += 2)
+        hook_remove(&hook, &entries[i]);
+    if (check(HF_DEFAULT, N / 2) == FAIL)
+        return FAIL;
+
+    /* a call sees the entries when it started. */
+    changer = 4;
+    ncalled = 0;
+    hook_call(&hook, HF_DEFAULT, &arg);
+    if (ncalled != N / 2 || hook.retired != NULL
+            || check(HF_DEFAULT, N / 2) == FAIL
+            || called[N / 2 - 1] != N || called[2] != 6)
+        return FAIL;
+
+    /* change the list directly. */
+    list_remove(&extra.node);
+    list_append(&list, &entries[1].node);
+    if (hook_update(&hook) == FAIL || check(HF_DEFAULT, N / 2) == FAIL
+            || called[0] != 1)
+        return FAIL;
+
+    /* the list is walked without chain. */
+    hook_drop(&hook);
+    if (hook.chain != NULL || check(HF_DEFAULT, N / 2) == FAIL)
+        return FAIL;
+
+    /* priorities and filters. */
+    hook_init(&hook, &list);
+    for (i = 0; i < N; ++i)
+    {
+        entries[i].hook_func = record_filter;
+        entries[i].priority = i % 7 % 4;
+        entries[i].mask = i % 4 == 0 ? 0 : 1UL << i % 3;
+        entries[i].key = i % 5 == 0 ? 0 : i % 3 + 1;
+        hook_add(&hook, &entries[i]);
+    }
+    for (i = 0; i < 2; ++i)
+    {
+        if (check_filter(HOOK_MASK_ALL, 0) == FAIL
+                || check_filter(1, 0) == FAIL
+                || check_filter(6, 0) == FAIL
+                || check_filter(2, 2) == FAIL
+                || check_filter(HOOK_MASK_ALL, 3) == FAIL
+                || check_filter(8, 1) == FAIL
+                || check_filter(0, 0) == FAIL
+                || check_filter(0, 2) == FAIL)
+            return FAIL;
+        hook_drop(&hook);
+    }
+    return OK;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("hook mismatch\n");
+        return 1;
+    }
+
+    printf("hook ok\n");
+    return 0;
+}
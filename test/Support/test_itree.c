@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <Support/itree.h>
+#include "../test.h"
+
+#define N 2000
+#define SIZE 20000
+
+/* the model: the interval of every entry, if it's in the tree. */
+static struct itree_entry entries[N];
+static size_t starts[N], ends[N];
+static int used[N];
+static int found[N];
+
+/* check a subtree, return its max end, or -1 if it's broken. */
+static long check_node(struct sbtree_entry *node, size_t start,
+        size_t low)
+{
+    struct itree_entry *entry = ITREE_NODE(node);
+    long max_end = (long)(start + entry->len), end;
+    size_t i = (size_t)(entry - entries);
+
+    if (start < low || !used[i] || start != starts[i]
+            || start + entry->len != ends[i]
+            || node->size != node->left->size + node->right->size + 1
+            || (node->left != &sbtree_nil && node->left->parent != node)
+            || (node->right != &sbtree_nil && node->right->parent != node))
+        return -1;
+    if (node->left != &sbtree_nil)
+    {
+        if ((end = check_node(node->left, start
+                        + ITREE_NODE(node->left)->off, low)) < 0)
+            return -1;
+        if (end > max_end)
+            max_end = end;
+    }
+    if (node->right != &sbtree_nil)
+    {
+        if ((end = check_node(node->right, start
+                        + ITREE_NODE(node->right)->off, start)) < 0)
+            return -1;
+        if (end > max_end)
+            max_end = end;
+    }
+    return max_end == (long)start + entry->max_end ? max_end : -1;
+}
+
+/* check the intervals found are the same as the model. */
+static int check_overlap(struct itree *tree, size_t low, size_t high)
+{
+    struct itree_iter it;
+    size_t i, count = 0, last = 0;
+
+    memset(found, 0, sizeof(found));
+    for (itree_overlap(tree, low, high, &it); it.node != &sbtree_nil;
+            itree_overlap_next(&it))
+    {
+        i = (size_t)(itree_iter_entry(&it) - entries);
+        if (found[i] || it.start < last || it.start != starts[i])
+            return FAIL;
+        found[i] = TRUE;
+        last = it.start;
+        ++count;
+    }
+
+    for (i = 0; i < N; ++i)
+        if (used[i] && starts[i] < high && ends[i] > low)
+        {
+            if (!found[i])
+                return FAIL;
+            --count;
+        }
+    return count == 0 ? OK : FAIL;
+}
+
+static int check(struct itree *tree, size_t count)
+{
+    size_t i, low;
+
+    if (itree_size(tree) != count || (tree->root != &sbtree_nil
+                && (tree->root->parent != &sbtree_nil
+                    || check_node(tree->root,
+                        (size_t)ITREE_NODE(tree->root)->off, 0) < 0)))
+        return FAIL;
+    for (i = 0; i < N; ++i)
+        if (used[i] && (itree_start(&entries[i]) != starts[i]
+                    || itree_end(&entries[i]) != ends[i]))
+            return FAIL;
+
+    for (i = 0; i < 20; ++i)
+    {
+        low = test_rand() % SIZE;
+        if (check_overlap(tree, low, low + test_rand() % 500) == FAIL
+                || check_overlap(tree, low, low) == FAIL)
+            return FAIL;
+    }
+    return OK;
+}
+
+/* adjust the model, see itree_adjust(). */
+static void model_adjust(size_t pos, size_t del, size_t ins)
+{
+    size_t i;
+
+    for (i = 0; i < N; ++i)
+    {
+        if (!used[i])
+            continue;
+        if (starts[i] < pos)
+        {
+            if (ends[i] > pos)
+                ends[i] = ends[i] >= pos + del ? ends[i] - del + ins : pos;
+        }
+        else if (starts[i] >= pos + del)
+        {
+            starts[i] = starts[i] - del + ins;
+            ends[i] = ends[i] - del + ins;
+        }
+        else
+        {
+            starts[i] = pos + ins;
+            ends[i] = ends[i] >= pos + del ? ends[i] - del + ins : pos + ins;
+        }
+    }
+}
+
+static int run(void)
+{
+    struct itree tree = ITREE_INIT;
+    size_t i, k, count = 0, pos, del, ins;
+    unsigned long op;
+
+    itree_init(&tree);
+    for (i = 0; i < 100000; ++i)
+    {
+        op = test_rand() % 16;
+        k = test_rand() % N;
+
+        if (op < 6 && !used[k])
+        {
+            starts[k] = test_rand() % SIZE;
+            ends[k] = starts[k] + (op == 0 ? 0 : test_rand() % 300);
+            used[k] = TRUE;
+            ++count;
+            itree_insert(&tree, &entries[k], starts[k], ends[k]);
+        }
+        else if (op < 9 && used[k])
+        {
+            itree_remove(&tree, &entries[k]);
+            used[k] = FALSE;
+            --count;
+        }
+        else if (op < 10 && used[k])
+        {
+            ends[k] = starts[k] + test_rand() % 300;
+            itree_set_end(&entries[k], ends[k]);
+        }
+        else if (op >= 10)
+        {
+            /* insert, delete or replace text. */
+            pos = test_rand() % SIZE;
+            del = op < 12 ? 0 : test_rand() % (op < 15 ? 50 : 2000);
+            ins = op >= 12 && op < 14 ? 0 : test_rand() % 60;
+            if (test_rand() % 8 == 0 && count != 0)
+            {
+                /* at the edge of a interval. */
+                for (k = test_rand() % N; !used[k]; k = (k + 1) % N)
+                    ;
+                pos = test_rand() % 2 ? starts[k] : ends[k];
+            }
+            model_adjust(pos, del, ins);
+            itree_adjust(&tree, pos, del, ins);
+        }
+
+        if (i % 1000 == 0 && check(&tree, count) == FAIL)
+            return FAIL;
+    }
+    if (check(&tree, count) == FAIL)
+        return FAIL;
+
+    /* move all intervals, then remove them. */
+    itree_shift(&tree, 0, 100);
+    for (i = 0; i < N; ++i)
+        if (used[i])
+        {
+            starts[i] += 100;
+            ends[i] += 100;
+        }
+    if (check(&tree, count) == FAIL)
+        return FAIL;
+    for (i = 0; i < N; ++i)
+        if (used[i])
+        {
+            itree_remove(&tree, &entries[i]);
+            used[i] = FALSE;
+            --count;
+        }
+    return check(&tree, count) == OK && tree.root == &sbtree_nil
+        ? OK : FAIL;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("itree mismatch\n");
+        return 1;
+    }
+
+    printf("itree ok\n");
+    return 0;
+}
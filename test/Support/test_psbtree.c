@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <Support/psbtree.h>
+#include "../test.h"
+
+struct node
+{
+    struct psbtree_entry entry;
+    int key;
+};
+
+#define NODE(ptr) PSBTREE_ENTRY(ptr, struct node, entry)
+
+#define KEYS 3000
+#define SNAPSHOTS 8
+
+/* a snapshot and the keys in it, in order. */
+struct version
+{
+    struct psbtree_entry *root;
+    int keys[KEYS];
+    size_t count;
+};
+
+static struct version versions[SNAPSHOTS];
+static struct version cur;
+
+static long live = 0;       /* the nodes not freed. */
+static long copy_fail = 0;  /* fail every copy_fail copies if not 0. */
+static long copies = 0;
+
+static struct psbtree_entry *node_copy(struct psbtree_entry const *node)
+{
+    struct node *copy;
+
+    if (copy_fail != 0 && ++copies % copy_fail == 0)
+        return NULL;
+    if ((copy = malloc(sizeof(struct node))) == NULL)
+        return NULL;
+    *copy = *NODE(node);
+    ++live;
+    return &copy->entry;
+}
+
+static void node_free(struct psbtree_entry *node)
+{
+    --live;
+    free(NODE(node));
+}
+
+static struct psbtree_ops const node_ops = {node_copy, node_free};
+
+static int node_cmp(struct psbtree_entry const *node, void const *key)
+{
+    return NODE(node)->key - *(int const*)key;
+}
+
+/* check the sizes and balance of a subtree, return its height. */
+static int check_node(struct psbtree_entry *node)
+{
+    int left, right;
+
+    if (node == &psbtree_nil)
+        return 0;
+    if (node->ref == 0
+            || node->size != node->left->size + node->right->size + 1)
+        return -1;
+    if ((left = check_node(node->left)) < 0
+            || (right = check_node(node->right)) < 0)
+        return -1;
+    return (left > right ? left : right) + 1;
+}
+
+/* check a version of the tree against its keys. */
+static int check(struct version *ver)
+{
+    struct psbtree_iter it;
+    struct psbtree_entry *node;
+    size_t i = 0;
+
+    if (check_node(ver->root) < 0 || ver->root->size != ver->count)
+        return FAIL;
+    for (node = psbtree_iter_init(&it, ver->root); node != &psbtree_nil;
+            node = psbtree_iter_next(&it), ++i)
+        if (i >= ver->count || NODE(node)->key != ver->keys[i])
+            return FAIL;
+    if (i != ver->count)
+        return FAIL;
+
+    if (ver->count != 0)
+    {
+        i = test_rand() % ver->count;
+        node = psbtree_select(ver->root, i);
+        if (NODE(node)->key != ver->keys[i]
+                || psbtree_rank(ver->root, &ver->keys[i], node_cmp) > i
+                || psbtree_lookup(ver->root, &ver->keys[i], node_cmp)
+                    == &psbtree_nil)
+            return FAIL;
+    }
+    return OK;
+}
+
+static void model_insert(struct version *ver, int key)
+{
+    size_t i = ver->count;
+
+    while (i > 0 && ver->keys[i - 1] > key)
+    {
+        ver->keys[i] = ver->keys[i - 1];
+        --i;
+    }
+    ver->keys[i] = key;
+    ++ver->count;
+}
+
+static int model_remove(struct version *ver, int key)
+{
+    size_t i;
+
+    for (i = 0; i < ver->count; ++i)
+        if (ver->keys[i] == key)
+        {
+            memmove(&ver->keys[i], &ver->keys[i + 1],
+                    (--ver->count - i) * sizeof(int));
+            return OK;
+        }
+    return FAIL;
+}
+
+static int run(void)
+{
+    struct node *node;
+    size_t i, k;
+    int key;
+
+    cur.root = &psbtree_nil;
+    cur.count = 0;
+    for (k = 0; k < SNAPSHOTS; ++k)
+        versions[k].root = NULL;
+
+    for (i = 0; i < 100000; ++i)
+    {
+        key = (int)(test_rand() % (KEYS * 2));
+        copy_fail = i % 3 == 0 ? 7 : 0;
+
+        if (test_rand() % 3 != 0 && cur.count < KEYS)
+        {
+            if ((node = malloc(sizeof(struct node))) == NULL)
+                return FAIL;
+            ++live;
+            node->key = key;
+            if (psbtree_insert(&cur.root, &node->entry, &key, node_cmp,
+                        &node_ops) != NULL)
+                model_insert(&cur, key);
+            else
+                node_free(&node->entry);
+        }
+        else if (psbtree_remove(&cur.root, &key, node_cmp, &node_ops) == OK
+                && model_remove(&cur, key) == FAIL)
+            return FAIL;
+
+        /* take a snapshot, or drop one. */
+        if (i % 97 == 0)
+        {
+            k = test_rand() % SNAPSHOTS;
+            if (versions[k].root != NULL)
+            {
+                if (check(&versions[k]) == FAIL)
+                    return FAIL;
+                psbtree_release(versions[k].root, &node_ops);
+            }
+            versions[k] = cur;
+            psbtree_retain(cur.root);
+        }
+
+        if (i % 1000 == 0 && check(&cur) == FAIL)
+            return FAIL;
+    }
+
+    copy_fail = 0;
+    for (k = 0; k < SNAPSHOTS; ++k)
+        if (versions[k].root != NULL)
+        {
+            if (check(&versions[k]) == FAIL)
+                return FAIL;
+            psbtree_release(versions[k].root, &node_ops);
+        }
+    if (check(&cur) == FAIL)
+        return FAIL;
+
+    /* nodes not shared are changed in place, no copies. */
+    copies = 0;
+    copy_fail = 1;
+    key = cur.keys[cur.count / 2];
+    if (psbtree_remove(&cur.root, &key, node_cmp, &node_ops) == FAIL
+            || model_remove(&cur, key) == FAIL || check(&cur) == FAIL)
+        return FAIL;
+
+    psbtree_release(cur.root, &node_ops);
+    return live == 0 ? OK : FAIL;
+}
+
+int main(void)
+{
+    if (run() == FAIL)
+    {
+        printf("psbtree mismatch\n");
+        return 1;
+    }
+
+    printf("psbtree ok\n");
+    return 0;
+}
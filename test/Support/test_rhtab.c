@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <Support/rhtab.h>
+#include "../test.h"
+
+struct node
+{
+    struct hash_entry entry;
+    char name[16];
+};
+
+#define N 2000
+#define COLLIDE 600
+
+static struct node nodes[N];
+static int present[N];
+
+static int node_cmp(void const *lhs, void const *rhs)
+{
+    return strcmp(lhs, rhs);
+}
+
+/* check every key, and the Robin Hood order of every slot. */
+static int check(struct rh_hashtable *rhtab, hash_t (*hash)(int))
+{
+    size_t i, count = 0;
+
+    for (i = 0; i < N; ++i)
+    {
+        struct hash_entry *found = rht_get(rhtab, nodes[i].name,
+                hash(i), node_cmp);
+        if (found != (present[i] ? &nodes[i].entry : NULL))
+            return FAIL;
+        count += present[i];
+    }
+
+    for (i = 0; i < rhtab->capacity; ++i)
+    {
+        size_t next = (i + 1) & (rhtab->capacity - 1);
+        if (rhtab->meta[next] != 0
+                && rht_slot_dist(rhtab, next) > rht_slot_dist(rhtab, i) + 1)
+            return FAIL;
+    }
+
+    return count == rhtab->size ? OK : FAIL;
+}
+
+static hash_t plain_hash(int i)
+{
+    return ht_default_hash(nodes[i].name);
+}
+
+/* the first COLLIDE keys share a hash value, to make far slots. */
+static hash_t collide_hash(int i)
+{
+    return i < COLLIDE ? 42 : ht_default_hash(nodes[i].name);
+}
+
+static int run(hash_t (*hash)(int))
+{
+    struct rh_hashtable rhtab = RH_HASHTABLE_INIT;
+    int i, k;
+
+    rht_init(&rhtab);
+    memset(present, 0, sizeof(present));
+    for (i = 0; i < 20000; ++i)
+    {
+        k = test_rand() % N;
+        if (test_rand() % 3 != 0)
+        {
+            nodes[k].entry.hash = hash(k);
+            if (rht_set(&rhtab, &nodes[k].entry, node_cmp)
+                    != &nodes[k].entry)
+                return FAIL;
+            present[k] = 1;
+        }
+        else
+        {
+            size_t slot = rht_find(&rhtab, nodes[k].name, hash(k),
+                    node_cmp);
+            if ((slot != RHT_NPOS) != present[k]
+                    || (slot != RHT_NPOS
+                        && rht_del(&rhtab, slot) != &nodes[k].entry))
+                return FAIL;
+            present[k] = 0;
+        }
+        if (i % 1000 == 0 && check(&rhtab, hash) == FAIL)
+            return FAIL;
+    }
+    if (check(&rhtab, hash) == FAIL)
+        return FAIL;
+
+    rht_clear(&rhtab);
+    memset(present, 0, sizeof(present));
+    if (check(&rhtab, hash) == FAIL)
+        return FAIL;
+    rht_drop(&rhtab);
+    return OK;
+}
+
+int main(void)
+{
+    struct rh_hashtable rhtab = RH_HASHTABLE_INIT;
+    int i;
+
+    for (i = 0; i < N; ++i)
+    {
+        sprintf(nodes[i].name, "key%d", i);
+        nodes[i].entry.key = nodes[i].name;
+    }
+
+    if (run(plain_hash) == FAIL || run(collide_hash) == FAIL)
+    {
+        printf("rhtab mismatch\n");
+        return 1;
+    }
+
+    /* the default routines. */
+    rht_init(&rhtab);
+    if (rht_insert(&rhtab, &nodes[0].entry) != &nodes[0].entry
+            || rht_insert(&rhtab, &nodes[1].entry) != &nodes[1].entry
+            || rht_insert(&rhtab, &nodes[0].entry) != &nodes[0].entry
+            || rht_lookup(&rhtab, "key1") != &nodes[1].entry
+            || rht_remove(&rhtab, "key1") != &nodes[1].entry
+            || rht_lookup(&rhtab, "key1") != NULL
+            || rht_remove(&rhtab, "key1") != NULL
+            || rhtab.size != 1)
+    {
+        printf("rhtab default routines failed\n");
+        return 1;
+    }
+    rht_drop(&rhtab);
+
+    printf("rhtab ok\n");
+    return 0;
+}
@@ -0,0 +1,468 @@
+#include <stdio.h>
+#include <Support/sbtree.h>
+
+struct node
+{
+    struct sbtree_entry entry;
+    int key;
+    int sum;
+};
+
+#define N 3000
+#define EXTRA 200
+#define NODE(ptr) SBTREE_ENTRY(ptr, struct node, entry)
+
+static struct node nodes[N];
+static struct sbtree_entry *ptrs[N];
+static struct node extra[EXTRA];
+
+static int node_cmp(struct sbtree_entry const *node, void const *key)
+{
+    return NODE(node)->key - *(int const*)key;
+}
+
+static int node_order(struct sbtree_entry const *lhs,
+        struct sbtree_entry const *rhs)
+{
+    return NODE(lhs)->key - NODE(rhs)->key;
+}
+
+static void node_update(struct sbtree_entry *node)
+{
+    NODE(node)->sum = NODE(node)->key
+        + (node->left == &sbtree_nil ? 0 : NODE(node->left)->sum)
+        + (node->right == &sbtree_nil ? 0 : NODE(node->right)->sum);
+}
+
+/* check the links, sizes and the balance of a subtree. */
+static int check_node(struct sbtree_entry *node, int aug)
+{
+    if (node == &sbtree_nil)
+        return OK;
+    if ((node->left != &sbtree_nil && node->left->parent != node)
+            || (node->right != &sbtree_nil && node->right->parent != node)
+            || node->size != node->left->size + node->right->size + 1
+            || node->left->left->size > node->right->size
+            || node->left->right->size > node->right->size
+            || node->right->right->size > node->left->size
+            || node->right->left->size > node->left->size)
+        return FAIL;
+    if (aug)
+    {
+        int sum = NODE(node)->sum;
+        node_update(node);
+        if (sum != NODE(node)->sum)
+            return FAIL;
+    }
+    if (check_node(node->left, aug) == FAIL)
+        return FAIL;
+    return check_node(node->right, aug);
+}
+
+/* check the tree, and the keys are in order. */
+static int check(struct sbtree_entry *root, size_t count, int aug)
+{
+    struct sbtree_entry *node, *next;
+    size_t i = 0;
+
+    if (root->parent != &sbtree_nil || root->size != count
+            || check_node(root, aug) == FAIL)
+        return FAIL;
+
+    if (root == &sbtree_nil)
+        return OK;
+    for (node = sbtree_get_min(root); (next = sbtree_get_succ(node))
+            != &sbtree_nil; node = next, ++i)
+        if (node_order(node, next) > 0)
+            return FAIL;
+    return i + 1 == count ? OK : FAIL;
+}
+
+static int check_build(size_t count)
+{
+    struct sbtree_entry *root, *head;
+    size_t i;
+
+    for (i = 0; i < count; ++i)
+    {
+        sbtree_init(&nodes[i].entry);
+        nodes[i].key = (int)i;
+        ptrs[i] = &nodes[i].entry;
+    }
+
+    root = sbtree_build(ptrs, count);
+    if (check(root, count, FALSE) == FAIL
+            || (count != 0 && sbtree_select(root, (int)count / 3)
+                != &nodes[count / 3].entry))
+        return FAIL;
+
+    /* flatten and build again, a node is left in the list. */
+    head = sbtree_flatten(root);
+    if (count != 0 && (root = sbtree_build_list(&head, count - 1),
+                head != &nodes[count - 1].entry
+                || check(root, count - 1, FALSE) == FAIL))
+        return FAIL;
+
+    root = sbtree_aug_build(ptrs, count, node_update);
+    if (check(root, count, TRUE) == FAIL
+            || (count != 0 && NODE(root)->sum
+                != (int)(count * (count - 1) / 2)))
+        return FAIL;
+    return OK;
+}
+
+/*
+ * the pieces of text, the summary is the bytes, newlines and the max
+ * line length in subtree.
+ */
+struct piece
+{
+    struct sbtree_entry entry;
+    int len, lines, width;
+    int bytes, nl, max_width;
+};
+
+#define PIECE(ptr) SBTREE_ENTRY(ptr, struct piece, entry)
+#define PIECES 2000
+
+static struct piece pieces[2][PIECES];
+static int order[PIECES];
+
+static void piece_update(struct sbtree_entry *node)
+{
+    struct piece *piece = PIECE(node), *child;
+
+    piece->bytes = piece->len;
+    piece->nl = piece->lines;
+    piece->max_width = piece->width;
+    if (node->left != &sbtree_nil)
+    {
+        child = PIECE(node->left);
+        piece->bytes += child->bytes;
+        piece->nl += child->nl;
+        if (child->max_width > piece->max_width)
+            piece->max_width = child->max_width;
+    }
+    if (node->right != &sbtree_nil)
+    {
+        child = PIECE(node->right);
+        piece->bytes += child->bytes;
+        piece->nl += child->nl;
+        if (child->max_width > piece->max_width)
+            piece->max_width = child->max_width;
+    }
+}
+
+DEFINE_SBTREE_AUG_ROUTINES(piece, piece_update)
+
+/*
+ * check the links and sizes of a subtree, remove doesn't maintain the
+ * tree, so the balance is not checked.
+ */
+static int check_links(struct sbtree_entry *node)
+{
+    if (node == &sbtree_nil)
+        return OK;
+    if ((node->left != &sbtree_nil && node->left->parent != node)
+            || (node->right != &sbtree_nil && node->right->parent != node)
+            || node->size != node->left->size + node->right->size + 1
+            || check_links(node->left) == FAIL)
+        return FAIL;
+    return check_links(node->right);
+}
+
+/* check the summary of all nodes in a subtree. */
+static int check_piece(struct sbtree_entry *node)
+{
+    struct piece old;
+
+    if (node == &sbtree_nil)
+        return OK;
+    old = *PIECE(node);
+    piece_update(node);
+    if (old.bytes != PIECE(node)->bytes || old.nl != PIECE(node)->nl
+            || old.max_width != PIECE(node)->max_width)
+        return FAIL;
+    if (check_piece(node->left) == FAIL)
+        return FAIL;
+    return check_piece(node->right);
+}
+
+/* find the piece contains byte offset, in O(log n). */
+static struct sbtree_entry *piece_find(struct sbtree_entry *node, int off)
+{
+    int left;
+
+    while (node != &sbtree_nil)
+    {
+        left = node->left == &sbtree_nil ? 0 : PIECE(node->left)->bytes;
+        if (off < left)
+            node = node->left;
+        else if ((off -= left) < PIECE(node)->len)
+            return node;
+        else
+        {
+            off -= PIECE(node)->len;
+            node = node->right;
+        }
+    }
+    return node;
+}
+
+/* check the trees with generated and callback routines. */
+static int check_pieces(struct sbtree_entry **roots, size_t count)
+{
+    struct sbtree_entry *node;
+    size_t i, t;
+    int off = 0, nl = 0, width = 0;
+
+    for (t = 0; t < 2; ++t)
+    {
+        if (check_links(roots[t]) == FAIL || roots[t]->size != count
+                || check_piece(roots[t]) == FAIL)
+            return FAIL;
+        node = count == 0 ? &sbtree_nil : sbtree_get_min(roots[t]);
+        for (i = 0; i < count; ++i, node = sbtree_get_succ(node))
+            if (node != &pieces[t][order[i]].entry)
+                return FAIL;
+    }
+    if (count == 0)
+        return OK;
+
+    for (i = 0; i < count; ++i)
+    {
+        struct piece *piece = &pieces[0][order[i]];
+
+        if (piece_find(roots[0], off + piece->len / 2) != &piece->entry)
+            return FAIL;
+        off += piece->len;
+        nl += piece->lines;
+        if (piece->width > width)
+            width = piece->width;
+    }
+    return PIECE(roots[0])->bytes == off && PIECE(roots[0])->nl == nl
+        && PIECE(roots[0])->max_width == width
+        && piece_find(roots[0], off) == &sbtree_nil ? OK : FAIL;
+}
+
+static int check_aug(void)
+{
+    struct sbtree_entry *roots[2] = {&sbtree_nil, &sbtree_nil};
+    struct sbtree_entry *pos[2];
+    size_t i, k, count = 0;
+    int t, after;
+
+    for (i = 0; i < PIECES; ++i)
+        for (t = 0; t < 2; ++t)
+        {
+            pieces[t][i].len = (int)(i * 7 % 13) + 1;
+            pieces[t][i].lines = (int)(i % 3);
+            pieces[t][i].width = (int)(i * 31 % 101);
+        }
+
+    /* link the pieces at random position, and remove some. */
+    for (i = 0; i < PIECES; ++i)
+    {
+        k = count == 0 ? 0 : i * 17 % count;
+        after = i % 2;
+        for (t = 0; t < 2; ++t)
+        {
+            pos[t] = count == 0 ? &sbtree_nil
+                : &pieces[t][order[k]].entry;
+            sbtree_init(&pieces[t][i].entry);
+            piece_update(&pieces[t][i].entry);
+        }
+        piece_link(&roots[0], pos[0], &pieces[0][i].entry, after);
+        sbtree_aug_link(&roots[1], pos[1], &pieces[1][i].entry, after,
+                piece_update);
+
+        if (count != 0 && after)
+            ++k;
+        memmove(&order[k + 1], &order[k], (count - k) * sizeof(int));
+        order[k] = (int)i;
+        ++count;
+
+        if (i % 3 == 2)
+        {
+            k = i * 13 % count;
+            piece_remove(&roots[0], &pieces[0][order[k]].entry);
+            sbtree_aug_remove(&roots[1], &pieces[1][order[k]].entry,
+                    piece_update);
+            --count;
+            memmove(&order[k], &order[k + 1], (count - k) * sizeof(int));
+        }
+
+        /* change the data of a piece. */
+        if (i % 5 == 0)
+        {
+            k = order[i * 11 % count];
+            for (t = 0; t < 2; ++t)
+                pieces[t][k].width += 50;
+            piece_propagate(&pieces[0][k].entry);
+            sbtree_aug_propagate(&pieces[1][k].entry, piece_update);
+        }
+
+        if (i % 100 == 0 && check_pieces(roots, count) == FAIL)
+            return FAIL;
+    }
+    if (check_pieces(roots, count) == FAIL)
+        return FAIL;
+
+    /* build from the order, the same as linked. */
+    for (i = 0; i < count; ++i)
+    {
+        sbtree_init(&pieces[0][order[i]].entry);
+        piece_update(&pieces[0][order[i]].entry);
+        ptrs[i] = &pieces[0][order[i]].entry;
+    }
+    roots[0] = piece_build(ptrs, count);
+    return check_pieces(roots, count);
+}
+
+/* the intervals ordered by start, the summary is the max end. */
+struct span
+{
+    struct sbtree_entry entry;
+    int start, end;
+    int max_end;
+};
+
+#define SPAN(ptr) SBTREE_ENTRY(ptr, struct span, entry)
+#define SPANS 1000
+
+static struct span spans[SPANS];
+static int removed[SPANS];
+
+static void span_update(struct sbtree_entry *node)
+{
+    struct span *span = SPAN(node);
+
+    span->max_end = span->end;
+    if (node->left != &sbtree_nil && SPAN(node->left)->max_end
+            > span->max_end)
+        span->max_end = SPAN(node->left)->max_end;
+    if (node->right != &sbtree_nil && SPAN(node->right)->max_end
+            > span->max_end)
+        span->max_end = SPAN(node->right)->max_end;
+}
+
+DEFINE_SBTREE_AUG_ROUTINES(span, span_update)
+
+static int span_cmp(struct sbtree_entry const *node, void const *key)
+{
+    return SPAN(node)->start - *(int const*)key;
+}
+
+/* count the intervals contain pos, skip the subtrees end before pos. */
+static int span_stab(struct sbtree_entry *node, int pos)
+{
+    int count = 0;
+
+    while (node != &sbtree_nil && SPAN(node)->max_end > pos)
+    {
+        count += span_stab(node->left, pos);
+        if (SPAN(node)->start > pos)
+            break;
+        count += SPAN(node)->end > pos;
+        node = node->right;
+    }
+    return count;
+}
+
+static int check_span(void)
+{
+    struct sbtree_entry *root = &sbtree_nil;
+    size_t i;
+    int pos, count;
+
+    for (i = 0; i < SPANS; ++i)
+    {
+        spans[i].start = (int)(i * 7919 % 5000);
+        spans[i].end = spans[i].start + (int)(i * 37 % 200) + 1;
+        sbtree_init(&spans[i].entry);
+        span_update(&spans[i].entry);
+        span_insert(&root, &spans[i].entry, &spans[i].start, span_cmp);
+        if (i % 4 == 3)
+        {
+            span_remove(&root, &spans[i / 2].entry);
+            removed[i / 2] = TRUE;
+        }
+    }
+    if (check_links(root) == FAIL)
+        return FAIL;
+
+    for (pos = 0; pos < 5300; pos += 7)
+    {
+        count = 0;
+        for (i = 0; i < SPANS; ++i)
+            if (!removed[i])
+                count += spans[i].start <= pos && pos < spans[i].end;
+        if (span_stab(root, pos) != count)
+            return FAIL;
+    }
+    return OK;
+}
+
+int main(void)
+{
+    struct sbtree_entry *root, *other = &sbtree_nil;
+    size_t i;
+
+    for (i = 0; i < 300; ++i)
+        if (check_build(i) == FAIL)
+        {
+            printf("sbtree build %lu failed\n", (unsigned long)i);
+            return 1;
+        }
+    if (check_build(N) == FAIL)
+    {
+        printf("sbtree build %d failed\n", N);
+        return 1;
+    }
+
+    /* even keys built, odd keys and some duplicates inserted. */
+    for (i = 0; i < N; ++i)
+    {
+        sbtree_init(&nodes[i].entry);
+        nodes[i].key = i < N / 2 ? (int)i * 2 : (int)(i - N / 2) * 3;
+        ptrs[i] = &nodes[i].entry;
+    }
+    root = sbtree_build(ptrs, N / 2);
+    for (i = N / 2; i < N; ++i)
+        sbtree_insert(&other, &nodes[i].entry, &nodes[i].key, node_cmp);
+    if (check(other, N - N / 2, FALSE) == FAIL)
+    {
+        printf("sbtree insert failed\n");
+        return 1;
+    }
+
+    sbtree_merge(&root, other, node_order);
+    if (check(root, N, FALSE) == FAIL)
+    {
+        printf("sbtree merge failed\n");
+        return 1;
+    }
+
+    /* the merged tree can be used as usual. */
+    for (i = 0; i < EXTRA; ++i)
+    {
+        sbtree_init(&extra[i].entry);
+        extra[i].key = (int)(i * 37 % N);
+        sbtree_insert(&root, &extra[i].entry, &extra[i].key, node_cmp);
+    }
+    if (check(root, N + EXTRA, FALSE) == FAIL
+            || sbtree_lookup(root, &extra[7].key, node_cmp) == &sbtree_nil)
+    {
+        printf("sbtree insert after merge failed\n");
+        return 1;
+    }
+
+    if (check_aug() == FAIL || check_span() == FAIL)
+    {
+        printf("sbtree augment failed\n");
+        return 1;
+    }
+
+    printf("sbtree ok\n");
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <System/mem.h>
+
+#define N 10000
+
+static unsigned char *blocks[N];
+
+static int check(size_t size, size_t prealloc)
+{
+    fixed_alloc_t fa = fixed_alloc(size, prealloc);
+    size_t i, k;
+
+    if (fa == NULL)
+        return FAIL;
+
+    for (i = 0; i < N; ++i)
+    {
+        if ((blocks[i] = fixed_acquire(fa)) == NULL
+                || (size_t)blocks[i] % sizeof(void*) != 0
+                || (size % 64 == 0 && (size_t)blocks[i] % 64 != 0))
+            return FAIL;
+        memset(blocks[i], (int)(i & 0xFF), size);
+    }
+
+    /* release the even blocks, they are acquired again first. */
+    for (i = 0; i < N; i += 2)
+        fixed_release(fa, blocks[i]);
+    for (i = 0; i < N; i += 2)
+        blocks[i] = fixed_acquire(fa);
+    for (i = 0; i < N; i += 2)
+        memset(blocks[i], (int)(i & 0xFF), size);
+
+    /* no block is overwritten by others. */
+    for (i = 0; i < N; ++i)
+        for (k = 0; k < size; ++k)
+            if (blocks[i][k] != (i & 0xFF))
+                return FAIL;
+
+    fixed_free(fa);
+    return OK;
+}
+
+static int check_arena(size_t chunk_size)
+{
+    arena_t arena = arena_create(chunk_size);
+    size_t i, k, size, mark = 0;
+
+    if (arena == NULL)
+        return FAIL;
+
+    for (k = 0; k < 3; ++k)
+    {
+        for (i = 0; i < N; ++i)
+        {
+            /* take a mark at the middle, and some big blocks. */
+            if (i == N / 2)
+                mark = arena_mark(arena);
+            size = i % 1000 == 0 ? 20000 : 1 + i % 100;
+            if ((blocks[i] = arena_alloc(arena, size)) == NULL
+                    || (size_t)blocks[i] % sizeof(void*) != 0)
+                return FAIL;
+            memset(blocks[i], (int)(i & 0xFF), size);
+        }
+
+        for (i = 0; i < N; ++i)
+            if (blocks[i][0] != (i & 0xFF))
+                return FAIL;
+
+        /* rewinding to the middle keeps the first half. */
+        arena_rewind(arena, mark);
+        if (arena_mark(arena) != mark)
+            return FAIL;
+        for (i = 0; i < N / 2; ++i)
+            if (blocks[i][0] != (i & 0xFF))
+                return FAIL;
+
+        arena_rewind(arena, 0);
+        if (arena_mark(arena) != 0)
+            return FAIL;
+    }
+
+    arena_destroy(arena);
+    return OK;
+}
+
+static int check_stat(void)
+{
+    static char const tag[] = "test_mem";
+    struct mem_stat stat;
+    arena_t arena;
+    size_t i;
+
+    /* nothing to check if the statistics are compiled out. */
+    if (vime_mem_stat(NULL, &stat) == FAIL)
+        return OK;
+
+    for (i = 0; i < 10; ++i)
+        blocks[i] = vime_malloc_tag(100, tag);
+    if (vime_mem_stat(tag, &stat) != OK || stat.live_count != 10
+            || stat.live_bytes != 1000 || stat.hist[3] != 10)
+        return FAIL;
+
+    blocks[0] = vime_realloc_tag(blocks[0], 1000, tag);
+    for (i = 0; i < 10; ++i)
+        vime_free(blocks[i]);
+    if (vime_mem_stat(tag, &stat) != OK || stat.live_count != 0
+            || stat.peak_bytes != 1900 || stat.allocs != 11)
+        return FAIL;
+
+    /* a zeroed block is counted, too. */
+    blocks[0] = vime_calloc_tag(1000, 100, tag);
+    for (i = 0; i < 100000 && blocks[0] != NULL; ++i)
+        if (blocks[0][i] != 0)
+            return FAIL;
+    if (vime_mem_stat(tag, &stat) != OK || stat.live_bytes != 100000)
+        return FAIL;
+    vime_free(blocks[0]);
+
+    /* big blocks after rewinding to 0 leak no chunk. */
+    if ((arena = arena_create(64)) == NULL)
+        return FAIL;
+    for (i = 0; i < 10; ++i)
+    {
+        arena_rewind(arena, 0);
+        if (arena_alloc(arena, 1000 * (i + 1)) == NULL)
+            return FAIL;
+    }
+    arena_destroy(arena);
+    if (vime_mem_stat("arena", &stat) == OK && stat.live_count != 0)
+        return FAIL;
+
+    return OK;
+}
+
+int main(void)
+{
+    if (check(1, 0) != OK || check(24, 100) != OK
+            || check(1000, 0) != OK || check(48, N) != OK
+            || check(512, 0) != OK || check(128, 3) != OK)
+    {
+        printf("fixed allocator failed\n");
+        return 1;
+    }
+
+    if (check_arena(0) != OK || check_arena(64) != OK)
+    {
+        printf("arena failed\n");
+        return 1;
+    }
+
+    if (check_stat() != OK)
+    {
+        printf("memory statistics failed\n");
+        return 1;
+    }
+
+    printf("mem ok\n");
+    return 0;
+}
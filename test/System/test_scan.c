@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <System/scan.h>
+#include "../test.h"
+
+#define N 4096
+
+static char const *names[] = { "scalar", "sse2", "avx2" };
+
+/* the plain byte-at-a-time UTF-8 checker, used to check kernels. */
+static size_t plain_utf8_valid(unsigned char const *s, size_t len)
+{
+    size_t i = 0, n, k;
+    unsigned long cp;
+
+    while (i < len)
+    {
+        if (s[i] < 0x80)
+        {
+            ++i;
+            continue;
+        }
+        else if ((s[i] & 0xE0) == 0xC0)
+            n = 2, cp = s[i] & 0x1F;
+        else if ((s[i] & 0xF0) == 0xE0)
+            n = 3, cp = s[i] & 0x0F;
+        else if ((s[i] & 0xF8) == 0xF0)
+            n = 4, cp = s[i] & 0x07;
+        else
+            break;
+
+        if (len - i < n)
+            break;
+        for (k = 1; k < n && (s[i + k] & 0xC0) == 0x80; ++k)
+            cp = cp << 6 | (s[i + k] & 0x3F);
+        if (k < n || (n == 2 && cp < 0x80) || (n == 3 && cp < 0x800)
+                || (n == 4 && cp < 0x10000) || cp > 0x10FFFF
+                || (cp >= 0xD800 && cp <= 0xDFFF))
+            break;
+        i += n;
+    }
+
+    return i;
+}
+
+/* fill text with ASCII, newlines, valid and maybe broken UTF-8. */
+static void fill(unsigned char *text, size_t len, int broken)
+{
+    static unsigned char const pieces[][4] = {
+        "\xC3\xA9", "\xE4\xB8\xAD", "\xF0\x9F\x98\x80", "\xED\xA0\x80",
+        "\xC0\xAF", "\xF4\x90\x80\x80", "\xE0\x80\xAF", "\x80",
+    };
+    size_t i = 0, k;
+
+    while (i < len)
+    {
+        unsigned long r = test_rand();
+
+        if (r % 64 == 0)
+        {
+            unsigned char const *p = pieces[r / 64 % (broken ? 8 : 3)];
+            for (k = 0; k < 4 && p[k] != 0 && i < len; ++k)
+                text[i++] = p[k];
+        }
+        else
+            text[i++] = r % 13 == 0 ? '\n' : 'a' + r % 26;
+    }
+}
+
+int main(void)
+{
+    static unsigned char text[N];
+    static size_t lines[N];
+    size_t i, j, k, off, len, nl, cps, valid;
+
+    for (i = 0; i < 2000; ++i)
+    {
+        off = test_rand() % 64;
+        len = test_rand() % (N - off);
+        fill(text, N, i % 2);
+
+        for (nl = cps = 0, k = off; k < off + len; ++k)
+        {
+            if (text[k] == '\n')
+                lines[nl++] = k - off;
+            cps += (text[k] & 0xC0) != 0x80;
+        }
+        lines[nl] = len;
+        valid = plain_utf8_valid(text + off, len);
+
+        for (k = 0; k < sizeof(names) / sizeof(names[0]); ++k)
+        {
+            char const *s = (char const*)text + off;
+
+            if (scan_use(names[k]) != OK)
+                continue;
+
+            for (j = 0; j <= nl; ++j)
+                if (scan_nth_newline(s, len, j + 1) != lines[j])
+                    break;
+
+            if (j <= nl || scan_newlines(s, len) != nl
+                    || scan_utf8_count(s, len) != cps
+                    || scan_utf8_valid(s, len) != valid)
+            {
+                printf("scan kernel %s mismatch at %lu\n",
+                        names[k], (unsigned long)i);
+                return 1;
+            }
+        }
+    }
+
+    printf("scan ok\n");
+    return 0;
+}
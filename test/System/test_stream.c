@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <System/stream.h>
+#include "../test.h"
+
+#define N (1024 * 1024)
+#define NAME "test_stream.tmp"
+
+static char text[N];
+static char copy[N];
+
+/* lines of random length, some longer than the buffer of stream. */
+static void fill(void)
+{
+    size_t i, len;
+
+    for (i = 0; i < N; i += len + 1)
+    {
+        len = test_rand() % 10 == 0 ? test_rand_long() % (3 * STREAM_BUFSIZE)
+            : test_rand() % 100;
+        if (len > N - i - 1)
+            len = N - i - 1;
+        memset(text + i, 'a' + (int)(i % 26), len);
+        text[i + len] = '\n';
+    }
+}
+
+/* write text by pieces of random size. */
+static int write_text(struct stream *s)
+{
+    size_t i, len;
+
+    for (i = 0; i < N; i += len)
+    {
+        len = test_rand() % 5 == 0 ? test_rand_long() % (2 * STREAM_BUFSIZE)
+            : test_rand() % 200;
+        if (len > N - i)
+            len = N - i;
+        if (stream_write(s, text + i, len) == FAIL)
+            return FAIL;
+    }
+    return stream_close(s);
+}
+
+/* parse the lines in place, each line must be the same as text. */
+static int check_lines(struct stream *s)
+{
+    char const *window, *nl;
+    size_t off = 0, len, want = 1;
+
+    while ((window = stream_borrow(s, want, &len)) != NULL)
+    {
+        if ((nl = memchr(window, '\n', len)) == NULL)
+        {
+            /* the last line is not complete, borrow more. */
+            if (stream_eof(s))
+                return FAIL;
+            want = len + 1;
+            continue;
+        }
+
+        len = nl + 1 - window;
+        if (off + len > N || memcmp(window, text + off, len) != 0)
+            return FAIL;
+        off += len;
+        stream_release(s, len);
+        want = 1;
+    }
+
+    if (off != N || !stream_eof(s) || stream_error(s))
+        return FAIL;
+    return stream_close(s);
+}
+
+/* read by stream_read() in pieces of random size. */
+static int check_read(struct stream *s)
+{
+    size_t off = 0, len, n;
+
+    do
+    {
+        len = test_rand_long() % (2 * STREAM_BUFSIZE);
+        n = stream_read(s, copy + off, len < N - off ? len : N - off);
+        off += n;
+    }
+    while (n != 0);
+
+    if (off != N || memcmp(copy, text, N) != 0)
+        return FAIL;
+    return stream_close(s);
+}
+
+/* a stream fails the second write, and writes the others into copy. */
+static size_t copied, writes;
+
+static ssize_t fail_write(struct stream *self, void const *buf, size_t len)
+{
+    if (++writes == 2)
+        return -1;
+    memcpy(copy + copied, buf, len);
+    copied += len;
+    return (ssize_t)len;
+}
+
+static int fail_sync(struct stream *self)
+{
+    return OK;
+}
+
+static int fail_close(struct stream *self)
+{
+    return OK;
+}
+
+static struct stream_ops const fail_ops =
+    { NULL, fail_write, fail_sync, fail_close };
+
+/* no text is written after a failed write, even if the system is ok
+ * again, the text written never has a gap. */
+static int check_error(void)
+{
+    struct stream s;
+    size_t i;
+
+    stream_init(&s, &fail_ops, STREAM_WRITE);
+    for (i = 0; i < 4; ++i)
+        if (stream_write(&s, text, STREAM_BUFSIZE / 2 + 1) == FAIL)
+            break;
+    if (i != 2 || !stream_error(&s) || stream_flush(&s) == OK
+            || stream_sync(&s) == OK || stream_close(&s) == OK)
+        return FAIL;
+    return copied == STREAM_BUFSIZE / 2 + 1 ? OK : FAIL;
+}
+
+/* feed the text through a pipe by a child process. */
+static int open_pipe(struct stream *s, pid_t *pid)
+{
+    struct stream out;
+    int fds[2];
+
+    if (pipe(fds) != 0 || (*pid = fork()) < 0)
+        return FAIL;
+
+    if (*pid == 0)
+    {
+        close(fds[0]);
+        stream_fdopen(&out, fds[1], STREAM_WRITE);
+        _exit(write_text(&out) == OK ? 0 : 1);
+    }
+
+    close(fds[1]);
+    return stream_fdopen(s, fds[0], STREAM_READ);
+}
+
+int main(void)
+{
+    struct stream s;
+    pid_t pid;
+    int status;
+
+    fill();
+
+    if (stream_open(&s, NAME, STREAM_WRITE) == FAIL
+            || write_text(&s) == FAIL)
+    {
+        printf("stream write failed\n");
+        return 1;
+    }
+
+    /* the regular file is mapped. */
+    if (stream_open(&s, NAME, STREAM_READ) == FAIL
+            || s.map.base == NULL || check_lines(&s) == FAIL
+            || stream_open(&s, NAME, STREAM_READ) == FAIL
+            || check_read(&s) == FAIL)
+    {
+        printf("stream of mapped file mismatch\n");
+        unlink(NAME);
+        return 1;
+    }
+
+    /* the file read by read(). */
+    if (stream_fdopen(&s, open(NAME, O_RDONLY), STREAM_READ) == FAIL
+            || check_lines(&s) == FAIL
+            || stream_fdopen(&s, open(NAME, O_RDONLY), STREAM_READ) == FAIL
+            || check_read(&s) == FAIL)
+    {
+        printf("stream of file descriptor mismatch\n");
+        unlink(NAME);
+        return 1;
+    }
+    unlink(NAME);
+
+    if (open_pipe(&s, &pid) == FAIL || check_lines(&s) == FAIL
+            || waitpid(pid, &status, 0) != pid || status != 0
+            || open_pipe(&s, &pid) == FAIL || check_read(&s) == FAIL
+            || waitpid(pid, &status, 0) != pid || status != 0)
+    {
+        printf("stream of pipe mismatch\n");
+        return 1;
+    }
+
+    if (check_error() == FAIL)
+    {
+        printf("stream written after error\n");
+        return 1;
+    }
+
+    printf("stream ok\n");
+    return 0;
+}
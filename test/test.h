@@ -0,0 +1,45 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/**
+ * \file test.h
+ *
+ * the helper routines for VimE test programs.
+ */
+
+
+#ifndef VIME_TEST_H
+#define VIME_TEST_H
+
+
+/** the biggest value returned by test_rand(). */
+#define TEST_RAND_MAX 0x7FFF
+
+/**
+ * a small random generator (the LCG of C standard), tests need
+ * reproducible input, so a failure can be repeated.
+ */
+static unsigned long test_seed = 1;
+
+static inline unsigned long test_rand(void)
+{
+    test_seed = test_seed * 1103515245 + 12345;
+    return (test_seed >> 16) & TEST_RAND_MAX;
+}
+
+
+/**
+ * get a random value of 30 bits, for the ranges bigger than
+ * TEST_RAND_MAX.
+ */
+static inline unsigned long test_rand_long(void)
+{
+    unsigned long high = test_rand();
+
+    return high << 15 | test_rand();
+}
+
+
+#endif /* VIME_TEST_H */
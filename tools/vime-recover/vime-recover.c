@@ -0,0 +1,56 @@
+/*
+ * VimE - the Vim Extensible
+ */
+
+
+/*
+ * vime-recover: recover the text of a buffer from its swapfile, after
+ * VimE crashed. the swapfile is replayed (see Core/swapfile.h), and the
+ * text is written into the output file atomically. the swapfile is
+ * never changed, remove it by hand after the text is checked.
+ *
+ * usage: vime-recover swapfile output
+ */
+
+
+#include <stdio.h>
+#include <Core/swapfile.h>
+
+
+int main(int argc, char **argv)
+{
+    struct memcache mc;
+    size_t count;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s swapfile output\n", argv[0]);
+        return 2;
+    }
+
+    if (mc_init(&mc) == NULL)
+    {
+        fprintf(stderr, "%s: no memory\n", argv[0]);
+        return 1;
+    }
+
+    if (swp_recover(&mc, argv[1], &count) == FAIL)
+    {
+        fprintf(stderr, "%s: can't recover %s, the swapfile or the "
+                "original file is broken or changed\n", argv[0], argv[1]);
+        mc_drop(&mc);
+        return 1;
+    }
+
+    if (mc_save(&mc, argv[2]) == FAIL)
+    {
+        fprintf(stderr, "%s: can't write %s\n", argv[0], argv[2]);
+        mc_drop(&mc);
+        return 1;
+    }
+
+    printf("%lu bytes recovered into %s, %lu changes replayed\n",
+            (unsigned long)mc_size(&mc), argv[2], (unsigned long)count);
+    mc_drop(&mc);
+    return 0;
+}
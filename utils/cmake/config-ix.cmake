@@ -123,7 +123,7 @@ elseif (VIME_ON_UNIX)
 
     check_symbol_exists(__GLIBC__ stdio.h VIME_USING_GLIBC)
     if (VIME_USING_GLIBC)
-	add_llvm_definitions(-D_GNU_SOURCE)
+	add_vime_definitions(-D_GNU_SOURCE)
     endif()
 endif()
 
@@ -153,6 +153,23 @@ int main(void) {
 " HAVE_INLINE)
 
 
+# SIMD checks {{{1
+
+CHECK_C_SOURCE_COMPILES("
+#include <immintrin.h>
+
+__attribute__((target(\"avx2\"))) int func(char const *p) {
+    __m256i v = _mm256_loadu_si256((__m256i const*)p);
+    return _mm256_movemask_epi8(v);
+}
+
+int main(void) {
+    char buf[32] = {0};
+    return __builtin_cpu_supports(\"avx2\") ? func(buf) : 0;
+}
+" HAVE_X86_INTRINSICS)
+
+
 # PIC flags checks {{{1
 include(CheckCCompilerFlag)
 
@@ -210,6 +227,10 @@ add_build_option(ENABLE_ASSERTIONS "Enable assertions"
 add_build_option(ENABLE_INLINE "Enable function inline"
     RELEASE ON BUILD OFF REQUIRE HAVE_INLINE)
 
+# enable allocation statistics in VimE.
+add_build_option(ENABLE_MEMSTAT "Enable allocation statistics"
+    DEFAULT OFF)
+
 
 # add debug flags use ENABLE_ASSERTIONS
 if (ENABLE_ASSERTIONS)
@@ -236,6 +257,9 @@ add_feature_option(ENABLE_GUI "Enable GUI Support."
 add_feature_option(ENABLE_INTL "Enable Multi-Language Support."
     FULL ON BIG ON NORMAL ON MINIAL OFF
     REQUIRE HAVE_LIBINTL_H OR WIN32)
+add_feature_option(ENABLE_SIMD "Enable SIMD Text Scanning."
+    FULL ON BIG ON NORMAL ON MINIAL OFF
+    REQUIRE HAVE_X86_INTRINSICS)
 add_feature_option(ENABLE_ICONV "Enable IConv Support."
     FULL ON BIG ON NORMAL OFF MINIAL OFF
     REQUIRE HAVE_ICONV_H OR WIN32)
@@ -38,12 +38,12 @@ function(get_system_libs OUT_VAR) # {{{1
             if (HAVE_LIBDL)
                 set(system_libs ${system_libs} ${CMAKE_DL_LIBS})
             endif()
-            if (LLVM_ENABLE_THREADS AND HAVE_LIBPTHREAD)
+            if (HAVE_LIBPTHREAD)
                 set(system_libs ${system_libs} pthread)
             endif()
         endif(MINGW)
     endif(NOT MSVC)
-    set(${return_var} ${system_libs} PARENT_SCOPE)
+    set(${OUT_VAR} ${system_libs} PARENT_SCOPE)
 endfunction(get_system_libs)
 
 
@@ -126,5 +126,12 @@ macro(add_vime_example name) # {{{1
     endif()
 endmacro(add_vime_example name)
 
+macro(add_vime_bench name) # {{{1
+    if (NOT VIME_BUILD_BENCH)
+        set(EXCLUDE_FROM_ALL ON)
+    endif()
+    add_vime_executable(${name} ${ARGN})
+endmacro(add_vime_bench name)
+
 # }}}1
 # vim: ft=cmake fdm=marker fdc=2 ts=8 sw=4 sts=4 ai et nu sta: